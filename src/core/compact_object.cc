@@ -25,6 +25,7 @@ extern "C" {
 #include "base/pod_array.h"
 #include "core/bloom.h"
 #include "core/detail/bitpacking.h"
+#include "core/huff_coder.h"
 #include "core/qlist.h"
 #include "core/sorted_map.h"
 #include "core/string_map.h"
@@ -390,6 +391,66 @@ constexpr bool kUseSmallStrings = true;
 /// file and implement with SIMD instructions.
 constexpr bool kUseAsciiEncoding = true;
 
+// Huffman encoded strings are prefixed with their decoded length: a single byte for lengths
+// below 128 and two bytes (little endian, 7 + 8 bits) otherwise.
+constexpr size_t kHuffMaxLen = (1u << 15) - 1;
+
+// The table is loaded once during the startup and is read-only afterwards,
+// therefore it is shared by all threads.
+struct HuffmanState {
+  HuffmanEncoder encoder;
+  HuffmanDecoder decoder;
+};
+
+HuffmanState huff_state;
+
+inline unsigned HuffHeaderLen(size_t decoded_len) {
+  return decoded_len < 128 ? 1 : 2;
+}
+
+inline void WriteHuffHeader(size_t decoded_len, uint8_t* dest) {
+  if (decoded_len < 128) {
+    dest[0] = decoded_len;
+  } else {
+    dest[0] = 0x80 | (decoded_len & 0x7F);
+    dest[1] = decoded_len >> 7;
+  }
+}
+
+inline size_t ReadHuffHeader(const uint8_t* src, unsigned* header_len) {
+  if (src[0] < 128) {
+    *header_len = 1;
+    return src[0];
+  }
+  *header_len = 2;
+  return (src[0] & 0x7F) | (size_t(src[1]) << 7);
+}
+
+// Encodes str into tl.tmp_buf if the encoded blob is shorter than limit.
+bool HuffEncode(string_view str, size_t limit, string_view* encoded) {
+  if (!huff_state.encoder.valid() || str.size() > kHuffMaxLen)
+    return false;
+
+  size_t payload_len = huff_state.encoder.EncodedSize(str);
+  unsigned header_len = HuffHeaderLen(str.size());
+  if (payload_len == 0 || payload_len + header_len >= limit)
+    return false;
+
+  tl.tmp_buf.resize(header_len + HuffmanEncoder::EncodedBound(payload_len));
+  WriteHuffHeader(str.size(), tl.tmp_buf.data());
+
+  uint32_t dest_size = tl.tmp_buf.size() - header_len;
+  string err;
+  if (!huff_state.encoder.Encode(str, tl.tmp_buf.data() + header_len, &dest_size, &err)) {
+    LOG(DFATAL) << "Huffman encoding failed: " << err;
+    return false;
+  }
+  DCHECK_EQ(dest_size, payload_len);
+
+  *encoded = string_view{reinterpret_cast<char*>(tl.tmp_buf.data()), header_len + dest_size};
+  return true;
+}
+
 }  // namespace
 
 static_assert(sizeof(CompactObj) == 18);
@@ -750,6 +811,31 @@ void CompactObj::InitThreadLocal(MemoryResource* mr) {
   tl.tmp_buf = base::PODArray<uint8_t>{mr};
 }
 
+bool CompactObj::InitHuffmanTable(string_view table, string* error_msg) {
+  if (table.empty()) {
+    huff_state.encoder.Reset();
+    huff_state.decoder.Reset();
+    return true;
+  }
+
+  if (!huff_state.encoder.Load(table, error_msg) || !huff_state.decoder.Load(table, error_msg)) {
+    huff_state.encoder.Reset();
+    return false;
+  }
+
+  // We must be able to encode any string, otherwise huffman encoding will be rarely applied.
+  for (unsigned i = 0; i < 256; ++i) {
+    if (huff_state.encoder.BitCount(i) == 0) {
+      *error_msg = absl::StrCat("huffman table does not cover symbol ", i);
+      huff_state.encoder.Reset();
+      huff_state.decoder.Reset();
+      return false;
+    }
+  }
+
+  return true;
+}
+
 CompactObj::~CompactObj() {
   if (HasAllocated()) {
     Free();
@@ -805,6 +891,8 @@ size_t CompactObj::Size() const {
     }
   }
   uint8_t encoded = (mask_ & kEncMask);
+  if (encoded == HUFFMAN_ENC)
+    return HuffDecodedLen();
   return encoded ? DecodedLen(raw_size) : raw_size;
 }
 
@@ -812,6 +900,11 @@ uint64_t CompactObj::HashCode() const {
   DCHECK(taglen_ != JSON_TAG) << "JSON type cannot be used for keys!";
 
   uint8_t encoded = (mask_ & kEncMask);
+  if (encoded == HUFFMAN_ENC) {
+    string_view sv = GetSlice(&tl.tmp_str);
+    return XXH3_64bits_withSeed(sv.data(), sv.size(), kHashSeed);
+  }
+
   if (IsInline()) {
     if (encoded) {
       char buf[kInlineLen * 2];
@@ -848,9 +941,14 @@ uint64_t CompactObj::HashCode(string_view str) {
 }
 
 CompactObjType CompactObj::ObjType() const {
-  if (IsInline() || taglen_ == INT_TAG || taglen_ == SMALL_TAG || taglen_ == EXTERNAL_TAG)
+  if (IsInline() || taglen_ == INT_TAG || taglen_ == SMALL_TAG)
     return OBJ_STRING;
 
+  if (taglen_ == EXTERNAL_TAG) {
+    const auto& ext = u_.ext_ptr;
+    return ext.is_cool ? ext.cool_record->value.ObjType() : ext.offload.obj_type;
+  }
+
   if (taglen_ == ROBJ_TAG)
     return u_.r_obj.type();
 
@@ -1013,6 +1111,12 @@ string_view CompactObj::GetSlice(string* scratch) const {
   CHECK(!IsExternal());
   uint8_t is_encoded = mask_ & kEncMask;
 
+  if (is_encoded == HUFFMAN_ENC) {
+    scratch->resize(HuffDecodedLen());
+    HuffDecode(scratch->data());
+    return *scratch;
+  }
+
   if (IsInline()) {
     if (is_encoded) {
       size_t decoded_len = taglen_ + 2;
@@ -1125,6 +1229,11 @@ void CompactObj::GetString(char* dest) const {
   CHECK(!IsExternal());
   uint8_t is_encoded = mask_ & kEncMask;
 
+  if (is_encoded == HUFFMAN_ENC) {
+    HuffDecode(dest);
+    return;
+  }
+
   if (IsInline()) {
     if (is_encoded) {
       size_t decoded_len = taglen_ + 2;
@@ -1193,12 +1302,16 @@ void CompactObj::GetString(char* dest) const {
 }
 
 void CompactObj::SetExternal(size_t offset, uint32_t sz) {
+  size_t huff_decoded_len = IsHuffmanEncoded() ? HuffDecodedLen() : 0;
+  CompactObjType obj_type = ObjType();
   SetMeta(EXTERNAL_TAG, mask_);
 
   u_.ext_ptr.is_cool = 0;
+  u_.ext_ptr.huff_decoded_len = huff_decoded_len;
   u_.ext_ptr.page_offset = offset % 4096;
   u_.ext_ptr.serialized_size = sz;
   u_.ext_ptr.offload.page_index = offset / 4096;
+  u_.ext_ptr.offload.obj_type = obj_type;
 }
 
 void CompactObj::SetCool(size_t offset, uint32_t sz, detail::TieredColdRecord* record) {
@@ -1206,6 +1319,7 @@ void CompactObj::SetCool(size_t offset, uint32_t sz, detail::TieredColdRecord* r
   SetMeta(EXTERNAL_TAG, record->value.mask_);
 
   u_.ext_ptr.is_cool = 1;
+  u_.ext_ptr.huff_decoded_len = IsHuffmanEncoded() ? record->value.HuffDecodedLen() : 0;
   u_.ext_ptr.page_offset = offset % 4096;
   u_.ext_ptr.serialized_size = sz;
   u_.ext_ptr.cool_record = record;
@@ -1255,6 +1369,15 @@ void CompactObj::Materialize(std::string_view blob, bool is_raw) {
   }
 }
 
+void CompactObj::Materialize(CompactObj&& obj) {
+  CHECK(IsExternal()) << int(taglen_);
+  DCHECK_EQ(ObjType(), obj.ObjType());
+
+  uint8_t mask = mask_ & ~kEncMask;
+  *this = std::move(obj);
+  mask_ = (mask_ & kEncMask) | mask;
+}
+
 void CompactObj::Reset() {
   if (HasAllocated()) {
     Free();
@@ -1360,6 +1483,15 @@ bool CompactObj::EqualNonInline(std::string_view sv) const {
 }
 
 bool CompactObj::CmpEncoded(string_view sv) const {
+  if (IsHuffmanEncoded()) {
+    if (HuffDecodedLen() != sv.size())
+      return false;
+
+    tl.tmp_str.resize(sv.size());
+    HuffDecode(tl.tmp_str.data());
+    return sv == tl.tmp_str;
+  }
+
   size_t encode_len = binpacked_len(sv.size());
 
   if (IsInline()) {
@@ -1441,7 +1573,16 @@ void CompactObj::EncodeString(string_view str) {
   string_view encoded = str;
   bool is_ascii = kUseAsciiEncoding && detail::validate_ascii_fast(str.data(), str.size());
 
-  if (is_ascii) {
+  // Huffman encoding is applied only if it is more compact than ascii packing.
+  if (HuffEncode(str, is_ascii ? binpacked_len(str.size()) : str.size(), &encoded)) {
+    mask |= HUFFMAN_ENC;
+
+    if (encoded.size() <= kInlineLen) {
+      SetMeta(encoded.size(), mask);
+      memcpy(u_.inline_str, encoded.data(), encoded.size());
+      return;
+    }
+  } else if (is_ascii) {
     size_t encode_len = binpacked_len(str.size());
     size_t rev_len = ascii_len(encode_len);
 
@@ -1507,6 +1648,51 @@ size_t CompactObj::DecodedLen(size_t sz) const {
   return ascii_len(sz) - ((mask_ & ASCII1_ENC_BIT) ? 1 : 0);
 }
 
+size_t CompactObj::HuffDecodedLen() const {
+  DCHECK(IsHuffmanEncoded());
+
+  const uint8_t* header = nullptr;
+  if (IsInline()) {
+    header = to_byte(u_.inline_str);
+  } else if (taglen_ == ROBJ_TAG) {
+    header = to_byte(u_.r_obj.inner_obj());
+  } else if (taglen_ == SMALL_TAG) {
+    string_view slices[2];
+    u_.small_str.GetV(slices);
+    DCHECK_GE(slices[0].size(), 2u);  // small string prefix always holds the whole header.
+    header = to_byte(slices[0].data());
+  } else if (taglen_ == EXTERNAL_TAG) {
+    return u_.ext_ptr.huff_decoded_len;
+  } else {
+    LOG(FATAL) << "Unsupported tag " << int(taglen_);
+  }
+
+  unsigned header_len;
+  return ReadHuffHeader(header, &header_len);
+}
+
+void CompactObj::HuffDecode(char* dest) const {
+  DCHECK(IsHuffmanEncoded());
+
+  string tmp;
+  string_view raw;
+  if (IsInline()) {
+    raw = string_view{u_.inline_str, taglen_};
+  } else if (taglen_ == ROBJ_TAG) {
+    raw = u_.r_obj.AsView();
+  } else if (taglen_ == SMALL_TAG) {
+    u_.small_str.Get(&tmp);
+    raw = tmp;
+  } else {
+    LOG(FATAL) << "Unsupported tag " << int(taglen_);
+  }
+
+  unsigned header_len;
+  size_t decoded_len = ReadHuffHeader(to_byte(raw.data()), &header_len);
+  bool res = huff_state.decoder.Decode(raw.substr(header_len), decoded_len, dest);
+  CHECK(res) << "Corrupted huffman encoded string";
+}
+
 MemoryResource* CompactObj::memory_resource() {
   return tl.local_mr;
 }
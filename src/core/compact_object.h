@@ -134,6 +134,8 @@ class CompactObj {
     // therefore, in order to know the original length we introduce 2 flags that
     // correct the length upon decoding. ASCII1_ENC_BIT rounds down the decoded length,
     // while ASCII2_ENC_BIT rounds it up. See DecodedLen implementation for more info.
+    // When both bits are set, the string is encoded with the huffman table loaded via
+    // InitHuffmanTable (see HUFFMAN_ENC).
     ASCII1_ENC_BIT = 8,
     ASCII2_ENC_BIT = 0x10,
 
@@ -154,6 +156,7 @@ class CompactObj {
   };
 
   static constexpr uint8_t kEncMask = ASCII1_ENC_BIT | ASCII2_ENC_BIT;
+  static constexpr uint8_t HUFFMAN_ENC = kEncMask;
 
  public:
   using PrefixArray = std::vector<std::string_view>;
@@ -393,6 +396,11 @@ class CompactObj {
   // Postcondition: The object is an in-memory string.
   void Materialize(std::string_view str, bool is_raw);
 
+  // Replaces the external value with obj, which was deserialized from the external blob.
+  // Preserves all the attributes except the encoding.
+  // Precondition: The object must be in the EXTERNAL state.
+  void Materialize(CompactObj&& obj);
+
   // Returns the approximation of memory used by the object.
   // If slow is true, may use more expensive methods to calculate the precise size.
   size_t MallocUsed(bool slow = false) const;
@@ -417,6 +425,11 @@ class CompactObj {
   static void InitThreadLocal(MemoryResource* mr);
   static MemoryResource* memory_resource();  // thread-local.
 
+  // Loads the huffman table (as exported by HuffmanEncoder::Export) that is used to encode
+  // strings. Empty table disables huffman encoding. Not thread-safe: it must be called before
+  // any string is created, since objects encoded with one table can not be decoded with another.
+  static bool InitHuffmanTable(std::string_view table, std::string* error_msg);
+
   template <typename T, typename... Args> static T* AllocateMR(Args&&... args) {
     void* ptr = memory_resource()->allocate(sizeof(T), alignof(T));
     if constexpr (std::is_constructible_v<T, decltype(memory_resource())> && sizeof...(args) == 0)
@@ -448,6 +461,16 @@ class CompactObj {
   void EncodeString(std::string_view str);
   size_t DecodedLen(size_t sz) const;
 
+  bool IsHuffmanEncoded() const {
+    return (mask_ & kEncMask) == HUFFMAN_ENC;
+  }
+
+  // Precondition: IsHuffmanEncoded() is true.
+  size_t HuffDecodedLen() const;
+
+  // Decodes huffman encoded string into dest that must have at least HuffDecodedLen() bytes.
+  void HuffDecode(char* dest) const;
+
   bool EqualNonInline(std::string_view sv) const;
 
   // Requires: HasAllocated() - true.
@@ -470,13 +493,16 @@ class CompactObj {
     uint32_t serialized_size;
     uint16_t page_offset;  // 0 for multi-page blobs. != 0 for small blobs.
     uint16_t is_cool : 1;
-    uint16_t is_reserved : 15;
+
+    // The decoded length of huffman encoded strings since it can not be derived from
+    // serialized_size. Huffman encoding is limited to strings of upto 32KB.
+    uint16_t huff_decoded_len : 15;
 
     // We do not have enough space in the common area to store page_index together with
     // cool_record pointer. Therefore, we moved this field into TieredColdRecord itself.
     struct Offload {
       uint32_t page_index;
-      uint32_t reserved;
+      uint32_t obj_type;  // the type of the offloaded value.
     };
 
     union {
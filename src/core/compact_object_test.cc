@@ -13,6 +13,7 @@
 #include "base/logging.h"
 #include "core/detail/bitpacking.h"
 #include "core/flat_set.h"
+#include "core/huff_coder.h"
 #include "core/mi_memory_resource.h"
 #include "core/string_set.h"
 
@@ -274,6 +275,52 @@ TEST_F(CompactObjectTest, InlineAsciiEncoded) {
   EXPECT_EQ(s.size(), obj.Size());
 }
 
+TEST_F(CompactObjectTest, HuffmanEncoded) {
+  unsigned hist[256] = {0};
+  string_view sample = "user:session:0123456789abcdef";
+  for (unsigned i = 0; i < 256; ++i) {
+    hist[i] = 1;
+  }
+  for (char c : sample) {
+    hist[uint8_t(c)] += 1000;
+  }
+
+  HuffmanEncoder encoder;
+  string err;
+  ASSERT_TRUE(encoder.Build(hist, 255, &err)) << err;
+  ASSERT_TRUE(CompactObj::InitHuffmanTable(encoder.Export(), &err)) << err;
+
+  for (size_t len : {17u, 22u, 40u, 200u, 1000u, 40000u}) {
+    string s = "user:session:";
+    while (s.size() < len) {
+      absl::StrAppend(&s, s.size() % 10);
+    }
+    s.resize(len);
+
+    CompactObj obj{s};
+    EXPECT_EQ(s.size(), obj.Size());
+    EXPECT_EQ(s, obj);
+    EXPECT_EQ(XXH3_64bits_withSeed(s.data(), s.size(), kSeed), obj.HashCode());
+    EXPECT_EQ(s, obj.ToString());
+    EXPECT_EQ(s, obj.GetSlice(&tmp_));
+    EXPECT_EQ(obj, CompactObj{s});
+
+    string other = s;
+    other.back() = 'x';
+    EXPECT_NE(obj, other);
+    EXPECT_NE(obj, string_view(s).substr(1));
+  }
+
+  // Huffman encoding should be denser than ascii packing for the low entropy strings.
+  string s = "user:session:0000000";
+  CompactObj obj{s};
+  EXPECT_TRUE(obj.IsInline());
+  EXPECT_EQ(s, obj);
+
+  ASSERT_TRUE(CompactObj::InitHuffmanTable("", &err));
+  EXPECT_FALSE(CompactObj::InitHuffmanTable("garbage", &err));
+}
+
 TEST_F(CompactObjectTest, Int) {
   cobj_.SetString("0");
   EXPECT_EQ(0, cobj_.TryGetInt());
@@ -621,6 +668,31 @@ TEST_F(CompactObjectTest, RawInterface) {
   }
 }
 
+TEST_F(CompactObjectTest, ExternalContainer) {
+  auto make_hash = [] {
+    uint8_t* lp = lpNew(0);
+    lp = lpAppend(lp, reinterpret_cast<const uint8_t*>("foo"), 3);
+    lp = lpAppend(lp, reinterpret_cast<const uint8_t*>("barrr"), 5);
+    CompactObj obj;
+    obj.InitRobj(OBJ_HASH, kEncodingListPack, lp);
+    return obj;
+  };
+
+  cobj_ = make_hash();
+  cobj_.SetExpire(true);
+  cobj_.SetExternal(4096, 100);  // dummy external pointer
+
+  EXPECT_TRUE(cobj_.IsExternal());
+  EXPECT_EQ(OBJ_HASH, cobj_.ObjType());
+  EXPECT_EQ(4096u, cobj_.GetExternalSlice().first);
+
+  cobj_.Materialize(make_hash());
+  EXPECT_FALSE(cobj_.IsExternal());
+  EXPECT_EQ(OBJ_HASH, cobj_.ObjType());
+  EXPECT_EQ(1, cobj_.Size());
+  EXPECT_TRUE(cobj_.HasExpire());
+}
+
 TEST_F(CompactObjectTest, lpGetInteger) {
   int64_t val = -1;
   uint8_t* lp = lpNew(0);
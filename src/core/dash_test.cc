@@ -17,6 +17,7 @@
 #include "base/hash.h"
 #include "base/logging.h"
 #include "base/zipf_gen.h"
+#include "core/huge_page_resource.h"
 #include "io/file.h"
 #include "io/line_reader.h"
 
@@ -450,6 +451,33 @@ TEST_F(DashTest, InsertOOM) {
       bad_alloc);
 }
 
+TEST_F(DashTest, HugePages) {
+  HugePageResource resource(PMR_NS::get_default_resource(), false);
+  {
+    Dash64 dt{1, UInt64Policy{}, &resource};
+    for (size_t i = 0; i < 100000; ++i) {
+      dt.Insert(i, i);
+    }
+
+    // All segments are served from the arena, which maps whole huge pages.
+    const auto& stats = resource.stats();
+    EXPECT_GE(stats.used_bytes, dt.GetSegmentCount() * sizeof(Dash64::Segment_t));
+    EXPECT_EQ(0u, stats.fallback_bytes);
+    EXPECT_EQ(0u, stats.mapped_bytes % HugePageResource::kPageSize);
+    EXPECT_GE(stats.mapped_bytes, stats.used_bytes);
+
+    for (size_t i = 0; i < 100000; ++i) {
+      auto it = dt.Find(i);
+      ASSERT_FALSE(it.is_done());
+      ASSERT_EQ(i, it->second);
+    }
+  }
+
+  // Empty pages are returned to the system.
+  EXPECT_EQ(0u, resource.stats().used_bytes);
+  EXPECT_EQ(0u, resource.stats().mapped_bytes);
+}
+
 struct Item {
   char buf[24];
 };
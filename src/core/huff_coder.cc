@@ -0,0 +1,180 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "core/huff_coder.h"
+
+#include <absl/strings/str_cat.h>
+
+#include <cstring>
+
+#include "base/logging.h"
+
+#define HUF_STATIC_LINKING_ONLY
+
+extern "C" {
+#include "huff/huf.h"
+}
+
+namespace dfly {
+
+using namespace std;
+
+namespace {
+
+constexpr unsigned kMaxSymbol = HUF_SYMBOLVALUE_MAX;
+constexpr size_t kCTableSize = HUF_CTABLE_SIZE_ST(kMaxSymbol);
+
+// X1 decoding table, see HUF_CREATE_STATIC_DTABLEX1.
+constexpr size_t kDTableSize = HUF_DTABLE_SIZE(HUF_TABLELOG_MAX - 1);
+constexpr uint32_t kDTableHeader = uint32_t(HUF_TABLELOG_MAX - 1) * 0x01000001;
+
+}  // namespace
+
+HuffmanEncoder::HuffmanEncoder() {
+}
+
+HuffmanEncoder::~HuffmanEncoder() {
+}
+
+bool HuffmanEncoder::Build(const unsigned hist[], unsigned max_symbol, string* error_msg) {
+  CHECK_LE(max_symbol, kMaxSymbol);
+
+  unique_ptr<uint32_t[]> wrkspace(new uint32_t[HUF_CTABLE_WORKSPACE_SIZE_U32]);
+  unique_ptr<size_t[]> ctable(new size_t[kCTableSize]);
+  size_t num_bits = HUF_buildCTable_wksp(ctable.get(), hist, max_symbol, 0, wrkspace.get(),
+                                         HUF_CTABLE_WORKSPACE_SIZE);
+  if (HUF_isError(num_bits)) {
+    *error_msg = HUF_getErrorName(num_bits);
+    return false;
+  }
+
+  huf_ctable_ = std::move(ctable);
+  max_symbol_ = max_symbol;
+  table_max_bits_ = num_bits;
+  InitBitCounts();
+
+  return true;
+}
+
+bool HuffmanEncoder::Load(string_view binary_data, string* error_msg) {
+  unique_ptr<size_t[]> ctable(new size_t[kCTableSize]);
+  unsigned max_symbol = kMaxSymbol;
+  unsigned has_zero_weights = 0;
+
+  size_t res = HUF_readCTable(ctable.get(), &max_symbol, binary_data.data(), binary_data.size(),
+                              &has_zero_weights);
+  if (HUF_isError(res)) {
+    *error_msg = HUF_getErrorName(res);
+    return false;
+  }
+
+  if (res != binary_data.size()) {
+    *error_msg = absl::StrCat("trailing data after huffman table: ", binary_data.size() - res);
+    return false;
+  }
+
+  huf_ctable_ = std::move(ctable);
+  max_symbol_ = max_symbol;
+  table_max_bits_ = HUF_readCTableHeader(huf_ctable_.get()).tableLog;
+  InitBitCounts();
+
+  return true;
+}
+
+string HuffmanEncoder::Export() const {
+  DCHECK(huf_ctable_);
+
+  unique_ptr<uint64_t[]> wrkspace(new uint64_t[HUF_WORKSPACE_SIZE / sizeof(uint64_t)]);
+  string res(HUF_CTABLEBOUND * 2, '\0');
+  size_t size = HUF_writeCTable_wksp(res.data(), res.size(), huf_ctable_.get(), max_symbol_,
+                                     table_max_bits_, wrkspace.get(), HUF_WORKSPACE_SIZE);
+  CHECK(!HUF_isError(size)) << HUF_getErrorName(size);
+  res.resize(size);
+
+  return res;
+}
+
+bool HuffmanEncoder::Encode(string_view data, uint8_t* dest, uint32_t* dest_size,
+                            string* error_msg) const {
+  DCHECK(huf_ctable_);
+
+  size_t res =
+      HUF_compress1X_usingCTable(dest, *dest_size, data.data(), data.size(), huf_ctable_.get(), 0);
+
+  if (HUF_isError(res)) {
+    *error_msg = HUF_getErrorName(res);
+    return false;
+  }
+
+  if (res == 0) {
+    *error_msg = "could not fit the encoded data into the destination";
+    return false;
+  }
+
+  *dest_size = res;
+  return true;
+}
+
+size_t HuffmanEncoder::EncodedSize(string_view data) const {
+  size_t bits = 0;
+  for (uint8_t c : data) {
+    unsigned nb = nbits_[c];
+    if (nb == 0)
+      return 0;
+    bits += nb;
+  }
+
+  // huff0 closes the stream with a single end-mark bit.
+  return (bits + 1 + 7) / 8;
+}
+
+void HuffmanEncoder::Reset() {
+  huf_ctable_.reset();
+  max_symbol_ = 0;
+  table_max_bits_ = 0;
+  memset(nbits_, 0, sizeof(nbits_));
+}
+
+void HuffmanEncoder::InitBitCounts() {
+  for (unsigned i = 0; i <= kMaxSymbol; ++i) {
+    nbits_[i] = HUF_getNbBitsFromCTable(huf_ctable_.get(), i);
+  }
+}
+
+HuffmanDecoder::HuffmanDecoder() {
+}
+
+HuffmanDecoder::~HuffmanDecoder() {
+}
+
+bool HuffmanDecoder::Load(string_view binary_data, string* error_msg) {
+  unique_ptr<uint32_t[]> dtable(new uint32_t[kDTableSize]);
+  dtable[0] = kDTableHeader;
+
+  unique_ptr<uint32_t[]> wrkspace(new uint32_t[HUF_DECOMPRESS_WORKSPACE_SIZE_U32]);
+  size_t res = HUF_readDTableX1_wksp(dtable.get(), binary_data.data(), binary_data.size(),
+                                     wrkspace.get(), HUF_DECOMPRESS_WORKSPACE_SIZE, 0);
+  if (HUF_isError(res)) {
+    *error_msg = HUF_getErrorName(res);
+    return false;
+  }
+
+  huf_dtable_ = std::move(dtable);
+  return true;
+}
+
+bool HuffmanDecoder::Decode(string_view encoded, size_t decoded_size, char* dest) const {
+  DCHECK(huf_dtable_);
+
+  size_t res = HUF_decompress1X_usingDTable(dest, decoded_size, encoded.data(), encoded.size(),
+                                            huf_dtable_.get(), 0);
+  if (HUF_isError(res)) {
+    LOG(ERROR) << "Failed to decode huffman blob: " << HUF_getErrorName(res);
+    return false;
+  }
+
+  return res == decoded_size;
+}
+
+}  // namespace dfly
@@ -0,0 +1,100 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace dfly {
+
+// A thin wrapper around huff0 (bundled with zstd) that encodes short blobs with a single,
+// pre-trained huffman table. Unlike zstd/huff0 block compression, the table is not stored
+// together with the encoded data, which makes it practical for small keys and values.
+class HuffmanEncoder {
+ public:
+  HuffmanEncoder();
+  ~HuffmanEncoder();
+
+  HuffmanEncoder(const HuffmanEncoder&) = delete;
+  void operator=(const HuffmanEncoder&) = delete;
+
+  // Builds the table from the histogram of symbols. hist must have at least max_symbol + 1
+  // entries. Symbols with zero frequency can not be encoded.
+  bool Build(const unsigned hist[], unsigned max_symbol, std::string* error_msg);
+
+  // Loads the table from the binary representation produced by Export().
+  bool Load(std::string_view binary_data, std::string* error_msg);
+
+  // Returns the compact binary representation of the table.
+  std::string Export() const;
+
+  // Encodes data into dest. On input, *dest_size holds the capacity of dest, on output -
+  // the encoded size. Returns false if the data can not be encoded or does not fit into dest.
+  // dest should have at least EncodedBound(data.size()) bytes to be safe.
+  bool Encode(std::string_view data, uint8_t* dest, uint32_t* dest_size,
+              std::string* error_msg) const;
+
+  // Returns the exact size in bytes of the encoded data or 0 if data has symbols that are
+  // not covered by the table.
+  size_t EncodedSize(std::string_view data) const;
+
+  // Number of bits used to encode a symbol, 0 if the symbol is not covered by the table.
+  unsigned BitCount(uint8_t symbol) const {
+    return nbits_[symbol];
+  }
+
+  unsigned num_bits() const {
+    return table_max_bits_;
+  }
+
+  bool valid() const {
+    return bool(huf_ctable_);
+  }
+
+  void Reset();
+
+  static constexpr size_t EncodedBound(size_t len) {
+    // huff0 bit-stream writer requires slack of the size of its bit container.
+    return len + 16;
+  }
+
+ private:
+  void InitBitCounts();
+
+  std::unique_ptr<size_t[]> huf_ctable_;
+  unsigned max_symbol_ = 0;
+  unsigned table_max_bits_ = 0;
+  uint8_t nbits_[256] = {0};
+};
+
+class HuffmanDecoder {
+ public:
+  HuffmanDecoder();
+  ~HuffmanDecoder();
+
+  HuffmanDecoder(const HuffmanDecoder&) = delete;
+  void operator=(const HuffmanDecoder&) = delete;
+
+  // Loads the table from the binary representation produced by HuffmanEncoder::Export().
+  bool Load(std::string_view binary_data, std::string* error_msg);
+
+  // Decodes the data into dest. decoded_size must be the exact size of the original blob.
+  bool Decode(std::string_view encoded, size_t decoded_size, char* dest) const;
+
+  bool valid() const {
+    return bool(huf_dtable_);
+  }
+
+  void Reset() {
+    huf_dtable_.reset();
+  }
+
+ private:
+  std::unique_ptr<uint32_t[]> huf_dtable_;
+};
+
+}  // namespace dfly
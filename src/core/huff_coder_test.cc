@@ -0,0 +1,98 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "core/huff_coder.h"
+
+#include "base/gtest.h"
+#include "base/logging.h"
+
+namespace dfly {
+
+using namespace std;
+
+class HuffCoderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (unsigned i = 0; i < 256; ++i) {
+      hist_[i] = 1;
+    }
+  }
+
+  void AddToHist(string_view data) {
+    for (uint8_t c : data) {
+      hist_[c] += 100;
+    }
+  }
+
+  unsigned hist_[256];
+  HuffmanEncoder encoder_;
+  HuffmanDecoder decoder_;
+  string error_msg_;
+};
+
+TEST_F(HuffCoderTest, Load) {
+  EXPECT_FALSE(encoder_.valid());
+  EXPECT_FALSE(decoder_.Load("", &error_msg_));
+  EXPECT_FALSE(encoder_.Load("", &error_msg_));
+
+  AddToHist("abcdefgh");
+  ASSERT_TRUE(encoder_.Build(hist_, 255, &error_msg_)) << error_msg_;
+  EXPECT_TRUE(encoder_.valid());
+  EXPECT_GT(encoder_.num_bits(), 8u);
+
+  string table = encoder_.Export();
+  EXPECT_LT(table.size(), 256u);
+
+  HuffmanEncoder loaded;
+  ASSERT_TRUE(loaded.Load(table, &error_msg_)) << error_msg_;
+  EXPECT_EQ(table, loaded.Export());
+  for (unsigned i = 0; i < 256; ++i) {
+    EXPECT_EQ(encoder_.BitCount(i), loaded.BitCount(i));
+  }
+
+  ASSERT_TRUE(decoder_.Load(table, &error_msg_)) << error_msg_;
+  EXPECT_TRUE(decoder_.valid());
+
+  encoder_.Reset();
+  EXPECT_FALSE(encoder_.valid());
+}
+
+TEST_F(HuffCoderTest, EncodeDecode) {
+  AddToHist("user:session:0123456789");
+  ASSERT_TRUE(encoder_.Build(hist_, 255, &error_msg_)) << error_msg_;
+  ASSERT_TRUE(decoder_.Load(encoder_.Export(), &error_msg_)) << error_msg_;
+
+  for (string_view data : {"u"sv, "user:session:42"sv, "user:session:1234567890:1234567890"sv,
+                           "\xff\x01 binary \x7f"sv}) {
+    size_t expected_size = encoder_.EncodedSize(data);
+    ASSERT_GT(expected_size, 0u);
+
+    vector<uint8_t> dest(HuffmanEncoder::EncodedBound(data.size()));
+    uint32_t dest_size = dest.size();
+    ASSERT_TRUE(encoder_.Encode(data, dest.data(), &dest_size, &error_msg_)) << error_msg_;
+    EXPECT_EQ(expected_size, dest_size);
+
+    string decoded(data.size(), '\0');
+    string_view encoded{reinterpret_cast<char*>(dest.data()), dest_size};
+    ASSERT_TRUE(decoder_.Decode(encoded, decoded.size(), decoded.data()));
+    EXPECT_EQ(data, decoded);
+  }
+
+  string_view key = "user:session:1234567890:1234567890";
+  EXPECT_LT(encoder_.EncodedSize(key), key.size() * 7 / 8);
+}
+
+TEST_F(HuffCoderTest, UncoveredSymbols) {
+  unsigned hist[256] = {0};
+  hist['a'] = 10;
+  hist['b'] = 5;
+  hist['c'] = 1;
+  ASSERT_TRUE(encoder_.Build(hist, 'c', &error_msg_)) << error_msg_;
+
+  EXPECT_GT(encoder_.EncodedSize("abcabc"), 0u);
+  EXPECT_EQ(0u, encoder_.EncodedSize("abcd"));
+  EXPECT_EQ(0u, encoder_.BitCount('d'));
+}
+
+}  // namespace dfly
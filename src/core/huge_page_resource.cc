@@ -0,0 +1,199 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+#include "core/huge_page_resource.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+
+namespace dfly {
+
+using namespace std;
+
+namespace {
+
+// Smaller allocations do not span enough memory to matter for the TLB.
+constexpr size_t kMinBlockSize = 4096;
+constexpr size_t kMaxBlockSize = HugePageResource::kPageSize / 4;
+constexpr size_t kBlockAlign = 64;
+
+constexpr size_t RoundUp(size_t val, size_t align) {
+  return (val + align - 1) & ~(align - 1);
+}
+
+}  // namespace
+
+HugePageResource::Stats& HugePageResource::Stats::operator+=(const Stats& o) {
+  mapped_bytes += o.mapped_bytes;
+  used_bytes += o.used_bytes;
+  fallback_bytes += o.fallback_bytes;
+  return *this;
+}
+
+HugePageResource::HugePageResource(PMR_NS::memory_resource* upstream, bool explicit_pages)
+    : upstream_(upstream), explicit_pages_(explicit_pages) {
+}
+
+HugePageResource::~HugePageResource() {
+  DCHECK_EQ(stats_.used_bytes, 0u);
+
+  for (const auto& [base, page] : pages_)
+    Unmap(reinterpret_cast<void*>(base), kPageSize);
+  for (const auto& [ptr, len] : large_)
+    Unmap(ptr, len);
+}
+
+void* HugePageResource::do_allocate(size_t size, size_t align) {
+  if (size < kMinBlockSize || align > kBlockAlign)
+    return upstream_->allocate(size, align);
+
+  void* res = nullptr;
+  if (size > kMaxBlockSize) {
+    size_t len = RoundUp(size, kPageSize);
+    if (char* ptr = Map(len); ptr) {
+      large_.emplace(ptr, len);
+      stats_.used_bytes += len;
+      res = ptr;
+    }
+  } else {
+    res = AllocateBlock(RoundUp(size, kBlockAlign));
+  }
+
+  if (res)
+    return res;
+
+  stats_.fallback_bytes += size;
+  return upstream_->allocate(size, align);
+}
+
+void HugePageResource::do_deallocate(void* ptr, size_t size, size_t align) {
+  if (size < kMinBlockSize || align > kBlockAlign) {
+    upstream_->deallocate(ptr, size, align);
+    return;
+  }
+
+  if (size > kMaxBlockSize) {
+    if (auto it = large_.find(ptr); it != large_.end()) {
+      stats_.used_bytes -= it->second;
+      Unmap(ptr, it->second);
+      large_.erase(it);
+      return;
+    }
+  } else {
+    uintptr_t base = reinterpret_cast<uintptr_t>(ptr) & ~(kPageSize - 1);
+    if (auto it = pages_.find(base); it != pages_.end()) {
+      DeallocateBlock(base, &it->second, ptr);
+      return;
+    }
+  }
+
+  DCHECK_GE(stats_.fallback_bytes, size);
+  stats_.fallback_bytes -= size;
+  upstream_->deallocate(ptr, size, align);
+}
+
+void* HugePageResource::AllocateBlock(uint32_t block_size) {
+  auto& partial = partial_pages_[block_size];
+  if (partial.empty()) {
+    char* ptr = Map(kPageSize);
+    if (!ptr)
+      return nullptr;
+
+    pages_[reinterpret_cast<uintptr_t>(ptr)].block_size = block_size;
+    partial.push_back(reinterpret_cast<uintptr_t>(ptr));
+  }
+
+  uintptr_t base = partial.back();
+  Page& page = pages_[base];
+  DCHECK_EQ(page.block_size, block_size);
+
+  void* res;
+  if (page.free_list) {
+    res = page.free_list;
+    page.free_list = *reinterpret_cast<void**>(res);
+  } else {
+    DCHECK_LE(page.bump + block_size, kPageSize);
+    res = reinterpret_cast<char*>(base) + page.bump;
+    page.bump += block_size;
+  }
+
+  page.num_used++;
+  stats_.used_bytes += block_size;
+
+  // Full pages are taken off the list until one of their blocks is freed.
+  if (!page.free_list && page.bump + block_size > kPageSize)
+    partial.pop_back();
+
+  return res;
+}
+
+void HugePageResource::DeallocateBlock(uintptr_t base, Page* page, void* ptr) {
+  DCHECK_GT(page->num_used, 0u);
+
+  auto& partial = partial_pages_[page->block_size];
+  bool was_full = !page->free_list && page->bump + page->block_size > kPageSize;
+
+  page->num_used--;
+  stats_.used_bytes -= page->block_size;
+
+  if (page->num_used == 0) {
+    if (!was_full)
+      partial.erase(find(partial.begin(), partial.end(), base));
+    Unmap(reinterpret_cast<void*>(base), kPageSize);
+    pages_.erase(base);
+    return;
+  }
+
+  *reinterpret_cast<void**>(ptr) = page->free_list;
+  page->free_list = ptr;
+  if (was_full)
+    partial.push_back(base);
+}
+
+char* HugePageResource::Map(size_t len) {
+  DCHECK_EQ(len % kPageSize, 0u);
+
+  constexpr int kProt = PROT_READ | PROT_WRITE;
+  if (explicit_pages_) {
+    void* ptr = mmap(nullptr, len, kProt, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr == MAP_FAILED) {
+      LOG_FIRST_N(WARNING, 1) << "Could not map huge pages, check vm.nr_hugepages: "
+                              << strerror(errno);
+      return nullptr;
+    }
+    stats_.mapped_bytes += len;
+    return reinterpret_cast<char*>(ptr);
+  }
+
+  // Over-map by a page and trim the ends, to get a range aligned to the huge page size
+  // that the kernel can back with transparent huge pages.
+  size_t map_len = len + kPageSize;
+  void* ptr = mmap(nullptr, map_len, kProt, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED)
+    return nullptr;
+
+  char* start = reinterpret_cast<char*>(ptr);
+  char* aligned = reinterpret_cast<char*>(RoundUp(reinterpret_cast<uintptr_t>(start), kPageSize));
+  size_t head = aligned - start;
+  if (head > 0)
+    munmap(start, head);
+  if (size_t tail = map_len - head - len; tail > 0)
+    munmap(aligned + len, tail);
+
+  if (madvise(aligned, len, MADV_HUGEPAGE) != 0) {
+    LOG_FIRST_N(WARNING, 1) << "madvise(MADV_HUGEPAGE) failed: " << strerror(errno);
+  }
+
+  stats_.mapped_bytes += len;
+  return aligned;
+}
+
+void HugePageResource::Unmap(void* ptr, size_t len) {
+  munmap(ptr, len);
+  stats_.mapped_bytes -= len;
+}
+
+}  // namespace dfly
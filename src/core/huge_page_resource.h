@@ -0,0 +1,79 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <absl/container/flat_hash_map.h>
+
+#include <vector>
+
+#include "base/pmr/memory_resource.h"
+
+namespace dfly {
+
+// Per thread memory resource that serves mid-sized allocations, like dash table segments and
+// their directories, from 2MB huge pages, so that random accesses into large tables do not
+// thrash the TLB.
+//
+// Every huge page is carved into blocks of a single size class, freed blocks are reused and a
+// page is unmapped once all of its blocks are freed. Allocations larger than a quarter of a huge
+// page get pages of their own. Small allocations, and allocations for which no huge pages can be
+// mapped (e.g. the hugetlbfs pool is exhausted), are served by the upstream resource.
+class HugePageResource : public PMR_NS::memory_resource {
+ public:
+  static constexpr size_t kPageSize = 2ULL << 20;
+
+  struct Stats {
+    size_t mapped_bytes = 0;    // huge page memory mapped by the arena
+    size_t used_bytes = 0;      // part of mapped_bytes allocated by callers
+    size_t fallback_bytes = 0;  // bytes that were not served from huge pages
+
+    Stats& operator+=(const Stats& o);
+  };
+
+  // With explicit_pages, the pages are allocated from the hugetlbfs pool (see vm.nr_hugepages),
+  // otherwise regular memory is mapped and advised to be backed by transparent huge pages.
+  HugePageResource(PMR_NS::memory_resource* upstream, bool explicit_pages);
+  ~HugePageResource();
+
+  const Stats& stats() const {
+    return stats_;
+  }
+
+ private:
+  // Huge page carved into blocks of block_size bytes.
+  struct Page {
+    uint32_t block_size = 0;
+    uint32_t num_used = 0;      // number of allocated blocks
+    uint32_t bump = 0;          // offset of the first block that was never allocated
+    void* free_list = nullptr;  // freed blocks, linked through their first word
+  };
+
+  void* do_allocate(std::size_t size, std::size_t align) final;
+
+  void do_deallocate(void* ptr, std::size_t size, std::size_t align) final;
+
+  bool do_is_equal(const PMR_NS::memory_resource& o) const noexcept {
+    return this == &o;
+  }
+
+  void* AllocateBlock(uint32_t block_size);
+  void DeallocateBlock(uintptr_t base, Page* page, void* ptr);
+
+  // Maps len bytes aligned to kPageSize, len must be a multiple of kPageSize.
+  // Returns nullptr on failure.
+  char* Map(size_t len);
+  void Unmap(void* ptr, size_t len);
+
+  PMR_NS::memory_resource* upstream_;
+  bool explicit_pages_;
+
+  absl::flat_hash_map<uintptr_t, Page> pages_;  // by page address
+  absl::flat_hash_map<uint32_t, std::vector<uintptr_t>> partial_pages_;  // by block size
+  absl::flat_hash_map<void*, size_t> large_;  // allocations with pages of their own -> mapped size
+
+  Stats stats_;
+};
+
+}  // namespace dfly
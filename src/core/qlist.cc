@@ -12,9 +12,13 @@ extern "C" {
 
 #include <absl/base/macros.h>
 #include <absl/base/optimization.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
 #include <absl/strings/escaping.h>
 #include <absl/strings/str_cat.h>
 #include <lz4frame.h>
+#include <zdict.h>
+#include <zstd.h>
 
 #include "base/logging.h"
 
@@ -50,21 +54,25 @@ using namespace std;
  *
  * If the 'recompress' flag of the node is false, we check whether the node is
  * within the range of compress depth before compressing it. */
-#define quicklistCompress(_node)                  \
-  do {                                            \
-    if ((_node)->recompress)                      \
-      CompressNode((_node), this->compr_method_); \
-    else                                          \
-      this->Compress(_node);                      \
+#define quicklistCompress(_node)                                            \
+  do {                                                                      \
+    if ((_node)->recompress) {                                              \
+      if (!this->DeferCompression(_node))                                   \
+        CompressNode((_node), this->compr_method_);                         \
+    } else {                                                                \
+      this->Compress(_node);                                                \
+    }                                                                       \
   } while (0)
 
+// LZ4 and ZSTD compressed nodes share the encoding, as their frames are told apart by
+// the magic number they start with.
 #define QLIST_NODE_ENCODING_LZ4 3
 
 namespace dfly {
 
 namespace {
 
-static_assert(sizeof(QList) == 32);
+static_assert(sizeof(QList) == 40);
 static_assert(sizeof(QList::Node) == 40);
 
 enum IterDir : uint8_t { FWD = 1, REV = 0 };
@@ -72,6 +80,42 @@ enum IterDir : uint8_t { FWD = 1, REV = 0 };
 /* This is for test suite development purposes only, 0 means disabled. */
 size_t packed_threshold = 0;
 
+// Set per thread, as every shard thread compresses its own lists.
+thread_local bool defer_compression = false;
+thread_local unsigned default_compr_method = QList::LZF;
+
+// Nodes marked for deferred compression, by list. Nodes are removed when they are deleted,
+// so the pending nodes are reached without scanning the lists.
+thread_local absl::flat_hash_map<QList*, absl::flat_hash_set<QList::Node*>> tl_pending_nodes;
+
+constexpr int kZstdLevel = 3;
+thread_local ZSTD_CCtx* tl_zstd_cctx = nullptr;
+thread_local ZSTD_DCtx* tl_zstd_dctx = nullptr;
+
+// ZSTD dictionary of the thread. It is trained once, by QList::TrainZstdDictionary(), on the
+// first nodes that the thread compresses with ZSTD, as the lists of a shard tend to hold similar
+// entries (e.g. events with the same fields) that a dictionary captures better than a single
+// 8KB node does.
+// Nodes are always decoded by the thread that owns their list, so the dictionary is not shared.
+struct ZstdDict {
+  ~ZstdDict() {
+    ZSTD_freeCDict(cdict);
+    ZSTD_freeDDict(ddict);
+  }
+
+  string samples;  // concatenated nodes to train the dictionary on
+  vector<size_t> sample_sizes;
+  bool failed = false;
+
+  ZSTD_CDict* cdict = nullptr;
+  ZSTD_DDict* ddict = nullptr;
+  unsigned id = 0;
+};
+
+constexpr size_t kZstdDictSize = 16 * 1024;
+constexpr size_t kZstdDictSamples = 128;  // ~1MB of 8KB nodes
+thread_local ZstdDict tl_zstd_dict;
+
 /* Optimization levels for size-based filling.
  * Note that the largest possible limit is 64k, so even if each record takes
  * just one byte, it still won't overflow the 16 bit count field. */
@@ -144,6 +188,7 @@ QList::Node* CreateRAW(int container, uint8_t* entry, size_t sz) {
   node->container = container;
   node->recompress = 0;
   node->dont_compress = 0;
+  node->compress_pending = 0;
   return node;
 }
 
@@ -253,6 +298,99 @@ bool CompressLZ4(QList::Node* node) {
   return true;
 }
 
+// Collects the node as a training sample until the thread has a dictionary.
+void SampleZstdNode(const QList::Node* node) {
+  ZstdDict& dict = tl_zstd_dict;
+  if (dict.cdict || dict.failed || dict.sample_sizes.size() >= kZstdDictSamples)
+    return;
+
+  dict.samples.append(reinterpret_cast<const char*>(node->entry), node->sz);
+  dict.sample_sizes.push_back(node->sz);
+}
+
+bool CompressZSTD(QList::Node* node) {
+  if (!tl_zstd_cctx)
+    tl_zstd_cctx = ZSTD_createCCtx();
+
+  SampleZstdNode(node);
+
+  size_t buf_size = ZSTD_compressBound(node->sz);
+  quicklistLZF* dest = (quicklistLZF*)zmalloc(sizeof(quicklistLZF) + buf_size);
+  size_t compr_sz;
+  if (tl_zstd_dict.cdict) {
+    compr_sz = ZSTD_compress_usingCDict(tl_zstd_cctx, dest->compressed, buf_size, node->entry,
+                                        node->sz, tl_zstd_dict.cdict);
+  } else {
+    compr_sz = ZSTD_compressCCtx(tl_zstd_cctx, dest->compressed, buf_size, node->entry, node->sz,
+                                 kZstdLevel);
+  }
+  CHECK(!ZSTD_isError(compr_sz)) << ZSTD_getErrorName(compr_sz);
+
+  if (compr_sz + MIN_COMPRESS_IMPROVE >= node->sz) {
+    QList::stats.bad_compression_attempts++;
+    zfree(dest);
+    return false;
+  }
+
+  dest->sz = compr_sz;
+  dest = (quicklistLZF*)zrealloc(dest, sizeof(quicklistLZF) + compr_sz);
+  QList::stats.compressed_bytes += compr_sz;
+  QList::stats.raw_compressed_bytes += node->sz;
+
+  zfree(node->entry);
+  node->entry = (unsigned char*)dest;
+  node->encoding = QLIST_NODE_ENCODING_LZ4;
+  return true;
+}
+
+bool IsZstdFrame(const quicklistLZF* lzf) {
+  uint32_t magic;
+  if (lzf->sz < sizeof(magic))
+    return false;
+  memcpy(&magic, lzf->compressed, sizeof(magic));
+  return magic == ZSTD_MAGICNUMBER;
+}
+
+// Decodes the compressed entry of the node into dest of node->sz bytes.
+bool DecodeNode(const QList::Node* node, void* dest) {
+  const quicklistLZF* lzf = (const quicklistLZF*)node->entry;
+
+  if (node->encoding == QUICKLIST_NODE_ENCODING_LZF) {
+    if (lzf_decompress(lzf->compressed, lzf->sz, dest, node->sz) == 0) {
+      LOG(DFATAL) << "Invalid LZF compressed data";
+      return false;
+    }
+    return true;
+  }
+
+  if (IsZstdFrame(lzf)) {
+    if (!tl_zstd_dctx)
+      tl_zstd_dctx = ZSTD_createDCtx();
+
+    size_t res;
+    if (unsigned dict_id = ZSTD_getDictID_fromFrame(lzf->compressed, lzf->sz); dict_id) {
+      CHECK_EQ(dict_id, tl_zstd_dict.id) << "List node compressed with a foreign dictionary";
+      res = ZSTD_decompress_usingDDict(tl_zstd_dctx, dest, node->sz, lzf->compressed, lzf->sz,
+                                       tl_zstd_dict.ddict);
+    } else {
+      res = ZSTD_decompressDCtx(tl_zstd_dctx, dest, node->sz, lzf->compressed, lzf->sz);
+    }
+    CHECK_EQ(res, node->sz) << (ZSTD_isError(res) ? ZSTD_getErrorName(res) : "");
+    return true;
+  }
+
+  LZ4F_dctx* dctx = nullptr;
+  LZ4F_errorCode_t code = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+  CHECK(!LZ4F_isError(code));
+  size_t decompressed_sz = node->sz;
+  size_t src_sz = lzf->sz;
+  size_t left = LZ4F_decompress(dctx, dest, &decompressed_sz, lzf->compressed, &src_sz, nullptr);
+  CHECK_EQ(left, 0u);
+  CHECK_EQ(decompressed_sz, node->sz);
+  LZ4F_freeDecompressionContext(dctx);
+  return true;
+}
+
 /* Compress the listpack in 'node' and update encoding details.
  * Returns true if listpack compressed successfully.
  * Returns false if compression failed or if listpack too small to compress. */
@@ -270,11 +408,14 @@ bool CompressNode(QList::Node* node, unsigned method) {
     return false;
 
   QList::stats.compression_attempts++;
-  if (method == static_cast<unsigned>(QList::LZF)) {
-    return CompressLZF(node);
+  switch (method) {
+    case QList::LZF:
+      return CompressLZF(node);
+    case QList::LZ4:
+      return CompressLZ4(node);
+    default:
+      return CompressZSTD(node);
   }
-
-  return CompressLZ4(node);
 }
 
 ssize_t CompressNodeIfNeeded(QList::Node* node, unsigned method) {
@@ -300,27 +441,15 @@ bool DecompressNode(bool recompress, QList::Node* node) {
   void* decompressed = zmalloc(node->sz);
   quicklistLZF* lzf = GetLzf(node);
   QList::stats.decompression_calls++;
-  QList::stats.compressed_bytes -= lzf->sz;
-  QList::stats.raw_compressed_bytes -= node->sz;
 
-  if (node->encoding == QLIST_NODE_ENCODING_LZ4) {
-    LZ4F_dctx* dctx = nullptr;
-    LZ4F_errorCode_t code = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
-    CHECK(!LZ4F_isError(code));
-    size_t decompressed_sz = node->sz;
-    size_t left =
-        LZ4F_decompress(dctx, decompressed, &decompressed_sz, lzf->compressed, &lzf->sz, nullptr);
-    CHECK_EQ(left, 0u);
-    CHECK_EQ(decompressed_sz, node->sz);
-    LZ4F_freeDecompressionContext(dctx);
-  } else {
-    if (lzf_decompress(lzf->compressed, lzf->sz, decompressed, node->sz) == 0) {
-      LOG(DFATAL) << "Invalid LZF compressed data";
-      /* Someone requested decompress, but we can't decompress.  Not good. */
-      zfree(decompressed);
-      return false;
-    }
+  if (!DecodeNode(node, decompressed)) {
+    /* Someone requested decompress, but we can't decompress.  Not good. */
+    zfree(decompressed);
+    return false;
   }
+
+  QList::stats.compressed_bytes -= lzf->sz;
+  QList::stats.raw_compressed_bytes -= node->sz;
   zfree(lzf);
   node->entry = (uint8_t*)decompressed;
   node->encoding = QUICKLIST_NODE_ENCODING_RAW;
@@ -385,8 +514,17 @@ void QList::SetPackedThreshold(unsigned threshold) {
   packed_threshold = threshold;
 }
 
-QList::QList(int fill, int compress) : fill_(fill), compress_(compress), bookmark_count_(0) {
-  compr_method_ = 0;
+void QList::SetDefaultComprMethod(COMPR_METHOD cm) {
+  default_compr_method = cm;
+}
+
+void QList::SetDeferCompression(bool defer) {
+  defer_compression = defer;
+}
+
+QList::QList(int fill, int compress)
+    : fill_(fill), compress_(compress), bookmark_count_(0), compress_pending_(0) {
+  compr_method_ = default_compr_method;
 }
 
 QList::QList(QList&& other)
@@ -394,10 +532,16 @@ QList::QList(QList&& other)
       count_(other.count_),
       len_(other.len_),
       fill_(other.fill_),
+      compr_method_(other.compr_method_),
       compress_(other.compress_),
-      bookmark_count_(other.bookmark_count_) {
+      bookmark_count_(other.bookmark_count_),
+      compress_pending_(0),
+      index_(std::move(other.index_)) {
+  malloc_size_ = std::exchange(other.malloc_size_, 0);
+  unaccounted_ = std::exchange(other.unaccounted_, 0);
   other.head_ = nullptr;
   other.len_ = other.count_ = 0;
+  TakePending(&other);
 }
 
 QList::~QList() {
@@ -411,11 +555,16 @@ QList& QList::operator=(QList&& other) {
     len_ = other.len_;
     count_ = other.count_;
     fill_ = other.fill_;
+    compr_method_ = other.compr_method_;
     compress_ = other.compress_;
     bookmark_count_ = other.bookmark_count_;
+    index_ = std::move(other.index_);
+    malloc_size_ = std::exchange(other.malloc_size_, 0);
+    unaccounted_ = std::exchange(other.unaccounted_, 0);
 
     other.head_ = nullptr;
     other.len_ = other.count_ = 0;
+    TakePending(&other);
   }
   return *this;
 }
@@ -439,6 +588,9 @@ void QList::Clear() {
   head_ = nullptr;
   count_ = 0;
   malloc_size_ = 0;
+  unaccounted_ = 0;
+  DropIndex();
+  ClearPending();
 }
 
 void QList::Push(string_view value, Where where) {
@@ -469,6 +621,7 @@ void QList::Push(string_view value, Where where) {
     auto func = (where == HEAD) ? LP_Prepend : LP_Append;
     malloc_size_ += NodeSetEntry(orig, func(orig->entry, value));
     orig->count++;
+    IndexCountChanged(orig, 1);
     if (len_ == 1) {  // sanity check
       DCHECK_EQ(malloc_size_, orig->sz);
     }
@@ -559,7 +712,11 @@ size_t QList::MallocUsed(bool slow) const {
     return node_size;
   }
 
-  return node_size + malloc_size_;
+  return node_size + malloc_size_ - unaccounted_;
+}
+
+size_t QList::IndexMallocUsed() const {
+  return index_ ? sizeof(NodeIndex) + index_->nodes.size() * sizeof(index_->nodes[0]) : 0;
 }
 
 void QList::Iterate(IterateFunc cb, long start, long end) const {
@@ -618,6 +775,7 @@ void QList::InsertNode(Node* old_node, Node* new_node, InsertOpt insert_opt) {
   /* Update len first, so in Compress we know exactly len */
   len_++;
   malloc_size_ += new_node->sz;
+  IndexInsertNode(new_node);
 
   if (old_node)
     quicklistCompress(old_node);
@@ -629,6 +787,9 @@ void QList::Insert(Iterator it, std::string_view elem, InsertOpt insert_opt) {
   DCHECK(it.current_);
   DCHECK(it.zi_);
 
+  // Inserts may split and merge nodes in the middle of the list.
+  DropIndex();
+
   int full = 0, at_tail = 0, at_head = 0, avail_next = 0, avail_prev = 0;
   Node* node = it.current_;
   size_t sz = elem.size();
@@ -674,7 +835,7 @@ void QList::Insert(Iterator it, std::string_view elem, InsertOpt insert_opt) {
     uint8_t* new_entry = LP_Insert(node->entry, elem, it.zi_, after ? LP_AFTER : LP_BEFORE);
     malloc_size_ += NodeSetEntry(node, new_entry);
     node->count++;
-    malloc_size_ += RecompressOnly(node, compr_method_);
+    malloc_size_ += Recompress(node);
   } else {
     bool insert_tail = at_tail && after;
     bool insert_head = at_head && !after;
@@ -685,8 +846,8 @@ void QList::Insert(Iterator it, std::string_view elem, InsertOpt insert_opt) {
       malloc_size_ += DecompressNodeIfNeeded(true, new_node);
       malloc_size_ += NodeSetEntry(new_node, LP_Prepend(new_node->entry, elem));
       new_node->count++;
-      malloc_size_ += RecompressOnly(new_node, compr_method_);
-      malloc_size_ += RecompressOnly(node, compr_method_);
+      malloc_size_ += Recompress(new_node);
+      malloc_size_ += Recompress(node);
     } else if (insert_head && avail_prev) {
       /* If we are: at head, previous has free space, and inserting before:
        *   - insert entry at tail of previous node. */
@@ -694,8 +855,8 @@ void QList::Insert(Iterator it, std::string_view elem, InsertOpt insert_opt) {
       malloc_size_ += DecompressNodeIfNeeded(true, new_node);
       malloc_size_ += NodeSetEntry(new_node, LP_Append(new_node->entry, elem));
       new_node->count++;
-      malloc_size_ += RecompressOnly(new_node, compr_method_);
-      malloc_size_ += RecompressOnly(node, compr_method_);
+      malloc_size_ += Recompress(new_node);
+      malloc_size_ += Recompress(node);
     } else if (insert_tail || insert_head) {
       /* If we are: full, and our prev/next has no available space, then:
        *   - create new node and attach to qlist */
@@ -740,6 +901,7 @@ void QList::Replace(Iterator it, std::string_view elem) {
       DelNode(node);
     }
   } else { /* The node is full or data is a large element */
+    DropIndex();
     Node *split_node = NULL, *new_node;
     node->dont_compress = 1; /* Prevent compression in InsertNode() */
 
@@ -819,12 +981,139 @@ void QList::Compress(Node* node) {
     reverse = reverse->prev;
   }
 
-  if (!in_depth && node) {
+  if (!in_depth && node && !DeferCompression(node)) {
     malloc_size_ += CompressNodeIfNeeded(node, this->compr_method_);
   }
   /* At this point, forward and reverse are one node beyond depth */
-  malloc_size_ += CompressNodeIfNeeded(forward, this->compr_method_);
-  malloc_size_ += CompressNodeIfNeeded(reverse, this->compr_method_);
+  if (!DeferCompression(forward))
+    malloc_size_ += CompressNodeIfNeeded(forward, this->compr_method_);
+  if (!DeferCompression(reverse))
+    malloc_size_ += CompressNodeIfNeeded(reverse, this->compr_method_);
+}
+
+bool QList::DeferCompression(Node* node) {
+  if (!defer_compression || node->encoding != QUICKLIST_NODE_ENCODING_RAW || node->dont_compress)
+    return false;
+
+  node->recompress = 0;
+  if (node->sz >= MIN_COMPRESS_BYTES && !node->compress_pending) {
+    node->compress_pending = 1;
+    compress_pending_ = 1;
+    tl_pending_nodes[this].insert(node);
+  }
+  return true;
+}
+
+ssize_t QList::Recompress(Node* node) {
+  if (node->recompress && DeferCompression(node))
+    return 0;
+  return RecompressOnly(node, compr_method_);
+}
+
+void QList::CompressRead(Node* node) {
+  bool defer = std::exchange(defer_compression, false);
+  size_t orig_size = malloc_size_;
+  Compress(node);
+  defer_compression = defer;
+  unaccounted_ += ssize_t(malloc_size_) - ssize_t(orig_size);
+}
+
+bool QList::InCompressDepth(const Node* node) const {
+  const Node* fwd = node;
+  const Node* rev = node;
+  for (unsigned i = 0; i < compress_; ++i) {
+    if (fwd == head_ || rev->next == nullptr)
+      return true;
+    fwd = fwd->prev;
+    rev = rev->next;
+  }
+  return false;
+}
+
+size_t QList::CompressPendingNodes(size_t* budget) {
+  auto it = tl_pending_nodes.find(this);
+  DCHECK(it != tl_pending_nodes.end());
+  auto& pending = it->second;
+
+  size_t compressed = 0;
+  while (!pending.empty() && *budget > 0) {
+    --*budget;
+    Node* node = *pending.begin();
+    pending.erase(pending.begin());
+    node->compress_pending = 0;
+
+    // The node could have moved into the compress depth since it was marked.
+    if (!AllowCompression() || node->encoding != QUICKLIST_NODE_ENCODING_RAW ||
+        node->dont_compress || InCompressDepth(node))
+      continue;
+
+    ssize_t diff = CompressNodeIfNeeded(node, compr_method_);
+    malloc_size_ += diff;
+    unaccounted_ += diff;
+    ++compressed;
+  }
+
+  return compressed;
+}
+
+void QList::ClearPending() {
+  if (compress_pending_) {
+    tl_pending_nodes.erase(this);
+    compress_pending_ = 0;
+  }
+}
+
+void QList::TakePending(QList* other) {
+  if (!other->compress_pending_)
+    return;
+
+  auto it = tl_pending_nodes.find(other);
+  auto nodes = std::move(it->second);
+  tl_pending_nodes.erase(it);
+  tl_pending_nodes[this] = std::move(nodes);
+
+  other->compress_pending_ = 0;
+  compress_pending_ = 1;
+}
+
+size_t QList::CompressPending(size_t max_nodes) {
+  size_t compressed = 0;
+  size_t budget = max_nodes;
+  for (auto it = tl_pending_nodes.begin(); it != tl_pending_nodes.end() && budget > 0;) {
+    QList* ql = it->first;
+    compressed += ql->CompressPendingNodes(&budget);
+    if (it->second.empty()) {
+      ql->compress_pending_ = 0;
+      tl_pending_nodes.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  return compressed;
+}
+
+bool QList::TrainZstdDictionary() {
+  ZstdDict& dict = tl_zstd_dict;
+  if (dict.cdict || dict.failed || dict.sample_sizes.size() < kZstdDictSamples)
+    return false;
+
+  string buf(kZstdDictSize, '\0');
+  size_t dict_sz = ZDICT_trainFromBuffer(buf.data(), buf.size(), dict.samples.data(),
+                                         dict.sample_sizes.data(), dict.sample_sizes.size());
+  if (ZDICT_isError(dict_sz)) {
+    LOG(WARNING) << "Could not train list compression dictionary: "
+                 << ZDICT_getErrorName(dict_sz);
+    dict.failed = true;
+  } else {
+    dict.cdict = ZSTD_createCDict(buf.data(), dict_sz, kZstdLevel);
+    dict.ddict = ZSTD_createDDict(buf.data(), dict_sz);
+    dict.id = ZDICT_getDictID(buf.data(), dict_sz);
+    VLOG(1) << "Trained list compression dictionary " << dict.id << " of " << dict_sz << " bytes";
+  }
+
+  string{}.swap(dict.samples);
+  vector<size_t>{}.swap(dict.sample_sizes);
+  return dict.cdict != nullptr;
 }
 
 /* Attempt to merge listpacks within two nodes on either side of 'center'.
@@ -924,6 +1213,10 @@ auto QList::ListpackMerge(Node* a, Node* b) -> Node* {
 }
 
 void QList::DelNode(Node* node) {
+  IndexDelNode(node);
+  if (node->compress_pending)
+    tl_pending_nodes[this].erase(node);
+
   if (node->next)
     node->next->prev = node->prev;
 
@@ -969,6 +1262,7 @@ bool QList::DelPackedIndex(Node* node, uint8_t* p) {
   malloc_size_ += NodeSetEntry(node, lpDelete(node->entry, p, NULL));
   node->count--;
   count_--;
+  IndexCountChanged(node, -1);
 
   return false;
 }
@@ -1000,30 +1294,37 @@ auto QList::GetIterator(long idx) const -> Iterator {
 
   DCHECK(head_);
 
-  /* Seek in the other direction if that way is shorter. */
-  int seek_forward = forward;
-  unsigned long long seek_index = index;
-  if (index > (count_ - 1) / 2) {
-    seek_forward = !forward;
-    seek_index = count_ - 1 - index;
-  }
+  if (len_ >= kIndexMinNodes) {
+    auto [node, start] = FindIndexed(forward ? index : count_ - 1 - index);
+    n = node;
+    /* accum is the number of entries before the node in the direction of idx. */
+    accum = forward ? start : count_ - n->count - start;
+  } else {
+    /* Seek in the other direction if that way is shorter. */
+    int seek_forward = forward;
+    unsigned long long seek_index = index;
+    if (index > (count_ - 1) / 2) {
+      seek_forward = !forward;
+      seek_index = count_ - 1 - index;
+    }
 
-  n = seek_forward ? head_ : head_->prev;
-  while (ABSL_PREDICT_TRUE(n)) {
-    if ((accum + n->count) > seek_index) {
-      break;
-    } else {
-      accum += n->count;
-      n = seek_forward ? n->next : n->prev;
+    n = seek_forward ? head_ : head_->prev;
+    while (ABSL_PREDICT_TRUE(n)) {
+      if ((accum + n->count) > seek_index) {
+        break;
+      } else {
+        accum += n->count;
+        n = seek_forward ? n->next : n->prev;
+      }
     }
-  }
 
-  if (!n)
-    return {};
+    if (!n)
+      return {};
 
-  /* Fix accum so it looks like we seeked in the other direction. */
-  if (seek_forward != forward)
-    accum = count_ - n->count - accum;
+    /* Fix accum so it looks like we seeked in the other direction. */
+    if (seek_forward != forward)
+      accum = count_ - n->count - accum;
+  }
 
   Iterator iter;
   iter.owner_ = this;
@@ -1042,6 +1343,77 @@ auto QList::GetIterator(long idx) const -> Iterator {
   return iter;
 }
 
+auto QList::FindIndexed(uint64_t index) const -> pair<Node*, uint64_t> {
+  DCHECK_LT(index, count_);
+
+  if (!index_) {
+    index_ = make_unique<NodeIndex>();
+    int64_t start = 0;
+    for (Node* node = head_; node; node = node->next) {
+      index_->nodes.emplace_back(node, start);
+      start += node->count;
+    }
+  }
+
+  const auto& nodes = index_->nodes;
+  DCHECK_EQ(nodes.size(), len_);
+
+  // Find the last node that starts at or before the index.
+  int64_t origin = nodes.front().second;
+  auto it = upper_bound(nodes.begin(), nodes.end(), origin + int64_t(index),
+                        [](int64_t pos, const auto& entry) { return pos < entry.second; });
+  DCHECK(it != nodes.begin());
+  --it;
+
+  DCHECK_LT(index - (it->second - origin), it->first->count);
+  return {it->first, it->second - origin};
+}
+
+void QList::IndexInsertNode(Node* node) {
+  if (!index_)
+    return;
+
+  auto& nodes = index_->nodes;
+  if (nodes.empty()) {
+    nodes.emplace_back(node, 0);
+  } else if (node == head_) {
+    nodes.emplace_front(node, nodes.front().second - node->count);
+  } else if (node == head_->prev) {
+    const auto& [tail, tail_start] = nodes.back();
+    nodes.emplace_back(node, tail_start + tail->count);
+  } else {
+    DropIndex();
+  }
+}
+
+void QList::IndexDelNode(Node* node) {
+  if (!index_)
+    return;
+
+  auto& nodes = index_->nodes;
+  if (node == head_) {
+    DCHECK_EQ(nodes.front().first, node);
+    nodes.pop_front();
+  } else if (node == head_->prev) {
+    DCHECK_EQ(nodes.back().first, node);
+    nodes.pop_back();
+  } else {
+    DropIndex();
+  }
+}
+
+void QList::IndexCountChanged(Node* node, int delta) {
+  if (!index_)
+    return;
+
+  // The positions are relative to the head, so that only its own start moves with it.
+  if (node == head_) {
+    index_->nodes.front().second -= delta;
+  } else if (node != head_->prev) {
+    DropIndex();
+  }
+}
+
 auto QList::Erase(Iterator it) -> Iterator {
   DCHECK(it.current_);
 
@@ -1106,6 +1478,9 @@ bool QList::Erase(const long start, unsigned count) {
   Node* node = it.current_;
   long offset = it.offset_;
 
+  // Partial deletes from the nodes in the middle would shift all the positions after them.
+  DropIndex();
+
   /* iterate over next nodes until everything is deleted. */
   while (extent) {
     Node* next = node->next;
@@ -1150,7 +1525,7 @@ bool QList::Erase(const long start, unsigned count) {
       if (node->count == 0) {
         DelNode(node);
       } else {
-        malloc_size_ += RecompressOnly(node, compr_method_);
+        malloc_size_ += Recompress(node);
       }
     }
 
@@ -1161,6 +1536,26 @@ bool QList::Erase(const long start, unsigned count) {
   return true;
 }
 
+string QList::UncompressedEntry(const Node* node) {
+  DCHECK_NE(node->encoding, QUICKLIST_NODE_ENCODING_RAW);
+
+  string res(node->sz, '\0');
+  CHECK(DecodeNode(node, res.data()));
+  return res;
+}
+
+auto QList::GetCompressionInfo() const -> CompressionInfo {
+  CompressionInfo info;
+  for (const Node* node = head_; node; node = node->next) {
+    if (node->encoding != QUICKLIST_NODE_ENCODING_RAW) {
+      info.compressed_nodes++;
+      info.raw_bytes += node->sz;
+      info.compressed_bytes += reinterpret_cast<const quicklistLZF*>(node->entry)->sz;
+    }
+  }
+  return info;
+}
+
 bool QList::Entry::operator==(std::string_view sv) const {
   if (std::holds_alternative<int64_t>(value_)) {
     char buf[absl::numbers_internal::kFastToBufferSize];
@@ -1177,7 +1572,10 @@ bool QList::Iterator::Next() {
   int plain = QL_NODE_IS_PLAIN(current_);
   if (!zi_) {
     /* If !zi, use current index. */
-    const_cast<QList*>(owner_)->malloc_size_ += DecompressNodeIfNeeded(true, current_);
+    QList* owner = const_cast<QList*>(owner_);
+    ssize_t diff = DecompressNodeIfNeeded(true, current_);
+    owner->malloc_size_ += diff;
+    owner->unaccounted_ += diff;
     if (ABSL_PREDICT_FALSE(plain))
       zi_ = current_->entry;
     else
@@ -1205,7 +1603,7 @@ bool QList::Iterator::Next() {
     return true;
 
   // Retry again with the next node.
-  const_cast<QList*>(owner_)->Compress(current_);
+  const_cast<QList*>(owner_)->CompressRead(current_);
 
   if (direction_ == FWD) {
     /* Forward traversal, Jumping to start of next node */
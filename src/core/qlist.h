@@ -10,8 +10,11 @@ extern "C" {
 
 #include <absl/functional/function_ref.h>
 
+#include <deque>
+#include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 #include <variant>
 
 namespace dfly {
@@ -19,7 +22,7 @@ namespace dfly {
 class QList {
  public:
   enum Where { TAIL, HEAD };
-  enum COMPR_METHOD { LZF = 0, LZ4 = 1 };
+  enum COMPR_METHOD { LZF = 0, LZ4 = 1, ZSTD = 2 };
 
   /* Node is a 40 byte struct describing a listpack for a quicklist.
    * We use bit fields keep the Node at 40 bytes.
@@ -29,7 +32,8 @@ class QList {
    * items). recompress: 1 bit, bool, true if node is temporary decompressed for usage.
    * attempted_compress: 1 bit, boolean, used for verifying during testing.
    * dont_compress: 1 bit, boolean, used for preventing compression of entry.
-   * extra: 9 bits, free for future use; pads out the remainder of 32 bits
+   * compress_pending: 1 bit, boolean, compression deferred to CompressPending().
+   * extra: 24 bits, free for future use; pads out the remainder of 32 bits
    * NOTE: do not change the ABI of this struct as long as we support --list_experimental_v2=false
    * */
 
@@ -44,7 +48,8 @@ class QList {
     unsigned int recompress : 1;         /* was this node previous compressed? */
     unsigned int attempted_compress : 1; /* node can't compress; too small */
     unsigned int dont_compress : 1;      /* prevent compression of entry that will be used later */
-    unsigned int extra : 25;             /* more bits to steal for future usage */
+    unsigned int compress_pending : 1;   /* compression is deferred to the background */
+    unsigned int extra : 24;             /* more bits to steal for future usage */
   } Node;
 
   // Provides wrapper around the references to the listpack entries.
@@ -167,8 +172,21 @@ class QList {
   // Returns true if item was replaced, false if index is out of range.
   bool Replace(long index, std::string_view elem);
 
+  // The fast variant leaves out the changes of TakeUnaccounted(), so that its value changes only
+  // with the updates of the list and can be accounted by the owner.
   size_t MallocUsed(bool slow) const;
 
+  // Returns the change in memory usage that was not made by an update of the list: nodes
+  // decompressed by reads, and nodes compressed by CompressPending(). The owner accounts it
+  // before it updates the list, and MallocUsed(false) includes it from then on.
+  ssize_t TakeUnaccounted() {
+    return std::exchange(unaccounted_, 0);
+  }
+
+  // Memory used by the positional index. Reads build and keep it without being able to report
+  // the change, so it is not part of MallocUsed().
+  size_t IndexMallocUsed() const;
+
   void Iterate(IterateFunc cb, long start, long end) const;
 
   // Returns an iterator to tail or the head of the list.
@@ -180,6 +198,7 @@ class QList {
   // or Invalid iterator if index is out of range.
   // negative index - means counting from the tail.
   // Requires calling subsequent Next() to initialize the iterator.
+  // Lists with at least kIndexMinNodes nodes resolve the index in O(log nodes).
   Iterator GetIterator(long idx) const;
 
   uint32_t node_count() const {
@@ -215,6 +234,40 @@ class QList {
 
   static void SetPackedThreshold(unsigned threshold);
 
+  // Compression method of the lists created from now on by the calling thread.
+  static void SetDefaultComprMethod(COMPR_METHOD cm);
+
+  // Applies to the lists of the calling thread. If enabled, nodes that leave the compress depth
+  // are not compressed right away, but only marked for compression, and CompressPending()
+  // compresses them later. This keeps the compression latency out of the push and read paths.
+  static void SetDeferCompression(bool defer);
+
+  // Processes up to max_nodes of the nodes marked for deferred compression in the lists of the
+  // calling thread. Returns the number of nodes that were compressed.
+  static size_t CompressPending(size_t max_nodes);
+
+  // Trains the ZSTD dictionary of the calling thread once enough nodes were compressed to sample
+  // it. Training takes a while, so it is not done when a node is compressed but left to the
+  // caller. Returns true if the dictionary was trained.
+  static bool TrainZstdDictionary();
+
+  // Returns the listpack of a compressed node in its uncompressed form.
+  static std::string UncompressedEntry(const Node* node);
+
+  struct CompressionInfo {
+    uint32_t compressed_nodes = 0;
+    size_t raw_bytes = 0;         // uncompressed size of the compressed nodes
+    size_t compressed_bytes = 0;  // their compressed size
+  };
+  CompressionInfo GetCompressionInfo() const;
+
+  // Minimal number of nodes from which the list builds its positional index.
+  static constexpr uint32_t kIndexMinNodes = 64;
+
+  bool HasIndex() const {
+    return bool(index_);
+  }
+
   struct Stats {
     uint64_t compression_attempts = 0;
 
@@ -252,6 +305,28 @@ class QList {
 
   void Compress(Node* node);
 
+  // Marks the node for CompressPending() if compression is deferred, in which case
+  // returns true and the node should not be compressed now.
+  bool DeferCompression(Node* node);
+
+  // Compresses the node if it was temporarily decompressed, returns the change in its size.
+  ssize_t Recompress(Node* node);
+
+  // Compresses the node that an iterator has read, without deferring it, so that reads leave
+  // the list compressed as they found it.
+  void CompressRead(Node* node);
+
+  // Returns true if the node is one of the compress_ nodes at either end of the list.
+  bool InCompressDepth(const Node* node) const;
+
+  // Compresses the pending nodes of this list. Every pending node is charged to the budget,
+  // whether it ends up compressed or not. Returns the number of nodes compressed.
+  size_t CompressPendingNodes(size_t* budget);
+  void ClearPending();
+
+  // Moves the pending nodes of the other list to this one.
+  void TakePending(QList* other);
+
   Node* MergeNodes(Node* node);
 
   // Deletes one of the nodes and returns the other.
@@ -260,16 +335,40 @@ class QList {
   void DelNode(Node* node);
   bool DelPackedIndex(Node* node, uint8_t* p);
 
+  // Positional index over the nodes of long lists. Holds the nodes in list order with the
+  // position of their first entry, relative to an origin that moves only when the head node
+  // changes, so that pushes and pops at either end update it in O(1).
+  struct NodeIndex {
+    std::deque<std::pair<Node*, int64_t>> nodes;
+  };
+
+  // Returns the node holding the entry at index (counted from the head) and the index of
+  // the first entry of that node. Builds the positional index if needed.
+  std::pair<Node*, uint64_t> FindIndexed(uint64_t index) const;
+
+  // Keep the positional index in sync with the changes of the list. The index is adjusted
+  // when nodes are added, removed or resized at the ends and dropped otherwise.
+  void IndexInsertNode(Node* node);
+  void IndexDelNode(Node* node);
+  void IndexCountChanged(Node* node, int delta);
+  void DropIndex() {
+    index_.reset();
+  }
+
   Node* head_ = nullptr;
   size_t malloc_size_ = 0;  // size of the quicklist struct
+  ssize_t unaccounted_ = 0;  // part of malloc_size_ not reported by MallocUsed(false)
   uint32_t count_ = 0;      /* total count of all entries in all listpacks */
   uint32_t len_ = 0;        /* number of quicklistNodes */
-  int fill_ : QL_FILL_BITS; /* fill factor for individual nodes */
-  int compr_method_ : 2;    // 0 - lzf, 1 - lz4
+  int fill_ : QL_FILL_BITS;    /* fill factor for individual nodes */
+  unsigned compr_method_ : 2;  // 0 - lzf, 1 - lz4, 2 - zstd
   int reserved1_ : 14;
   unsigned compress_ : QL_COMP_BITS; /* depth of end nodes not to compress;0=off */
   unsigned bookmark_count_ : QL_BM_BITS;
-  unsigned reserved2_ : 12;
+  unsigned compress_pending_ : 1;  // registered for CompressPending()
+  unsigned reserved2_ : 11;
+
+  mutable std::unique_ptr<NodeIndex> index_;  // built lazily by GetIterator
 };
 
 }  // namespace dfly
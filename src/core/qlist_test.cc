@@ -4,11 +4,13 @@
 
 #include "core/qlist.h"
 
+#include <absl/cleanup/cleanup.h>
 #include <absl/strings/match.h>
 #include <absl/strings/str_cat.h>
 #include <absl/strings/str_format.h>
 #include <gmock/gmock.h>
 #include <mimalloc.h>
+#include <zstd.h>
 
 #include "base/gtest.h"
 #include "base/logging.h"
@@ -290,6 +292,115 @@ TEST_F(QListTest, CompressionPlain) {
   EXPECT_EQ(500, i);
 }
 
+TEST_F(QListTest, DeferredCompression) {
+  QList::SetDeferCompression(true);
+  absl::Cleanup cleanup([] { QList::SetDeferCompression(false); });
+  ql_ = QList(-2, 1);
+  ql_.set_compr_method(QList::ZSTD);
+
+  for (int i = 0; i < 5000; i++) {
+    ql_.Push(StrCat("value:", i, string(20, 'x')), QList::TAIL);
+  }
+  ASSERT_GT(ql_.node_count(), 4u);
+  EXPECT_EQ(0u, ql_.GetCompressionInfo().compressed_nodes);
+
+  // Nodes are compressed in batches, the edge nodes are never compressed.
+  size_t used = ql_.MallocUsed(false);
+  EXPECT_EQ(2u, QList::CompressPending(2));
+  EXPECT_EQ(2u, ql_.GetCompressionInfo().compressed_nodes);
+
+  // The compression is not an update of the list, so it is left to the owner to account.
+  EXPECT_EQ(used, ql_.MallocUsed(false));
+  ssize_t delta = ql_.TakeUnaccounted();
+  EXPECT_LT(delta, 0);
+  EXPECT_EQ(used + delta, ql_.MallocUsed(false));
+
+  // The node before the tail was marked, but it moves into the compress depth once the tail
+  // node is popped and must stay uncompressed.
+  for (unsigned nc = ql_.node_count(); ql_.node_count() == nc;) {
+    ql_.Pop(QList::TAIL);
+  }
+  QList::CompressPending(1000);
+  EXPECT_EQ(0u, QList::CompressPending(1000));
+
+  QList::CompressionInfo ci = ql_.GetCompressionInfo();
+  EXPECT_EQ(ql_.node_count() - 2, ci.compressed_nodes);
+  EXPECT_LT(ci.compressed_bytes, ci.raw_bytes);
+  EXPECT_EQ(QUICKLIST_NODE_ENCODING_RAW, ql_.Head()->prev->encoding);
+
+  // Reading the nodes decompresses them temporarily, and they are compressed back right away.
+  ql_.TakeUnaccounted();
+  used = ql_.MallocUsed(false);
+  unsigned index = 0;
+  ql_.Iterate(
+      [&](const QList::Entry& e) {
+        EXPECT_EQ(StrCat("value:", index++, string(20, 'x')), e.view());
+        return true;
+      },
+      0, -1);
+  EXPECT_EQ(ql_.Size(), index);
+  EXPECT_EQ(0u, QList::CompressPending(1000));
+  EXPECT_EQ(ql_.node_count() - 2, ql_.GetCompressionInfo().compressed_nodes);
+  EXPECT_EQ(0, ql_.TakeUnaccounted());
+  EXPECT_EQ(used, ql_.MallocUsed(false));
+
+  const QList::Node* node = ql_.Head()->next;
+  ASSERT_NE(QUICKLIST_NODE_ENCODING_RAW, node->encoding);
+  string entry = QList::UncompressedEntry(node);
+  EXPECT_EQ(node->sz, entry.size());
+  EXPECT_EQ(node->count, lpLength(reinterpret_cast<uint8_t*>(entry.data())));
+
+  // Destroyed lists are removed from the pending set.
+  for (int i = 0; i < 1000; i++) {
+    ql_.Push(StrCat("value:", i, string(20, 'x')), QList::TAIL);
+  }
+  ql_.Clear();
+  EXPECT_EQ(0u, QList::CompressPending(1000));
+}
+
+TEST_F(QListTest, ZstdDictionary) {
+  ql_ = QList(-2, 1);
+  ql_.set_compr_method(QList::ZSTD);
+
+  auto entry = [](unsigned i) {
+    return StrCat(R"({"ts":)", 1700000000 + i, R"(,"type":"click","user":"u)", i % 1000, "\"}");
+  };
+
+  // The nodes compressed before the dictionary is trained are sampled for it.
+  unsigned num_entries = 0;
+  for (; num_entries < 40000; num_entries++) {
+    ql_.Push(entry(num_entries), QList::TAIL);
+  }
+  ASSERT_GT(ql_.node_count(), 130u);
+
+  const QList::Node* node = ql_.Head()->prev->prev;
+  ASSERT_NE(QUICKLIST_NODE_ENCODING_RAW, node->encoding);
+  const quicklistLZF* lzf = reinterpret_cast<const quicklistLZF*>(node->entry);
+  EXPECT_EQ(0u, ZSTD_getDictID_fromFrame(lzf->compressed, lzf->sz));
+
+  ASSERT_TRUE(QList::TrainZstdDictionary());
+  EXPECT_FALSE(QList::TrainZstdDictionary());
+
+  for (; num_entries < 60000; num_entries++) {
+    ql_.Push(entry(num_entries), QList::TAIL);
+  }
+  node = ql_.Head()->prev->prev;
+  ASSERT_NE(QUICKLIST_NODE_ENCODING_RAW, node->encoding);
+  lzf = reinterpret_cast<const quicklistLZF*>(node->entry);
+  EXPECT_NE(0u, ZSTD_getDictID_fromFrame(lzf->compressed, lzf->sz));
+
+  // Nodes compressed with and without the dictionary are both decoded.
+  unsigned index = 0;
+  ql_.Iterate(
+      [&](const QList::Entry& e) {
+        EXPECT_EQ(entry(index), e.view());
+        ++index;
+        return true;
+      },
+      0, -1);
+  EXPECT_EQ(num_entries, index);
+}
+
 TEST_F(QListTest, LargeValues) {
   string val(100000, 'a');
   ql_.Push(val, QList::HEAD);
@@ -311,6 +422,65 @@ TEST_F(QListTest, RemoveListpack) {
   ASSERT_FALSE(it.Next());
 }
 
+TEST_F(QListTest, PositionalIndex) {
+  deque<int64_t> expected;
+  for (int64_t i = 0; i < 1000000; ++i) {
+    ql_.Push(absl::StrCat(i), QList::TAIL);
+    expected.push_back(i);
+  }
+  ASSERT_GE(ql_.node_count(), QList::kIndexMinNodes);
+
+  auto check = [&](long index) {
+    auto it = ql_.GetIterator(index);
+    ASSERT_TRUE(it.Next()) << index;
+    long pos = index < 0 ? long(expected.size()) + index : index;
+    ASSERT_EQ(expected[pos], it.Get().ival()) << index;
+  };
+
+  check(0);
+  ASSERT_TRUE(ql_.HasIndex());
+
+  // Pushes and pops at both ends keep the index.
+  for (int64_t i = 0; i < 20000; ++i) {
+    ql_.Push(absl::StrCat(-i - 1), QList::HEAD);
+    expected.push_front(-i - 1);
+    if (i % 3 == 0) {
+      ql_.Pop(QList::TAIL);
+      expected.pop_back();
+    }
+    if (i % 5 == 0) {
+      ql_.Pop(QList::HEAD);
+      expected.pop_front();
+    }
+    if (i % 97 == 0) {
+      check(i * 37 % expected.size());
+      check(-long(i * 53 % expected.size()) - 1);
+    }
+  }
+  ASSERT_TRUE(ql_.HasIndex());
+
+  for (size_t i = 0; i < expected.size(); i += 997) {
+    check(i);
+    check(-long(i) - 1);
+  }
+  check(expected.size() - 1);
+  EXPECT_FALSE(ql_.GetIterator(expected.size()).Next());
+
+  // Changes in the middle of the list drop it until the next lookup.
+  ASSERT_TRUE(ql_.Replace(500000, "abcdefghijklmnopqrstuvwxyz"));
+  auto it = ql_.GetIterator(500000);
+  ASSERT_TRUE(it.Next());
+  EXPECT_EQ("abcdefghijklmnopqrstuvwxyz", it.Get());
+
+  ASSERT_TRUE(ql_.Erase(100000, 1000));
+  expected.erase(expected.begin() + 100000, expected.begin() + 101000);
+  EXPECT_FALSE(ql_.HasIndex());
+  check(300000);
+  check(99999);
+  check(100000);
+  EXPECT_TRUE(ql_.HasIndex());
+}
+
 using FillCompress = tuple<int, unsigned, QList::COMPR_METHOD>;
 
 class PrintToFillCompress {
@@ -320,7 +490,7 @@ class PrintToFillCompress {
     int compress = get<1>(info.param);
     QList::COMPR_METHOD method = get<2>(info.param);
     string fill_str = fill >= 0 ? absl::StrCat("f", fill) : absl::StrCat("fminus", -fill);
-    string method_str = method == QList::LZF ? "lzf" : "lz4";
+    string method_str = method == QList::LZF ? "lzf" : method == QList::LZ4 ? "lz4" : "zstd";
     return absl::StrCat(fill_str, "compr", compress, method_str);
   }
 };
@@ -329,7 +499,8 @@ class OptionsTest : public QListTest, public WithParamInterface<FillCompress> {}
 
 INSTANTIATE_TEST_SUITE_P(Matrix, OptionsTest,
                          Combine(Values(-5, -4, -3, -2, -1, 0, 1, 2, 32, 66, 128, 999),
-                                 Values(0, 1, 2, 3, 4, 5, 6, 10), Values(QList::LZF, QList::LZ4)),
+                                 Values(0, 1, 2, 3, 4, 5, 6, 10),
+                                 Values(QList::LZF, QList::LZ4, QList::ZSTD)),
                          PrintToFillCompress());
 
 TEST_P(OptionsTest, Numbers) {
@@ -884,7 +1055,7 @@ static void BM_QListCompress(benchmark::State& state) {
   VLOG(1) << "Read " << lines.size() << " lines " << state.range(0);
   while (state.KeepRunning()) {
     QList ql(-2, state.range(0));  // uses differrent compression modes, see below.
-    ql.set_compr_method(state.range(1) == 0 ? QList::LZF : QList::LZ4);
+    ql.set_compr_method(static_cast<QList::COMPR_METHOD>(state.range(1)));
 
     for (const string& l : lines) {
       ql.Push(l, QList::TAIL);
@@ -894,9 +1065,9 @@ static void BM_QListCompress(benchmark::State& state) {
   CHECK_EQ(0, zmalloc_used_memory_tl);
 }
 BENCHMARK(BM_QListCompress)
-    ->ArgsProduct({{1, 4, 0}, {0, 1}});  // x - compression depth, y compression method.
-                                         // x = 0 no compression, 1 - compress all nodes but edges,
-                                         // 4 - compress all but 4 nodes from edges.
+    ->ArgsProduct({{1, 4, 0}, {0, 1, 2}});  // x - compression depth, y compression method.
+                                            // x = 0 no compression, 1 - compress all nodes but
+                                            // edges, 4 - compress all but 4 nodes from edges.
 
 static void BM_QListUncompress(benchmark::State& state) {
   SetupMalloc();
@@ -907,7 +1078,7 @@ static void BM_QListUncompress(benchmark::State& state) {
   io::LineReader lr(*src, TAKE_OWNERSHIP);
   string_view line;
   QList ql(-2, state.range(0));
-  ql.set_compr_method(state.range(1) == 0 ? QList::LZF : QList::LZ4);
+  ql.set_compr_method(static_cast<QList::COMPR_METHOD>(state.range(1)));
   QList::stats.compression_attempts = 0;
 
   CHECK_EQ(QList::stats.compressed_bytes, 0u);
@@ -942,6 +1113,24 @@ static void BM_QListUncompress(benchmark::State& state) {
     CHECK_EQ(line_len, actual_len);
   }
 }
-BENCHMARK(BM_QListUncompress)->ArgsProduct({{1, 4, 0}, {0, 1}});
+BENCHMARK(BM_QListUncompress)->ArgsProduct({{1, 4, 0}, {0, 1, 2}});
+
+static void BM_QListIndex(benchmark::State& state) {
+  SetupMalloc();
+
+  QList ql(-2, 0);
+  for (long i = 0; i < state.range(0); ++i) {
+    ql.Push(absl::StrCat(i), QList::TAIL);
+  }
+
+  long index = 0;
+  while (state.KeepRunning()) {
+    auto it = ql.GetIterator(index);
+    CHECK(it.Next());
+    benchmark::DoNotOptimize(it.Get().ival());
+    index = (index + 7919) % state.range(0);
+  }
+}
+BENCHMARK(BM_QListIndex)->Arg(10000)->Arg(1000000)->Arg(10000000);
 
 }  // namespace dfly
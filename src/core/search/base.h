@@ -20,7 +20,10 @@ namespace dfly::search {
 
 using DocId = uint32_t;
 
-enum class VectorSimilarity { L2, COSINE };
+enum class VectorSimilarity { L2, IP, COSINE };
+
+// Storage format of indexed vectors. INT8 keeps one byte per component instead of a float.
+enum class VectorQuantization { NONE, INT8 };
 
 using OwnedFtVector = std::pair<std::unique_ptr<float[]>, size_t /* dimension (size) */>;
 
@@ -85,6 +88,9 @@ struct DocumentAccessor {
   virtual std::optional<StringList> GetTags(std::string_view active_field) const = 0;
 };
 
+class BinaryWriter;
+class BinaryReader;
+
 // Base class for type-specific indices.
 //
 // Queries should be done directly on subclasses with their distinc
@@ -95,6 +101,19 @@ struct BaseIndex {
   // Returns true if the document was added / indexed
   virtual bool Add(DocId id, const DocumentAccessor& doc, std::string_view field) = 0;
   virtual void Remove(DocId id, const DocumentAccessor& doc, std::string_view field) = 0;
+
+  // Writes the index state, so that it can be restored without re-indexing all documents.
+  // Returns false if the index does not support serialization or a checkpoint of the writer
+  // failed.
+  virtual bool Serialize(BinaryWriter* out) const {
+    return false;
+  }
+
+  // Restores the state written by Serialize() into an empty index.
+  // Returns false if the data is malformed.
+  virtual bool Deserialize(BinaryReader* in) {
+    return false;
+  }
 };
 
 // Base class for type-specific sorting indices.
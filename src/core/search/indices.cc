@@ -23,6 +23,8 @@
 #include <cctype>
 
 #include "base/logging.h"
+#include "core/search/serialization.h"
+#include "core/search/vector_utils.h"
 
 namespace dfly::search {
 
@@ -99,6 +101,31 @@ void NumericIndex::Remove(DocId id, const DocumentAccessor& doc, string_view fie
   }
 }
 
+bool NumericIndex::Serialize(BinaryWriter* out) const {
+  out->Write<uint64_t>(entries_.size());
+  for (const auto& [num, id] : entries_) {
+    if (!out->Checkpoint())
+      return false;
+    out->Write(num);
+    out->Write(id);
+  }
+  return true;
+}
+
+bool NumericIndex::Deserialize(BinaryReader* in) {
+  uint64_t size = 0;
+  if (!in->ReadSize(&size, sizeof(double) + sizeof(DocId)))
+    return false;
+
+  for (uint64_t i = 0; i < size; i++) {
+    Entry entry;
+    if (!in->Read(&entry.first) || !in->Read(&entry.second))
+      return false;
+    entries_.insert(entries_.end(), entry);  // entries are written in order
+  }
+  return true;
+}
+
 vector<DocId> NumericIndex::Range(double l, double r) const {
   if (r < l)
     return {};
@@ -188,6 +215,43 @@ void BaseStringIndex<C>::Remove(DocId id, const DocumentAccessor& doc, string_vi
   }
 }
 
+// Format: number of terms, then every term followed by its sorted document ids.
+template <typename C> bool BaseStringIndex<C>::Serialize(BinaryWriter* out) const {
+  out->Write<uint64_t>(entries_.size());
+  for (const auto& [term, container] : entries_) {
+    out->WriteString(term);
+    out->Write<uint64_t>(container.Size());
+    for (DocId id : container) {
+      if (!out->Checkpoint())
+        return false;
+      out->Write(id);
+    }
+  }
+  return true;
+}
+
+template <typename C> bool BaseStringIndex<C>::Deserialize(BinaryReader* in) {
+  uint64_t num_terms = 0;
+  if (!in->ReadSize(&num_terms, sizeof(uint64_t) * 2))
+    return false;
+
+  for (uint64_t i = 0; i < num_terms; i++) {
+    string_view term;
+    uint64_t num_ids = 0;
+    if (!in->ReadString(&term) || !in->ReadSize(&num_ids, sizeof(DocId)))
+      return false;
+
+    Container* container = GetOrCreate(term);
+    for (uint64_t j = 0; j < num_ids; j++) {
+      DocId id;
+      if (!in->Read(&id))
+        return false;
+      container->Insert(id);
+    }
+  }
+  return true;
+}
+
 template <typename C> vector<string> BaseStringIndex<C>::GetTerms() const {
   vector<string> res;
   res.reserve(entries_.size());
@@ -218,13 +282,38 @@ absl::flat_hash_set<std::string> TagIndex::Tokenize(std::string_view value) cons
   return NormalizeTags(value, case_sensitive_, separator_);
 }
 
-BaseVectorIndex::BaseVectorIndex(size_t dim, VectorSimilarity sim) : dim_{dim}, sim_{sim} {
+BaseVectorIndex::BaseVectorIndex(const SchemaField::VectorParams& params)
+    : dim_{params.dim},
+      sim_{params.sim},
+      quantization_{params.quantization},
+      rerank_factor_{params.rerank_factor} {
 }
 
 std::pair<size_t /*dim*/, VectorSimilarity> BaseVectorIndex::Info() const {
   return {dim_, sim_};
 }
 
+std::unique_ptr<float[]> BaseVectorIndex::NormalizedCopy(const float* vector) const {
+  auto out = make_unique<float[]>(dim_);
+  memcpy(out.get(), vector, dim_ * sizeof(float));
+  NormalizeVector(out.get(), dim_);
+  return out;
+}
+
+std::unique_ptr<uint8_t[]> BaseVectorIndex::QuantizedCopy(const float* vector) const {
+  DCHECK(quantization_ == VectorQuantization::INT8);
+
+  unique_ptr<float[]> normalized;
+  if (sim_ == VectorSimilarity::COSINE) {
+    normalized = NormalizedCopy(vector);
+    vector = normalized.get();
+  }
+
+  auto out = make_unique<uint8_t[]>(QuantizedVectorSize(dim_));
+  QuantizeVector(vector, dim_, out.get());
+  return out;
+}
+
 bool BaseVectorIndex::Add(DocId id, const DocumentAccessor& doc, std::string_view field) {
   auto vector = doc.GetVector(field);
   if (!vector)
@@ -241,19 +330,42 @@ bool BaseVectorIndex::Add(DocId id, const DocumentAccessor& doc, std::string_vie
 
 FlatVectorIndex::FlatVectorIndex(const SchemaField::VectorParams& params,
                                  PMR_NS::memory_resource* mr)
-    : BaseVectorIndex{params.dim, params.sim}, entries_{mr} {
+    : BaseVectorIndex{params}, entries_{mr}, codes_{mr} {
   DCHECK(!params.use_hnsw);
-  entries_.reserve(params.capacity * params.dim);
+  if (quantization_ == VectorQuantization::INT8) {
+    code_size_ = QuantizedVectorSize(dim_);
+    codes_.reserve(params.capacity * code_size_);
+  } else {
+    entries_.reserve(params.capacity * params.dim);
+  }
 }
 
 void FlatVectorIndex::AddVector(DocId id, const VectorPtr& vector) {
+  if (quantization_ == VectorQuantization::INT8) {
+    DCHECK_LE(id * code_size_, codes_.size());
+    if (id * code_size_ == codes_.size())
+      codes_.resize((id + 1) * code_size_);
+
+    if (vector) {
+      if (sim_ == VectorSimilarity::COSINE)
+        NormalizeVector(vector.get(), dim_);
+      QuantizeVector(vector.get(), dim_, &codes_[id * code_size_]);
+    }
+    return;
+  }
+
   DCHECK_LE(id * dim_, entries_.size());
   if (id * dim_ == entries_.size())
     entries_.resize((id + 1) * dim_);
 
   // TODO: Let get vector write to buf itself
   if (vector) {
-    memcpy(&entries_[id * dim_], vector.get(), dim_ * sizeof(float));
+    float* dest = &entries_[id * dim_];
+    memcpy(dest, vector.get(), dim_ * sizeof(float));
+
+    // Cosine distance of normalized vectors reduces to the inner product.
+    if (sim_ == VectorSimilarity::COSINE)
+      NormalizeVector(dest, dim_);
   }
 }
 
@@ -261,21 +373,51 @@ void FlatVectorIndex::Remove(DocId id, const DocumentAccessor& doc, string_view
   // noop
 }
 
+// Vectors are stored as is: normalized for cosine indices and quantized for int8 ones.
+bool FlatVectorIndex::Serialize(BinaryWriter* out) const {
+  out->Write<uint64_t>(entries_.size());
+  if (!out->WriteBytesChunked(entries_.data(), entries_.size() * sizeof(float)))
+    return false;
+  out->Write<uint64_t>(codes_.size());
+  return out->WriteBytesChunked(codes_.data(), codes_.size());
+}
+
+bool FlatVectorIndex::Deserialize(BinaryReader* in) {
+  uint64_t size = 0;
+  if (!in->ReadSize(&size, sizeof(float)) || (dim_ && size % dim_))
+    return false;
+  entries_.resize(size);
+  if (!in->ReadBytes(entries_.data(), size * sizeof(float)))
+    return false;
+
+  if (!in->ReadSize(&size, 1) || (code_size_ ? size % code_size_ : size != 0))
+    return false;
+  codes_.resize(size);
+  return in->ReadBytes(codes_.data(), size);
+}
+
 const float* FlatVectorIndex::Get(DocId doc) const {
+  DCHECK(quantization_ == VectorQuantization::NONE);
   return &entries_[doc * dim_];
 }
 
+const uint8_t* FlatVectorIndex::GetQuantized(DocId doc) const {
+  DCHECK(quantization_ == VectorQuantization::INT8);
+  return &codes_[doc * code_size_];
+}
+
 struct HnswlibAdapter {
   // Default setting of hnswlib/hnswalg
   constexpr static size_t kDefaultEfRuntime = 10;
 
   HnswlibAdapter(const SchemaField::VectorParams& params)
-      : space_{MakeSpace(params.dim, params.sim)},
+      : space_{MakeSpace(params)},
         world_{GetSpacePtr(), params.capacity, params.hnsw_m, params.hnsw_ef_construction,
                100 /* seed*/} {
   }
 
-  void Add(const float* data, DocId id) {
+  // data is either a float vector or a quantized one, depending on the index params.
+  void Add(const void* data, DocId id) {
     if (world_.cur_element_count + 1 >= world_.max_elements_)
       world_.resizeIndex(world_.cur_element_count * 2);
     world_.addPoint(data, id);
@@ -285,12 +427,83 @@ struct HnswlibAdapter {
     world_.markDelete(id);
   }
 
-  vector<pair<float, DocId>> Knn(float* target, size_t k, std::optional<size_t> ef) {
+  // hnswlib can save its index only to a file, so the graph is serialized directly
+  // with the same layout as HierarchicalNSW::saveIndex() uses.
+  bool Serialize(BinaryWriter* out) const {
+    size_t count = world_.cur_element_count;
+    out->Write<uint64_t>(count);
+    out->Write<uint64_t>(world_.size_data_per_element_);
+    out->Write<int32_t>(world_.maxlevel_);
+    out->Write<uint32_t>(world_.enterpoint_node_);
+    if (!out->WriteBytesChunked(world_.data_level0_memory_,
+                                count * world_.size_data_per_element_))
+      return false;
+
+    for (size_t i = 0; i < count; i++) {
+      if (!out->Checkpoint())
+        return false;
+
+      uint32_t size = world_.element_levels_[i] > 0
+                          ? world_.size_links_per_element_ * world_.element_levels_[i]
+                          : 0;
+      out->Write(size);
+      out->WriteBytes(world_.linkLists_[i], size);
+    }
+    return true;
+  }
+
+  // Must be called on an empty index created with the same parameters.
+  bool Deserialize(BinaryReader* in) {
+    DCHECK_EQ(world_.cur_element_count, 0u);
+
+    uint64_t count = 0, data_size = 0;
+    int32_t max_level = 0;
+    uint32_t enterpoint = 0;
+    if (!in->Read(&count) || !in->Read(&data_size) || !in->Read(&max_level) ||
+        !in->Read(&enterpoint) || data_size != world_.size_data_per_element_ ||
+        count > std::numeric_limits<uint32_t>::max())
+      return false;
+
+    if (count >= world_.max_elements_)
+      world_.resizeIndex(count + 1);
+
+    if (!in->ReadBytes(world_.data_level0_memory_, count * data_size))
+      return false;
+
+    // cur_element_count covers only initialized link lists, so that they are freed on failure.
+    for (size_t i = 0; i < count; i++) {
+      uint32_t size = 0;
+      if (!in->Read(&size) || size % world_.size_links_per_element_ != 0)
+        return false;
+
+      world_.element_levels_[i] = size / world_.size_links_per_element_;
+      world_.linkLists_[i] = nullptr;
+      if (size > 0) {
+        world_.linkLists_[i] = static_cast<char*>(malloc(size));
+        if (!in->ReadBytes(world_.linkLists_[i], size)) {
+          free(world_.linkLists_[i]);
+          return false;
+        }
+      }
+      world_.cur_element_count = i + 1;
+    }
+
+    world_.maxlevel_ = max_level;
+    world_.enterpoint_node_ = enterpoint;
+    for (size_t i = 0; i < count; i++) {
+      world_.label_lookup_[world_.getExternalLabel(i)] = i;
+      if (world_.isMarkedDeleted(i))
+        world_.num_deleted_++;
+    }
+    return true;
+  }
+
+  vector<pair<float, DocId>> Knn(const void* target, size_t k, std::optional<size_t> ef) {
     world_.setEf(ef.value_or(kDefaultEfRuntime));
     return QueueToVec(world_.searchKnn(target, k));
   }
 
-  vector<pair<float, DocId>> Knn(float* target, size_t k, std::optional<size_t> ef,
+  vector<pair<float, DocId>> Knn(const void* target, size_t k, std::optional<size_t> ef,
                                  const vector<DocId>& allowed) {
     struct BinsearchFilter : hnswlib::BaseFilterFunctor {
       virtual bool operator()(hnswlib::labeltype id) {
@@ -308,13 +521,50 @@ struct HnswlibAdapter {
   }
 
  private:
-  using SpaceUnion = std::variant<hnswlib::L2Space, hnswlib::InnerProductSpace>;
+  // Space of int8 quantized vectors, see QuantizeVector().
+  class QuantizedSpace : public hnswlib::SpaceInterface<float> {
+   public:
+    QuantizedSpace(size_t dim, VectorSimilarity sim) : param_{dim, sim} {
+    }
+
+    size_t get_data_size() override {
+      return QuantizedVectorSize(param_.dim);
+    }
 
-  static SpaceUnion MakeSpace(size_t dim, VectorSimilarity sim) {
-    if (sim == VectorSimilarity::L2)
-      return hnswlib::L2Space{dim};
+    hnswlib::DISTFUNC<float> get_dist_func() override {
+      return &Distance;
+    }
+
+    void* get_dist_func_param() override {
+      return &param_;
+    }
+
+   private:
+    struct Param {
+      size_t dim;
+      VectorSimilarity sim;
+    };
+
+    static float Distance(const void* u, const void* v, const void* param) {
+      auto* p = static_cast<const Param*>(param);
+      return QuantizedVectorDistance(static_cast<const uint8_t*>(u),
+                                     static_cast<const uint8_t*>(v), p->dim, p->sim);
+    }
+
+    Param param_;
+  };
+
+  using SpaceUnion = std::variant<hnswlib::L2Space, hnswlib::InnerProductSpace, QuantizedSpace>;
+
+  // InnerProductSpace is used for cosine similarity as well, vectors are normalized
+  // by HnswVectorIndex in this case.
+  static SpaceUnion MakeSpace(const SchemaField::VectorParams& params) {
+    if (params.quantization == VectorQuantization::INT8)
+      return QuantizedSpace{params.dim, params.sim};
+    if (params.sim == VectorSimilarity::L2)
+      return hnswlib::L2Space{params.dim};
     else
-      return hnswlib::InnerProductSpace{dim};
+      return hnswlib::InnerProductSpace{params.dim};
   }
 
   hnswlib::SpaceInterface<float>* GetSpacePtr() {
@@ -336,7 +586,7 @@ struct HnswlibAdapter {
 };
 
 HnswVectorIndex::HnswVectorIndex(const SchemaField::VectorParams& params, PMR_NS::memory_resource*)
-    : BaseVectorIndex{params.dim, params.sim}, adapter_{make_unique<HnswlibAdapter>(params)} {
+    : BaseVectorIndex{params}, adapter_{make_unique<HnswlibAdapter>(params)} {
   DCHECK(params.use_hnsw);
   // TODO: Patch hnsw to use MR
 }
@@ -346,17 +596,38 @@ HnswVectorIndex::~HnswVectorIndex() {
 
 void HnswVectorIndex::AddVector(DocId id, const VectorPtr& vector) {
   if (vector) {
+    if (quantization_ == VectorQuantization::INT8) {
+      adapter_->Add(QuantizedCopy(vector.get()).get(), id);
+      return;
+    }
+
+    if (sim_ == VectorSimilarity::COSINE)
+      NormalizeVector(vector.get(), dim_);
     adapter_->Add(vector.get(), id);
   }
 }
 
 std::vector<std::pair<float, DocId>> HnswVectorIndex::Knn(float* target, size_t k,
                                                           std::optional<size_t> ef) const {
+  if (quantization_ == VectorQuantization::INT8)
+    return adapter_->Knn(QuantizedCopy(target).get(), k, ef);
+
+  if (sim_ == VectorSimilarity::COSINE) {
+    auto normalized = NormalizedCopy(target);
+    return adapter_->Knn(normalized.get(), k, ef);
+  }
   return adapter_->Knn(target, k, ef);
 }
 std::vector<std::pair<float, DocId>> HnswVectorIndex::Knn(float* target, size_t k,
                                                           std::optional<size_t> ef,
                                                           const std::vector<DocId>& allowed) const {
+  if (quantization_ == VectorQuantization::INT8)
+    return adapter_->Knn(QuantizedCopy(target).get(), k, ef, allowed);
+
+  if (sim_ == VectorSimilarity::COSINE) {
+    auto normalized = NormalizedCopy(target);
+    return adapter_->Knn(normalized.get(), k, ef, allowed);
+  }
   return adapter_->Knn(target, k, ef, allowed);
 }
 
@@ -364,4 +635,12 @@ void HnswVectorIndex::Remove(DocId id, const DocumentAccessor& doc, string_view
   adapter_->Remove(id);
 }
 
+bool HnswVectorIndex::Serialize(BinaryWriter* out) const {
+  return adapter_->Serialize(out);
+}
+
+bool HnswVectorIndex::Deserialize(BinaryReader* in) {
+  return adapter_->Deserialize(in);
+}
+
 }  // namespace dfly::search
@@ -33,6 +33,9 @@ struct NumericIndex : public BaseIndex {
   bool Add(DocId id, const DocumentAccessor& doc, std::string_view field) override;
   void Remove(DocId id, const DocumentAccessor& doc, std::string_view field) override;
 
+  bool Serialize(BinaryWriter* out) const override;
+  bool Deserialize(BinaryReader* in) override;
+
   std::vector<DocId> Range(double l, double r) const;
 
  private:
@@ -49,6 +52,9 @@ template <typename C> struct BaseStringIndex : public BaseIndex {
   bool Add(DocId id, const DocumentAccessor& doc, std::string_view field) override;
   void Remove(DocId id, const DocumentAccessor& doc, std::string_view field) override;
 
+  bool Serialize(BinaryWriter* out) const override;
+  bool Deserialize(BinaryReader* in) override;
+
   // Pointer is valid as long as index is not mutated. Nullptr if not found
   const Container* Matching(std::string_view str, bool strip_whitespace = true) const;
 
@@ -112,32 +118,58 @@ struct TagIndex : public BaseStringIndex<SortedVector> {
 struct BaseVectorIndex : public BaseIndex {
   std::pair<size_t /*dim*/, VectorSimilarity> Info() const;
 
+  VectorQuantization GetQuantization() const {
+    return quantization_;
+  }
+
+  size_t GetRerankFactor() const {
+    return rerank_factor_;
+  }
+
+  // Returns a unit length copy of the vector, used for queries on cosine indices.
+  std::unique_ptr<float[]> NormalizedCopy(const float* vector) const;
+
+  // Returns the int8 quantized copy of the vector, normalized first for cosine indices.
+  std::unique_ptr<uint8_t[]> QuantizedCopy(const float* vector) const;
+
   bool Add(DocId id, const DocumentAccessor& doc, std::string_view field) override final;
 
  protected:
-  BaseVectorIndex(size_t dim, VectorSimilarity sim);
+  explicit BaseVectorIndex(const SchemaField::VectorParams& params);
 
   using VectorPtr = decltype(std::declval<OwnedFtVector>().first);
   virtual void AddVector(DocId id, const VectorPtr& vector) = 0;
 
   size_t dim_;
   VectorSimilarity sim_;
+  VectorQuantization quantization_;
+  size_t rerank_factor_;
 };
 
 // Index for vector fields.
-// Only supports lookup by id.
+// Only supports lookup by id. Vectors of cosine indices are stored normalized.
+// Quantized indices keep only the int8 codes of vectors.
 struct FlatVectorIndex : public BaseVectorIndex {
   FlatVectorIndex(const SchemaField::VectorParams& params, PMR_NS::memory_resource* mr);
 
   void Remove(DocId id, const DocumentAccessor& doc, std::string_view field) override;
 
+  bool Serialize(BinaryWriter* out) const override;
+  bool Deserialize(BinaryReader* in) override;
+
+  // Available only for indices without quantization.
   const float* Get(DocId doc) const;
 
+  // Available only for quantized indices, see QuantizeVector().
+  const uint8_t* GetQuantized(DocId doc) const;
+
  protected:
   void AddVector(DocId id, const VectorPtr& vector) override;
 
  private:
   PMR_NS::vector<float> entries_;
+  PMR_NS::vector<uint8_t> codes_;
+  size_t code_size_ = 0;  // size of a quantized vector in codes_
 };
 
 struct HnswlibAdapter;
@@ -148,6 +180,9 @@ struct HnswVectorIndex : public BaseVectorIndex {
 
   void Remove(DocId id, const DocumentAccessor& doc, std::string_view field) override;
 
+  bool Serialize(BinaryWriter* out) const override;
+  bool Deserialize(BinaryReader* in) override;
+
   std::vector<std::pair<float, DocId>> Knn(float* target, size_t k, std::optional<size_t> ef) const;
   std::vector<std::pair<float, DocId>> Knn(float* target, size_t k, std::optional<size_t> ef,
                                            const std::vector<DocId>& allowed) const;
@@ -20,6 +20,7 @@
 #include "core/search/compressed_sorted_set.h"
 #include "core/search/indices.h"
 #include "core/search/query_driver.h"
+#include "core/search/serialization.h"
 #include "core/search/sort_indices.h"
 #include "core/search/vector_utils.h"
 
@@ -177,8 +178,8 @@ struct ProfileBuilder {
 struct BasicSearch {
   using LogicOp = AstLogicalNode::LogicOp;
 
-  BasicSearch(const FieldIndices* indices, size_t limit)
-      : indices_{indices}, limit_{limit}, tmp_vec_{} {
+  BasicSearch(const FieldIndices* indices, size_t limit, const VectorLoader* vector_loader)
+      : indices_{indices}, limit_{limit}, vector_loader_{vector_loader}, tmp_vec_{} {
   }
 
   void EnableProfiling() {
@@ -393,29 +394,71 @@ struct BasicSearch {
     return IndexResult{};
   }
 
-  void SearchKnnFlat(FlatVectorIndex* vec_index, const AstKnnNode& knn, IndexResult&& sub_results) {
+  void SearchKnnFlat(FlatVectorIndex* vec_index, const AstKnnNode& knn, size_t k,
+                     IndexResult&& sub_results) {
     knn_distances_.reserve(sub_results.Size());
+
+    auto [dim, sim] = vec_index->Info();
+    const float* target = knn.vec.first.get();
+
+    if (vec_index->GetQuantization() == VectorQuantization::INT8) {
+      auto quantized = vec_index->QuantizedCopy(target);
+      auto cb = [&](auto* set) {
+        for (DocId matched_doc : *set) {
+          float dist = QuantizedVectorDistance(quantized.get(),
+                                               vec_index->GetQuantized(matched_doc), dim, sim);
+          knn_distances_.emplace_back(dist, matched_doc);
+        }
+      };
+      visit(cb, sub_results.Borrowed());
+      KeepClosest(k);
+      return;
+    }
+
+    // Cosine vectors are stored normalized, so it's enough to normalize the target once.
+    unique_ptr<float[]> normalized;
+    if (sim == VectorSimilarity::COSINE) {
+      normalized = vec_index->NormalizedCopy(target);
+      target = normalized.get();
+      sim = VectorSimilarity::IP;
+    }
+
     auto cb = [&](auto* set) {
-      auto [dim, sim] = vec_index->Info();
       for (DocId matched_doc : *set) {
-        float dist = VectorDistance(knn.vec.first.get(), vec_index->Get(matched_doc), dim, sim);
+        float dist = VectorDistance(target, vec_index->Get(matched_doc), dim, sim);
         knn_distances_.emplace_back(dist, matched_doc);
       }
     };
     visit(cb, sub_results.Borrowed());
-
-    size_t prefix_size = min(knn.limit, knn_distances_.size());
-    partial_sort(knn_distances_.begin(), knn_distances_.begin() + prefix_size,
-                 knn_distances_.end());
-    knn_distances_.resize(prefix_size);
+    KeepClosest(k);
   }
 
-  void SearchKnnHnsw(HnswVectorIndex* vec_index, const AstKnnNode& knn, IndexResult&& sub_results) {
+  void SearchKnnHnsw(HnswVectorIndex* vec_index, const AstKnnNode& knn, size_t k,
+                     IndexResult&& sub_results) {
     if (indices_->GetAllDocs().size() == sub_results.Size())
-      knn_distances_ = vec_index->Knn(knn.vec.first.get(), knn.limit, knn.ef_runtime);
+      knn_distances_ = vec_index->Knn(knn.vec.first.get(), k, knn.ef_runtime);
     else
-      knn_distances_ =
-          vec_index->Knn(knn.vec.first.get(), knn.limit, knn.ef_runtime, sub_results.Take());
+      knn_distances_ = vec_index->Knn(knn.vec.first.get(), k, knn.ef_runtime, sub_results.Take());
+  }
+
+  // Recomputes distances of the candidates found by a quantized index with their full precision
+  // vectors. Candidates whose vectors can't be loaded keep their approximate distances.
+  void RerankKnn(const BaseVectorIndex& vec_index, const AstKnnNode& knn) {
+    auto [dim, sim] = vec_index.Info();
+    string_view field = indices_->GetSchema().LookupAlias(knn.field);
+
+    for (auto& [dist, doc] : knn_distances_) {
+      if (auto vec = (*vector_loader_)(doc, field); vec && vec->first && vec->second == dim)
+        dist = VectorDistance(knn.vec.first.get(), vec->first.get(), dim, sim);
+    }
+    KeepClosest(knn.limit);
+  }
+
+  void KeepClosest(size_t k) {
+    size_t prefix_size = min(k, knn_distances_.size());
+    partial_sort(knn_distances_.begin(), knn_distances_.begin() + prefix_size,
+                 knn_distances_.end());
+    knn_distances_.resize(prefix_size);
   }
 
   // [KNN limit @field vec]: Compute distance from `vec` to all vectors keep closest `limit`
@@ -433,12 +476,20 @@ struct BasicSearch {
       return IndexResult{};
     }
 
+    // Quantized indices return more candidates, so that re-ranking can restore the true top k.
+    bool rerank = vector_loader_ && vec_index->GetQuantization() != VectorQuantization::NONE &&
+                  vec_index->GetRerankFactor() > 0;
+    size_t k = rerank ? knn.limit * vec_index->GetRerankFactor() : knn.limit;
+
     preagg_total_ = sub_results.Size();
     scores_.clear();
     if (auto hnsw_index = dynamic_cast<HnswVectorIndex*>(vec_index); hnsw_index)
-      SearchKnnHnsw(hnsw_index, knn, std::move(sub_results));
+      SearchKnnHnsw(hnsw_index, knn, k, std::move(sub_results));
     else
-      SearchKnnFlat(dynamic_cast<FlatVectorIndex*>(vec_index), knn, std::move(sub_results));
+      SearchKnnFlat(dynamic_cast<FlatVectorIndex*>(vec_index), knn, k, std::move(sub_results));
+
+    if (rerank)
+      RerankKnn(*vec_index, knn);
 
     vector<DocId> out(knn_distances_.size());
     scores_.reserve(knn_distances_.size());
@@ -490,6 +541,7 @@ struct BasicSearch {
 
   const FieldIndices* indices_;
   size_t limit_;
+  const VectorLoader* vector_loader_;
 
   size_t preagg_total_ = 0;
   string error_;
@@ -674,6 +726,65 @@ const Synonyms* FieldIndices::GetSynonyms() const {
   return synonyms_;
 }
 
+namespace {
+
+// Indices are written in the order of field identifiers, as hash map order is not stable.
+template <typename M> bool SerializeIndices(const M& indices, BinaryWriter* out) {
+  vector<pair<string_view, const BaseIndex*>> sorted;
+  for (const auto& [field, index] : indices)
+    sorted.emplace_back(field, index.get());
+  sort(sorted.begin(), sorted.end());
+
+  out->Write<uint64_t>(sorted.size());
+  for (const auto& [field, index] : sorted) {
+    out->WriteString(field);
+    if (!index->Serialize(out))
+      return false;
+  }
+  return true;
+}
+
+template <typename M> bool DeserializeIndices(M* indices, BinaryReader* in) {
+  uint64_t size = 0;
+  if (!in->Read(&size) || size != indices->size())
+    return false;
+
+  for (uint64_t i = 0; i < size; i++) {
+    string_view field;
+    if (!in->ReadString(&field))
+      return false;
+
+    auto it = indices->find(field);
+    if (it == indices->end() || !it->second->Deserialize(in))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool FieldIndices::Serialize(BinaryWriter* out) const {
+  out->Write<uint64_t>(all_ids_.size());
+  if (!out->WriteBytesChunked(all_ids_.data(), all_ids_.size() * sizeof(DocId)))
+    return false;
+
+  return SerializeIndices(indices_, out) && SerializeIndices(sort_indices_, out);
+}
+
+bool FieldIndices::Deserialize(BinaryReader* in) {
+  DCHECK(all_ids_.empty());
+
+  uint64_t size = 0;
+  if (!in->ReadSize(&size, sizeof(DocId)))
+    return false;
+  all_ids_.resize(size);
+  if (!in->ReadBytes(all_ids_.data(), size * sizeof(DocId)) ||
+      !is_sorted(all_ids_.begin(), all_ids_.end()))
+    return false;
+
+  return DeserializeIndices(&indices_, in) && DeserializeIndices(&sort_indices_, in);
+}
+
 SearchAlgorithm::SearchAlgorithm() = default;
 SearchAlgorithm::~SearchAlgorithm() = default;
 
@@ -699,8 +810,9 @@ bool SearchAlgorithm::Init(string_view query, const QueryParams* params, const S
   return true;
 }
 
-SearchResult SearchAlgorithm::Search(const FieldIndices* index, size_t limit) const {
-  auto bs = BasicSearch{index, limit};
+SearchResult SearchAlgorithm::Search(const FieldIndices* index, size_t limit,
+                                     const VectorLoader* vector_loader) const {
+  auto bs = BasicSearch{index, limit, vector_loader};
   if (profiling_enabled_)
     bs.EnableProfiling();
   return bs.Search(*query_);
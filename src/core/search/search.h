@@ -36,6 +36,11 @@ struct SchemaField {
     size_t capacity = 1000;                       // initial capacity
     size_t hnsw_ef_construction = 200;
     size_t hnsw_m = 16;
+
+    VectorQuantization quantization = VectorQuantization::NONE;
+    // If set, quantized indices return rerank_factor * k candidates for KNN queries that are
+    // re-ranked by their full precision vectors.
+    size_t rerank_factor = 0;
   };
 
   struct TagParams {
@@ -97,6 +102,14 @@ class FieldIndices {
 
   SortableValue GetSortIndexValue(DocId doc, std::string_view field_identifier) const;
 
+  // Writes the state of all indices. Returns false if some index doesn't support serialization
+  // or a checkpoint of the writer failed.
+  bool Serialize(BinaryWriter* out) const;
+
+  // Restores the state written by Serialize() with the same schema into empty indices.
+  // Returns false if the data is malformed or doesn't match the schema.
+  bool Deserialize(BinaryReader* in);
+
  private:
   void CreateIndices(PMR_NS::memory_resource* mr);
   void CreateSortIndices(PMR_NS::memory_resource* mr);
@@ -146,6 +159,10 @@ struct AggregationInfo {
   size_t limit = std::numeric_limits<size_t>::max();
 };
 
+// Loads the full precision vector of a document field. Used to re-rank KNN results of quantized
+// indices, as they don't keep the original vectors.
+using VectorLoader = std::function<std::optional<OwnedFtVector>(DocId, std::string_view /*field*/)>;
+
 // SearchAlgorithm allows searching field indices with a query
 class SearchAlgorithm {
  public:
@@ -155,8 +172,8 @@ class SearchAlgorithm {
   // Init with query and return true if successful.
   bool Init(std::string_view query, const QueryParams* params, const SortOption* sort = nullptr);
 
-  SearchResult Search(const FieldIndices* index,
-                      size_t limit = std::numeric_limits<size_t>::max()) const;
+  SearchResult Search(const FieldIndices* index, size_t limit = std::numeric_limits<size_t>::max(),
+                      const VectorLoader* vector_loader = nullptr) const;
 
   // if enabled, return limit & alias for knn query
   std::optional<AggregationInfo> GetAggregationInfo() const;
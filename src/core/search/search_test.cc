@@ -8,6 +8,7 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/strings/escaping.h>
 #include <absl/strings/numbers.h>
+#include <absl/strings/str_cat.h>
 #include <absl/strings/str_split.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -15,12 +16,14 @@
 
 #include <algorithm>
 #include <memory_resource>
+#include <numeric>
 #include <random>
 
 #include "base/gtest.h"
 #include "base/logging.h"
 #include "core/search/base.h"
 #include "core/search/query_driver.h"
+#include "core/search/serialization.h"
 #include "core/search/vector_utils.h"
 
 extern "C" {
@@ -540,6 +543,102 @@ TEST_F(SearchTest, MatchNumericRangeWithCommas) {
   }
 }
 
+TEST_F(SearchTest, SerializeIndices) {
+  auto schema = MakeSimpleSchema({{"title", SchemaField::TEXT},
+                                  {"tags", SchemaField::TAG},
+                                  {"num", SchemaField::NUMERIC},
+                                  {"flat", SchemaField::VECTOR},
+                                  {"hnsw", SchemaField::VECTOR}});
+  schema.fields["num"].flags |= SchemaField::SORTABLE;
+  schema.fields["flat"].special_params = SchemaField::VectorParams{false, 2};
+  schema.fields["hnsw"].special_params = SchemaField::VectorParams{true, 2};
+
+  FieldIndices indices{schema, kEmptyOptions, PMR_NS::get_default_resource(), nullptr};
+  vector<MockedDocument> documents(20);
+  for (size_t i = 0; i < documents.size(); i++) {
+    documents[i] = Map{{"title", i % 2 ? "odd number" : "even number"},
+                       {"tags", absl::StrCat("t", i % 3)},
+                       {"num", absl::StrCat(i)},
+                       {"flat", ToBytes({float(i), 0})},
+                       {"hnsw", ToBytes({0, float(i)})}};
+    indices.Add(i, documents[i]);
+  }
+  indices.Remove(7, documents[7]);
+
+  string serialized;
+  BinaryWriter writer{&serialized};
+  ASSERT_TRUE(indices.Serialize(&writer));
+
+  FieldIndices restored{schema, kEmptyOptions, PMR_NS::get_default_resource(), nullptr};
+  BinaryReader reader{serialized};
+  ASSERT_TRUE(restored.Deserialize(&reader));
+  EXPECT_TRUE(reader.Empty());
+
+  EXPECT_EQ(indices.GetAllDocs(), restored.GetAllDocs());
+  EXPECT_EQ(indices.GetSortIndexValue(5, "num"), restored.GetSortIndexValue(5, "num"));
+
+  QueryParams params;
+  params["vec"] = ToBytes({3, 0});
+  params["vec2"] = ToBytes({0, 3});
+  for (string_view query :
+       {"odd", "@tags:{t1}", "@num:[5 10]", "even @num:[0 6]", "* =>[KNN 3 @flat $vec]",
+        "* =>[KNN 3 @hnsw $vec2]"}) {
+    SearchAlgorithm algo{};
+    ASSERT_TRUE(algo.Init(query, &params)) << query;
+    EXPECT_EQ(algo.Search(&indices).ids, algo.Search(&restored).ids) << query;
+  }
+
+  // Restored indices remain mutable
+  restored.Remove(8, documents[8]);
+  restored.Add(7, documents[7]);
+  SearchAlgorithm algo{};
+  algo.Init("@num:[6 8]", &params);
+  EXPECT_THAT(algo.Search(&restored).ids, testing::ElementsAre(6, 7));
+
+  // Truncated data is rejected
+  FieldIndices truncated{schema, kEmptyOptions, PMR_NS::get_default_resource(), nullptr};
+  BinaryReader truncated_reader{string_view{serialized}.substr(0, serialized.size() / 2)};
+  EXPECT_FALSE(truncated.Deserialize(&truncated_reader));
+}
+
+TEST_F(SearchTest, SerializeIndicesInChunks) {
+  auto schema = MakeSimpleSchema({{"tags", SchemaField::TAG},
+                                  {"num", SchemaField::NUMERIC},
+                                  {"hnsw", SchemaField::VECTOR}});
+  schema.fields["hnsw"].special_params = SchemaField::VectorParams{true, 2};
+
+  FieldIndices indices{schema, kEmptyOptions, PMR_NS::get_default_resource(), nullptr};
+  for (size_t i = 0; i < 100; i++) {
+    MockedDocument doc{Map{{"tags", absl::StrCat("t", i % 3)},
+                           {"num", absl::StrCat(i)},
+                           {"hnsw", ToBytes({0, float(i)})}}};
+    indices.Add(i, doc);
+  }
+
+  string serialized;
+  BinaryWriter writer{&serialized};
+  ASSERT_TRUE(indices.Serialize(&writer));
+
+  // Chunks are small and add up to the same data
+  string buf, chunked;
+  size_t num_chunks = 0;
+  BinaryWriter chunk_writer{&buf, 64, [&](string_view chunk) {
+                              EXPECT_LT(chunk.size(), 512u);
+                              chunked.append(chunk);
+                              num_chunks++;
+                              return true;
+                            }};
+  ASSERT_TRUE(indices.Serialize(&chunk_writer) && chunk_writer.Flush());
+  EXPECT_GT(num_chunks, 10u);
+  EXPECT_EQ(chunked, serialized);
+
+  // Serialization stops at the first failed checkpoint
+  num_chunks = 0;
+  BinaryWriter failing_writer{&buf, 64, [&](string_view) { return ++num_chunks < 3; }};
+  EXPECT_FALSE(indices.Serialize(&failing_writer));
+  EXPECT_EQ(num_chunks, 3u);
+}
+
 class KnnTest : public SearchTest, public testing::WithParamInterface<bool /* hnsw */> {};
 
 TEST_P(KnnTest, Simple1D) {
@@ -704,6 +803,29 @@ TEST_P(KnnTest, Cosine) {
   }
 }
 
+TEST_P(KnnTest, InnerProduct) {
+  // Unlike cosine, inner product takes the magnitude into account
+  const pair<float, float> kTestCoords[] = {{1, 0}, {3, 0}, {0, 2}, {-1, 0}};
+
+  auto schema = MakeSimpleSchema({{"pos", SchemaField::VECTOR}});
+  schema.fields["pos"].special_params =
+      SchemaField::VectorParams{GetParam(), 2, VectorSimilarity::IP};
+  FieldIndices indices{schema, kEmptyOptions, PMR_NS::get_default_resource(), nullptr};
+
+  for (size_t i = 0; i < ABSL_ARRAYSIZE(kTestCoords); i++) {
+    string coords = ToBytes({kTestCoords[i].first, kTestCoords[i].second});
+    MockedDocument doc{Map{{"pos", coords}}};
+    indices.Add(i, doc);
+  }
+
+  SearchAlgorithm algo{};
+  QueryParams params;
+
+  params["vec"] = ToBytes({1, 0});
+  algo.Init("* =>[KNN 4 @pos $vec]", &params);
+  EXPECT_THAT(algo.Search(&indices).ids, testing::ElementsAre(1, 0, 2, 3));
+}
+
 TEST_P(KnnTest, AddRemove) {
   auto schema = MakeSimpleSchema({{"pos", SchemaField::VECTOR}});
   schema.fields["pos"].special_params =
@@ -766,6 +888,125 @@ TEST_P(KnnTest, AutoResize) {
   EXPECT_EQ(indices.GetAllDocs().size(), 100);
 }
 
+TEST_P(KnnTest, Int8Quantization) {
+  const size_t kDims = 16, kNumDocs = 300, kLimit = 10;
+  default_random_engine rng{42};
+  uniform_real_distribution<float> dist(-1, 1);
+
+  vector<vector<float>> vectors(kNumDocs, vector<float>(kDims));
+  for (auto& vec : vectors)
+    generate(vec.begin(), vec.end(), [&] { return dist(rng); });
+
+  vector<float> target(kDims);
+  generate(target.begin(), target.end(), [&] { return dist(rng); });
+
+  vector<DocId> expected(kNumDocs);
+  iota(expected.begin(), expected.end(), 0);
+  sort(expected.begin(), expected.end(), [&](DocId l, DocId r) {
+    return VectorDistance(target.data(), vectors[l].data(), kDims, VectorSimilarity::L2) <
+           VectorDistance(target.data(), vectors[r].data(), kDims, VectorSimilarity::L2);
+  });
+  expected.resize(kLimit);
+
+  auto recall = [&](const vector<DocId>& ids) {
+    return count_if(ids.begin(), ids.end(), [&](DocId id) {
+      return find(expected.begin(), expected.end(), id) != expected.end();
+    });
+  };
+
+  SchemaField::VectorParams vparams{GetParam(), kDims, VectorSimilarity::L2};
+  vparams.quantization = VectorQuantization::INT8;
+  vparams.rerank_factor = 4;
+
+  auto schema = MakeSimpleSchema({{"pos", SchemaField::VECTOR}});
+  schema.fields["pos"].special_params = vparams;
+  FieldIndices indices{schema, kEmptyOptions, PMR_NS::get_default_resource(), nullptr};
+
+  vector<MockedDocument> documents(kNumDocs);
+  for (size_t i = 0; i < kNumDocs; i++) {
+    documents[i] = Map{{"pos", ToBytes(vectors[i])}};
+    indices.Add(i, documents[i]);
+  }
+
+  SearchAlgorithm algo{};
+  QueryParams params;
+  params["vec"] = ToBytes(target);
+  algo.Init("* =>[KNN 10 @pos $vec]", &params);
+
+  // Without a loader the quantized distances are used as is
+  auto result = algo.Search(&indices);
+  ASSERT_EQ(result.ids.size(), kLimit);
+  EXPECT_GE(recall(result.ids), 8);
+
+  // Re-ranking restores the exact distances
+  VectorLoader loader = [&](DocId id, string_view field) {
+    EXPECT_EQ(field, "pos");
+    return documents[id].GetVector(field);
+  };
+  result = algo.Search(&indices, kLimit, &loader);
+  ASSERT_EQ(result.ids.size(), kLimit);
+  EXPECT_GE(recall(result.ids), 9);
+  for (size_t i = 0; i < kLimit; i++) {
+    float exact = VectorDistance(target.data(), vectors[result.ids[i]].data(), kDims,
+                                 VectorSimilarity::L2);
+    EXPECT_FLOAT_EQ(exact, get<float>(result.scores[i]));
+  }
+}
+
+TEST(VectorUtilsTest, Distances) {
+  default_random_engine rng{42};
+  uniform_real_distribution<float> dist(-1, 1);
+
+  // Check all kernel tails against a naive implementation.
+  for (size_t dims = 1; dims < 70; dims++) {
+    vector<float> u(dims), v(dims);
+    generate(u.begin(), u.end(), [&] { return dist(rng); });
+    generate(v.begin(), v.end(), [&] { return dist(rng); });
+
+    double l2 = 0, uv = 0, uu = 0, vv = 0;
+    for (size_t i = 0; i < dims; i++) {
+      l2 += (u[i] - v[i]) * (u[i] - v[i]);
+      uv += u[i] * v[i];
+      uu += u[i] * u[i];
+      vv += v[i] * v[i];
+    }
+
+    EXPECT_NEAR(sqrt(l2), VectorDistance(u.data(), v.data(), dims, VectorSimilarity::L2), 1e-4);
+    EXPECT_NEAR(1 - uv, VectorDistance(u.data(), v.data(), dims, VectorSimilarity::IP), 1e-4);
+
+    double cosine = 1 - uv / sqrt(uu * vv);
+    EXPECT_NEAR(cosine, VectorDistance(u.data(), v.data(), dims, VectorSimilarity::COSINE), 1e-4);
+
+    NormalizeVector(u.data(), dims);
+    NormalizeVector(v.data(), dims);
+    EXPECT_NEAR(cosine, VectorDistance(u.data(), v.data(), dims, VectorSimilarity::IP), 1e-4);
+  }
+}
+
+TEST(VectorUtilsTest, Quantization) {
+  default_random_engine rng{42};
+  uniform_real_distribution<float> dist(-1, 1);
+
+  for (size_t dims : {1, 15, 16, 17, 100, 768}) {
+    vector<float> u(dims), v(dims);
+    generate(u.begin(), u.end(), [&] { return dist(rng); });
+    generate(v.begin(), v.end(), [&] { return dist(rng); });
+
+    vector<uint8_t> qu(QuantizedVectorSize(dims)), qv(QuantizedVectorSize(dims));
+    EXPECT_EQ(qu.size() - dims, qv.size() - dims);
+    QuantizeVector(u.data(), dims, qu.data());
+    QuantizeVector(v.data(), dims, qv.data());
+
+    for (auto sim : {VectorSimilarity::L2, VectorSimilarity::IP}) {
+      float exact = VectorDistance(u.data(), v.data(), dims, sim);
+      float approx = QuantizedVectorDistance(qu.data(), qv.data(), dims, sim);
+      EXPECT_NEAR(exact, approx, 0.01 * max(1.0f, abs(exact))) << dims;
+    }
+    EXPECT_NEAR(0, QuantizedVectorDistance(qu.data(), qu.data(), dims, VectorSimilarity::L2),
+                1e-2);
+  }
+}
+
 INSTANTIATE_TEST_SUITE_P(KnnFlat, KnnTest, testing::Values(false));
 INSTANTIATE_TEST_SUITE_P(KnnHnsw, KnnTest, testing::Values(true));
 
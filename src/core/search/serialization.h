@@ -0,0 +1,130 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace dfly::search {
+
+// Appends the binary representation of index structures to a string. Values are stored with
+// the host byte order, so the data can be read back only on a machine with the same endianness.
+//
+// With a flush callback the data is produced in chunks: serializers call Checkpoint() between
+// items and the buffered data is passed to the callback once it exceeds the chunk size.
+class BinaryWriter {
+ public:
+  // Receives the next chunk. Might preempt, returns false if serialization must stop.
+  using FlushCb = std::function<bool(std::string_view)>;
+
+  explicit BinaryWriter(std::string* out) : out_{out} {
+  }
+
+  BinaryWriter(std::string* out, size_t chunk_size, FlushCb flush_cb)
+      : out_{out}, chunk_size_{chunk_size}, flush_cb_{std::move(flush_cb)} {
+  }
+
+  template <typename T> void Write(T value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    WriteBytes(&value, sizeof(T));
+  }
+
+  void WriteBytes(const void* data, size_t len) {
+    out_->append(reinterpret_cast<const char*>(data), len);
+  }
+
+  // Writes the length followed by the data.
+  void WriteString(std::string_view str) {
+    Write<uint64_t>(str.size());
+    WriteBytes(str.data(), str.size());
+  }
+
+  // Writes a large buffer in parts with checkpoints in between, see Checkpoint().
+  bool WriteBytesChunked(const void* data, size_t len) {
+    const char* ptr = reinterpret_cast<const char*>(data);
+    while (len > 0) {
+      if (!Checkpoint())
+        return false;
+
+      size_t part = std::min(len, chunk_size_);
+      WriteBytes(ptr, part);
+      ptr += part;
+      len -= part;
+    }
+    return true;
+  }
+
+  // Called by serializers between items, flushes the buffered data if it exceeds the chunk size.
+  // The structure being serialized can change while the callback preempts, so if false is
+  // returned, the serializer must return false without accessing the structure again.
+  bool Checkpoint() {
+    return out_->size() < chunk_size_ || Flush();
+  }
+
+  // Passes the buffered data to the flush callback.
+  bool Flush() {
+    if (!flush_cb_ || out_->empty())
+      return true;
+
+    bool res = flush_cb_(*out_);
+    out_->clear();
+    return res;
+  }
+
+ private:
+  std::string* out_;
+  size_t chunk_size_ = SIZE_MAX;
+  FlushCb flush_cb_;
+};
+
+// Reads data written by BinaryWriter. All methods return false if the input is exhausted.
+class BinaryReader {
+ public:
+  explicit BinaryReader(std::string_view in) : in_{in} {
+  }
+
+  template <typename T> bool Read(T* value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    return ReadBytes(value, sizeof(T));
+  }
+
+  bool ReadBytes(void* dest, size_t len) {
+    if (in_.size() < len)
+      return false;
+    memcpy(dest, in_.data(), len);
+    in_.remove_prefix(len);
+    return true;
+  }
+
+  // The returned view points into the input.
+  bool ReadString(std::string_view* str) {
+    uint64_t len = 0;
+    if (!Read(&len) || in_.size() < len)
+      return false;
+    *str = in_.substr(0, len);
+    in_.remove_prefix(len);
+    return true;
+  }
+
+  // Reads a container size and checks that the input has at least min_item_size bytes for
+  // every item, so that malformed input can't trigger huge allocations.
+  bool ReadSize(uint64_t* size, size_t min_item_size) {
+    return Read(size) && (min_item_size == 0 || *size <= in_.size() / min_item_size);
+  }
+
+  bool Empty() const {
+    return in_.empty();
+  }
+
+ private:
+  std::string_view in_;
+};
+
+}  // namespace dfly::search
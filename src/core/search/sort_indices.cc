@@ -14,6 +14,8 @@
 #include <type_traits>
 #include <variant>
 
+#include "core/search/serialization.h"
+
 namespace dfly::search {
 
 using namespace std;
@@ -90,6 +92,59 @@ void SimpleValueSortIndex<T>::Remove(DocId id, const DocumentAccessor& doc,
   values_[id] = T{};
 }
 
+template <typename T> bool SimpleValueSortIndex<T>::Serialize(BinaryWriter* out) const {
+  out->Write<uint64_t>(values_.size());
+  for (const T& value : values_) {
+    if (!out->Checkpoint())
+      return false;
+
+    if constexpr (is_same_v<T, PMR_NS::string>)
+      out->WriteString(value);
+    else
+      out->Write(value);
+  }
+
+  out->Write<uint64_t>(null_values_.size());
+  for (DocId id : null_values_) {
+    if (!out->Checkpoint())
+      return false;
+    out->Write(id);
+  }
+  return true;
+}
+
+template <typename T> bool SimpleValueSortIndex<T>::Deserialize(BinaryReader* in) {
+  constexpr size_t kMinValueSize = is_same_v<T, PMR_NS::string> ? sizeof(uint64_t) : sizeof(T);
+
+  uint64_t size = 0;
+  if (!in->ReadSize(&size, kMinValueSize))
+    return false;
+
+  values_.resize(size);
+  for (T& value : values_) {
+    if constexpr (is_same_v<T, PMR_NS::string>) {
+      string_view str;
+      if (!in->ReadString(&str))
+        return false;
+      value.assign(str);
+    } else if (!in->Read(&value)) {
+      return false;
+    }
+  }
+
+  if (!in->ReadSize(&size, sizeof(DocId)))
+    return false;
+
+  null_values_.reserve(size);
+  for (uint64_t i = 0; i < size; i++) {
+    DocId id;
+    if (!in->Read(&id))
+      return false;
+    null_values_.insert(id);
+  }
+  return true;
+}
+
 template <typename T> PMR_NS::memory_resource* SimpleValueSortIndex<T>::GetMemRes() const {
   return values_.get_allocator().resource();
 }
@@ -41,6 +41,9 @@ template <typename T> struct SimpleValueSortIndex : public BaseSortIndex {
   bool Add(DocId id, const DocumentAccessor& doc, std::string_view field) override;
   void Remove(DocId id, const DocumentAccessor& doc, std::string_view field) override;
 
+  bool Serialize(BinaryWriter* out) const override;
+  bool Deserialize(BinaryReader* in) override;
+
  protected:
   virtual ParsedSortValue Get(const DocumentAccessor& doc, std::string_view field_value) = 0;
 
@@ -4,7 +4,15 @@
 
 #include "core/search/vector_utils.h"
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <memory>
 
 #include "base/logging.h"
@@ -21,28 +29,251 @@ namespace {
 #define FAST_MATH
 #endif
 
-// Euclidean vector distance: sqrt( sum: (u[i] - v[i])^2  )
-FAST_MATH float L2Distance(const float* u, const float* v, size_t dims) {
+// Portable kernels, used when no SIMD extension is available.
+
+// Squared euclidean distance: sum: (u[i] - v[i])^2
+FAST_MATH float L2SquaredScalar(const float* u, const float* v, size_t dims) {
   float sum = 0;
   for (size_t i = 0; i < dims; i++)
     sum += (u[i] - v[i]) * (u[i] - v[i]);
-  return sqrt(sum);
+  return sum;
 }
 
-// TODO: Normalize vectors ahead if cosine distance is used
-FAST_MATH float CosineDistance(const float* u, const float* v, size_t dims) {
-  float sum_uv = 0, sum_uu = 0, sum_vv = 0;
-  for (size_t i = 0; i < dims; i++) {
-    sum_uv += u[i] * v[i];
-    sum_uu += u[i] * u[i];
-    sum_vv += v[i] * v[i];
+// Dot product: sum: u[i] * v[i]
+FAST_MATH float InnerProductScalar(const float* u, const float* v, size_t dims) {
+  float sum = 0;
+  for (size_t i = 0; i < dims; i++)
+    sum += u[i] * v[i];
+  return sum;
+}
+
+// Dot product of int8 quantization codes. Does not overflow for up to 66051 dimensions.
+uint32_t CodeProductScalar(const uint8_t* u, const uint8_t* v, size_t dims) {
+  uint32_t sum = 0;
+  for (size_t i = 0; i < dims; i++)
+    sum += uint32_t(u[i]) * v[i];
+  return sum;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("avx2,fma"))) inline float HorizontalSum(__m256 v) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+  return _mm_cvtss_f32(sum);
+}
+
+// Two accumulators hide the latency of dependent fma instructions.
+__attribute__((target("avx2,fma"))) float L2SquaredAVX2(const float* u, const float* v,
+                                                        size_t dims) {
+  __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= dims; i += 16) {
+    __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(u + i), _mm256_loadu_ps(v + i));
+    __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(u + i + 8), _mm256_loadu_ps(v + i + 8));
+    sum0 = _mm256_fmadd_ps(d0, d0, sum0);
+    sum1 = _mm256_fmadd_ps(d1, d1, sum1);
+  }
+  if (i + 8 <= dims) {
+    __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(u + i), _mm256_loadu_ps(v + i));
+    sum0 = _mm256_fmadd_ps(d0, d0, sum0);
+    i += 8;
   }
 
+  float res = HorizontalSum(_mm256_add_ps(sum0, sum1));
+  for (; i < dims; i++)
+    res += (u[i] - v[i]) * (u[i] - v[i]);
+  return res;
+}
+
+__attribute__((target("avx2,fma"))) float InnerProductAVX2(const float* u, const float* v,
+                                                           size_t dims) {
+  __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= dims; i += 16) {
+    sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(u + i), _mm256_loadu_ps(v + i), sum0);
+    sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(u + i + 8), _mm256_loadu_ps(v + i + 8), sum1);
+  }
+  if (i + 8 <= dims) {
+    sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(u + i), _mm256_loadu_ps(v + i), sum0);
+    i += 8;
+  }
+
+  float res = HorizontalSum(_mm256_add_ps(sum0, sum1));
+  for (; i < dims; i++)
+    res += u[i] * v[i];
+  return res;
+}
+
+// Codes are widened to 16 bits, madd sums pairs of products into 32 bit lanes.
+__attribute__((target("avx2"))) uint32_t CodeProductAVX2(const uint8_t* u, const uint8_t* v,
+                                                         size_t dims) {
+  __m256i sum = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 16 <= dims; i += 16) {
+    __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(u + i)));
+    __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i)));
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(a, b));
+  }
+
+  __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, _MM_SHUFFLE(2, 3, 0, 1)));
+  uint32_t res = _mm_cvtsi128_si32(sum128);
+  for (; i < dims; i++)
+    res += uint32_t(u[i]) * v[i];
+  return res;
+}
+
+// The tail is handled with masked loads, so no scalar loop is needed.
+__attribute__((target("avx512f"))) float L2SquaredAVX512(const float* u, const float* v,
+                                                         size_t dims) {
+  __m512 sum = _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= dims; i += 16) {
+    __m512 d = _mm512_sub_ps(_mm512_loadu_ps(u + i), _mm512_loadu_ps(v + i));
+    sum = _mm512_fmadd_ps(d, d, sum);
+  }
+  if (i < dims) {
+    __mmask16 mask = (1u << (dims - i)) - 1;
+    __m512 d =
+        _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, u + i), _mm512_maskz_loadu_ps(mask, v + i));
+    sum = _mm512_fmadd_ps(d, d, sum);
+  }
+  return _mm512_reduce_add_ps(sum);
+}
+
+__attribute__((target("avx512f"))) float InnerProductAVX512(const float* u, const float* v,
+                                                            size_t dims) {
+  __m512 sum = _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= dims; i += 16) {
+    sum = _mm512_fmadd_ps(_mm512_loadu_ps(u + i), _mm512_loadu_ps(v + i), sum);
+  }
+  if (i < dims) {
+    __mmask16 mask = (1u << (dims - i)) - 1;
+    sum = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, u + i), _mm512_maskz_loadu_ps(mask, v + i),
+                          sum);
+  }
+  return _mm512_reduce_add_ps(sum);
+}
+
+#elif defined(__aarch64__)
+
+// NEON is part of the aarch64 baseline, so it does not require runtime detection.
+float L2SquaredNeon(const float* u, const float* v, size_t dims) {
+  float32x4_t sum0 = vdupq_n_f32(0), sum1 = vdupq_n_f32(0);
+  size_t i = 0;
+  for (; i + 8 <= dims; i += 8) {
+    float32x4_t d0 = vsubq_f32(vld1q_f32(u + i), vld1q_f32(v + i));
+    float32x4_t d1 = vsubq_f32(vld1q_f32(u + i + 4), vld1q_f32(v + i + 4));
+    sum0 = vfmaq_f32(sum0, d0, d0);
+    sum1 = vfmaq_f32(sum1, d1, d1);
+  }
+
+  float res = vaddvq_f32(vaddq_f32(sum0, sum1));
+  for (; i < dims; i++)
+    res += (u[i] - v[i]) * (u[i] - v[i]);
+  return res;
+}
+
+uint32_t CodeProductNeon(const uint8_t* u, const uint8_t* v, size_t dims) {
+  uint32x4_t sum = vdupq_n_u32(0);
+  size_t i = 0;
+  for (; i + 16 <= dims; i += 16) {
+    uint8x16_t a = vld1q_u8(u + i), b = vld1q_u8(v + i);
+    sum = vpadalq_u16(sum, vmull_u8(vget_low_u8(a), vget_low_u8(b)));
+    sum = vpadalq_u16(sum, vmull_u8(vget_high_u8(a), vget_high_u8(b)));
+  }
+
+  uint32_t res = vaddvq_u32(sum);
+  for (; i < dims; i++)
+    res += uint32_t(u[i]) * v[i];
+  return res;
+}
+
+float InnerProductNeon(const float* u, const float* v, size_t dims) {
+  float32x4_t sum0 = vdupq_n_f32(0), sum1 = vdupq_n_f32(0);
+  size_t i = 0;
+  for (; i + 8 <= dims; i += 8) {
+    sum0 = vfmaq_f32(sum0, vld1q_f32(u + i), vld1q_f32(v + i));
+    sum1 = vfmaq_f32(sum1, vld1q_f32(u + i + 4), vld1q_f32(v + i + 4));
+  }
+
+  float res = vaddvq_f32(vaddq_f32(sum0, sum1));
+  for (; i < dims; i++)
+    res += u[i] * v[i];
+  return res;
+}
+
+#endif
+
+using KernelFn = float (*)(const float*, const float*, size_t);
+using CodeKernelFn = uint32_t (*)(const uint8_t*, const uint8_t*, size_t);
+
+struct Kernels {
+  KernelFn l2_squared = L2SquaredScalar;
+  KernelFn inner_product = InnerProductScalar;
+  CodeKernelFn code_product = CodeProductScalar;
+};
+
+Kernels SelectKernels() {
+  Kernels res;
+#if defined(__x86_64__)
+  if (__builtin_cpu_supports("avx512f")) {
+    res.l2_squared = L2SquaredAVX512;
+    res.inner_product = InnerProductAVX512;
+  } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    res.l2_squared = L2SquaredAVX2;
+    res.inner_product = InnerProductAVX2;
+  }
+  if (__builtin_cpu_supports("avx2"))
+    res.code_product = CodeProductAVX2;
+#elif defined(__aarch64__)
+  res.l2_squared = L2SquaredNeon;
+  res.inner_product = InnerProductNeon;
+  res.code_product = CodeProductNeon;
+#endif
+  return res;
+}
+
+const Kernels& GetKernels() {
+  static const Kernels kernels = SelectKernels();
+  return kernels;
+}
+
+// Euclidean vector distance: sqrt( sum: (u[i] - v[i])^2  )
+float L2Distance(const float* u, const float* v, size_t dims) {
+  return sqrt(GetKernels().l2_squared(u, v, dims));
+}
+
+float IPDistance(const float* u, const float* v, size_t dims) {
+  return 1 - GetKernels().inner_product(u, v, dims);
+}
+
+// Indices store normalized vectors for cosine similarity, so this version is used only for
+// vectors that were not normalized ahead.
+float CosineDistance(const float* u, const float* v, size_t dims) {
+  const Kernels& kernels = GetKernels();
+  float sum_uv = kernels.inner_product(u, v, dims);
+  float sum_uu = kernels.inner_product(u, u, dims);
+  float sum_vv = kernels.inner_product(v, v, dims);
+
   if (float denom = sum_uu * sum_vv; denom != 0.0f)
     return 1 - sum_uv / sqrt(denom);
   return 0.0f;
 }
 
+// Header of an int8 quantized vector, followed by dims codes. Component i is restored as
+// offset + scale * code[i]. code_sum and norm2 allow computing distances without decoding.
+struct QuantizedHeader {
+  float offset;
+  float scale;
+  float code_sum;  // sum: code[i]
+  float norm2;     // squared length of the restored vector
+};
+
 OwnedFtVector ConvertToFtVector(string_view value) {
   // Value cannot be casted directly as it might be not aligned as a float (4 bytes).
   // Misaligned memory access is UB.
@@ -71,10 +302,72 @@ float VectorDistance(const float* u, const float* v, size_t dims, VectorSimilari
   switch (sim) {
     case VectorSimilarity::L2:
       return L2Distance(u, v, dims);
+    case VectorSimilarity::IP:
+      return IPDistance(u, v, dims);
     case VectorSimilarity::COSINE:
       return CosineDistance(u, v, dims);
   };
   return 0.0f;
 }
 
+size_t QuantizedVectorSize(size_t dims) {
+  return sizeof(QuantizedHeader) + dims;
+}
+
+void QuantizeVector(const float* v, size_t dims, uint8_t* dest) {
+  QuantizedHeader hdr{0, 0, 0, 0};
+  uint8_t* codes = dest + sizeof(QuantizedHeader);
+
+  if (dims > 0) {
+    auto [min_it, max_it] = minmax_element(v, v + dims);
+    hdr.offset = *min_it;
+    hdr.scale = (*max_it - *min_it) / 255.0f;
+  }
+
+  float inv_scale = hdr.scale > 0 ? 1.0f / hdr.scale : 0.0f;
+  uint32_t code_sum = 0;
+  double norm2 = 0;
+  for (size_t i = 0; i < dims; i++) {
+    float code = roundf((v[i] - hdr.offset) * inv_scale);
+    codes[i] = uint8_t(clamp(code, 0.0f, 255.0f));
+    code_sum += codes[i];
+
+    double restored = hdr.offset + double(hdr.scale) * codes[i];
+    norm2 += restored * restored;
+  }
+  hdr.code_sum = code_sum;
+  hdr.norm2 = norm2;
+
+  memcpy(dest, &hdr, sizeof(hdr));
+}
+
+float QuantizedVectorDistance(const uint8_t* u, const uint8_t* v, size_t dims,
+                              VectorSimilarity sim) {
+  QuantizedHeader hu, hv;
+  memcpy(&hu, u, sizeof(hu));
+  memcpy(&hv, v, sizeof(hv));
+
+  uint32_t code_product =
+      GetKernels().code_product(u + sizeof(QuantizedHeader), v + sizeof(QuantizedHeader), dims);
+
+  // sum: (ou + su * cu[i]) * (ov + sv * cv[i])
+  double dot = double(hu.offset) * hv.offset * dims + double(hu.offset) * hv.scale * hv.code_sum +
+               double(hv.offset) * hu.scale * hu.code_sum +
+               double(hu.scale) * hv.scale * code_product;
+
+  if (sim == VectorSimilarity::L2)
+    return sqrt(max(0.0, double(hu.norm2) + hv.norm2 - 2 * dot));
+  return 1 - dot;
+}
+
+void NormalizeVector(float* v, size_t dims) {
+  float norm = sqrt(GetKernels().inner_product(v, v, dims));
+  if (norm == 0.0f)
+    return;
+
+  float inv_norm = 1.0f / norm;
+  for (size_t i = 0; i < dims; i++)
+    v[i] *= inv_norm;
+}
+
 }  // namespace dfly::search
@@ -14,6 +14,24 @@ OwnedFtVector BytesToFtVector(std::string_view value);
 // TODO: Remove unsafe version
 std::optional<OwnedFtVector> BytesToFtVectorSafe(std::string_view value);
 
+// Returns the distance between u and v. For IP it is 1 - <u, v>, for COSINE 1 - cos(u, v).
 float VectorDistance(const float* u, const float* v, size_t dims, VectorSimilarity sim);
 
+// Scales v to unit length. Zero vectors are left intact.
+// Cosine distance between normalized vectors equals to their IP distance.
+void NormalizeVector(float* v, size_t dims);
+
+// Int8 scalar quantization: every component is mapped linearly onto [0, 255] by the min and max
+// of its vector. Quantized vectors are 4x smaller and their distances are computed directly
+// on the codes. Returns the number of bytes a quantized vector of dims components occupies.
+size_t QuantizedVectorSize(size_t dims);
+
+// Writes QuantizedVectorSize(dims) bytes to dest.
+void QuantizeVector(const float* v, size_t dims, uint8_t* dest);
+
+// Approximates VectorDistance of the original vectors. Vectors of COSINE indices must be
+// normalized before quantization, so for them it is equal to the IP distance.
+float QuantizedVectorDistance(const uint8_t* u, const uint8_t* v, size_t dims,
+                              VectorSimilarity sim);
+
 }  // namespace dfly::search
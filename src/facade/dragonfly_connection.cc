@@ -20,6 +20,7 @@
 #include "core/heap_size.h"
 #include "facade/conn_context.h"
 #include "facade/dragonfly_listener.h"
+#include "facade/framed_transport.h"
 #include "facade/memcache_parser.h"
 #include "facade/redis_parser.h"
 #include "facade/service_interface.h"
@@ -71,6 +72,16 @@ ABSL_FLAG(uint32_t, pipeline_queue_limit, 10000,
 ABSL_FLAG(uint64_t, publish_buffer_limit, 128_MB,
           "Amount of memory to use for storing pub commands in bytes - per IO thread");
 
+ABSL_FLAG(uint64_t, subscriber_buffer_limit, 0,
+          "Amount of memory in bytes that pub/sub messages queued for a single subscriber may use, "
+          "0 means unlimited. Once exceeded, subscriber_overflow_policy is applied, so that slow "
+          "subscribers do not throttle the publishers via publish_buffer_limit");
+
+ABSL_FLAG(facade::PubOverflowPolicy, subscriber_overflow_policy,
+          facade::PubOverflowPolicy::DROP_OLDEST,
+          "What to do with subscribers over subscriber_buffer_limit: drop-oldest, drop-newest or "
+          "disconnect");
+
 ABSL_FLAG(bool, no_tls_on_admin_port, false, "Allow non-tls connections on admin port");
 
 ABSL_FLAG(uint32_t, pipeline_squash, 10,
@@ -100,6 +111,37 @@ using nonstd::make_unexpected;
 
 namespace facade {
 
+bool AbslParseFlag(std::string_view in, PubOverflowPolicy* policy, std::string* err) {
+  if (in == "drop-oldest") {
+    *policy = PubOverflowPolicy::DROP_OLDEST;
+    return true;
+  }
+  if (in == "drop-newest") {
+    *policy = PubOverflowPolicy::DROP_NEWEST;
+    return true;
+  }
+  if (in == "disconnect") {
+    *policy = PubOverflowPolicy::DISCONNECT;
+    return true;
+  }
+
+  *err = absl::StrCat("Unknown value ", in, " for subscriber_overflow_policy flag");
+  return false;
+}
+
+std::string AbslUnparseFlag(PubOverflowPolicy policy) {
+  switch (policy) {
+    case PubOverflowPolicy::DROP_OLDEST:
+      return "drop-oldest";
+    case PubOverflowPolicy::DROP_NEWEST:
+      return "drop-newest";
+    case PubOverflowPolicy::DISCONNECT:
+      return "disconnect";
+  }
+  DCHECK(false) << "Unknown subscriber_overflow_policy value " << int(policy);
+  return "drop-oldest";
+}
+
 namespace {
 
 void SendProtocolError(RedisParser::Result pres, SinkReplyBuilder* builder) {
@@ -272,6 +314,13 @@ void LogTraffic(uint32_t id, bool has_more, absl::Span<RespExpr> resp,
 
 constexpr size_t kMinReadSize = 256;
 
+// For how long new connections of a thread read into their own buffers after the provided
+// buffers of the thread were exhausted.
+constexpr time_t kBufRingCooldownSec = 1;
+
+// Last time a recv found all the provided buffers of this thread in use.
+thread_local time_t tl_bufring_exhausted_ts = 0;
+
 const char* kPhaseName[Connection::NUM_PHASES] = {"SETUP", "READ", "PROCESS", "SHUTTING_DOWN",
                                                   "PRECLOSE"};
 
@@ -298,6 +347,8 @@ struct QueueBackpressure {
   util::fb2::CondVarAny pipeline_cnd;
 
   size_t publish_buffer_limit = 0;        // cached flag publish_buffer_limit
+  size_t subscriber_buffer_limit = 0;     // cached flag subscriber_buffer_limit
+  PubOverflowPolicy subscriber_overflow_policy = PubOverflowPolicy::DROP_OLDEST;
   size_t pipeline_cache_limit = 0;        // cached flag pipeline_cache_limit
   size_t pipeline_buffer_limit = 0;       // cached flag for buffer size in bytes
   uint32_t pipeline_queue_max_len = 256;  // cached flag for pipeline queue max length.
@@ -441,7 +492,10 @@ size_t Connection::MessageHandle::UsedMemory() const {
       return 0;  // no access to internal type, memory usage negligible
     }
     size_t operator()(const InvalidationMessage& msg) {
-      return 0;
+      size_t size = msg.keys.capacity() * sizeof(string);
+      for (const string& key : msg.keys)
+        size += key.capacity();
+      return size;
     }
     size_t operator()(const MCPipelineMessagePtr& msg) {
       return sizeof(MCPipelineMessage) + msg->backing_size +
@@ -542,6 +596,7 @@ void Connection::AsyncOperations::operator()(const MCPipelineMessage& msg) {
                              static_cast<MCReplyBuilder*>(self->reply_builder_.get()),
                              self->cc_.get());
   self->last_interaction_ = time(nullptr);
+  self->skip_next_squashing_ = false;
 }
 
 void Connection::AsyncOperations::operator()(const MigrationRequestMessage& msg) {
@@ -562,8 +617,7 @@ void Connection::AsyncOperations::operator()(const InvalidationMessage& msg) {
   if (msg.invalidate_due_to_flush) {
     rbuilder->SendNull();
   } else {
-    string_view keys[] = {msg.key};
-    rbuilder->SendBulkStrArr(keys);
+    rbuilder->SendBulkStrArr(msg.keys);
   }
 }
 
@@ -587,6 +641,8 @@ void Connection::Init(unsigned io_threads) {
   for (unsigned i = 0; i < io_threads; ++i) {
     auto& qbp = thread_queue_backpressure[i];
     qbp.publish_buffer_limit = GetFlag(FLAGS_publish_buffer_limit);
+    qbp.subscriber_buffer_limit = GetFlag(FLAGS_subscriber_buffer_limit);
+    qbp.subscriber_overflow_policy = GetFlag(FLAGS_subscriber_overflow_policy);
     qbp.pipeline_cache_limit = GetFlag(FLAGS_request_cache_limit);
     qbp.pipeline_buffer_limit = GetFlag(FLAGS_pipeline_buffer_limit);
     qbp.pipeline_queue_max_len = GetFlag(FLAGS_pipeline_queue_limit);
@@ -817,6 +873,7 @@ void Connection::HandleRequests() {
       VLOG(1) << "Closed connection for peer "
               << GetClientInfo(fb2::ProactorBase::me()->GetPoolIndex());
       reply_builder_.reset();
+      transport_.reset();
     }
     cc_.reset();
   }
@@ -868,7 +925,12 @@ pair<string, string> Connection::GetClientInfoBeforeAfterTid() const {
   if (dispatch_q_.size()) {
     absl::StrAppend(&after, " pipeline=", dispatch_q_.size());
   }
+  if (pub_queue_bytes_ || pub_dropped_) {
+    absl::StrAppend(&after, " pubsub-qbuf=", pub_queue_bytes_, " pubsub-dropped=", pub_dropped_);
+  }
   absl::StrAppend(&after, " age=", now - creation_time_, " idle=", now - last_interaction_);
+  uint64_t req_allocs = pipeline_msg_allocs_ + (redis_parser_ ? redis_parser_->num_allocs() : 0);
+  absl::StrAppend(&after, " req-allocs=", req_allocs);
   string_view phase_name = PHASE_NAMES[phase_];
 
   if (cc_) {
@@ -954,6 +1016,17 @@ const absl::flat_hash_map<string, uint64_t>& Connection::GetLibStatsTL() {
   return g_libname_ver_map;
 }
 
+void Connection::EnableFramedTransport(unique_ptr<FrameCodec> codec, size_t min_compress_size) {
+  DCHECK(!transport_);
+  DCHECK(!cc_->async_dispatch);
+
+  // The reply to the command that enabled the transport is not framed.
+  reply_builder_->Flush();
+  transport_ = make_unique<FramedTransport>(socket_.get(), std::move(codec), min_compress_size,
+                                            GetFlag(FLAGS_max_client_iobuf_len));
+  reply_builder_->SetSink(transport_.get());
+}
+
 io::Result<bool> Connection::CheckForHttpProto() {
   if (!IsPrivileged() && !IsMain()) {
     return false;
@@ -1163,11 +1236,13 @@ Connection::ParserStatus Connection::ParseRedis() {
     RespExpr::VecToArgList(parse_args, &cmd_vec);
     service_->DispatchCommand(absl::MakeSpan(cmd_vec), reply_builder_.get(), cc_.get());
   };
+  // Copies the arguments, so that parse_args keeps its capacity for the next command.
   auto dispatch_async = [this, &parse_args, tlh = mi_heap_get_backing()]() -> MessageHandle {
-    return {FromArgs(std::move(parse_args), tlh)};
+    return {FromArgs(parse_args, tlh)};
   };
 
   ReadBuffer read_buffer = GetReadBuffer();
+  uint64_t parser_allocs = redis_parser_->num_allocs();
 
   do {
     if (read_buffer.ShouldAdvance()) {  // can happen only with io_uring/bundles
@@ -1195,6 +1270,7 @@ Connection::ParserStatus Connection::ParseRedis() {
            !reply_builder_->GetError());
 
   MarkReadBufferConsumed();
+  stats_->request_allocs += redis_parser_->num_allocs() - parser_allocs;
 
   parser_error_ = result;
   if (result == RedisParser::OK)
@@ -1337,21 +1413,34 @@ void Connection::HandleMigrateRequest() {
 error_code Connection::HandleRecvSocket() {
   phase_ = READ_SOCKET;
 
+  if (transport_)
+    return HandleRecvFramed();
+
   // We can use provided buffers only after we emptied io_buf_.
+  bool recv_done = false;
   if (recv_provided_ && io_buf_.InputBuffer().empty()) {
     stats_->num_recv_provided_calls++;
 
     unsigned res = socket_->RecvProvided(1, &recv_buf_);
     CHECK_EQ(res, 1u);
-    if (recv_buf_.res_len < 0) {
+    if (recv_buf_.res_len == -ENOBUFS) {
+      // All the buffers of the ring are held by other connections, read into io_buf_ instead.
+      stats_->num_recv_provided_exhausted++;
+      tl_bufring_exhausted_ts = time(nullptr);
+      recv_buf_.res_len = 0;
+    } else if (recv_buf_.res_len < 0) {
       return error_code{-recv_buf_.res_len, system_category()};
-    }
+    } else {
+      CHECK_EQ(recv_buf_.type, FiberSocketBase::kBufRingType);  // We only support this type.
+      CHECK_GT(recv_buf_.res_len, 0);
 
-    CHECK_EQ(recv_buf_.type, FiberSocketBase::kBufRingType);  // We only support this type.
-    CHECK_GT(recv_buf_.res_len, 0);
+      stats_->io_read_bytes += recv_buf_.res_len;
+      last_interaction_ = time(nullptr);
+      recv_done = true;
+    }
+  }
 
-    stats_->io_read_bytes += recv_buf_.res_len;
-  } else {
+  if (!recv_done) {
     io::MutableBytes append_buf = io_buf_.AppendBuffer();
     DCHECK(!append_buf.empty());
 
@@ -1372,6 +1461,33 @@ error_code Connection::HandleRecvSocket() {
   return {};
 }
 
+error_code Connection::HandleRecvFramed() {
+  // Read until at least one frame is decoded, the parsers need non empty input.
+  do {
+    ::io::Result<size_t> recv_sz = socket_->Recv(transport_->PrepareRead());
+    last_interaction_ = time(nullptr);
+
+    if (!recv_sz) {
+      return recv_sz.error();
+    }
+    if (*recv_sz == 0) {
+      return make_error_code(errc::connection_aborted);
+    }
+
+    stats_->io_read_bytes += *recv_sz;
+    ++stats_->io_read_cnt;
+
+    error_code ec;
+    UpdateIoBufCapacity(io_buf_, stats_,
+                        [&]() { ec = transport_->CommitRead(*recv_sz, &io_buf_); });
+    if (ec) {
+      return ec;
+    }
+  } while (io_buf_.InputLen() == 0);
+
+  return {};
+}
+
 auto Connection::IoLoop() -> variant<error_code, ParserStatus> {
   error_code ec;
   ParserStatus parse_status = OK;
@@ -1390,6 +1506,9 @@ auto Connection::IoLoop() -> variant<error_code, ParserStatus> {
     phase_ = PROCESS;
     bool is_iobuf_full = io_buf_.AppendLen() == 0;
 
+    // The parser stashes partial requests read from provided buffers, io_buf_ is not needed.
+    bool provided_input = recv_provided_ && recv_buf_.res_len > 0;
+
     if (redis_parser_) {
       parse_status = ParseRedis();
     } else {
@@ -1401,7 +1520,7 @@ auto Connection::IoLoop() -> variant<error_code, ParserStatus> {
       parse_status = OK;
 
       size_t capacity = io_buf_.Capacity();
-      if (capacity < max_iobfuf_len) {
+      if (capacity < max_iobfuf_len && !provided_input) {
         size_t parser_hint = 0;
         if (redis_parser_)
           parser_hint = redis_parser_->parselen_hint();  // Could be done for MC as well.
@@ -1474,25 +1593,44 @@ bool Connection::ShouldEndAsyncFiber(const MessageHandle& msg) {
 
 void Connection::SquashPipeline() {
   DCHECK_EQ(dispatch_q_.size(), pending_pipeline_cmd_cnt_);
-  DCHECK_EQ(reply_builder_->GetProtocol(), Protocol::REDIS);  // Only Redis is supported.
 
-  vector<ArgSlice> squash_cmds;
-  squash_cmds.reserve(dispatch_q_.size());
+  cc_->async_dispatch = true;
 
-  for (auto& msg : dispatch_q_) {
-    CHECK(holds_alternative<PipelineMessagePtr>(msg.handle))
-        << msg.handle.index() << " on " << DebugInfo();
+  size_t dispatched = 0;
+  size_t num_cmds = 0;
+  if (reply_builder_->GetProtocol() == Protocol::REDIS) {
+    vector<ArgSlice> squash_cmds;
+    squash_cmds.reserve(dispatch_q_.size());
 
-    auto& pmsg = get<PipelineMessagePtr>(msg.handle);
-    squash_cmds.push_back(absl::MakeSpan(pmsg->args));
-  }
+    for (auto& msg : dispatch_q_) {
+      CHECK(holds_alternative<PipelineMessagePtr>(msg.handle))
+          << msg.handle.index() << " on " << DebugInfo();
 
-  cc_->async_dispatch = true;
+      auto& pmsg = get<PipelineMessagePtr>(msg.handle);
+      squash_cmds.push_back(absl::MakeSpan(pmsg->args));
+    }
+
+    num_cmds = squash_cmds.size();
+    dispatched = service_->DispatchManyCommands(absl::MakeSpan(squash_cmds), reply_builder_.get(),
+                                                cc_.get());
+  } else {
+    vector<MCCommandRef> squash_cmds;
+    squash_cmds.reserve(dispatch_q_.size());
+
+    for (auto& msg : dispatch_q_) {
+      CHECK(holds_alternative<MCPipelineMessagePtr>(msg.handle))
+          << msg.handle.index() << " on " << DebugInfo();
 
-  size_t dispatched =
-      service_->DispatchManyCommands(absl::MakeSpan(squash_cmds), reply_builder_.get(), cc_.get());
+      auto& pmsg = get<MCPipelineMessagePtr>(msg.handle);
+      squash_cmds.push_back({&pmsg->cmd, pmsg->value});
+    }
+
+    num_cmds = squash_cmds.size();
+    dispatched = service_->DispatchManyMCCommands(
+        squash_cmds, static_cast<MCReplyBuilder*>(reply_builder_.get()), cc_.get());
+  }
 
-  if (pending_pipeline_cmd_cnt_ == squash_cmds.size()) {  // Flush if no new commands appeared
+  if (pending_pipeline_cmd_cnt_ == num_cmds) {  // Flush if no new commands appeared
     reply_builder_->Flush();
     reply_builder_->SetBatchMode(false);  // in case the next dispatch is sync
   }
@@ -1509,7 +1647,7 @@ void Connection::SquashPipeline() {
   dispatch_q_.erase(it, it + dispatched);
 
   // If interrupted due to pause, fall back to regular dispatch
-  skip_next_squashing_ = dispatched != squash_cmds.size();
+  skip_next_squashing_ = dispatched != num_cmds;
 }
 
 void Connection::ClearPipelinedMessages() {
@@ -1577,11 +1715,18 @@ void Connection::AsyncFiber() {
   while (!reply_builder_->GetError()) {
     DCHECK_EQ(socket()->proactor(), ProactorBase::me());
     cnd_.wait(noop_lk, [this] {
-      return cc_->conn_closing || (!dispatch_q_.empty() && !cc_->sync_dispatch);
+      return cc_->conn_closing || pub_overflow_closed_ ||
+             (!dispatch_q_.empty() && !cc_->sync_dispatch);
     });
     if (cc_->conn_closing)
       break;
 
+    if (pub_overflow_closed_) {
+      ShutdownSelf();
+      cc_->conn_closing = true;
+      break;
+    }
+
     // We really want to have batching in the builder if possible. This is especially
     // critical in situations where Nagle's algorithm can introduce unwanted high
     // latencies. However we can only batch if we're sure that there are more commands
@@ -1650,7 +1795,7 @@ void Connection::AsyncFiber() {
   qbp.pipeline_cnd.notify_all();
 }
 
-Connection::PipelineMessagePtr Connection::FromArgs(RespVec args, mi_heap_t* heap) {
+Connection::PipelineMessagePtr Connection::FromArgs(const RespVec& args, mi_heap_t* heap) {
   DCHECK(!args.empty());
   size_t backed_sz = 0;
   for (const auto& arg : args) {
@@ -1665,11 +1810,18 @@ Connection::PipelineMessagePtr Connection::FromArgs(RespVec args, mi_heap_t* hea
 
   PipelineMessagePtr ptr;
   if (ptr = GetFromPipelinePool(); ptr) {
+    size_t capacity = ptr->StorageCapacity();
     ptr->Reset(args.size(), backed_sz);
+    if (ptr->StorageCapacity() > capacity) {
+      ++pipeline_msg_allocs_;
+      ++stats_->request_allocs;
+    }
   } else {
     void* heap_ptr = mi_heap_malloc_small(heap, sizeof(PipelineMessage));
     // We must construct in place here, since there is a slice that uses memory locations
     ptr.reset(new (heap_ptr) PipelineMessage(args.size(), backed_sz));
+    ++pipeline_msg_allocs_;
+    ++stats_->request_allocs;
   }
 
   ptr->SetArgs(args);
@@ -1742,7 +1894,56 @@ bool Connection::IsCurrentlyDispatching() const {
 
 void Connection::SendPubMessageAsync(PubMessage msg) {
   void* ptr = mi_malloc(sizeof(PubMessage));
-  SendAsync({PubMessagePtr{new (ptr) PubMessage{std::move(msg)}, MessageDeleter{}}});
+  MessageHandle handle{PubMessagePtr{new (ptr) PubMessage{std::move(msg)}, MessageDeleter{}}};
+
+  const QueueBackpressure& qbp = GetQueueBackpressure();
+  if (size_t limit = qbp.subscriber_buffer_limit; limit > 0) {
+    size_t size = handle.UsedMemory();
+    if (pub_queue_bytes_ + size > limit &&
+        !HandlePubOverflow(size, limit, qbp.subscriber_overflow_policy)) {
+      return;
+    }
+  }
+
+  SendAsync(std::move(handle));
+}
+
+bool Connection::HandlePubOverflow(size_t size, size_t limit, PubOverflowPolicy policy) {
+  if (pub_overflow_closed_ || cc_->conn_closing)
+    return false;
+
+  switch (policy) {
+    case PubOverflowPolicy::DROP_NEWEST:
+      break;
+    case PubOverflowPolicy::DROP_OLDEST: {
+      auto it = dispatch_q_.begin();
+      while (it != dispatch_q_.end() && pub_queue_bytes_ + size > limit) {
+        if (!it->IsPubMsg()) {
+          ++it;
+          continue;
+        }
+        RecycleMessage(std::move(*it));
+        it = dispatch_q_.erase(it);
+        ++pub_dropped_;
+        ++stats_->pubsub_dropped_messages;
+      }
+      GetQueueBackpressure().pubsub_ec.notify();
+      return true;
+    }
+    case PubOverflowPolicy::DISCONNECT:
+      LOG_EVERY_T(INFO, 1) << "Disconnecting subscriber over subscriber_buffer_limit "
+                           << DebugInfo();
+      // We may run in a brief callback, so the async fiber shuts down the socket.
+      pub_overflow_closed_ = true;
+      ++stats_->pubsub_overflow_disconnects;
+      LaunchAsyncFiberIfNeeded();
+      cnd_.notify_one();
+      return false;
+  }
+
+  ++pub_dropped_;
+  ++stats_->pubsub_dropped_messages;
+  return false;
 }
 
 void Connection::SendMonitorMessageAsync(string msg) {
@@ -1807,10 +2008,10 @@ void Connection::SendAsync(MessageHandle msg) {
     QueueBackpressure& qbp = GetQueueBackpressure();
     qbp.subscriber_bytes.fetch_add(used_mem, memory_order_relaxed);
     stats_->dispatch_queue_subscriber_bytes += used_mem;
+    pub_queue_bytes_ += used_mem;
   }
 
-  // Squashing is only applied to redis commands
-  if (std::holds_alternative<PipelineMessagePtr>(msg.handle)) {
+  if (msg.IsPipelineMsg()) {
     pending_pipeline_cmd_cnt_++;
   }
 
@@ -1839,16 +2040,17 @@ void Connection::RecycleMessage(MessageHandle msg) {
   if (msg.IsPubMsg()) {
     qbp.subscriber_bytes.fetch_sub(used_mem, memory_order_relaxed);
     stats_->dispatch_queue_subscriber_bytes -= used_mem;
+    pub_queue_bytes_ -= used_mem;
   }
 
   if (msg.IsPipelineMsg()) {
     ++stats_->pipelined_cmd_cnt;
     stats_->pipelined_cmd_latency += (ProactorBase::GetMonotonicTimeNs() - msg.dispatch_ts) / 1000;
+    pending_pipeline_cmd_cnt_--;
   }
 
   // Retain pipeline message in pool.
   if (auto* pipe = get_if<PipelineMessagePtr>(&msg.handle); pipe) {
-    pending_pipeline_cmd_cnt_--;
     if (stats_->pipeline_cmd_cache_bytes < qbp.pipeline_cache_limit) {
       stats_->pipeline_cmd_cache_bytes += (*pipe)->StorageCapacity();
       pipeline_req_pool_.push_back(std::move(*pipe));
@@ -1920,6 +2122,8 @@ Connection::MemoryUsage Connection::GetMemoryUsage() const {
                dfly::HeapSize(tmp_parse_args_) + dfly::HeapSize(tmp_cmd_vec_) +
                dfly::HeapSize(memcache_parser_) + dfly::HeapSize(redis_parser_) +
                dfly::HeapSize(cc_) + dfly::HeapSize(reply_builder_);
+  if (transport_)
+    mem += transport_->UsedMemory();
 
   // We add a hardcoded 9k value to accomodate for the part of the Fiber stack that is in use.
   // The allocated stack is actually larger (~130k), but only a small fraction of that (9k
@@ -1953,8 +2157,12 @@ void Connection::ConfigureProvidedBuffer() {
 #ifdef __linux__
     auto* up = static_cast<fb2::UringProactor*>(socket_->proactor());
 
-    // If bufring is enabled, configure the socket to use it.
-    recv_provided_ = up->BufRingEntrySize(kRecvSockGid) > 0;
+    // If bufring is enabled, configure the socket to use it. Memcache parsing needs contiguous
+    // input, so only the redis parser, that stashes partial requests, reads from the ring.
+    // While the ring of this thread is exhausted, new connections keep to their own buffers.
+    bool ring_available = time(nullptr) - tl_bufring_exhausted_ts > kBufRingCooldownSec;
+    recv_provided_ =
+        up->BufRingEntrySize(kRecvSockGid) > 0 && redis_parser_ != nullptr && ring_available;
     if (recv_provided_) {
       auto* us = static_cast<fb2::UringSocket*>(socket_.get());
       us->set_bufring_id(kRecvSockGid);
@@ -2030,6 +2238,14 @@ void Connection::SetPipelineBufferLimit(unsigned tid, size_t val) {
   thread_queue_backpressure[tid].pipeline_cnd.notify_all();
 }
 
+void Connection::SetSubscriberBufferLimit(unsigned tid, size_t val) {
+  thread_queue_backpressure[tid].subscriber_buffer_limit = val;
+}
+
+void Connection::SetSubscriberOverflowPolicy(unsigned tid, PubOverflowPolicy policy) {
+  thread_queue_backpressure[tid].subscriber_overflow_policy = policy;
+}
+
 void Connection::GetRequestSizeHistogramThreadLocal(std::string* hist) {
   if (io_req_size_hist)
     *hist = io_req_size_hist->ToString();
@@ -44,10 +44,23 @@ constexpr size_t kReqStorageSize = 120;
 namespace facade {
 
 class ConnectionContext;
+class FrameCodec;
+class FramedTransport;
 class RedisParser;
 class ServiceInterface;
 class SinkReplyBuilder;
 
+// What to do with a message published to a subscriber whose queued pub/sub messages exceed
+// subscriber_buffer_limit.
+enum class PubOverflowPolicy : uint8_t {
+  DROP_OLDEST,  // drop queued messages, starting with the oldest, until the new one fits
+  DROP_NEWEST,  // drop the new message
+  DISCONNECT,   // disconnect the subscriber
+};
+
+bool AbslParseFlag(std::string_view in, PubOverflowPolicy* policy, std::string* err);
+std::string AbslUnparseFlag(PubOverflowPolicy policy);
+
 // Connection represents an active connection for a client.
 //
 // It directly dispatches regular commands from the io-loop.
@@ -127,8 +140,9 @@ class Connection : public util::Connection {
     util::fb2::BlockingCounter bc;  // Decremented counter when processed
   };
 
+  // Invalidates the keys in the client side cache, or all of them due to a flush.
   struct InvalidationMessage {
-    std::string key;
+    std::vector<std::string> keys;
     bool invalidate_due_to_flush = false;
   };
 
@@ -273,6 +287,15 @@ class Connection : public util::Connection {
   // Returns a map of 'libname:libver'->count, thread local data
   static const absl::flat_hash_map<std::string, uint64_t>& GetLibStatsTL();
 
+  // Switches the connection to the compressed transport (see FramedTransport) after sending the
+  // pending replies. Must be called by a command that was dispatched synchronously, because the
+  // client is expected to send the following requests framed.
+  void EnableFramedTransport(std::unique_ptr<FrameCodec> codec, size_t min_compress_size);
+
+  bool IsFramedTransport() const {
+    return bool(transport_);
+  }
+
   std::string_view GetName() const {
     return name_;
   }
@@ -305,6 +328,8 @@ class Connection : public util::Connection {
   // Sets max queue length locally in the calling thread.
   static void SetMaxQueueLenThreadLocal(unsigned tid, uint32_t val);
   static void SetPipelineBufferLimit(unsigned tid, size_t val);
+  static void SetSubscriberBufferLimit(unsigned tid, size_t val);
+  static void SetSubscriberOverflowPolicy(unsigned tid, PubOverflowPolicy policy);
   static void GetRequestSizeHistogramThreadLocal(std::string* hist);
   static void TrackRequestSize(bool enable);
   static void EnsureMemoryBudget(unsigned tid);
@@ -359,7 +384,7 @@ class Connection : public util::Connection {
   void RecycleMessage(MessageHandle msg);
 
   // Create new pipeline request, re-use from pool when possible.
-  PipelineMessagePtr FromArgs(RespVec args, mi_heap_t* heap);
+  PipelineMessagePtr FromArgs(const RespVec& args, mi_heap_t* heap);
 
   ParserStatus ParseRedis();
   ParserStatus ParseMemcache();
@@ -374,6 +399,7 @@ class Connection : public util::Connection {
 
   void HandleMigrateRequest();
   std::error_code HandleRecvSocket();
+  std::error_code HandleRecvFramed();
 
   bool ShouldEndAsyncFiber(const MessageHandle& msg);
 
@@ -392,6 +418,10 @@ class Connection : public util::Connection {
 
   void ConfigureProvidedBuffer();
 
+  // Applies the overflow policy before queuing a pub/sub message of the given size that does not
+  // fit into the subscriber limit. Returns true if the message should still be queued.
+  bool HandlePubOverflow(size_t size, size_t limit, PubOverflowPolicy policy);
+
   // The read buffer with read data that needs to be parsed and processed.
   // For io_uring bundles we may have available_bytes larger than slice.size()
   // which means that there are more buffers available to read.
@@ -420,7 +450,10 @@ class Connection : public util::Connection {
   util::fb2::CondVarAny cnd_;             // dispatch queue waker
   util::fb2::Fiber async_fb_;             // async fiber (if started)
 
-  uint64_t pending_pipeline_cmd_cnt_ = 0;  // how many queued Redis async commands in dispatch_q
+  uint64_t pending_pipeline_cmd_cnt_ = 0;  // how many queued async commands in dispatch_q
+
+  size_t pub_queue_bytes_ = 0;  // memory of the pub/sub messages in dispatch_q_
+  uint64_t pub_dropped_ = 0;    // pub/sub messages dropped due to subscriber_buffer_limit
 
   // how many bytes of the current request have been consumed
   size_t request_consumed_bytes_ = 0;
@@ -435,6 +468,7 @@ class Connection : public util::Connection {
   ConnectionStats* stats_ = nullptr;
 
   std::unique_ptr<SinkReplyBuilder> reply_builder_;
+  std::unique_ptr<FramedTransport> transport_;  // set if the client enabled compression
   util::HttpListenerBase* http_listener_;
   SSL_CTX* ssl_ctx_;
 
@@ -458,6 +492,7 @@ class Connection : public util::Connection {
   // Used by redis parser to avoid allocations
   RespVec tmp_parse_args_;
   CmdArgVec tmp_cmd_vec_;
+  uint64_t pipeline_msg_allocs_ = 0;  // pipeline messages that could not reuse pooled memory
 
   // Used to keep track of borrowed references. Does not really own itself
   std::shared_ptr<Connection> self_;
@@ -482,6 +517,7 @@ class Connection : public util::Connection {
       bool is_tls_ : 1;
       bool recv_provided_ : 1;
       bool is_main_ : 1;
+      bool pub_overflow_closed_ : 1;  // disconnected due to subscriber_buffer_limit
     };
   };
 };
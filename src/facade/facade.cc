@@ -20,7 +20,7 @@ constexpr size_t kSizeConnStats = sizeof(ConnectionStats);
 
 ConnectionStats& ConnectionStats::operator+=(const ConnectionStats& o) {
   // To break this code deliberately if we add/remove a field to this struct.
-  static_assert(kSizeConnStats == 136u);
+  static_assert(kSizeConnStats == 168u);
 
   ADD(read_buf_capacity);
   ADD(dispatch_queue_entries);
@@ -39,7 +39,11 @@ ConnectionStats& ConnectionStats::operator+=(const ConnectionStats& o) {
   ADD(num_blocked_clients);
   ADD(num_migrations);
   ADD(num_recv_provided_calls);
+  ADD(num_recv_provided_exhausted);
+  ADD(pubsub_dropped_messages);
+  ADD(pubsub_overflow_disconnects);
   ADD(pipeline_throttle_count);
+  ADD(request_allocs);
 
   return *this;
 }
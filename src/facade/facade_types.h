@@ -110,10 +110,19 @@ struct ConnectionStats {
   uint32_t num_blocked_clients = 0;
   uint64_t num_migrations = 0;
   uint64_t num_recv_provided_calls = 0;
+  uint64_t num_recv_provided_exhausted = 0;  // recv calls that found no free provided buffer
+
+  // Pub/sub messages dropped and subscribers disconnected due to subscriber_buffer_limit.
+  uint64_t pubsub_dropped_messages = 0;
+  uint64_t pubsub_overflow_disconnects = 0;
 
   // Number of events when the pipeline queue was over the limit and was throttled.
   uint64_t pipeline_throttle_count = 0;
 
+  // Heap allocations for storing the parsed requests: stashes of the parser for requests split
+  // between reads and the pipeline messages that could not reuse pooled memory.
+  uint64_t request_allocs = 0;
+
   ConnectionStats& operator+=(const ConnectionStats& o);
 };
 
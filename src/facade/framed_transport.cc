@@ -0,0 +1,129 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "facade/framed_transport.h"
+
+#include <absl/base/internal/endian.h>
+#include <absl/container/inlined_vector.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "base/logging.h"
+
+namespace facade {
+
+using namespace std;
+
+namespace {
+
+constexpr size_t kMaxPayloadLen = numeric_limits<uint32_t>::max();
+constexpr size_t kMinReadSize = 4096;
+
+// Shrink the scratch buffer after compressing big replies.
+constexpr size_t kMaxRetainedScratch = 1 << 20;
+
+}  // namespace
+
+FramedTransport::FramedTransport(io::Sink* upstream, unique_ptr<FrameCodec> codec,
+                                 size_t min_compress_size, size_t max_frame_size)
+    : upstream_{upstream},
+      codec_{std::move(codec)},
+      min_compress_size_{min_compress_size},
+      max_frame_size_{min(max_frame_size, kMaxPayloadLen)},
+      input_{kMinReadSize} {
+}
+
+io::Result<size_t> FramedTransport::WriteSome(const iovec* v, uint32_t len) {
+  // Writes larger than a frame are split by the callers of WriteSome.
+  absl::InlinedVector<iovec, 16> payload;
+  size_t payload_len = 0;
+  for (uint32_t i = 0; i < len && payload_len < kMaxPayloadLen; ++i) {
+    size_t part = min(v[i].iov_len, kMaxPayloadLen - payload_len);
+    payload.push_back(iovec{v[i].iov_base, part});
+    payload_len += part;
+  }
+
+  error_code ec;
+  if (payload_len < min_compress_size_) {
+    ec = WriteFrame(0, payload.data(), payload.size(), payload_len);
+  } else {
+    scratch_.clear();
+    for (const iovec& part : payload)
+      scratch_.append(reinterpret_cast<const char*>(part.iov_base), part.iov_len);
+
+    // Incompressible data is sent raw.
+    auto res = codec_->Compress(io::Buffer(scratch_));
+    if (res && res->size() < payload_len) {
+      iovec compressed{const_cast<uint8_t*>(res->data()), res->size()};
+      ec = WriteFrame(kCompressedFlag, &compressed, 1, res->size());
+    } else {
+      iovec raw{scratch_.data(), scratch_.size()};
+      ec = WriteFrame(0, &raw, 1, payload_len);
+    }
+
+    if (scratch_.capacity() > kMaxRetainedScratch) {
+      scratch_.clear();
+      scratch_.shrink_to_fit();
+    }
+  }
+
+  if (ec)
+    return nonstd::make_unexpected(ec);
+  return payload_len;
+}
+
+error_code FramedTransport::WriteFrame(uint8_t flags, const iovec* v, uint32_t len,
+                                       size_t payload_len) {
+  uint8_t header[kHeaderSize];
+  header[0] = flags;
+  absl::little_endian::Store32(header + 1, payload_len);
+
+  absl::InlinedVector<iovec, 16> frame;
+  frame.push_back(iovec{header, kHeaderSize});
+  frame.insert(frame.end(), v, v + len);
+  return upstream_->Write(frame.data(), frame.size());
+}
+
+io::MutableBytes FramedTransport::PrepareRead() {
+  size_t required = kMinReadSize;
+  if (input_.InputLen() >= kHeaderSize) {
+    size_t frame_len = kHeaderSize + absl::little_endian::Load32(input_.InputBuffer().data() + 1);
+    if (frame_len <= kHeaderSize + max_frame_size_ && frame_len > input_.InputLen())
+      required = max(required, frame_len - input_.InputLen());
+  }
+
+  input_.EnsureCapacity(required);
+  return input_.AppendBuffer();
+}
+
+error_code FramedTransport::CommitRead(size_t len, io::IoBuf* dest) {
+  input_.CommitWrite(len);
+
+  while (input_.InputLen() >= kHeaderSize) {
+    const uint8_t* header = input_.InputBuffer().data();
+    uint8_t flags = header[0];
+    size_t payload_len = absl::little_endian::Load32(header + 1);
+    if ((flags & ~kCompressedFlag) != 0 || payload_len > max_frame_size_) {
+      VLOG(1) << "Bad frame with flags " << unsigned(flags) << " and length " << payload_len;
+      return make_error_code(errc::bad_message);
+    }
+
+    if (input_.InputLen() < kHeaderSize + payload_len)
+      break;
+
+    io::Bytes payload = input_.InputBuffer().subspan(kHeaderSize, payload_len);
+    if (flags & kCompressedFlag) {
+      if (error_code ec = codec_->Decompress(payload, max_frame_size_, dest); ec)
+        return ec;
+    } else {
+      dest->WriteAndCommit(payload.data(), payload.size());
+    }
+    input_.ConsumeInput(kHeaderSize + payload_len);
+  }
+
+  return {};
+}
+
+}  // namespace facade
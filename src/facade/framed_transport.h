@@ -0,0 +1,67 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <system_error>
+
+#include "io/io.h"
+#include "io/io_buf.h"
+
+namespace facade {
+
+// Compresses the frame payloads of FramedTransport. Implemented by the server, which links the
+// compression libraries.
+class FrameCodec {
+ public:
+  virtual ~FrameCodec() = default;
+
+  // Returns the compressed data, which stays valid until the next call.
+  virtual io::Result<io::Bytes> Compress(io::Bytes data) = 0;
+
+  // Appends the decompressed data to dest. Fails if it would be larger than max_size.
+  virtual std::error_code Decompress(io::Bytes data, size_t max_size, io::IoBuf* dest) = 0;
+};
+
+// Stream of a connection that switched to the compressed transport with CLIENT COMPRESSION.
+// Requests and replies are sent in frames of the form:
+// flags (1 byte) | payload length (4 bytes, little endian) | payload,
+// where the payload is compressed if flags is kCompressedFlag. Replies smaller than
+// min_compress_size are sent raw, because compressing them does not pay off.
+class FramedTransport : public io::Sink {
+ public:
+  static constexpr size_t kHeaderSize = 5;
+  static constexpr uint8_t kCompressedFlag = 1;
+
+  FramedTransport(io::Sink* upstream, std::unique_ptr<FrameCodec> codec, size_t min_compress_size,
+                  size_t max_frame_size);
+
+  // Sends the data as a single frame.
+  io::Result<size_t> WriteSome(const iovec* v, uint32_t len) final;
+
+  // Returns the buffer to receive the next bytes into, which can hold the frame that is being
+  // received.
+  io::MutableBytes PrepareRead();
+
+  // Commits len received bytes and appends the payloads of the complete frames to dest.
+  std::error_code CommitRead(size_t len, io::IoBuf* dest);
+
+  size_t UsedMemory() const {
+    return input_.Capacity() + scratch_.capacity();
+  }
+
+ private:
+  std::error_code WriteFrame(uint8_t flags, const iovec* v, uint32_t len, size_t payload_len);
+
+  io::Sink* upstream_;
+  std::unique_ptr<FrameCodec> codec_;
+  size_t min_compress_size_, max_frame_size_;
+
+  io::IoBuf input_;      // received bytes that were not decoded yet
+  std::string scratch_;  // gathers the replies to compress them
+};
+
+}  // namespace facade
@@ -0,0 +1,144 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "facade/framed_transport.h"
+
+#include <absl/base/internal/endian.h>
+
+#include "base/gtest.h"
+#include "base/logging.h"
+#include "facade/facade_types.h"
+#include "facade/reply_builder.h"
+
+using namespace testing;
+using namespace std;
+
+namespace facade {
+
+namespace {
+
+// Run length encoding with pairs of (count, byte).
+class RleCodec : public FrameCodec {
+ public:
+  io::Result<io::Bytes> Compress(io::Bytes data) final {
+    out_.clear();
+    for (size_t i = 0; i < data.size();) {
+      size_t run = 1;
+      while (i + run < data.size() && run < 255 && data[i + run] == data[i])
+        ++run;
+      out_.push_back(uint8_t(run));
+      out_.push_back(data[i]);
+      i += run;
+    }
+    return io::Bytes(out_.data(), out_.size());
+  }
+
+  error_code Decompress(io::Bytes data, size_t max_size, io::IoBuf* dest) final {
+    string res;
+    for (size_t i = 0; i + 1 < data.size(); i += 2)
+      res.append(data[i], data[i + 1]);
+    if (res.size() > max_size)
+      return make_error_code(errc::message_size);
+    dest->WriteAndCommit(res.data(), res.size());
+    return {};
+  }
+
+ private:
+  vector<uint8_t> out_;
+};
+
+string Frame(uint8_t flags, string_view payload) {
+  string res(FramedTransport::kHeaderSize, '\0');
+  res[0] = flags;
+  absl::little_endian::Store32(res.data() + 1, payload.size());
+  return res.append(payload);
+}
+
+}  // namespace
+
+class FramedTransportTest : public Test {
+ protected:
+  static void SetUpTestSuite() {
+    tl_facade_stats = new FacadeStats;
+  }
+
+  FramedTransportTest() : transport_{&sink_, make_unique<RleCodec>(), 64, 1024} {
+  }
+
+  // Feeds data in chunks of chunk_size bytes.
+  error_code Feed(string_view data, size_t chunk_size) {
+    while (!data.empty()) {
+      io::MutableBytes buf = transport_.PrepareRead();
+      size_t len = min({chunk_size, buf.size(), data.size()});
+      memcpy(buf.data(), data.data(), len);
+      data.remove_prefix(len);
+      if (auto ec = transport_.CommitRead(len, &decoded_); ec)
+        return ec;
+    }
+    return {};
+  }
+
+  string_view Decoded() {
+    return ToSV(decoded_.InputBuffer());
+  }
+
+  io::StringSink sink_;
+  FramedTransport transport_;
+  io::IoBuf decoded_;
+};
+
+TEST_F(FramedTransportTest, Write) {
+  RedisReplyBuilder builder{&transport_};
+
+  builder.SendOk();
+  EXPECT_EQ(sink_.str(), Frame(0, "+OK\r\n"));
+
+  // Large replies are compressed unless they do not get smaller.
+  sink_.Clear();
+  builder.SendSimpleString(string(300, 'a'));
+  string compressed = {char(255), 'a', char(45), 'a', 1, '\r', 1, '\n'};
+  EXPECT_EQ(sink_.str(), Frame(FramedTransport::kCompressedFlag, "\1+" + compressed));
+
+  sink_.Clear();
+  string mixed;
+  for (unsigned i = 0; i < 100; ++i)
+    mixed.push_back('a' + i % 26);
+  builder.SendSimpleString(mixed);
+  EXPECT_EQ(sink_.str(), Frame(0, "+" + mixed + "\r\n"));
+}
+
+TEST_F(FramedTransportTest, Read) {
+  string frames = Frame(0, "*1\r\n$4\r\nPING\r\n") + Frame(1, "\3a\2b") + Frame(0, "");
+  for (size_t chunk_size : {1, 3, 1000}) {
+    decoded_.Clear();
+    ASSERT_FALSE(Feed(frames, chunk_size));
+    EXPECT_EQ(Decoded(), "*1\r\n$4\r\nPING\r\naaabb");
+  }
+
+  // A partial frame stays pending.
+  decoded_.Clear();
+  ASSERT_FALSE(Feed(Frame(0, "abcdef").substr(0, 8), 100));
+  EXPECT_EQ(Decoded(), "");
+  ASSERT_FALSE(Feed("def", 100));
+  EXPECT_EQ(Decoded(), "abcdef");
+
+  // A large frame is received into a single buffer.
+  decoded_.Clear();
+  ASSERT_FALSE(Feed(Frame(0, string(1000, 'x')), 10000));
+  EXPECT_EQ(Decoded(), string(1000, 'x'));
+}
+
+TEST_F(FramedTransportTest, BadFrames) {
+  EXPECT_EQ(Feed(Frame(2, "abc"), 100), errc::bad_message);
+}
+
+TEST_F(FramedTransportTest, FrameTooLarge) {
+  EXPECT_EQ(Feed(Frame(0, string(2000, 'x')), 100), errc::bad_message);
+}
+
+TEST_F(FramedTransportTest, DecompressedTooLarge) {
+  EXPECT_EQ(Feed(Frame(1, string(20, char(255))), 100), errc::message_size);
+}
+
+}  // namespace facade
@@ -38,6 +38,13 @@ class OkService : public ServiceInterface {
     builder->SendError("");
   }
 
+  size_t DispatchManyMCCommands(absl::Span<const MCCommandRef> cmds, MCReplyBuilder* builder,
+                                ConnectionContext* cntx) final {
+    for (const auto& ref : cmds)
+      DispatchMC(*ref.cmd, ref.value, builder, cntx);
+    return cmds.size();
+  }
+
   ConnectionContext* CreateContext(Connection* owner) final {
     return new ConnectionContext{owner};
   }
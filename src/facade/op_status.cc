@@ -38,6 +38,8 @@ std::string_view StatusToMsg(OpStatus status) {
       return kInvalidJsonPathErr;
     case OpStatus::INVALID_JSON:
       return kJsonParseError;
+    case OpStatus::TRY_AGAIN:
+      return "-TRYAGAIN The value is being loaded from disk, try again";
     default:
       LOG(ERROR) << "Unsupported status " << status;
       return "Internal error";
@@ -32,6 +32,7 @@ enum class OpStatus : uint16_t {
   MEMBER_NOTFOUND,
   INVALID_JSON_PATH,
   INVALID_JSON,
+  TRY_AGAIN,
 };
 
 class OpResultBase {
@@ -9,11 +9,56 @@
 
 #include "base/logging.h"
 #include "core/heap_size.h"
+#include "core/sse_port.h"
 
 namespace facade {
 
 using namespace std;
 
+namespace {
+
+// Lengths with more digits fall back to the state machine, so the fast path can't overflow.
+constexpr unsigned kMaxFastLenDigits = 18;
+
+constexpr size_t kMinStashChunk = 512;
+constexpr size_t kMaxRetainedStashChunk = 4096;
+
+// Returns the position of the first '\r' in [ptr, end) or end if there is none.
+inline const uint8_t* FindCR(const uint8_t* ptr, const uint8_t* end) {
+#ifndef __s390x__
+  const __m128i cr = _mm_set1_epi8('\r');
+  for (; end - ptr >= 16; ptr += 16) {
+    __m128i chunk = dfly::mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, cr));
+    if (mask)
+      return ptr + __builtin_ctz(mask);
+  }
+#endif
+  const void* pos = memchr(ptr, '\r', end - ptr);
+  return pos ? static_cast<const uint8_t*>(pos) : end;
+}
+
+// Parses a non-negative length followed by \r\n. Returns the position after the line or nullptr
+// if the line is incomplete or has any unusual form.
+inline const uint8_t* ParseLenLine(const uint8_t* ptr, const uint8_t* end, uint64_t* len) {
+  const uint8_t* limit = size_t(end - ptr) > kMaxFastLenDigits ? ptr + kMaxFastLenDigits + 1 : end;
+  const uint8_t* cr = FindCR(ptr, limit);
+  if (cr == ptr || end - cr < 2 || *cr != '\r' || cr[1] != '\n')
+    return nullptr;
+
+  uint64_t val = 0;
+  for (; ptr != cr; ++ptr) {
+    unsigned digit = *ptr - '0';
+    if (digit > 9)
+      return nullptr;
+    val = val * 10 + digit;
+  }
+  *len = val;
+  return cr + 2;
+}
+
+}  // namespace
+
 auto RedisParser::Parse(Buffer str, uint32_t* consumed, RespExpr::Vec* res) -> Result {
   DCHECK(!str.empty());
   *consumed = 0;
@@ -22,6 +67,11 @@ auto RedisParser::Parse(Buffer str, uint32_t* consumed, RespExpr::Vec* res) -> R
   DVLOG(2) << "Parsing: "
            << absl::CHexEscape(string_view{reinterpret_cast<const char*>(str.data()), str.size()});
 
+  if (state_ == CMD_COMPLETE_S && server_mode_ && str[0] == '*' &&
+      ParseCompleteCommand(str, consumed, res)) {
+    return OK;
+  }
+
   if (state_ == CMD_COMPLETE_S) {
     if (InitStart(str[0], res)) {
       // We recognized a non-INLINE state, starting with a special char.
@@ -112,9 +162,45 @@ auto RedisParser::Parse(Buffer str, uint32_t* consumed, RespExpr::Vec* res) -> R
   return resultc.first;
 }
 
+bool RedisParser::ParseCompleteCommand(Buffer str, uint32_t* consumed, RespExpr::Vec* res) {
+  const uint8_t* ptr = str.data();
+  const uint8_t* end = ptr + str.size();
+
+  uint64_t arr_len = 0;
+  ptr = ParseLenLine(ptr + 1, end, &arr_len);  // skip '*'
+
+  // Every argument takes at least 6 bytes ($0\r\n\r\n), so larger arrays are not complete.
+  if (!ptr || arr_len == 0 || arr_len > max_arr_len_ || arr_len > size_t(end - ptr) / 6)
+    return false;
+
+  res->reserve(arr_len);
+  for (uint64_t i = 0; i < arr_len; ++i) {
+    uint64_t len = 0;
+    if (ptr == end || *ptr != '$' || !(ptr = ParseLenLine(ptr + 1, end, &len)) ||
+        len > max_bulk_len_ || size_t(end - ptr) < len + 2 || ptr[len] != '\r' ||
+        ptr[len + 1] != '\n') {
+      res->clear();
+      return false;
+    }
+
+    res->emplace_back(RespExpr::STRING);
+    res->back().u = Buffer{ptr, size_t(len)};
+    ptr += len + 2;
+  }
+
+  // Same state as after the state machine completes a command.
+  ResetStash();
+  parse_stack_.clear();
+  cached_expr_ = res;
+  last_stashed_level_ = 0;
+  last_stashed_index_ = 0;
+
+  *consumed = ptr - str.data();
+  return true;
+}
+
 bool RedisParser::InitStart(char prefix_b, RespExpr::Vec* res) {
-  buf_stash_.clear();
-  stash_.clear();
+  ResetStash();
   cached_expr_ = res;
   parse_stack_.clear();
   last_stashed_level_ = 0;
@@ -151,8 +237,8 @@ void RedisParser::StashState(RespExpr::Vec* res) {
   }
 
   if (cached_expr_ == res) {
-    stash_.emplace_back(new RespExpr::Vec(*res));
-    cached_expr_ = stash_.back().get();
+    cached_expr_ = NewStashVec();
+    *cached_expr_ = *res;
   }
 
   DCHECK_LT(last_stashed_level_, stash_.size());
@@ -166,10 +252,9 @@ void RedisParser::StashState(RespExpr::Vec* res) {
         if (ebuf.empty() && last_stashed_index_ + 1 == cur.size())
           break;
         if (!ebuf.empty() && !e.has_support) {
-          Blob blob(ebuf.size());
-          memcpy(blob.data(), ebuf.data(), ebuf.size());
-          ebuf = Buffer{blob.data(), blob.size()};
-          buf_stash_.push_back(std::move(blob));
+          uint8_t* copy = arena_.Allocate(ebuf.size());
+          memcpy(copy, ebuf.data(), ebuf.size());
+          ebuf = Buffer{copy, ebuf.size()};
           e.has_support = true;
         }
       }
@@ -338,8 +423,7 @@ auto RedisParser::ConsumeArrayLen(Buffer str) -> ResultConsumed {
     DCHECK(!server_mode_);
 
     cached_expr_->emplace_back(RespExpr::ARRAY);
-    stash_.emplace_back(new RespExpr::Vec());
-    RespExpr::Vec* arr = stash_.back().get();
+    RespExpr::Vec* arr = NewStashVec();
     arr->reserve(len);
     cached_expr_->back().u = arr;
     cached_expr_ = arr;
@@ -511,10 +595,9 @@ auto RedisParser::ConsumeBulk(Buffer str) -> ResultConsumed {
     DVLOG(1) << "Extending bulk stash to size " << bulk_str.size();
   } else {
     DVLOG(1) << "New bulk stash size " << bulk_len_;
-    vector<uint8_t> nb(bulk_len_);
-    memcpy(nb.data(), str.data(), len);
-    bulk_str = Buffer{nb.data(), len};
-    buf_stash_.emplace_back(std::move(nb));
+    uint8_t* nb = arena_.Allocate(bulk_len_);
+    memcpy(nb, str.data(), len);
+    bulk_str = Buffer{nb, len};
     is_broken_token_ = true;
     cached_expr_->back().has_support = true;
   }
@@ -547,21 +630,95 @@ void RedisParser::HandleFinishArg() {
 
 void RedisParser::ExtendLastString(Buffer str) {
   DCHECK(!cached_expr_->empty() && cached_expr_->back().type == RespExpr::STRING);
-  DCHECK(!buf_stash_.empty());
+  DCHECK(cached_expr_->back().has_support);
 
   Buffer& last_str = get<Buffer>(cached_expr_->back().u);
+  size_t new_size = last_str.size() + str.size();
+  uint8_t* nb = arena_.Extend(const_cast<uint8_t*>(last_str.data()), last_str.size(), new_size);
+  memcpy(nb + last_str.size(), str.data(), str.size());
+  last_str = RespExpr::Buffer{nb, new_size};
+}
 
-  DCHECK(last_str.data() == buf_stash_.back().data());
+void RedisParser::ResetStash() {
+  if (!stash_.empty() && !spare_vec_) {
+    spare_vec_ = std::move(stash_.front());
+    spare_vec_->clear();
+  }
+  stash_.clear();
+  arena_.Reset();
+}
 
-  vector<uint8_t> nb(last_str.size() + str.size());
-  memcpy(nb.data(), last_str.data(), last_str.size());
-  memcpy(nb.data() + last_str.size(), str.data(), str.size());
-  last_str = RespExpr::Buffer{nb.data(), last_str.size() + str.size()};
-  buf_stash_.back() = std::move(nb);
+RespVec* RedisParser::NewStashVec() {
+  if (spare_vec_) {
+    stash_.push_back(std::move(spare_vec_));
+  } else {
+    stash_.emplace_back(new RespVec());
+    ++num_vec_allocs_;
+  }
+  return stash_.back().get();
 }
 
 size_t RedisParser::UsedMemory() const {
-  return dfly::HeapSize(parse_stack_) + dfly::HeapSize(stash_) + dfly::HeapSize(buf_stash_);
+  return dfly::HeapSize(parse_stack_) + dfly::HeapSize(stash_) + dfly::HeapSize(spare_vec_) +
+         arena_.UsedMemory();
+}
+
+uint8_t* RedisParser::StashArena::Allocate(size_t size) {
+  if (chunks_.empty() || chunks_.back().size - offset_ < size) {
+    // Grow geometrically up to the retained size, larger strings get dedicated chunks.
+    size_t chunk_size = chunks_.empty() ? kMinStashChunk : 2 * chunks_.back().size;
+    chunk_size = max(min(chunk_size, kMaxRetainedStashChunk), size);
+    chunks_.push_back(Chunk{unique_ptr<uint8_t[]>(new uint8_t[chunk_size]), chunk_size});
+    offset_ = 0;
+    ++num_allocs_;
+  }
+
+  uint8_t* res = chunks_.back().data.get() + offset_;
+  offset_ += size;
+  return res;
+}
+
+uint8_t* RedisParser::StashArena::Extend(uint8_t* ptr, size_t size, size_t new_size) {
+  DCHECK(!chunks_.empty());
+  uint8_t* start = chunks_.back().data.get();
+  bool is_last = ptr >= start && ptr + size == start + offset_;
+  if (is_last && ptr + new_size <= start + chunks_.back().size) {
+    offset_ += new_size - size;
+    return ptr;
+  }
+
+  uint8_t* res = Allocate(new_size);
+  memcpy(res, ptr, size);
+  return res;
+}
+
+void RedisParser::StashArena::Reset() {
+  offset_ = 0;
+  if (chunks_.size() == 1 && chunks_.front().size <= kMaxRetainedStashChunk)
+    return;
+
+  // Keep the largest chunk that is not too big.
+  size_t retained = chunks_.size();
+  for (size_t i = 0; i < chunks_.size(); ++i) {
+    if (chunks_[i].size > kMaxRetainedStashChunk)
+      continue;
+    if (retained == chunks_.size() || chunks_[i].size > chunks_[retained].size)
+      retained = i;
+  }
+
+  if (retained == chunks_.size()) {
+    chunks_.clear();
+  } else {
+    std::swap(chunks_.front(), chunks_[retained]);
+    chunks_.resize(1);
+  }
+}
+
+size_t RedisParser::StashArena::UsedMemory() const {
+  size_t res = chunks_.capacity() * sizeof(Chunk);
+  for (const Chunk& chunk : chunks_)
+    res += chunk.size;
+  return res;
 }
 
 }  // namespace facade
@@ -69,13 +69,56 @@ class RedisParser {
 
   size_t UsedMemory() const;
 
+  // Number of heap allocations made to stash the commands that were split between reads.
+  uint64_t num_allocs() const {
+    return arena_.num_allocs() + num_vec_allocs_;
+  }
+
  private:
   using ResultConsumed = std::pair<Result, uint32_t>;
 
+  // Bump allocator for the strings that are copied when a command is split between reads.
+  // They are all released when the next command starts, so the arena keeps a chunk to serve
+  // the following commands without allocating.
+  class StashArena {
+   public:
+    uint8_t* Allocate(size_t size);
+
+    // Grows the last allocation in place if it fits, otherwise copies it to a new allocation.
+    uint8_t* Extend(uint8_t* ptr, size_t size, size_t new_size);
+
+    void Reset();
+
+    size_t UsedMemory() const;
+
+    uint64_t num_allocs() const {
+      return num_allocs_;
+    }
+
+   private:
+    struct Chunk {
+      std::unique_ptr<uint8_t[]> data;
+      size_t size;
+    };
+
+    std::vector<Chunk> chunks_;
+    size_t offset_ = 0;  // used bytes of the last chunk
+    uint64_t num_allocs_ = 0;
+  };
+
+  // Parses an array of bulk strings that is fully present in str in one pass. This is the
+  // common form of client requests. Returns false without changing the parser state if the
+  // command is incomplete or has any other form, so that the state machine handles it.
+  bool ParseCompleteCommand(Buffer str, uint32_t* consumed, RespVec* res);
+
   // Returns true if this is a RESP message, false if INLINE.
   bool InitStart(char prefix_b, RespVec* res);
   void StashState(RespVec* res);
 
+  // Releases the stashed state of the previous command, retaining the memory for the next one.
+  void ResetStash();
+  RespVec* NewStashVec();
+
   // Skips the first character (*).
   ResultConsumed ConsumeArrayLen(Buffer str);
   ResultConsumed ParseArg(Buffer str);
@@ -115,9 +158,10 @@ class RedisParser {
   // For server mode, the length is at most 1.
   absl::InlinedVector<std::pair<uint32_t, RespVec*>, 4> parse_stack_;
   std::vector<std::unique_ptr<RespVec>> stash_;
+  std::unique_ptr<RespVec> spare_vec_;  // reused by the next stashed command
+  uint64_t num_vec_allocs_ = 0;
 
-  using Blob = std::vector<uint8_t>;
-  std::vector<Blob> buf_stash_;
+  StashArena arena_;
   std::array<char, 32> small_buf_;
 };
 
@@ -288,4 +288,86 @@ TEST_F(RedisParserTest, InlineReset) {
   EXPECT_EQ(13, consumed_);
 }
 
+TEST_F(RedisParserTest, CompleteCommands) {
+  string value(16, 'v');
+  string set_cmd = absl::StrCat("*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$16\r\n", value, "\r\n");
+  string get_cmd = "*2\r\n$3\r\nGET\r\n$3\r\nkey\r\n";
+
+  // Each complete command is parsed in one call and the following ones are left in the buffer.
+  ASSERT_EQ(RedisParser::OK, Parse(set_cmd + get_cmd));
+  EXPECT_EQ(set_cmd.size(), consumed_);
+  EXPECT_THAT(args_, ElementsAre("SET", "key", value));
+  EXPECT_EQ(0u, parser_.stash_size());
+
+  // Binary data and empty strings.
+  ASSERT_EQ(RedisParser::OK, Parse("*2\r\n$4\r\na\r\nb\r\n$0\r\n\r\n"));
+  EXPECT_EQ(20u, consumed_);
+  EXPECT_THAT(args_, ElementsAre("a\r\nb", ""));
+
+  // Incomplete commands are handled by the state machine.
+  ASSERT_EQ(RedisParser::INPUT_PENDING, Parse(get_cmd.substr(0, 20)));
+  EXPECT_EQ(20u, consumed_);
+  ASSERT_EQ(RedisParser::OK, Parse(get_cmd.substr(20) + set_cmd));
+  EXPECT_EQ(get_cmd.size() - 20, consumed_);
+  EXPECT_THAT(args_, ElementsAre("GET", "key"));
+
+  // Malformed commands are reported as before.
+  ASSERT_EQ(RedisParser::BAD_STRING, Parse("*1\r\n$3\r\nGETX\r\n"));
+}
+
+TEST_F(RedisParserTest, StashReuse) {
+  string value(100, 'v');
+  string cmd = absl::StrCat("*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$100\r\n", value, "\r\n");
+
+  // Commands split between reads are stashed in memory that is reused by the following ones.
+  uint64_t allocs = 0;
+  for (unsigned i = 0; i < 3; ++i) {
+    for (size_t split : {10, 20, 30, 100}) {
+      ASSERT_EQ(RedisParser::INPUT_PENDING, Parse(cmd.substr(0, split)));
+      ASSERT_EQ(split, consumed_);
+      ASSERT_EQ(RedisParser::OK, Parse(cmd.substr(split)));
+      EXPECT_THAT(args_, ElementsAre("SET", "key", value));
+    }
+    if (i == 0)
+      allocs = parser_.num_allocs();
+  }
+  EXPECT_GT(allocs, 0u);
+  EXPECT_EQ(allocs, parser_.num_allocs());
+
+  // Inline tokens are extended in place.
+  for (unsigned i = 0; i < 3; ++i) {
+    ASSERT_EQ(RedisParser::INPUT_PENDING, Parse("SET ke"));
+    ASSERT_EQ(RedisParser::INPUT_PENDING, Parse("y va"));
+    ASSERT_EQ(RedisParser::OK, Parse("lue\n"));
+    EXPECT_THAT(args_, ElementsAre("SET", "key", "value"));
+  }
+  EXPECT_EQ(allocs, parser_.num_allocs());
+}
+
+static void BM_ParsePipeline(benchmark::State& state) {
+  string value(state.range(0), 'v');
+  string buf;
+  for (unsigned i = 0; i < 100; ++i) {
+    absl::StrAppend(&buf, "*3\r\n$3\r\nSET\r\n$8\r\nkey:", absl::Dec(i, absl::kZeroPad4),
+                    "\r\n$", value.size(), "\r\n", value, "\r\n");
+    absl::StrAppend(&buf, "*2\r\n$3\r\nGET\r\n$8\r\nkey:", absl::Dec(i, absl::kZeroPad4),
+                    "\r\n");
+  }
+
+  RedisParser parser;
+  RespVec args;
+  while (state.KeepRunning()) {
+    RedisParser::Buffer input{reinterpret_cast<const uint8_t*>(buf.data()), buf.size()};
+    while (!input.empty()) {
+      uint32_t consumed = 0;
+      auto res = parser.Parse(input, &consumed, &args);
+      DCHECK_EQ(RedisParser::OK, res);
+      input.remove_prefix(consumed);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * buf.size());
+  state.SetItemsProcessed(state.iterations() * 200);
+}
+BENCHMARK(BM_ParsePipeline)->Arg(16)->Arg(512);
+
 }  // namespace facade
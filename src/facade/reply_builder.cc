@@ -179,7 +179,8 @@ void SinkReplyBuilder::Send() {
 void SinkReplyBuilder::FinishScope() {
   replies_recorded_++;
 
-  if (!batched_ || total_size_ * 2 >= kMaxBufferSize)
+  // Large references are always sent directly, see kMinDirectRefSize.
+  if (!batched_ || total_size_ >= kMinDirectRefSize)
     return Flush();
 
   // Check if we have enough space to copy all refs to buffer
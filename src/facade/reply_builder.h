@@ -36,6 +36,11 @@ class SinkReplyBuilder {
   constexpr static size_t kMaxInlineSize = 32;
   constexpr static size_t kMaxBufferSize = 8192;
 
+  // Strings of at least this size are never copied by the builder. Outside of ReplyScope they are
+  // written to the socket before the Send call returns, so they need to be valid only for the
+  // duration of the call, which allows replying with values that are pinned only meanwhile.
+  constexpr static size_t kMinDirectRefSize = kMaxBufferSize / 2;
+
   struct PendingPin : public boost::intrusive::list_base_hook<
                           ::boost::intrusive::link_mode<::boost::intrusive::normal_link>> {
     uint64_t timestamp_ns;
@@ -97,6 +102,11 @@ class SinkReplyBuilder {
     batched_ = b;
   }
 
+  // Redirects the following replies. The accumulated replies must be flushed before.
+  void SetSink(io::Sink* sink) {
+    sink_ = sink;
+  }
+
   void CloseConnection();
 
   static const ReplyStats& GetThreadLocalStats() {
@@ -209,6 +219,15 @@ class MCReplyBuilder : public SinkReplyBuilder {
     flag_.return_version = val;
   }
 
+  // All reply flags at once, to carry them over to another builder.
+  uint8_t GetFlags() const {
+    return all_;
+  }
+
+  void SetFlags(uint8_t flags) {
+    all_ = flags;
+  }
+
  private:
   union {
     struct {
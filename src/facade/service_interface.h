@@ -21,6 +21,12 @@ class Connection;
 class SinkReplyBuilder;
 class MCReplyBuilder;
 
+// Parsed memcache command with its value.
+struct MCCommandRef {
+  const MemcacheParser::Command* cmd;
+  std::string_view value;
+};
+
 class ServiceInterface {
  public:
   virtual ~ServiceInterface() {
@@ -36,6 +42,10 @@ class ServiceInterface {
   virtual void DispatchMC(const MemcacheParser::Command& cmd, std::string_view value,
                           MCReplyBuilder* builder, ConnectionContext* cntx) = 0;
 
+  // Returns number of processed memcache commands
+  virtual size_t DispatchManyMCCommands(absl::Span<const MCCommandRef> cmds,
+                                        MCReplyBuilder* builder, ConnectionContext* cntx) = 0;
+
   virtual ConnectionContext* CreateContext(Connection* owner) = 0;
 
   virtual void ConfigureHttpHandlers(util::HttpListenerBase* base, bool is_privileged) {
@@ -45,8 +45,83 @@ auto BuildSender(string_view channel, facade::ArgRange messages, bool unsubscrib
   };
 }
 
+// Compiled matchers of the glob patterns of a PatternIndex, by pattern slot. They are kept per
+// thread, as GlobMatcher can not be used concurrently, and are dropped once the thread uses
+// a newer index, so they never outlive the set of subscribed patterns.
+struct ThreadMatchers {
+  uint64_t generation = 0;
+  vector<unique_ptr<GlobMatcher>> by_slot;
+};
+
+thread_local ThreadMatchers tl_matchers;
+atomic_uint64_t next_index_generation{1};
+
+// Length of the literal prefix of a glob pattern.
+size_t LiteralPrefixLen(string_view pattern) {
+  size_t pos = pattern.find_first_of("*?[\\");
+  return pos == string_view::npos ? pattern.size() : pos;
+}
+
 }  // namespace
 
+ChannelStore::PatternIndex::PatternIndex(const ChannelMap& patterns)
+    : generation_{next_index_generation.fetch_add(1, memory_order_relaxed)} {
+  for (const auto& entry : patterns) {
+    string_view pattern = entry.first;
+    size_t prefix_len = LiteralPrefixLen(pattern);
+    Group& group = groups_[pattern.substr(0, prefix_len)];
+
+    if (prefix_len == pattern.size())
+      group.exact.push_back(&entry);
+    else if (prefix_len + 1 == pattern.size() && pattern.back() == '*')
+      group.any_suffix.push_back(&entry);
+    else
+      group.globs.emplace_back(&entry, num_globs_++);
+  }
+
+  for (const auto& [prefix, _] : groups_)
+    prefix_lens_.push_back(prefix.size());
+  sort(prefix_lens_.begin(), prefix_lens_.end());
+}
+
+const GlobMatcher& ChannelStore::PatternIndex::Matcher(uint32_t slot, string_view pattern) const {
+  ThreadMatchers& tl = tl_matchers;
+  if (tl.generation != generation_) {
+    tl.generation = generation_;
+    tl.by_slot.clear();
+    tl.by_slot.resize(num_globs_);
+  }
+
+  auto& matcher = tl.by_slot[slot];
+  if (!matcher)
+    matcher = make_unique<GlobMatcher>(pattern, true);
+  return *matcher;
+}
+
+template <typename F>
+void ChannelStore::PatternIndex::ForEachMatch(string_view channel, F&& cb) const {
+  for (size_t len : prefix_lens_) {
+    if (len > channel.size())
+      break;
+
+    auto it = groups_.find(channel.substr(0, len));
+    if (it == groups_.end())
+      continue;
+
+    const Group& group = it->second;
+    if (len == channel.size()) {
+      for (const Entry* entry : group.exact)
+        cb(*entry);
+    }
+    for (const Entry* entry : group.any_suffix)
+      cb(*entry);
+    for (auto [entry, slot] : group.globs) {
+      if (Matcher(slot, entry->first).Matches(channel))
+        cb(*entry);
+    }
+  }
+}
+
 bool ChannelStore::Subscriber::ByThread(const Subscriber& lhs, const Subscriber& rhs) {
   return ByThreadId(lhs, rhs.Thread());
 }
@@ -95,12 +170,16 @@ void ChannelStore::ChannelMap::DeleteAll() {
     delete ptr.Get();
 }
 
-ChannelStore::ChannelStore() : channels_{new ChannelMap{}}, patterns_{new ChannelMap{}} {
+ChannelStore::ChannelStore()
+    : channels_{new ChannelMap{}},
+      patterns_{new ChannelMap{}},
+      pattern_index_{new PatternIndex{*patterns_}} {
   control_block.most_recent = this;
 }
 
-ChannelStore::ChannelStore(ChannelMap* channels, ChannelMap* patterns)
-    : channels_{channels}, patterns_{patterns} {
+ChannelStore::ChannelStore(ChannelMap* channels, ChannelMap* patterns,
+                           const PatternIndex* pattern_index)
+    : channels_{channels}, patterns_{patterns}, pattern_index_{pattern_index} {
 }
 
 void ChannelStore::Destroy() {
@@ -112,6 +191,7 @@ void ChannelStore::Destroy() {
     chan_map->DeleteAll();
     delete chan_map;
   }
+  delete store->pattern_index_;
   delete control_block.most_recent;
 }
 
@@ -164,11 +244,10 @@ vector<ChannelStore::Subscriber> ChannelStore::FetchSubscribers(string_view chan
   if (auto it = channels_->find(channel); it != channels_->end())
     Fill(*it->second, string{}, &res);
 
-  for (const auto& [pat, subs] : *patterns_) {
-    GlobMatcher matcher{pat, true};
-    if (matcher.Matches(channel))
-      Fill(*subs, pat, &res);
-  }
+  pattern_index_->ForEachMatch(channel, [&](const auto& entry) {
+    const auto& [pat, subs] = entry;
+    Fill(*subs, pat, &res);
+  });
 
   sort(res.begin(), res.end(), Subscriber::ByThread);
   return res;
@@ -305,12 +384,13 @@ void ChannelStoreUpdater::Apply() {
   for (auto key : ops_)
     Modify(target, key);
 
-  // Prepare replacement.
+  // Prepare replacement. The pattern index is rebuilt only when the set of patterns changes.
   auto* replacement = store;
   if (copied) {
     auto* new_chans = pattern_ ? store->channels_ : target;
     auto* new_patterns = pattern_ ? target : store->patterns_;
-    replacement = new ChannelStore{new_chans, new_patterns};
+    auto* new_index = pattern_ ? new ChannelStore::PatternIndex{*target} : store->pattern_index_;
+    replacement = new ChannelStore{new_chans, new_patterns, new_index};
   }
 
   // Update control block and unlock it.
@@ -331,7 +411,12 @@ void ChannelStoreUpdater::Apply() {
 
   // Delete previous map and channel store.
   if (copied) {
-    delete (pattern_ ? store->patterns_ : store->channels_);
+    if (pattern_) {
+      delete store->patterns_;
+      delete store->pattern_index_;
+    } else {
+      delete store->channels_;
+    }
     delete store;
   }
 
@@ -364,7 +449,7 @@ void ChannelStoreUpdater::ApplyAndUnsubscribe() {
   }
 
   // Prepare replacement.
-  auto* replacement = new ChannelStore{target, store->patterns_};
+  auto* replacement = new ChannelStore{target, store->patterns_, store->pattern_index_};
 
   // Update control block and unlock it.
   cb.most_recent.store(replacement, memory_order_relaxed);
@@ -13,6 +13,7 @@
 namespace dfly {
 
 class ChannelStoreUpdater;
+class GlobMatcher;
 
 namespace cluster {
 class SlotSet;
@@ -111,6 +112,39 @@ class ChannelStore {
     void DeleteAll();
   };
 
+  // Index over the patterns of a ChannelMap, rebuilt whenever the set of patterns changes.
+  //
+  // A channel can match a pattern only if the literal prefix of the pattern (the part before its
+  // first special character) is a prefix of the channel. Patterns are grouped by their literal
+  // prefixes, so a channel is checked with a lookup per distinct prefix length and only the
+  // patterns of the matching groups are evaluated. Within a group, literal patterns and
+  // patterns of the form "prefix*" are resolved without glob matching.
+  class PatternIndex {
+   public:
+    using Entry = ChannelMap::value_type;
+
+    // The map must not change its set of keys while the index is in use.
+    explicit PatternIndex(const ChannelMap& patterns);
+
+    // Calls cb(entry) for every pattern that matches the channel.
+    template <typename F> void ForEachMatch(std::string_view channel, F&& cb) const;
+
+   private:
+    struct Group {
+      std::vector<const Entry*> exact;       // patterns without special characters
+      std::vector<const Entry*> any_suffix;  // "prefix*"
+      std::vector<std::pair<const Entry*, uint32_t>> globs;  // all others, with their slots
+    };
+
+    // Returns the compiled matcher of the calling thread for the glob pattern in the slot.
+    const GlobMatcher& Matcher(uint32_t slot, std::string_view pattern) const;
+
+    absl::flat_hash_map<std::string_view, Group> groups_;
+    std::vector<size_t> prefix_lens_;  // sorted distinct lengths of the keys in groups_
+    uint32_t num_globs_ = 0;
+    uint64_t generation_;  // unique per index, identifies the matchers compiled for it
+  };
+
   // Centralized controller to prevent overlaping updates.
   struct ControlBlock {
     std::atomic<ChannelStore*> most_recent;
@@ -120,13 +154,14 @@ class ChannelStore {
  private:
   static ControlBlock control_block;
 
-  ChannelStore(ChannelMap* channels, ChannelMap* patterns);
+  ChannelStore(ChannelMap* channels, ChannelMap* patterns, const PatternIndex* pattern_index);
 
   static void Fill(const SubscribeMap& src, const std::string& pattern,
                    std::vector<Subscriber>* out);
 
   ChannelMap* channels_;
   ChannelMap* patterns_;
+  const PatternIndex* pattern_index_;  // index of patterns_, replaced together with it
 };
 
 // Performs RCU (read-copy-update) updates to the channel store.
@@ -144,6 +144,13 @@ uint64_t CommandId::Invoke(CmdArgList args, const CommandContext& cmd_cntx,
   ++ent.first;
   ent.second += execution_time_usec;
 
+  if (ss->latency_tracking) {
+    auto& histo = latency_histos_[ss->thread_index()];
+    if (!histo)
+      histo = make_unique<LatencyHistogram>();
+    histo->Add(execution_time_usec);
+  }
+
   return execution_time_usec;
 }
 
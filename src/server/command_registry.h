@@ -13,6 +13,7 @@
 
 #include "base/function2.hpp"
 #include "facade/command_id.h"
+#include "server/latency_monitor.h"
 
 namespace facade {
 class SinkReplyBuilder;
@@ -96,6 +97,7 @@ class CommandId : public facade::CommandId {
 
   void Init(unsigned thread_count) {
     command_stats_ = std::make_unique<CmdCallStats[]>(thread_count);
+    latency_histos_ = std::make_unique<std::unique_ptr<LatencyHistogram>[]>(thread_count);
   }
 
   using Handler3 = fu2::function_base<true, true, fu2::capacity_default, false, false,
@@ -145,12 +147,18 @@ class CommandId : public facade::CommandId {
 
   void ResetStats(unsigned thread_index) {
     command_stats_[thread_index].clear();
+    latency_histos_[thread_index].reset();
   }
 
   CmdCallStats GetStats(unsigned thread_index) const {
     return command_stats_[thread_index];
   }
 
+  // Returns nullptr if the command was not called on the thread since the last reset.
+  const LatencyHistogram* GetLatencyHistogram(unsigned thread_index) const {
+    return latency_histos_[thread_index].get();
+  }
+
   void SetAclCategory(uint32_t mask) {
     if (implicit_acl_)
       acl_categories_ |= mask;
@@ -159,6 +167,9 @@ class CommandId : public facade::CommandId {
  private:
   bool implicit_acl_;
   std::unique_ptr<CmdCallStats[]> command_stats_;
+
+  // Per thread latency histograms, allocated on the first call.
+  std::unique_ptr<std::unique_ptr<LatencyHistogram>[]> latency_histos_;
   Handler3 handler_;
   ArgValidator validator_;
 };
@@ -217,6 +228,15 @@ class CommandRegistry {
     }
   }
 
+  void MergeLatencyHistograms(
+      unsigned thread_index,
+      std::function<void(std::string_view, const LatencyHistogram&)> cb) const {
+    for (const auto& [name, cmd_id] : cmd_map_) {
+      if (const LatencyHistogram* histo = cmd_id.GetLatencyHistogram(thread_index); histo)
+        cb(name, *histo);
+    }
+  }
+
   void StartFamily(std::optional<uint32_t> acl_category = std::nullopt);
 
   std::string_view RenamedOrOriginal(std::string_view orig) const;
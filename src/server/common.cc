@@ -238,7 +238,7 @@ bool ParseDouble(string_view src, double* value) {
 #define ADD(x) (x) += o.x
 
 TieredStats& TieredStats::operator+=(const TieredStats& o) {
-  static_assert(sizeof(TieredStats) == 144);
+  static_assert(sizeof(TieredStats) == 168);
 
   ADD(total_stashes);
   ADD(total_fetches);
@@ -262,6 +262,9 @@ TieredStats& TieredStats::operator+=(const TieredStats& o) {
   ADD(cold_storage_bytes);
   ADD(total_offloading_steps);
   ADD(total_offloading_stashes);
+  ADD(total_compactions);
+  ADD(total_relocations);
+  ADD(released_bytes);
   return *this;
 }
 
@@ -81,9 +81,12 @@ struct TieredStats {
   uint64_t total_stash_overflows = 0;
   uint64_t total_offloading_steps = 0;
   uint64_t total_offloading_stashes = 0;
+  uint64_t total_compactions = 0;
+  uint64_t total_relocations = 0;
 
   size_t allocated_bytes = 0;
   size_t capacity_bytes = 0;
+  size_t released_bytes = 0;  // disk space of freed pages returned to the filesystem
 
   uint32_t pending_read_cnt = 0;
   uint32_t pending_stash_cnt = 0;
@@ -11,6 +11,7 @@
 #include "server/channel_store.h"
 #include "server/command_registry.h"
 #include "server/engine_shard_set.h"
+#include "server/namespaces.h"
 #include "server/server_family.h"
 #include "server/server_state.h"
 #include "server/transaction.h"
@@ -157,6 +158,20 @@ void ConnectionContext::ChangeMonitor(bool start) {
   EnableMonitoring(start);
 }
 
+void ConnectionContext::ChangeBcastTracking(bool to_add) {
+  const auto& prefixes = conn_state.tracking_info_.GetPrefixes();
+  auto cb = [conn_ref = conn()->Borrow(), &prefixes, to_add, ns = ns](EngineShard* shard) {
+    DbSlice& db_slice = ns->GetDbSlice(shard->shard_id());
+    if (prefixes.empty()) {
+      db_slice.ChangeBcastPrefix(conn_ref, "", to_add);
+      return;
+    }
+    for (string_view prefix : prefixes)
+      db_slice.ChangeBcastPrefix(conn_ref, prefix, to_add);
+  };
+  shard_set->RunBriefInParallel(std::move(cb));
+}
+
 void ConnectionContext::ChangeSubscription(bool to_add, bool to_reply, CmdArgList args,
                                            facade::RedisReplyBuilder* rb) {
   vector<unsigned> result = ChangeSubscriptions(args, false, to_add, to_reply);
@@ -303,7 +318,8 @@ void ConnectionState::ExecInfo::ClearWatched() {
 }
 
 bool ConnectionState::ClientTracking::ShouldTrackKeys() const {
-  if (!IsTrackingOn()) {
+  // In broadcast mode the keys are matched against the prefixes on writes.
+  if (!IsTrackingOn() || bcast_) {
     return false;
   }
 
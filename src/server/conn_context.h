@@ -218,6 +218,22 @@ struct ConnectionState {
       noloop_ = noloop;
     }
 
+    // Set when BCAST is used with CLIENT TRACKING. In broadcast mode no keys are tracked on reads,
+    // instead the client is notified about all the writes to keys matching one of its prefixes.
+    // No prefixes means that all the keys are matched.
+    void SetBcast(bool bcast, std::vector<std::string> prefixes) {
+      bcast_ = bcast;
+      prefixes_ = std::move(prefixes);
+    }
+
+    bool IsBcast() const {
+      return bcast_;
+    }
+
+    const std::vector<std::string>& GetPrefixes() const {
+      return prefixes_;
+    }
+
     // Check if the keys should be tracked. Result adheres to the state machine described above.
     bool ShouldTrackKeys() const;
 
@@ -244,7 +260,9 @@ struct ConnectionState {
     // a flag indicating whether the client has turned on client tracking.
     bool tracking_enabled_ = false;
     bool noloop_ = false;
+    bool bcast_ = false;
     Options option_ = NONE;
+    std::vector<std::string> prefixes_;
     // sequence number
     size_t seq_num_ = 0;
     size_t caching_seq_num_ = 0;
@@ -302,6 +320,9 @@ class ConnectionContext : public facade::ConnectionContext {
   void PUnsubscribeAll(bool to_reply, facade::RedisReplyBuilder* rb);
   void ChangeMonitor(bool start);  // either start or stop monitor on a given connection
 
+  // Registers or unregisters the BCAST prefixes of the connection with all the shards.
+  void ChangeBcastTracking(bool to_add);
+
   size_t UsedMemory() const override;
 
   virtual void Unsubscribe(std::string_view channel) override;
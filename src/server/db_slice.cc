@@ -12,6 +12,7 @@ extern "C" {
 
 #include "base/flags.h"
 #include "base/logging.h"
+#include "core/qlist.h"
 #include "core/top_keys.h"
 #include "search/doc_index.h"
 #include "server/channel_store.h"
@@ -375,7 +376,10 @@ DbSlice::DbSlice(uint32_t index, bool cache_mode, EngineShard* owner)
     : shard_id_(index),
       cache_mode_(cache_mode),
       owner_(owner),
-      client_tracking_map_(owner->memory_resource()) {
+      tracking_mr_(owner->memory_resource()),
+      client_tracking_map_(&tracking_mr_),
+      pending_send_map_(&tracking_mr_),
+      bcast_prefix_map_(&tracking_mr_) {
   db_arr_.emplace_back();
   CreateDb(0);
   expire_base_[0] = expire_base_[1] = 0;
@@ -419,6 +423,7 @@ auto DbSlice::GetStats() const -> Stats {
     stats.table_mem_usage = db_wrap.table_memory();
   }
   s.small_string_bytes = CompactObj::GetStats().small_string_bytes;
+  s.client_tracking_bytes = tracking_mr_.used();
 
   return s;
 }
@@ -564,6 +569,17 @@ auto DbSlice::FindInternal(const Context& cntx, string_view key, optional<unsign
     }
   }
 
+  // Offloaded containers are accessed only in memory and the shard must not wait for the disk.
+  // Coordinators upload them before the hop and they are not offloaded while their keys are
+  // locked (see Transaction::FetchOffloadedContainers). Only keys that are not declared by the
+  // transaction, like those of global transactions, can get here. The command fails and can be
+  // retried once the container is uploaded.
+  if (const PrimeValue& pv = res.it->second;
+      pv.IsExternal() && !pv.IsCool() && pv.ObjType() != OBJ_STRING) {
+    owner_->tiered_storage()->FetchContainerAsync(cntx.db_index, key, pv);
+    return OpStatus::TRY_AGAIN;
+  }
+
   DCHECK(IsValid(res.it));
   if (IsCacheMode()) {
     if (!change_cb_.empty()) {
@@ -654,6 +670,8 @@ OpResult<DbSlice::ItAndUpdater> DbSlice::AddOrFindInternal(const Context& cntx,
     }
   }
   auto status = res.status();
+  if (status == OpStatus::TRY_AGAIN)
+    return status;
   CHECK(status == OpStatus::KEY_NOTFOUND || status == OpStatus::OUT_OF_MEMORY) << status;
 
   // It's a new entry.
@@ -1143,9 +1161,28 @@ bool DbSlice::CheckLock(IntentLock::Mode mode, DbIndex dbid, uint64_t fp) const
   return true;
 }
 
+bool DbSlice::CanMoveValue(DbIndex db_ind, const PrimeKey& key) const {
+  if (pinned_values_ == 0)
+    return true;
+
+  string tmp;
+  return CheckLock(IntentLock::EXCLUSIVE, db_ind, key.GetSlice(&tmp));
+}
+
 void DbSlice::PreUpdateBlocking(DbIndex db_ind, Iterator it, std::string_view key) {
   CallChangeCallbacks(db_ind, key, ChangeReq{it.GetInnerIt()});
   it.GetInnerIt().SetVersion(NextVersion());
+
+  // Lists change their size when they are read or compressed in the background. These changes
+  // are accounted here, before the update measures the original size of the value.
+  if (!it.GetInnerIt().IsOccupied())
+    return;
+
+  PrimeValue& pv = it->second;
+  if (pv.ObjType() == OBJ_LIST && pv.Encoding() == kEncodingQL2 && !pv.IsExternal()) {
+    ssize_t delta = static_cast<QList*>(pv.RObjPtr())->TakeUnaccounted();
+    AccountObjectMemory(key, OBJ_LIST, delta, GetDBTable(db_ind));
+  }
 }
 
 void DbSlice::PostUpdate(DbIndex db_ind, Iterator it, std::string_view key, size_t orig_size) {
@@ -1171,7 +1208,7 @@ void DbSlice::PostUpdate(DbIndex db_ind, Iterator it, std::string_view key, size
     db.slots_stats[KeySlot(key)].total_writes += 1;
   }
 
-  if (!client_tracking_map_.empty()) {
+  if (HasTrackingClients()) {
     QueueInvalidationTrackingMessageAtomic(key);
   }
 }
@@ -1444,7 +1481,7 @@ finish:
 void DbSlice::CreateDb(DbIndex db_ind) {
   auto& db = db_arr_[db_ind];
   if (!db) {
-    db.reset(new DbTable{owner_->memory_resource(), db_ind});
+    db.reset(new DbTable{owner_->table_memory_resource(), db_ind});
     table_memory_ += db->table_memory();
   }
 }
@@ -1531,22 +1568,56 @@ void DbSlice::SetNotifyKeyspaceEvents(std::string_view notify_keyspace_events) {
   expired_keys_events_recording_ = !notify_keyspace_events.empty();
 }
 
+void DbSlice::ChangeBcastPrefix(const facade::Connection::WeakRef& conn_ref,
+                                std::string_view prefix, bool to_add) {
+  if (to_add) {
+    auto [it, inserted] = bcast_prefix_map_.try_emplace(prefix, HashSetAllocator{&tracking_mr_});
+    it->second.insert(conn_ref);
+    if (!inserted)
+      return;
+  } else {
+    auto it = bcast_prefix_map_.find(prefix);
+    if (it == bcast_prefix_map_.end())
+      return;
+    it->second.erase(conn_ref);
+    if (!it->second.empty())
+      return;
+    bcast_prefix_map_.erase(it);
+  }
+
+  bcast_prefix_lens_.clear();
+  for (const auto& [p, _] : bcast_prefix_map_)
+    bcast_prefix_lens_.push_back(p.size());
+  sort(bcast_prefix_lens_.begin(), bcast_prefix_lens_.end());
+  bcast_prefix_lens_.erase(unique(bcast_prefix_lens_.begin(), bcast_prefix_lens_.end()),
+                           bcast_prefix_lens_.end());
+}
+
 void DbSlice::QueueInvalidationTrackingMessageAtomic(std::string_view key) {
   FiberAtomicGuard guard;
-  auto it = client_tracking_map_.find(key);
-  if (it == client_tracking_map_.end()) {
-    return;
+  if (auto it = client_tracking_map_.find(key); it != client_tracking_map_.end()) {
+    ConnectionHashSet moved_set = std::move(it->second);
+    client_tracking_map_.erase(it);
+
+    auto [pend_it, inserted] = pending_send_map_.emplace(key, std::move(moved_set));
+    if (!inserted) {
+      ConnectionHashSet& client_set = pend_it->second;
+      for (auto& client : moved_set) {
+        client_set.insert(client);
+      }
+    }
   }
 
-  ConnectionHashSet moved_set = std::move(it->second);
-  client_tracking_map_.erase(it);
+  for (size_t len : bcast_prefix_lens_) {
+    if (len > key.size())
+      break;
 
-  auto [pend_it, inserted] = pending_send_map_.emplace(key, std::move(moved_set));
-  if (!inserted) {
-    ConnectionHashSet& client_set = pend_it->second;
-    for (auto& client : moved_set) {
-      client_set.insert(client);
-    }
+    auto it = bcast_prefix_map_.find(key.substr(0, len));
+    if (it == bcast_prefix_map_.end())
+      continue;
+
+    auto pend_it = pending_send_map_.try_emplace(key, HashSetAllocator{&tracking_mr_}).first;
+    pend_it->second.insert(it->second.begin(), it->second.end());
   }
 }
 
@@ -1559,6 +1630,8 @@ void DbSlice::SendQueuedInvalidationMessages() {
     // Notify all the clients. this function is not efficient,
     // because it broadcasts to all threads unrelated to the subscribers for the key.
     auto cb = [&](unsigned idx, util::ProactorBase*) {
+      // All the keys invalidated for a client are sent in a single message.
+      absl::flat_hash_map<facade::Connection*, facade::Connection::InvalidationMessage> messages;
       for (auto& [key, client_list] : local_map) {
         for (auto& client : client_list) {
           if (client.IsExpired() || (client.Thread() != idx)) {
@@ -1567,10 +1640,14 @@ void DbSlice::SendQueuedInvalidationMessages() {
           auto* conn = client.Get();
           auto* cntx = static_cast<ConnectionContext*>(conn->cntx());
           if (cntx && cntx->conn_state.tracking_info_.IsTrackingOn()) {
-            conn->SendInvalidationMessageAsync({key});
+            messages[conn].keys.push_back(key);
           }
         }
       }
+
+      for (auto& [conn, msg] : messages) {
+        conn->SendInvalidationMessageAsync(std::move(msg));
+      }
     };
 
     shard_set->pool()->AwaitBrief(std::move(cb));
@@ -1699,7 +1776,7 @@ void DbSlice::PerformDeletionAtomic(Iterator del_it, ExpIterator exp_it, DbTable
   --entries_count_;
   memory_budget_ += (value_heap_size + key_size_used);
 
-  if (!client_tracking_map_.empty()) {
+  if (HasTrackingClients()) {
     QueueInvalidationTrackingMessageAtomic(del_it.key());
   }
 }
@@ -185,6 +185,7 @@ class DbSlice {
     std::vector<DbStats> db_stats;
     SliceEvents events;
     size_t small_string_bytes = 0;
+    size_t client_tracking_bytes = 0;
   };
 
   using Context = DbContext;
@@ -301,6 +302,57 @@ class DbSlice {
   OpResult<ConstIterator> FindReadOnly(const Context& cntx, std::string_view key,
                                        unsigned req_obj_type) const;
 
+  // Number of keys whose buckets are prefetched together by the batched lookups.
+  static constexpr unsigned kPrefetchBatch = 16;
+
+  // Prefetches the bucket of the prime table the key hashes to, so that a subsequent lookup
+  // of the key does not stall on it.
+  void PrefetchKey(DbIndex db_ind, std::string_view key) const {
+    if (IsDbValid(db_ind))
+      db_arr_[db_ind]->prime.Prefetch(key);
+  }
+
+  // Calls cb(it) for every step-th iterator of [begin, end), where *it is a key. The buckets of
+  // every kPrefetchBatch keys are prefetched before their callbacks run, so that the cache misses
+  // of multi-key commands overlap instead of being taken one key at a time. step > 1 iterates
+  // over key/value sequences, their length must be a multiple of step.
+  template <typename It, typename Cb>
+  void ForEachPrefetched(DbIndex db_ind, It begin, It end, Cb&& cb, unsigned step = 1) const {
+    auto advance = [step](It& it) {
+      for (unsigned i = 0; i < step; ++i)
+        ++it;
+    };
+
+    while (begin != end) {
+      It batch_end = begin;
+      for (unsigned i = 0; i < kPrefetchBatch && batch_end != end; ++i) {
+        PrefetchKey(db_ind, *batch_end);
+        advance(batch_end);
+      }
+
+      for (; begin != batch_end; advance(begin))
+        cb(begin);
+    }
+  }
+
+  // Batched FindReadOnly, calls cb(key, ItAndExpConst) for every key in order.
+  template <typename Range, typename Cb>
+  void FindReadOnlyBatch(const Context& cntx, const Range& keys, Cb&& cb) const {
+    ForEachPrefetched(cntx.db_index, keys.begin(), keys.end(), [&](auto it) {
+      std::string_view key = *it;
+      cb(key, FindReadOnly(cntx, key));
+    });
+  }
+
+  // Batched FindMutable, calls cb(key, ItAndUpdater) for every key in order.
+  template <typename Range, typename Cb>
+  void FindMutableBatch(const Context& cntx, const Range& keys, Cb&& cb) {
+    ForEachPrefetched(cntx.db_index, keys.begin(), keys.end(), [&](auto it) {
+      std::string_view key = *it;
+      cb(key, FindMutable(cntx, key));
+    });
+  }
+
   OpResult<ItAndUpdater> AddOrFind(const Context& cntx, std::string_view key);
 
   // Same as AddOrSkip, but overwrites in case entry exists.
@@ -507,9 +559,14 @@ class DbSlice {
 
   // Track keys for the client represented by the the weak reference to its connection.
   void TrackKey(const facade::Connection::WeakRef& conn_ref, std::string_view key) {
-    client_tracking_map_[key].insert(conn_ref);
+    client_tracking_map_.try_emplace(key, HashSetAllocator{&tracking_mr_})
+        .first->second.insert(conn_ref);
   }
 
+  // Registers or unregisters the client as tracking all the keys starting with prefix (BCAST mode).
+  void ChangeBcastPrefix(const facade::Connection::WeakRef& conn_ref, std::string_view prefix,
+                         bool to_add);
+
   // Does not check for non supported events. Callers must parse the string and reject it
   // if it's not empty and not EX.
   void SetNotifyKeyspaceEvents(std::string_view notify_keyspace_events);
@@ -522,6 +579,19 @@ class DbSlice {
     return &serialization_latch_;
   }
 
+  // Values that are read by the reply builders of other threads while their keys stay locked.
+  // While there are any, background tasks that move or release values must skip locked keys.
+  void PinValue() {
+    ++pinned_values_;
+  }
+
+  void UnpinValue() {
+    --pinned_values_;
+  }
+
+  // Returns true if the value of the key can be moved or released by a background task.
+  bool CanMoveValue(DbIndex db_ind, const PrimeKey& key) const;
+
   void StartSampleTopK(DbIndex db_ind, uint32_t min_freq);
 
   struct SamplingResult {
@@ -558,6 +628,10 @@ class DbSlice {
 
   void PerformDeletionAtomic(Iterator del_it, ExpIterator exp_it, DbTable* table);
 
+  bool HasTrackingClients() const {
+    return !client_tracking_map_.empty() || !bcast_prefix_map_.empty();
+  }
+
   // Queues invalidation message to the clients that are tracking the change to a key.
   void QueueInvalidationTrackingMessageAtomic(std::string_view key);
   void SendQueuedInvalidationMessages();
@@ -594,6 +668,7 @@ class DbSlice {
   // to avoid Heartbeat or Flushing the db.
   // This latch protects us against this case.
   mutable LocalLatch serialization_latch_;
+  size_t pinned_values_ = 0;
 
   ShardId shard_id_;
   uint8_t cache_mode_ : 1;
@@ -643,6 +718,37 @@ class DbSlice {
   // Record whenever a key expired to DbTable::expired_keys_events_ for keyspace notifications
   bool expired_keys_events_recording_ = true;
 
+  // Forwards to the shard memory resource and accounts the memory used by the tracking tables.
+  // Keys that do not fit into std::string's inline buffer are allocated separately and are not
+  // accounted.
+  class TrackingMemoryResource : public PMR_NS::memory_resource {
+   public:
+    explicit TrackingMemoryResource(PMR_NS::memory_resource* upstream) : upstream_(upstream) {
+    }
+
+    size_t used() const {
+      return used_;
+    }
+
+   private:
+    void* do_allocate(std::size_t size, std::size_t align) final {
+      used_ += size;
+      return upstream_->allocate(size, align);
+    }
+
+    void do_deallocate(void* ptr, std::size_t size, std::size_t align) final {
+      used_ -= size;
+      upstream_->deallocate(ptr, size, align);
+    }
+
+    bool do_is_equal(const PMR_NS::memory_resource& o) const noexcept final {
+      return this == &o;
+    }
+
+    PMR_NS::memory_resource* upstream_;
+    size_t used_ = 0;
+  };
+
   struct Hash {
     size_t operator()(const facade::Connection::WeakRef& c) const {
       return std::hash<uint32_t>()(c.GetClientId());
@@ -655,8 +761,12 @@ class DbSlice {
   // the declarations below meant to say:
   // absl::flat_hash_map<std::string,
   //                    absl::flat_hash_set<facade::Connection::WeakRef, Hash>> client_tracking_map_
+  // The sets must be constructed with the allocator explicitly, otherwise they use the default
+  // memory resource.
   using HashSetAllocator = PMR_NS::polymorphic_allocator<facade::Connection::WeakRef>;
 
+  TrackingMemoryResource tracking_mr_;
+
   using ConnectionHashSet =
       absl::flat_hash_set<facade::Connection::WeakRef, Hash,
                           absl::container_internal::hash_default_eq<facade::Connection::WeakRef>,
@@ -669,6 +779,17 @@ class DbSlice {
                       absl::container_internal::hash_default_eq<std::string>, AllocatorType>
       client_tracking_map_, pending_send_map_;
 
+  // Clients in BCAST mode by their prefixes. Unlike client_tracking_map_, the entries stay until
+  // the clients turn tracking off.
+  absl::flat_hash_map<std::string, ConnectionHashSet,
+                      absl::container_internal::hash_default_hash<std::string>,
+                      absl::container_internal::hash_default_eq<std::string>, AllocatorType>
+      bcast_prefix_map_;
+
+  // Sorted distinct lengths of the prefixes in bcast_prefix_map_, so that a key is matched with
+  // a lookup per length instead of a scan over all the prefixes.
+  std::vector<size_t> bcast_prefix_lens_;
+
   class PrimeBumpPolicy;
 };
 
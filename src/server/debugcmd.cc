@@ -3,18 +3,17 @@
 //
 #include "server/debugcmd.h"
 
-#define HUF_STATIC_LINKING_ONLY
-
 extern "C" {
 #include "huff/hist.h"
-#include "huff/huf.h"
 #include "redis/redis_aux.h"
 }
 
 #include <absl/cleanup/cleanup.h>
 #include <absl/random/random.h>
+#include <absl/strings/escaping.h>
 #include <absl/strings/match.h>
 #include <absl/strings/str_cat.h>
+#include <absl/strings/str_format.h>
 #include <lz4.h>
 #include <zdict.h>
 #include <zstd.h>
@@ -24,6 +23,7 @@ extern "C" {
 #include "base/flags.h"
 #include "base/logging.h"
 #include "core/compact_object.h"
+#include "core/huff_coder.h"
 #include "core/qlist.h"
 #include "core/sorted_map.h"
 #include "core/string_map.h"
@@ -66,6 +66,8 @@ struct ObjInfo {
   // for lists - how many nodes do they have.
   unsigned num_nodes = 0;
   unsigned num_compressed = 0;
+  double compress_ratio = 0;  // compressed to raw size of the compressed nodes
+  size_t index_bytes = 0;     // memory of the positional index, not accounted in the object size
 
   enum LockStatus { NONE, S, X } lock_status = NONE;
 
@@ -279,7 +281,8 @@ struct HufHist {
   }
 };
 
-void DoComputeHist(EngineShard* shard, ConnectionContext* cntx, HufHist* dest) {
+void DoComputeHist(EngineShard* shard, ConnectionContext* cntx, bool with_values,
+                   HufHist* dest) {
   auto& db_slice = cntx->ns->GetDbSlice(shard->shard_id());
   DbTable* dbt = db_slice.GetDBTable(cntx->db_index());
   CHECK(dbt);
@@ -295,6 +298,13 @@ void DoComputeHist(EngineShard* shard, ConnectionContext* cntx, HufHist* dest) {
       it->first.GetString(&scratch);
       size_t len = std::min(scratch.size(), kMaxLen);
       HIST_add(dest->hist.data(), scratch.data(), len);
+
+      const PrimeValue& pv = it->second;
+      if (with_values && pv.ObjType() == OBJ_STRING && !pv.IsExternal()) {
+        pv.GetString(&scratch);
+        len = std::min(scratch.size(), kMaxLen);
+        HIST_add(dest->hist.data(), scratch.data(), len);
+      }
     });
 
     if (steps >= 20000) {
@@ -326,14 +336,12 @@ ObjInfo InspectOp(ConnectionContext* cntx, string_view key) {
     if (pv.ObjType() == OBJ_LIST && pv.Encoding() == kEncodingQL2) {
       const QList* qlist = static_cast<const QList*>(pv.RObjPtr());
       oinfo.num_nodes = qlist->node_count();
-      auto* node = qlist->Head();
 
-      while (node) {
-        if (node->encoding == QUICKLIST_NODE_ENCODING_LZF) {
-          ++oinfo.num_compressed;
-        }
-        node = node->next;
-      }
+      QList::CompressionInfo ci = qlist->GetCompressionInfo();
+      oinfo.num_compressed = ci.compressed_nodes;
+      if (ci.raw_bytes)
+        oinfo.compress_ratio = double(ci.compressed_bytes) / ci.raw_bytes;
+      oinfo.index_bytes = qlist->IndexMallocUsed();
     }
 
     if (pv.IsExternal()) {
@@ -511,8 +519,10 @@ void DebugCmd::Run(CmdArgList args, facade::SinkReplyBuilder* builder) {
         "    traffic logging is stopped.",
         "RECVSIZE [<tid> | ENABLE | DISABLE]",
         "    Prints the histogram of the received request sizes on the given thread",
-        "COMPRESSION"
-        "    Estimate the compressability of values of the given type",
+        "COMPRESSION [VALUES]",
+        "    Estimates the compressability of keys (and string values if VALUES is specified)",
+        "    with huffman encoding. Returns the huffman table that can be passed via",
+        "    --huffman_table flag.",
         "HELP",
         "    Prints this help.",
     };
@@ -585,7 +595,7 @@ void DebugCmd::Run(CmdArgList args, facade::SinkReplyBuilder* builder) {
   }
 
   if (subcmd == "COMPRESSION") {
-    return Compression(builder);
+    return Compression(args.subspan(1), builder);
   }
 
   string reply = UnknownSubCmd(subcmd, "DEBUG");
@@ -968,6 +978,12 @@ void DebugCmd::Inspect(string_view key, CmdArgList args, facade::SinkReplyBuilde
     if (res.num_compressed) {
       // compressed nodes
       StrAppend(&resp, " cn:", res.num_compressed);
+      StrAppend(&resp, " cr:", absl::StrFormat("%.2f", res.compress_ratio));
+    }
+
+    if (res.index_bytes) {
+      // positional index bytes
+      StrAppend(&resp, " ib:", res.index_bytes);
     }
 
     if (res.lock_status != ObjInfo::NONE) {
@@ -1233,36 +1249,55 @@ void DebugCmd::Keys(CmdArgList args, facade::SinkReplyBuilder* builder) {
   return builder->SendError(kSyntaxErr);
 }
 
-void DebugCmd::Compression(facade::SinkReplyBuilder* builder) {
+void DebugCmd::Compression(CmdArgList args, facade::SinkReplyBuilder* builder) {
   auto* rb = static_cast<RedisReplyBuilder*>(builder);
 
+  bool with_values = false;
+  if (!args.empty()) {
+    if (args.size() > 1 || !absl::EqualsIgnoreCase(ArgS(args, 0), "VALUES"))
+      return rb->SendError(kSyntaxErr);
+    with_values = true;
+  }
+
   fb2::Mutex mu;
   HufHist hist;
   shard_set->RunBlockingInParallel([&](EngineShard* shard) {
     HufHist local;
-    DoComputeHist(shard, cntx_, &local);
+    DoComputeHist(shard, cntx_, with_values, &local);
     std::unique_lock lk(mu);
     hist.Merge(local);
   });
 
-  HUF_CREATE_STATIC_CTABLE(huf_ctable, HufHist::kMaxSymbol);
-
   size_t num_bits = 0, compressed_size = 0, raw_size = 0;
+  string huff_table;
 
   if (hist.max_symbol) {
-    unique_ptr<uint32_t[]> wrkspace(new uint32_t[HUF_CTABLE_WORKSPACE_SIZE_U32]);
-    constexpr size_t kWspSize = HUF_CTABLE_WORKSPACE_SIZE;
-    num_bits = HUF_buildCTable_wksp(huf_ctable, hist.hist.data(), hist.max_symbol, 0,
-                                    wrkspace.get(), kWspSize);
-
-    compressed_size = HUF_estimateCompressedSize(huf_ctable, hist.hist.data(), hist.max_symbol);
-    raw_size = 0;
-    for (unsigned i = 0; i < hist.max_symbol; i++) {
+    for (unsigned i = 0; i <= hist.max_symbol; i++) {
       raw_size += hist.hist[i];
     }
+
+    // The table must be able to encode any string, hence we give the missing symbols
+    // the lowest possible frequency.
+    for (unsigned i = 0; i <= HufHist::kMaxSymbol; i++) {
+      hist.hist[i] = std::max(hist.hist[i], 1u);
+    }
+
+    HuffmanEncoder encoder;
+    string err;
+    if (!encoder.Build(hist.hist.data(), HufHist::kMaxSymbol, &err)) {
+      return rb->SendError(StrCat("Failed to build huffman table: ", err));
+    }
+
+    num_bits = encoder.num_bits();
+    size_t compressed_bits = 0;
+    for (unsigned i = 0; i <= hist.max_symbol; i++) {
+      compressed_bits += size_t(hist.hist[i]) * encoder.BitCount(i);
+    }
+    compressed_size = compressed_bits / 8;
+    huff_table = absl::Base64Escape(encoder.Export());
   }
 
-  rb->StartCollection(5, RedisReplyBuilder::CollectionType::MAP);
+  rb->StartCollection(6, RedisReplyBuilder::CollectionType::MAP);
   rb->SendSimpleString("max_symbol");
   rb->SendLong(hist.max_symbol);
   rb->SendSimpleString("max_bits");
@@ -1274,6 +1309,8 @@ void DebugCmd::Compression(facade::SinkReplyBuilder* builder) {
   rb->SendSimpleString("ratio");
   double ratio = raw_size > 0 ? static_cast<double>(compressed_size) / raw_size : 0;
   rb->SendDouble(ratio);
+  rb->SendSimpleString("huffman_table");
+  rb->SendBulkString(huff_table);
 }
 
 void DebugCmd::DoPopulateBatch(const PopulateOptions& options, const PopulateBatch& batch) {
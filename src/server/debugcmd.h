@@ -58,7 +58,7 @@ class DebugCmd {
   void RecvSize(std::string_view param, facade::SinkReplyBuilder* builder);
   void Topk(CmdArgList args, facade::SinkReplyBuilder* builder);
   void Keys(CmdArgList args, facade::SinkReplyBuilder* builder);
-  void Compression(facade::SinkReplyBuilder* builder);
+  void Compression(CmdArgList args, facade::SinkReplyBuilder* builder);
 
   struct PopulateBatch {
     DbIndex dbid;
@@ -41,12 +41,16 @@ class ZstdDecompress : public DecompressImpl {
 io::Result<io::IoBuf*> ZstdDecompress::Decompress(std::string_view str) {
   // Prepare membuf memory to uncompressed string.
   auto uncomp_size = ZSTD_getFrameContentSize(str.data(), str.size());
+  // The data can come from clients with the compressed transport, so errors are rate limited.
   if (uncomp_size == ZSTD_CONTENTSIZE_UNKNOWN) {
-    LOG(ERROR) << "Zstd compression missing frame content size";
+    LOG_EVERY_T(ERROR, 1) << "Zstd compression missing frame content size";
     return Unexpected(errc::invalid_encoding);
   }
   if (uncomp_size == ZSTD_CONTENTSIZE_ERROR) {
-    LOG(ERROR) << "Invalid ZSTD compressed string";
+    LOG_EVERY_T(ERROR, 1) << "Invalid ZSTD compressed string";
+    return Unexpected(errc::invalid_encoding);
+  }
+  if (uncomp_size > max_size_) {
     return Unexpected(errc::invalid_encoding);
   }
 
@@ -60,7 +64,7 @@ io::Result<io::IoBuf*> ZstdDecompress::Decompress(std::string_view str) {
   size_t const d_size =
       ZSTD_decompressDCtx(dctx_, dest.data(), dest.size(), str.data(), str.size());
   if (d_size == 0 || d_size != uncomp_size) {
-    LOG(ERROR) << "Invalid ZSTD compressed string";
+    LOG_EVERY_T(ERROR, 1) << "Invalid ZSTD compressed string";
     return Unexpected(errc::rdb_file_corrupted);
   }
   uncompressed_mem_buf_.CommitWrite(d_size);
@@ -90,6 +94,13 @@ class Lz4Decompress : public DecompressImpl {
   io::Result<base::IoBuf*> Decompress(std::string_view str);
 
  private:
+  // Drops the partially decompressed frame, so that the next one starts from a clean state.
+  io::Result<base::IoBuf*> Fail(errc ev) {
+    LZ4F_resetDecompressionContext(dctx_);
+    uncompressed_mem_buf_.Clear();
+    return Unexpected(ev);
+  }
+
   LZ4F_dctx* dctx_;
 };
 
@@ -101,14 +112,17 @@ io::Result<base::IoBuf*> Lz4Decompress::Decompress(std::string_view data) {
   size_t consumed = frame_size;  // The nb of bytes consumed from data will be written into consumed
   size_t res = LZ4F_getFrameInfo(dctx_, &frame_info, data.data(), &consumed);
   if (LZ4F_isError(res)) {
-    LOG(ERROR) << "LZ4F_getFrameInfo failed with error " << LZ4F_getErrorName(res);
-    return Unexpected(errc::rdb_file_corrupted);
-    ;
+    // The data can come from clients with the compressed transport, so errors are rate limited.
+    LOG_EVERY_T(ERROR, 1) << "LZ4F_getFrameInfo failed with error " << LZ4F_getErrorName(res);
+    return Fail(errc::rdb_file_corrupted);
   }
 
   if (frame_info.contentSize == 0) {
-    LOG(ERROR) << "Missing frame content size";
-    return Unexpected(errc::rdb_file_corrupted);
+    LOG_EVERY_T(ERROR, 1) << "Missing frame content size";
+    return Fail(errc::rdb_file_corrupted);
+  }
+  if (frame_info.contentSize > max_size_) {
+    return Fail(errc::invalid_encoding);
   }
 
   // reserve place for uncompressed data and end opcode
@@ -116,7 +130,7 @@ io::Result<base::IoBuf*> Lz4Decompress::Decompress(std::string_view data) {
   uncompressed_mem_buf_.Reserve(reserve);
   IoBuf::Bytes dest = uncompressed_mem_buf_.AppendBuffer();
   if (dest.size() < reserve) {
-    return Unexpected(errc::out_of_memory);
+    return Fail(errc::out_of_memory);
   }
 
   // Uncompress data to membuf
@@ -134,8 +148,13 @@ io::Result<base::IoBuf*> Lz4Decompress::Decompress(std::string_view data) {
     // The nb of bytes decompressed into dest will be written into dest_capacity
     ret = LZ4F_decompress(dctx_, dest.data(), &dest_capacity, src.data(), &src_size, nullptr);
     if (LZ4F_isError(ret)) {
-      LOG(ERROR) << "LZ4F_decompress failed with error " << LZ4F_getErrorName(ret);
-      return Unexpected(errc::rdb_file_corrupted);
+      LOG_EVERY_T(ERROR, 1) << "LZ4F_decompress failed with error " << LZ4F_getErrorName(ret);
+      return Fail(errc::rdb_file_corrupted);
+    }
+
+    // A truncated frame or one with a wrong content size can't make progress anymore.
+    if (ret != 0 && ((src_size == 0 && dest_capacity == 0) || src_size == src.size())) {
+      return Fail(errc::rdb_file_corrupted);
     }
     consumed += src_size;
 
@@ -144,16 +163,16 @@ io::Result<base::IoBuf*> Lz4Decompress::Decompress(std::string_view data) {
     src_size = src.size();
   }
   if (consumed != frame_size) {
-    return Unexpected(errc::rdb_file_corrupted);
+    return Fail(errc::rdb_file_corrupted);
   }
   if (uncompressed_mem_buf_.InputLen() != frame_info.contentSize) {
-    return Unexpected(errc::rdb_file_corrupted);
+    return Fail(errc::rdb_file_corrupted);
   }
 
   // Add opcode of compressed blob end to membuf.
   dest = uncompressed_mem_buf_.AppendBuffer();
   if (dest.size() < 1) {
-    return Unexpected(errc::out_of_memory);
+    return Fail(errc::out_of_memory);
   }
   dest[0] = RDB_OPCODE_COMPRESSED_BLOB_END;
   uncompressed_mem_buf_.CommitWrite(1);
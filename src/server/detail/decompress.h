@@ -3,6 +3,7 @@
 //
 #pragma once
 
+#include <cstdint>
 #include <memory>
 
 #include "io/io.h"
@@ -22,10 +23,17 @@ class DecompressImpl {
   virtual ~DecompressImpl() {
   }
 
+  // Returns the decompressed data followed by RDB_OPCODE_COMPRESSED_BLOB_END.
   virtual io::Result<io::IoBuf*> Decompress(std::string_view str) = 0;
 
+  // Data larger than max_size is rejected before decompressing it.
+  void set_max_size(size_t max_size) {
+    max_size_ = max_size;
+  }
+
  protected:
   io::IoBuf uncompressed_mem_buf_;
+  size_t max_size_ = SIZE_MAX;
 };
 
 }  // namespace detail
@@ -12,6 +12,7 @@
 #include "base/flags.h"
 #include "base/logging.h"
 #include "server/detail/snapshot_storage.h"
+#include "server/journal/journal.h"
 #include "server/main_service.h"
 #include "server/namespaces.h"
 #include "server/script_mgr.h"
@@ -204,6 +205,15 @@ SaveInfo SaveStagesController::Finalize() {
     shared_err_ = err;
   }
 
+  // The startup snapshot covers the on-disk journal entries up to its position, see
+  // RDB_OPCODE_JOURNAL_POSITION.
+  if (!shared_err_ && use_dfs_format_ && basename_.empty() && cloud_uri_.empty()) {
+    shard_set->RunBriefInParallel([](EngineShard* es) {
+      if (auto* journal = es->journal(); journal)
+        journal->RemoveSnapshottedSegments();
+    });
+  }
+
   return GetSaveInfo();
 }
 
@@ -0,0 +1,42 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "server/detail/transport_codec.h"
+
+
+namespace dfly::detail {
+
+using namespace std;
+
+unique_ptr<TransportCodec> TransportCodec::CreateLZ4() {
+  return make_unique<TransportCodec>(CompressorImpl::CreateLZ4(), DecompressImpl::CreateLZ4());
+}
+
+unique_ptr<TransportCodec> TransportCodec::CreateZstd() {
+  return make_unique<TransportCodec>(CompressorImpl::CreateZstd(), DecompressImpl::CreateZstd());
+}
+
+TransportCodec::TransportCodec(unique_ptr<CompressorImpl> compressor,
+                               unique_ptr<DecompressImpl> decompressor)
+    : compressor_{std::move(compressor)}, decompressor_{std::move(decompressor)} {
+}
+
+io::Result<io::Bytes> TransportCodec::Compress(io::Bytes data) {
+  return compressor_->Compress(data);
+}
+
+error_code TransportCodec::Decompress(io::Bytes data, size_t max_size, io::IoBuf* dest) {
+  decompressor_->set_max_size(max_size);
+  auto res = decompressor_->Decompress(io::View(data));
+  if (!res)
+    return res.error();
+
+  // Skip the blob end opcode that terminates the decompressed data.
+  io::IoBuf* buf = *res;
+  dest->WriteAndCommit(buf->InputBuffer().data(), buf->InputLen() - 1);
+  buf->ConsumeInput(buf->InputLen());
+  return {};
+}
+
+}  // namespace dfly::detail
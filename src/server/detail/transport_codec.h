@@ -0,0 +1,32 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <memory>
+
+#include "facade/framed_transport.h"
+#include "server/detail/compressor.h"
+#include "server/detail/decompress.h"
+
+namespace dfly::detail {
+
+// Compresses the framed transport of a connection with the snapshot compressors.
+class TransportCodec : public facade::FrameCodec {
+ public:
+  static std::unique_ptr<TransportCodec> CreateLZ4();
+  static std::unique_ptr<TransportCodec> CreateZstd();
+
+  TransportCodec(std::unique_ptr<CompressorImpl> compressor,
+                 std::unique_ptr<DecompressImpl> decompressor);
+
+  io::Result<io::Bytes> Compress(io::Bytes data) final;
+  std::error_code Decompress(io::Bytes data, size_t max_size, io::IoBuf* dest) final;
+
+ private:
+  std::unique_ptr<CompressorImpl> compressor_;
+  std::unique_ptr<DecompressImpl> decompressor_;
+};
+
+}  // namespace dfly::detail
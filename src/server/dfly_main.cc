@@ -82,8 +82,8 @@ ABSL_FLAG(bool, version_check, true,
 
 ABSL_FLAG(uint16_t, tcp_backlog, 256, "TCP listen(2) backlog parameter.");
 ABSL_FLAG(uint16_t, uring_recv_buffer_cnt, 0,
-          "How many socket recv buffers of size 256 to allocate per thread."
-          "Relevant only for modern kernels with io_uring enabled");
+          "How many socket recv buffers of size 128 to allocate per thread, shared by all its "
+          "connections, 0 disables them. Relevant only for modern kernels with io_uring enabled");
 
 ABSL_FLAG(bool, omit_basic_usage, false, "Omit printing basic usage info.");
 
@@ -616,8 +616,8 @@ void RegisterBufRings(ProactorPool* pool) {
   }
 
   if (dfly::kernel_version < 602 || pool->at(0)->GetKind() != ProactorBase::IOURING) {
-    LOG(WARNING) << "uring_recv_buffer_cnt is only supported on kernels >= 6.2 and with "
-                    "io_uring proactor";
+    LOG(INFO) << "Not using socket recv buffer rings, they are only supported on kernels >= 6.2 "
+                 "and with io_uring proactor";
     return;
   }
 
@@ -0,0 +1,189 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "server/dispatch_coalescer.h"
+
+#include "base/flags.h"
+#include "base/logging.h"
+#include "server/command_registry.h"
+#include "server/engine_shard_set.h"
+#include "server/main_service.h"
+#include "server/server_state.h"
+#include "server/transaction.h"
+#include "server/tx_base.h"
+
+ABSL_FLAG(uint32_t, cross_conn_squash, 0,
+          "Average number of concurrently dispatched single-shard commands per thread from which "
+          "commands of different connections are squashed into one shard hop, 0 means disabled");
+
+namespace dfly {
+
+using namespace std;
+using namespace facade;
+using namespace util;
+
+namespace {
+
+thread_local DispatchCoalescer tl_coalescer;
+
+}  // namespace
+
+DispatchCoalescer* DispatchCoalescer::tlocal() {
+  return &tl_coalescer;
+}
+
+bool DispatchCoalescer::TryDispatch(const CommandId* cid, CmdArgList tail_args,
+                                    RedisReplyBuilder* rb, ConnectionContext* cntx,
+                                    Service* service, optional<string_view> orig_cmd_name) {
+  uint32_t threshold = absl::GetFlag(FLAGS_cross_conn_squash);
+  if (threshold == 0 || cntx->conn() == nullptr)
+    return false;
+
+  if (!cid->IsTransactional() || cid->IsBlocking() || (cid->opt_mask() & CO::GLOBAL_TRANS) ||
+      CO::IsTransKind(cid->name()) || CO::IsEvalKind(cid->name()) || cid->name() == "CLIENT")
+    return false;
+
+  // Tracking needs the owner connection to be registered with the keys read by the command.
+  if (cntx->conn_state.tracking_info_.IsTrackingOn() || cntx->conn_state.squashing_info)
+    return false;
+
+  auto keys = DetermineKeys(cid, tail_args);
+  if (!keys.ok() || keys->NumArgs() == 0)
+    return false;
+
+  ShardId sid = kInvalidSid;
+  for (string_view key : keys->Range(tail_args)) {
+    ShardId key_sid = Shard(key, shard_set->size());
+    if (sid != kInvalidSid && sid != key_sid)
+      return false;
+    sid = key_sid;
+  }
+
+  bool leader = pending_cnt_ == 0;
+  if (leader && !ShouldOpenBatch(threshold))
+    return false;
+
+  if (pending_.empty()) {
+    pending_ = std::move(spare_);
+    pending_.resize(shard_set->size());
+  }
+
+  if (pending_[sid].size() >= kMaxBatchPerShard)
+    return false;
+
+  if (!base_cid_)
+    base_cid_ = service->FindCmd("EXEC");
+
+  Entry entry{cid, tail_args, *keys, orig_cmd_name, cntx, rb->GetRespVersion(), {}, false, {}};
+  pending_[sid].push_back(&entry);
+  pending_cnt_++;
+
+  cntx->cid = cid;
+  cntx->last_command_debug.shards_count = 1;
+
+  if (leader) {
+    // Let all connections that are ready in this iteration join the batch.
+    ThisFiber::Yield();
+    ExecuteBatch(service);
+  } else {
+    entry.done.Wait();
+  }
+
+  if (!entry.executed)
+    return false;
+
+  CapturingReplyBuilder::Apply(std::move(entry.reply), rb);
+  return true;
+}
+
+bool DispatchCoalescer::ShouldOpenBatch(uint32_t threshold) {
+  if (avg_batch_size_ >= threshold)
+    return true;
+
+  // Probe periodically, otherwise the average would never grow again once below the threshold.
+  return ++bypassed_ % kProbeInterval == 0;
+}
+
+void DispatchCoalescer::ExecuteBatch(Service* service) {
+  Batch batch = std::move(pending_);
+  size_t batch_size = pending_cnt_;
+  pending_.clear();
+  pending_cnt_ = 0;
+  bypassed_ = 0;
+
+  unsigned num_shards = 0;
+  for (const auto& entries : batch)
+    num_shards += !entries.empty();
+
+  fb2::BlockingCounter bc(num_shards);
+  for (ShardId sid = 0; sid < batch.size(); ++sid) {
+    if (batch[sid].empty())
+      continue;
+
+    shard_set->AddL2(sid, [this, entries = absl::MakeSpan(batch[sid]), service, bc]() mutable {
+      ExecuteOnShard(entries, service);
+      bc->Dec();
+    });
+  }
+  bc->Wait();
+
+  avg_batch_size_ = avg_batch_size_ * 0.875 + batch_size * 0.125;
+
+  // The leader is notified as well, it just does not wait on it.
+  size_t executed = 0;
+  for (auto& entries : batch) {
+    for (Entry* entry : entries) {
+      executed += entry->executed;
+      entry->done.Notify();
+    }
+    entries.clear();
+  }
+
+  auto* ss = ServerState::tlocal();
+  ss->stats.cross_conn_squash_batches++;
+  ss->stats.cross_conn_squashed_commands += executed;
+
+  if (spare_.empty())
+    spare_ = std::move(batch);
+}
+
+void DispatchCoalescer::ExecuteOnShard(absl::Span<Entry* const> entries, Service* service) {
+  boost::intrusive_ptr<Transaction> local_tx{new Transaction{base_cid_}};
+  local_tx->StartMultiNonAtomic();
+
+  ShardId sid = EngineShard::tlocal()->shard_id();
+  for (Entry* entry : entries) {
+    const DbSlice& db_slice = entry->cntx->ns->GetDbSlice(sid);
+    DbIndex db_index = entry->cntx->conn_state.db_index;
+    auto mode = entry->cid->IsReadOnly() ? IntentLock::SHARED : IntentLock::EXCLUSIVE;
+    bool locked = false;
+    for (string_view key : entry->keys.Range(entry->args))
+      locked |= !db_slice.CheckLock(mode, db_index, key);
+    if (locked)
+      continue;
+
+    entry->executed = true;
+    CapturingReplyBuilder crb(ReplyMode::FULL, entry->resp_v);
+    ConnectionContext local_cntx{entry->cntx, local_tx.get()};
+
+    local_tx->MultiSwitchCmd(entry->cid);
+    local_cntx.cid = entry->cid;
+
+    OpStatus status =
+        local_tx->InitByArgs(entry->cntx->ns, local_cntx.conn_state.db_index, entry->args);
+    if (status != OpStatus::OK) {
+      crb.SendError(status);
+    } else if (!service->InvokeCmd(entry->cid, entry->args, &crb, &local_cntx,
+                                   entry->orig_cmd_name)) {
+      crb.SendError("Internal Error");
+    }
+    entry->reply = crb.Take();
+
+    DCHECK_EQ(local_cntx.conn_state.db_index, entry->cntx->conn_state.db_index);
+  }
+
+  local_tx->UnlockMulti();
+}
+
+}  // namespace dfly
@@ -0,0 +1,88 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "facade/reply_capture.h"
+#include "server/conn_context.h"
+#include "server/tx_base.h"
+#include "util/fibers/synchronization.h"
+
+namespace dfly {
+
+class Service;
+
+// DispatchCoalescer squashes single-shard commands of different connections of the same IO thread
+// into one shard hop, the same way MultiCommandSquasher squashes the commands of one pipeline.
+//
+// The first connection that dispatches a command opens a batch and yields, so that all
+// connections that are ready in the same event-loop iteration can add their commands to it.
+// Then it runs the batch on the shards with one callback per shard and wakes up the other
+// connections, each of which sends its captured reply on its own. Because every connection waits
+// for its command to finish, the order of commands within a connection is preserved.
+//
+// Unlike atomic squashing, there is no parent transaction that holds the locks of the batch and
+// could spawn stub transactions. Each shard runs its commands on a standalone non-atomic carrier
+// transaction instead, which schedules every command on its own. A command on a locked key would
+// wait there for the holder of the lock and stall the rest of the batch, so it is left out of the
+// batch and its connection dispatches it regularly.
+//
+// Coalescing only pays off when many connections dispatch concurrently, so the coalescer tracks
+// the average batch size and bypasses itself while it is below the cross_conn_squash threshold,
+// running a batch every now and then to re-measure it.
+class DispatchCoalescer {
+ public:
+  // Returns the coalescer of the calling IO thread.
+  static DispatchCoalescer* tlocal();
+
+  // Executes the command as part of a batch and sends its reply to rb. Returns false if the
+  // command can not be coalesced, its keys are locked or coalescing is not worth it now, in that
+  // case it must be dispatched regularly. orig_cmd_name is the alias the command was called by.
+  bool TryDispatch(const CommandId* cid, CmdArgList tail_args, facade::RedisReplyBuilder* rb,
+                   ConnectionContext* cntx, Service* service,
+                   std::optional<std::string_view> orig_cmd_name);
+
+ private:
+  // Command of a waiting connection, lives on the stack of its fiber.
+  struct Entry {
+    const CommandId* cid;
+    CmdArgList args;
+    KeyIndex keys;
+    std::optional<std::string_view> orig_cmd_name;
+    ConnectionContext* cntx;
+    facade::RespVersion resp_v;
+    facade::CapturingReplyBuilder::Payload reply;
+    bool executed = false;  // false if the command was left out because of a locked key
+    util::fb2::Done done;
+  };
+
+  using Batch = std::vector<std::vector<Entry*>>;  // entries per shard
+
+  static constexpr unsigned kMaxBatchPerShard = 32;
+  static constexpr unsigned kProbeInterval = 64;
+
+  // Whether a new batch should be opened for the given threshold.
+  bool ShouldOpenBatch(uint32_t threshold);
+
+  // Runs the pending batch on all shards and notifies its entries.
+  void ExecuteBatch(Service* service);
+
+  // Callback that runs on the shard for its part of the batch.
+  void ExecuteOnShard(absl::Span<Entry* const> entries, Service* service);
+
+  Batch pending_;  // open batch
+  Batch spare_;    // recycled batch, to avoid reallocating the per shard vectors
+  size_t pending_cnt_ = 0;
+
+  double avg_batch_size_ = 0;  // moving average of the batch sizes seen
+  uint64_t bypassed_ = 0;      // commands dispatched regularly since the last batch
+
+  const CommandId* base_cid_ = nullptr;  // cid of the carrier transactions
+};
+
+}  // namespace dfly
@@ -386,6 +386,39 @@ TEST_F(DflyEngineTest, MemcacheFlags) {
   });
 }
 
+TEST_F(DflyEngineTest, MemcachePipelineSquashing) {
+  using MP = MemcacheParser;
+
+  auto make_cmd = [](MP::CmdType type, string_view key, uint32_t bytes_len = 0) {
+    MP::Command cmd;
+    cmd.type = type;
+    cmd.key = key;
+    cmd.bytes_len = bytes_len;
+    return cmd;
+  };
+
+  vector<MP::Command> cmds;
+  cmds.push_back(make_cmd(MP::SET, "a", 2));
+  cmds.back().no_reply = true;
+  cmds.push_back(make_cmd(MP::SET, "b", 3));
+  cmds.back().flags = 7;
+  cmds.push_back(make_cmd(MP::GET, "a"));
+  cmds.push_back(make_cmd(MP::GET, "b"));
+  cmds.back().keys_ext.push_back("a");
+  cmds.push_back(make_cmd(MP::VERSION, ""));
+  cmds.push_back(make_cmd(MP::DELETE, "b"));
+  cmds.push_back(make_cmd(MP::GET, "b"));
+
+  const string_view values[] = {"va", "vbb", "", "", "", "", ""};
+  vector<facade::MCCommandRef> refs;
+  for (size_t i = 0; i < cmds.size(); ++i)
+    refs.push_back({&cmds[i], values[i]});
+
+  auto resp = RunMCPipeline(refs);
+  EXPECT_THAT(resp, ElementsAre("STORED", "VALUE a 0 2", "va", "END", "VALUE b 7 3", "vbb",
+                                "VALUE a 0 2", "va", "END", "VERSION 1.6.0 DF", "DELETED", "END"));
+}
+
 TEST_F(DflyEngineTest, LimitMemory) {
   mi_option_enable(mi_option_limit_os_alloc);
   string blob(128, 'a');
@@ -546,6 +579,40 @@ TEST_F(DflyEngineTest, PSubscribe) {
   EXPECT_EQ("a*", msg.pattern);
 }
 
+TEST_F(DflyEngineTest, PSubscribeManyPatterns) {
+  single_response_ = false;
+  auto resp = pp_->at(1)->Await([&] {
+    return Run({"psubscribe", "news", "news.*", "news.[st]*", "*.sport", "n?ws.*", "ne\\ws", "x*"});
+  });
+  EXPECT_THAT(resp, ArrLen(3));
+
+  auto publish = [&](std::string_view channel) {
+    return pp_->at(0)->Await([&] { return Run({"publish", channel, "foo"}); });
+  };
+  EXPECT_THAT(publish("news"), IntArg(2));  // also matched by the escaped pattern
+  EXPECT_THAT(publish("news.sport"), IntArg(4));
+  EXPECT_THAT(publish("news.tech"), IntArg(3));
+  EXPECT_THAT(publish("nows.tech"), IntArg(1));
+  EXPECT_THAT(publish("new"), IntArg(0));
+  EXPECT_THAT(publish("ne\\ws"), IntArg(0));
+  EXPECT_THAT(publish("old.sport"), IntArg(1));
+
+  pp_->AwaitFiberOnAll([](ProactorBase* pb) {});
+  EXPECT_EQ(11, SubscriberMessagesLen("IO1"));
+
+  // Removing a pattern rebuilds the index.
+  pp_->at(1)->Await([&] { return Run({"punsubscribe", "news.*"}); });
+  EXPECT_THAT(publish("news.sport"), IntArg(3));
+
+  // Glob patterns get new slots in the rebuilt index, and matchers compiled for the previous
+  // index must not be reused for them.
+  pp_->at(1)->Await([&] { return Run({"punsubscribe", "news.[st]*"}); });
+  pp_->at(1)->Await([&] { return Run({"psubscribe", "o?d.*"}); });
+  EXPECT_THAT(publish("news.sport"), IntArg(2));
+  EXPECT_THAT(publish("old.sport"), IntArg(2));
+  EXPECT_THAT(publish("nows.tech"), IntArg(1));
+}
+
 TEST_F(DflyEngineTest, Unsubscribe) {
   auto resp = Run({"unsubscribe", "a"});
   EXPECT_THAT(resp.GetVec(), ElementsAre("unsubscribe", "a", IntArg(0)));
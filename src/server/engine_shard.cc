@@ -8,6 +8,7 @@
 #include <absl/strings/str_cat.h>
 
 #include "base/flags.h"
+#include "core/qlist.h"
 #include "io/proc_reader.h"
 
 extern "C" {
@@ -65,7 +66,15 @@ ABSL_FLAG(double, eviction_memory_budget_threshold, 0.1,
           "Eviction starts when the free memory (including RSS memory) drops below "
           "eviction_memory_budget_threshold * max_memory_limit.");
 
+ABSL_FLAG(string, table_huge_pages, "",
+          "If set, the segments of the hash tables are allocated from 2MB huge pages, to reduce "
+          "TLB misses on large datasets. 'transparent' uses transparent huge pages, 'explicit' "
+          "uses the hugetlbfs pages reserved with vm.nr_hugepages and falls back to regular pages "
+          "once they run out.");
+
 ABSL_DECLARE_FLAG(uint32_t, max_eviction_per_heartbeat);
+ABSL_DECLARE_FLAG(string, list_compress_method);
+ABSL_DECLARE_FLAG(bool, list_background_compression);
 
 namespace dfly {
 
@@ -76,6 +85,9 @@ namespace {
 
 constexpr uint64_t kCursorDoneState = 0u;
 
+// Bounds the time the heartbeat spends on deferred list compression, ~1MB of 8KB nodes.
+constexpr size_t kMaxListNodesCompressedPerHeartbeat = 128;
+
 struct ShardMemUsage {
   std::size_t commited = 0;
   std::size_t used = 0;
@@ -94,6 +106,19 @@ ShardMemUsage ReadShardMemUsage(float wasted_ratio) {
   return usage;
 }
 
+QList::COMPR_METHOD ParseListComprMethod() {
+  string method = GetFlag(FLAGS_list_compress_method);
+  if (method == "lzf")
+    return QList::LZF;
+  if (method == "lz4")
+    return QList::LZ4;
+  if (method == "zstd")
+    return QList::ZSTD;
+
+  LOG(ERROR) << "Invalid list_compress_method value: " << method;
+  exit(1);
+}
+
 // RoundRobinSharder implements a way to distribute keys that begin with some prefix.
 // Round-robin is disabled by default. It is not a general use-case optimization, but instead only
 // reasonable when there are a few highly contended keys, which we'd like to spread between the
@@ -383,6 +408,7 @@ bool EngineShard::DoDefrag() {
 
   constexpr size_t kMaxTraverses = 40;
   const float threshold = GetFlag(FLAGS_mem_defrag_page_utilization_threshold);
+  const uint64_t start = fb2::ProactorBase::GetMonotonicTimeNs();
 
   // TODO: enable tiered storage on non-default db slice
   DbSlice& slice = namespaces->GetDefaultNamespace().GetDbSlice(shard_->shard_id());
@@ -406,6 +432,9 @@ bool EngineShard::DoDefrag() {
 
   do {
     cur = prime_table->Traverse(cur, [&](PrimeIterator it) {
+      if (!slice.CanMoveValue(defrag_state_.dbid, it->first))
+        return;
+
       // for each value check whether we should move it because it
       // seats on underutilized page of memory, and if so, do it.
       bool did = it->second.DefragIfNeeded(threshold);
@@ -434,6 +463,8 @@ bool EngineShard::DoDefrag() {
   stats_.defrag_task_invocation_total++;
   stats_.defrag_attempt_total += attempts;
 
+  ServerState::tlocal()->RecordLatencyEvent(
+      "defrag-cycle", (fb2::ProactorBase::GetMonotonicTimeNs() - start) / 1000);
   return true;
 }
 
@@ -467,6 +498,14 @@ EngineShard::EngineShard(util::ProactorBase* pb, mi_heap_t* heap)
       txq_([](const Transaction* t) { return t->txid(); }),
       mi_resource_(heap),
       shard_id_(pb->GetPoolIndex()) {
+  if (string huge_pages = GetFlag(FLAGS_table_huge_pages); !huge_pages.empty()) {
+    if (huge_pages != "transparent" && huge_pages != "explicit") {
+      LOG(ERROR) << "Invalid table_huge_pages value: " << huge_pages;
+      exit(1);
+    }
+    huge_page_resource_ = make_unique<HugePageResource>(&mi_resource_, huge_pages == "explicit");
+  }
+
   queue_.Start(absl::StrCat("shard_queue_", shard_id()));
   queue2_.Start(absl::StrCat("l2_queue_", shard_id()));
 }
@@ -555,6 +594,9 @@ void EngineShard::InitThreadLocal(ProactorBase* pb) {
   CompactObj::InitThreadLocal(shard_->memory_resource());
   SmallString::InitThreadLocal(data_heap);
 
+  QList::SetDefaultComprMethod(ParseListComprMethod());
+  QList::SetDeferCompression(GetFlag(FLAGS_list_background_compression));
+
   RoundRobinSharder::Init();
 
   shard_->shard_search_indices_.reset(new ShardDocIndices());
@@ -758,6 +800,7 @@ void EngineShard::Heartbeat() {
                                 shard_set->size()
                       : std::numeric_limits<size_t>::max();
   size_t used_memory = UsedMemory();
+  const uint64_t tiering_start = fb2::ProactorBase::GetMonotonicTimeNs();
   if (used_memory > tiering_offload_threshold) {
     VLOG(1) << "Running Offloading, memory=" << used_memory
             << " tiering_threshold: " << tiering_offload_threshold
@@ -768,7 +811,18 @@ void EngineShard::Heartbeat() {
         continue;
       tiered_storage_->RunOffloading(i);
     }
+  } else if (tiered_storage_) {
+    // Entries are relocated from sparse pages to memory, so compact only when it's not needed.
+    tiered_storage_->RunCompaction();
   }
+
+  if (tiered_storage_) {
+    ServerState::tlocal()->RecordLatencyEvent(
+        "tiering-cycle", (fb2::ProactorBase::GetMonotonicTimeNs() - tiering_start) / 1000);
+  }
+
+  QList::TrainZstdDictionary();
+  QList::CompressPending(kMaxListNodesCompressedPerHeartbeat);
 }
 
 void EngineShard::RetireExpiredAndEvict() {
@@ -795,6 +849,7 @@ void EngineShard::RetireExpiredAndEvict() {
   db_cntx.time_now_ms = GetCurrentTimeMs();
 
   size_t eviction_goal = GetFlag(FLAGS_enable_heartbeat_eviction) ? CalculateEvictionBytes() : 0;
+  ServerState* ss = ServerState::tlocal();
 
   for (unsigned i = 0; i < db_slice.db_array_size(); ++i) {
     if (!db_slice.IsDbValid(i))
@@ -803,7 +858,10 @@ void EngineShard::RetireExpiredAndEvict() {
     db_cntx.db_index = i;
     auto [pt, expt] = db_slice.GetTables(i);
     if (expt->size() > pt->size() / 4) {
+      uint64_t start = fb2::ProactorBase::GetMonotonicTimeNs();
       DbSlice::DeleteExpiredStats stats = db_slice.DeleteExpiredStep(db_cntx, ttl_delete_target);
+      ss->RecordLatencyEvent("expire-cycle",
+                             (fb2::ProactorBase::GetMonotonicTimeNs() - start) / 1000);
 
       eviction_goal -= std::min(eviction_goal, size_t(stats.deleted_bytes));
       counter_[TTL_TRAVERSE].IncBy(stats.traversed);
@@ -812,8 +870,11 @@ void EngineShard::RetireExpiredAndEvict() {
 
     if (eviction_goal) {
       uint32_t starting_segment_id = rand() % pt->GetSegmentCount();
+      uint64_t start = fb2::ProactorBase::GetMonotonicTimeNs();
       auto [evicted_items, evicted_bytes] =
           db_slice.FreeMemWithEvictionStep(i, starting_segment_id, eviction_goal);
+      ss->RecordLatencyEvent("eviction-cycle",
+                             (fb2::ProactorBase::GetMonotonicTimeNs() - start) / 1000);
 
       DVLOG(2) << "Heartbeat eviction: Expected to evict " << eviction_goal
                << " bytes. Actually evicted " << evicted_items << " items, " << evicted_bytes
@@ -854,8 +915,9 @@ void EngineShard::CacheStats() {
 }
 
 size_t EngineShard::UsedMemory() const {
-  return mi_resource_.used() + zmalloc_used_memory_tl + SmallString::UsedThreadLocal() +
-         search_indices()->GetUsedMemory();
+  size_t huge_pages_used = huge_page_resource_ ? huge_page_resource_->stats().mapped_bytes : 0;
+  return mi_resource_.used() + huge_pages_used + zmalloc_used_memory_tl +
+         SmallString::UsedThreadLocal() + search_indices()->GetUsedMemory();
 }
 
 bool EngineShard::ShouldThrottleForTiering() const {  // see header for formula justification
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "core/huge_page_resource.h"
 #include "core/intent_lock.h"
 #include "core/mi_memory_resource.h"
 #include "core/task_queue.h"
@@ -72,6 +73,17 @@ class EngineShard {
     return &mi_resource_;
   }
 
+  // Resource for the hash tables of the shard, backed by huge pages if table_huge_pages is set.
+  PMR_NS::memory_resource* table_memory_resource() {
+    return huge_page_resource_ ? static_cast<PMR_NS::memory_resource*>(huge_page_resource_.get())
+                               : &mi_resource_;
+  }
+
+  // nullptr unless table_huge_pages is set.
+  const HugePageResource* huge_page_resource() const {
+    return huge_page_resource_.get();
+  }
+
   TaskQueue* GetFiberQueue() {
     return &queue_;
   }
@@ -246,6 +258,7 @@ class EngineShard {
 
   TxQueue txq_;
   MiMemoryResource mi_resource_;
+  std::unique_ptr<HugePageResource> huge_page_resource_;
   ShardId shard_id_;
 
   Stats stats_;
@@ -1058,17 +1058,17 @@ OpResult<uint32_t> GenericFamily::OpDel(const OpArgs& op_args, const ShardArgs&
 
   uint32_t res = 0;
 
-  for (string_view key : keys) {
-    auto it = db_slice.FindMutable(op_args.db_cntx, key).it;  // post_updater will run immediately
+  db_slice.FindMutableBatch(op_args.db_cntx, keys, [&](string_view key, auto find_res) {
+    auto it = find_res.it;  // post_updater will run immediately
     if (!IsValid(it))
-      continue;
+      return;
 
     if (async)
       it->first.SetAsyncDelete();
 
     db_slice.Del(op_args.db_cntx, it);
     ++res;
-  }
+  });
 
   return res;
 }
@@ -1790,10 +1790,8 @@ OpResult<uint32_t> GenericFamily::OpExists(const OpArgs& op_args, const ShardArg
   auto& db_slice = op_args.GetDbSlice();
   uint32_t res = 0;
 
-  for (string_view key : keys) {
-    auto find_res = db_slice.FindReadOnly(op_args.db_cntx, key);
-    res += IsValid(find_res.it);
-  }
+  db_slice.FindReadOnlyBatch(op_args.db_cntx, keys,
+                             [&](string_view, auto find_res) { res += IsValid(find_res.it); });
   return res;
 }
 
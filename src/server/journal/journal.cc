@@ -8,6 +8,7 @@
 
 #include "base/logging.h"
 #include "server/engine_shard_set.h"
+#include "server/error.h"
 #include "server/journal/journal_slice.h"
 #include "server/server_state.h"
 
@@ -47,6 +48,12 @@ error_code Journal::Close() {
 
   lock_guard lk(state_mu_);
   auto close_cb = [&](auto*) {
+    if (EngineShard* shard = EngineShard::tlocal(); shard && files_)
+      files_[shard->shard_id()].store(nullptr, memory_order_release);
+
+    auto ec = journal_slice.CloseFile();
+    LOG_IF(ERROR, ec) << "Error closing journal file: " << ec.message();
+
     ServerState::tlocal()->set_journal(nullptr);
     EngineShard* shard = EngineShard::tlocal();
     if (shard) {
@@ -59,6 +66,23 @@ error_code Journal::Close() {
   return {};
 }
 
+void Journal::SetLoadedSnapshotPosition(ShardId sid, LSN lsn) {
+  lock_guard lk(state_mu_);
+  loaded_snapshot_positions_[sid] = lsn;
+}
+
+optional<LSN> Journal::GetLoadedSnapshotPosition(ShardId sid) const {
+  lock_guard lk(state_mu_);
+  if (auto it = loaded_snapshot_positions_.find(sid); it != loaded_snapshot_positions_.end())
+    return it->second;
+  return nullopt;
+}
+
+void Journal::ClearLoadedSnapshotPositions() {
+  lock_guard lk(state_mu_);
+  loaded_snapshot_positions_.clear();
+}
+
 uint32_t Journal::RegisterOnChange(ChangeCallback cb) {
   return journal_slice.RegisterOnChange(cb);
 }
@@ -92,5 +116,54 @@ void Journal::SetFlushMode(bool allow_flush) {
   journal_slice.SetFlushMode(allow_flush);
 }
 
+void Journal::SetLsn(LSN lsn) {
+  journal_slice.set_cur_lsn(lsn);
+}
+
+error_code Journal::OpenFile(const JournalFile::Options& opts) {
+  JournalFile::Options file_opts = opts;
+  file_opts.on_error = [this](error_code ec) {
+    lock_guard lk(error_mu_);
+    if (!file_ec_)
+      file_ec_ = ec;
+    file_failed_.store(true, memory_order_relaxed);
+  };
+  RETURN_ON_ERR(journal_slice.OpenFile(file_opts));
+
+  lock_guard lk(state_mu_);
+  if (!files_)
+    files_.reset(new atomic<JournalFile*>[shard_set->size()]{});
+  files_[EngineShard::tlocal()->shard_id()].store(journal_slice.file(), memory_order_release);
+  syncs_every_write_ = opts.fsync == FsyncPolicy::ALWAYS;
+  return {};
+}
+
+error_code Journal::WaitDurable(ShardId sid) const {
+  JournalFile* file = files_ ? files_[sid].load(memory_order_acquire) : nullptr;
+  return file ? file->WaitSynced() : error_code{};
+}
+
+error_code Journal::GetFileError() const {
+  lock_guard lk(error_mu_);
+  return file_ec_;
+}
+
+bool Journal::HasFile() const {
+  return journal_slice.HasFile();
+}
+
+void Journal::TEST_FailFileSync(error_code ec) {
+  CHECK(journal_slice.HasFile());
+  journal_slice.file()->TEST_FailSync(ec);
+}
+
+LSN Journal::MarkSnapshotPosition() {
+  return journal_slice.MarkSnapshotPosition();
+}
+
+void Journal::RemoveSnapshottedSegments() {
+  journal_slice.RemoveSnapshottedSegments();
+}
+
 }  // namespace journal
 }  // namespace dfly
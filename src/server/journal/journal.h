@@ -3,6 +3,10 @@
 //
 
 #pragma once
+
+#include <absl/container/flat_hash_map.h>
+
+#include "server/journal/journal_file.h"
 #include "server/journal/types.h"
 #include "util/fibers/detail/fiber_interface.h"
 #include "util/proactor_pool.h"
@@ -13,6 +17,10 @@ class Transaction;
 
 namespace journal {
 
+// Reply to writes once the journal file could not persist them.
+constexpr std::string_view kFileErr =
+    "-MISCONF Errors writing to the journal file, writes are disabled";
+
 class Journal {
  public:
   using Span = absl::Span<const std::string_view>;
@@ -23,6 +31,12 @@ class Journal {
 
   std::error_code Close();
 
+  // Journal positions of the shards in the snapshot that is being loaded, see
+  // RDB_OPCODE_JOURNAL_POSITION. Thread safe.
+  void SetLoadedSnapshotPosition(ShardId sid, LSN lsn);
+  std::optional<LSN> GetLoadedSnapshotPosition(ShardId sid) const;
+  void ClearLoadedSnapshotPositions();
+
   //******* The following functions must be called in the context of the owning shard *********//
 
   uint32_t RegisterOnChange(ChangeCallback cb);
@@ -39,8 +53,45 @@ class Journal {
 
   void SetFlushMode(bool allow_flush);
 
+  void SetLsn(LSN lsn);
+
+  // On-disk persistence of the shard journal, see JournalSlice.
+  std::error_code OpenFile(const JournalFile::Options& opts);
+  bool HasFile() const;
+  LSN MarkSnapshotPosition();
+  void RemoveSnapshottedSegments();
+
+  // Makes the journal file of the shard fail on its next sync.
+  void TEST_FailFileSync(std::error_code ec);
+
+  //******* The following functions can be called from any thread *********//
+
+  // Whether writes must wait for WaitDurable() before replying (journal_fsync=always).
+  bool SyncsEveryWrite() const {
+    return syncs_every_write_;
+  }
+
+  // Blocks until the entries that shard sid journaled so far are synced to disk.
+  std::error_code WaitDurable(ShardId sid) const;
+
+  // Set once a journal file failed to persist entries. Writes are rejected afterwards.
+  bool HasFileError() const {
+    return file_failed_.load(std::memory_order_relaxed);
+  }
+  std::error_code GetFileError() const;
+
  private:
   mutable util::fb2::Mutex state_mu_;
+  absl::flat_hash_map<ShardId, LSN> loaded_snapshot_positions_;
+
+  // Journal files indexed by shard id. Set when the files are opened during startup.
+  std::unique_ptr<std::atomic<JournalFile*>[]> files_;
+  bool syncs_every_write_ = false;
+  std::atomic_bool file_failed_{false};
+
+  // Separate from state_mu_, which Close() holds while the files are flushed.
+  mutable util::fb2::Mutex error_mu_;
+  std::error_code file_ec_;
 };
 
 class JournalFlushGuard {
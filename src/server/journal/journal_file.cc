@@ -0,0 +1,376 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "server/journal/journal_file.h"
+
+#include <absl/base/internal/endian.h>
+#include <absl/strings/match.h>
+#include <absl/strings/numbers.h>
+#include <absl/strings/str_cat.h>
+#include <absl/strings/strip.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+
+#include "base/logging.h"
+#include "server/error.h"
+#include "util/fibers/uring_file.h"
+#include "util/fibers/uring_proactor.h"
+
+extern "C" {
+#include "redis/crc64.h"
+}
+
+namespace dfly {
+namespace journal {
+
+using namespace std;
+using namespace util;
+using namespace chrono_literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t kRecordHeaderSize = 20;  // lsn, length, crc64
+constexpr size_t kMaxRecordSize = 1ULL << 31;
+
+// Shrink the batch buffer after big bursts of writes.
+constexpr size_t kMaxRetainedBatchCapacity = 4 << 20;
+
+string SegmentPrefix(unsigned shard_id) {
+  return absl::StrCat("journal-", absl::Dec(shard_id, absl::kZeroPad4), "-");
+}
+
+string SegmentName(unsigned shard_id, LSN start_lsn) {
+  return absl::StrCat(SegmentPrefix(shard_id), absl::Dec(start_lsn, absl::kZeroPad20), ".log");
+}
+
+uint64_t RecordCrc(const uint8_t* header, string_view data) {
+  uint64_t crc = crc64(0, header, 12);
+  return crc64(crc, reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+error_code Fdatasync(int fd) {
+  auto* proactor = static_cast<fb2::UringProactor*>(ProactorBase::me());
+  fb2::FiberCall fc(proactor);
+  fc->PrepFSync(fd, IORING_FSYNC_DATASYNC);
+  fb2::FiberCall::IoResult io_res = fc.Get();
+  return io_res < 0 ? error_code{-io_res, system_category()} : error_code{};
+}
+
+// Removes the file with io_uring, so that the shard thread does not block on the filesystem.
+// SubmitEntry has no helper for unlinkat, so the entry is prepared like io_uring_prep_unlinkat.
+error_code UnlinkFile(const string& path) {
+  auto* proactor = static_cast<fb2::UringProactor*>(ProactorBase::me());
+  fb2::FiberCall fc(proactor);
+  io_uring_sqe* sqe = fc->sqe();
+  sqe->opcode = IORING_OP_UNLINKAT;
+  sqe->flags = 0;
+  sqe->ioprio = 0;
+  sqe->fd = AT_FDCWD;
+  sqe->off = 0;
+  sqe->addr = reinterpret_cast<uint64_t>(path.c_str());
+  sqe->len = 0;
+  sqe->unlink_flags = 0;
+  sqe->buf_index = 0;
+  sqe->personality = 0;
+  sqe->file_index = 0;
+  fb2::FiberCall::IoResult io_res = fc.Get();
+
+  // Kernels before 5.11 do not support the opcode.
+  if (io_res == -EINVAL && unlink(path.c_str()) == 0)
+    return {};
+  return io_res < 0 ? error_code{-io_res, system_category()} : error_code{};
+}
+
+}  // namespace
+
+bool ParseFsyncPolicy(string_view str, FsyncPolicy* policy) {
+  if (absl::EqualsIgnoreCase(str, "always"))
+    *policy = FsyncPolicy::ALWAYS;
+  else if (absl::EqualsIgnoreCase(str, "everysec"))
+    *policy = FsyncPolicy::EVERYSEC;
+  else if (absl::EqualsIgnoreCase(str, "no"))
+    *policy = FsyncPolicy::NO;
+  else
+    return false;
+  return true;
+}
+
+JournalFile::JournalFile(unsigned shard_id, Options opts)
+    : shard_id_(shard_id), opts_(std::move(opts)) {
+}
+
+JournalFile::~JournalFile() {
+  DCHECK(!file_);
+}
+
+error_code JournalFile::Open(LSN next_lsn) {
+  CHECK(!file_);
+  if (ProactorBase::me()->GetKind() != ProactorBase::IOURING)
+    return make_error_code(errc::operation_not_supported);
+
+  for (auto& segment : ListSegments(opts_.dir, shard_id_)) {
+    if (segment.start_lsn < next_lsn) {
+      segments_.push_back(std::move(segment));
+    } else if (segment.start_lsn > next_lsn) {
+      // Can only be left after unreadable segments, it must not be replayed after the new one.
+      LOG(WARNING) << "Removing stale journal segment " << segment.path;
+      RETURN_ON_ERR(UnlinkFile(segment.path));
+    }
+    // A segment that starts at next_lsn has no entries and is truncated by OpenSegment.
+  }
+
+  RETURN_ON_ERR(OpenSegment(next_lsn));
+
+  last_sync_ = chrono::steady_clock::now();
+  flush_fb_ = fb2::Fiber(absl::StrCat("journal_file", shard_id_), [this] { FlushFb(); });
+  return {};
+}
+
+error_code JournalFile::Close() {
+  stopping_ = true;
+  waker_.notify();
+  flush_fb_.JoinIfNeeded();
+
+  error_code ec;
+  if (file_) {
+    ec = file_->Close();
+    file_.reset();
+  }
+  return status_ec_ ? status_ec_ : ec;
+}
+
+void JournalFile::Append(LSN lsn, string_view data) {
+  if (status_ec_ || !file_)
+    return;
+
+  if (pending_.empty())
+    pending_start_lsn_ = lsn;
+  EncodeRecord(lsn, data, &pending_);
+  appended_lsn_.store(lsn, memory_order_release);
+  waker_.notify();
+}
+
+error_code JournalFile::WaitSynced() {
+  if (opts_.fsync != FsyncPolicy::ALWAYS)
+    return {};
+
+  LSN lsn = appended_lsn_.load(memory_order_acquire);
+  synced_ec_.await([&] {
+    return synced_lsn_.load(memory_order_acquire) >= lsn || failed_.load(memory_order_acquire);
+  });
+  return failed_.load(memory_order_acquire) ? make_error_code(errc::io_error) : error_code{};
+}
+
+void JournalFile::RemoveSegmentsBefore(LSN lsn) {
+  // A segment holds the entries up to the start of the next one, the last segment is active.
+  while (segments_.size() > 1 && segments_[1].start_lsn <= lsn) {
+    error_code ec = UnlinkFile(segments_.front().path);
+    LOG_IF(WARNING, ec) << "Could not remove journal segment " << segments_.front().path << ": "
+                        << ec.message();
+    VLOG(1) << "Removed journal segment " << segments_.front().path;
+    segments_.pop_front();
+  }
+}
+
+vector<JournalSegment> JournalFile::ListSegments(string_view dir, unsigned shard_id) {
+  vector<JournalSegment> res;
+  error_code ec;
+  const string prefix = SegmentPrefix(shard_id);
+
+  for (const auto& entry : fs::directory_iterator(dir, ec)) {
+    string name = entry.path().filename().string();
+    string_view lsn_str = name;
+    if (!absl::ConsumePrefix(&lsn_str, prefix) || !absl::ConsumeSuffix(&lsn_str, ".log"))
+      continue;
+
+    LSN start_lsn;
+    if (absl::SimpleAtoi(lsn_str, &start_lsn))
+      res.push_back({entry.path().string(), start_lsn});
+  }
+  LOG_IF(WARNING, ec && ec != errc::no_such_file_or_directory)
+      << "Could not list journal directory " << dir << ": " << ec.message();
+
+  sort(res.begin(), res.end(),
+       [](const auto& l, const auto& r) { return l.start_lsn < r.start_lsn; });
+  return res;
+}
+
+void JournalFile::EncodeRecord(LSN lsn, string_view data, string* dest) {
+  uint8_t header[kRecordHeaderSize];
+  absl::little_endian::Store64(header, lsn);
+  absl::little_endian::Store32(header + 8, data.size());
+  absl::little_endian::Store64(header + 12, RecordCrc(header, data));
+
+  dest->append(reinterpret_cast<const char*>(header), kRecordHeaderSize);
+  dest->append(data);
+}
+
+error_code JournalFile::OpenSegment(LSN start_lsn) {
+  string path = (fs::path(opts_.dir) / SegmentName(shard_id_, start_lsn)).string();
+
+  // O_TRUNC is safe, because an existing segment with the same start has no entries.
+  constexpr int kFlags = O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC;
+  auto res = fb2::OpenLinux(path, kFlags, 0644);
+  if (!res)
+    return res.error();
+
+  file_ = std::move(res.value());
+  offset_ = 0;
+  RETURN_ON_ERR(file_->Write(io::Buffer(kMagic), offset_, 0));
+  offset_ += kMagic.size();
+
+  segments_.push_back({std::move(path), start_lsn});
+  VLOG(1) << "Opened journal segment " << segments_.back().path;
+  return {};
+}
+
+error_code JournalFile::WriteBatch() {
+  if (opts_.max_segment_size && offset_ > kMagic.size() &&
+      offset_ + batch_.size() > opts_.max_segment_size) {
+    // The batch starts with a new segment, so the segments never split records.
+    if (dirty_) {
+      RETURN_ON_ERR(Sync());
+    }
+    RETURN_ON_ERR(file_->Close());
+    file_.reset();
+
+    RETURN_ON_ERR(OpenSegment(batch_start_lsn_));
+  }
+
+  RETURN_ON_ERR(file_->Write(io::Buffer(batch_), offset_, 0));
+  offset_ += batch_.size();
+  dirty_ = true;
+  return {};
+}
+
+error_code JournalFile::Sync() {
+  if (test_sync_ec_)
+    return test_sync_ec_;
+  RETURN_ON_ERR(Fdatasync(file_->fd()));
+  dirty_ = false;
+  last_sync_ = chrono::steady_clock::now();
+
+  synced_lsn_.store(written_lsn_, memory_order_release);
+  synced_ec_.notifyAll();
+  return {};
+}
+
+void JournalFile::FlushFb() {
+  while (true) {
+    waker_.await_until([this] { return !pending_.empty() || stopping_; },
+                       chrono::steady_clock::now() + 1s);
+
+    if (!pending_.empty()) {
+      // Everything that was appended while the previous batch was written goes with one write.
+      batch_start_lsn_ = pending_start_lsn_;
+      batch_.swap(pending_);
+      LSN batch_end_lsn = appended_lsn_.load(memory_order_relaxed);
+
+      status_ec_ = WriteBatch();
+      if (!status_ec_)
+        written_lsn_ = batch_end_lsn;
+      batch_.clear();
+      if (batch_.capacity() > kMaxRetainedBatchCapacity)
+        batch_.shrink_to_fit();
+    }
+
+    bool sync = dirty_ && !status_ec_;
+    if (sync && !stopping_) {
+      if (opts_.fsync == FsyncPolicy::EVERYSEC)
+        sync = chrono::steady_clock::now() - last_sync_ >= 1s;
+      else if (opts_.fsync == FsyncPolicy::NO)
+        sync = false;
+    }
+
+    if (sync)
+      status_ec_ = Sync();
+
+    if (status_ec_) {
+      LOG(ERROR) << "Journal file of shard " << shard_id_
+                 << " failed, stopped persisting the journal: " << status_ec_.message();
+      pending_.clear();
+
+      failed_.store(true, memory_order_release);
+      synced_ec_.notifyAll();
+      if (opts_.on_error)
+        opts_.on_error(status_ec_);
+      return;
+    }
+
+    if (stopping_ && pending_.empty())
+      return;
+  }
+}
+
+JournalFileReader::JournalFileReader(io::Source* source) : source_{source}, buf_{1 << 16} {
+}
+
+bool JournalFileReader::Next(LSN* lsn, string* data) {
+  if (!header_checked_) {
+    if (!EnsureRead(JournalFile::kMagic.size()))
+      return false;
+
+    string_view magic{reinterpret_cast<const char*>(buf_.InputBuffer().data()),
+                      JournalFile::kMagic.size()};
+    if (magic != JournalFile::kMagic) {
+      corrupted_ = true;
+      return false;
+    }
+    buf_.ConsumeInput(JournalFile::kMagic.size());
+    header_checked_ = true;
+  }
+
+  if (!EnsureRead(kRecordHeaderSize))
+    return false;
+
+  const uint8_t* header = buf_.InputBuffer().data();
+  uint32_t len = absl::little_endian::Load32(header + 8);
+  if (len > kMaxRecordSize) {
+    corrupted_ = true;
+    return false;
+  }
+  if (!EnsureRead(kRecordHeaderSize + len))
+    return false;
+
+  // EnsureRead could reallocate the buffer.
+  header = buf_.InputBuffer().data();
+  string_view record{reinterpret_cast<const char*>(header + kRecordHeaderSize), len};
+  if (RecordCrc(header, record) != absl::little_endian::Load64(header + 12)) {
+    corrupted_ = true;
+    return false;
+  }
+
+  *lsn = absl::little_endian::Load64(header);
+  data->assign(record);
+  buf_.ConsumeInput(kRecordHeaderSize + len);
+  return true;
+}
+
+bool JournalFileReader::EnsureRead(size_t num) {
+  if (buf_.InputLen() >= num)
+    return true;
+
+  size_t remainder = num - buf_.InputLen();
+  buf_.EnsureCapacity(remainder);
+  auto res = source_->ReadAtLeast(buf_.AppendBuffer(), remainder);
+  if (!res) {
+    corrupted_ = true;
+    return false;
+  }
+
+  buf_.CommitWrite(*res);
+  if (*res < remainder) {
+    // An incomplete record at the end is the result of an interrupted write.
+    corrupted_ = buf_.InputLen() > 0;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace journal
+}  // namespace dfly
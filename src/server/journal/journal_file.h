@@ -0,0 +1,157 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "io/io.h"
+#include "io/io_buf.h"
+#include "server/common.h"
+#include "util/fibers/fibers.h"
+#include "util/fibers/synchronization.h"
+
+namespace util::fb2 {
+class LinuxFile;
+}  // namespace util::fb2
+
+namespace dfly {
+namespace journal {
+
+enum class FsyncPolicy : uint8_t {
+  ALWAYS,    // Sync after every written batch of entries, writes reply after their batch is synced.
+  EVERYSEC,  // Sync at most once per second.
+  NO,        // Leave it to the operating system.
+};
+
+bool ParseFsyncPolicy(std::string_view str, FsyncPolicy* policy);
+
+// A segment of the on-disk journal of a shard. Segments are named after the LSN of their first
+// entry, so that ordering and pruning do not require reading them.
+struct JournalSegment {
+  std::string path;
+  LSN start_lsn;
+};
+
+// Persists the journal of a single shard into a sequence of append-only segment files.
+// Append() only buffers the entry and never preempts. A dedicated fiber writes everything that
+// was buffered while the previous write was in flight with a single io_uring write (group commit)
+// and syncs the file according to the fsync policy. With FsyncPolicy::ALWAYS, coordinators call
+// WaitSynced() before replying to writes.
+//
+// Every segment starts with a magic header followed by records of the form:
+// lsn (8 bytes) | length (4 bytes) | crc64 of the previous fields and the data (8 bytes) | data,
+// where data is a serialized journal entry. All integers are little endian.
+class JournalFile {
+ public:
+  struct Options {
+    std::string dir;
+    FsyncPolicy fsync = FsyncPolicy::EVERYSEC;
+    size_t max_segment_size = 0;  // 0 - no rotation.
+
+    // Called from the shard thread once writing or syncing failed. No entries are persisted after.
+    std::function<void(std::error_code)> on_error;
+  };
+
+  JournalFile(unsigned shard_id, Options opts);
+  ~JournalFile();
+
+  // Starts a new segment with entries from next_lsn after the existing segments of the shard.
+  // Must be called from the shard thread, which must run an io_uring proactor. The directory must
+  // exist.
+  std::error_code Open(LSN next_lsn);
+
+  // Writes and syncs all buffered entries, then closes the segment.
+  std::error_code Close();
+
+  void Append(LSN lsn, std::string_view data);
+
+  // With FsyncPolicy::ALWAYS, blocks the calling fiber until all entries appended so far are
+  // synced. Returns an error if the file failed before. Can be called from any thread.
+  std::error_code WaitSynced();
+
+  // Removes the segments that contain only entries below lsn. The active segment is never removed.
+  void RemoveSegmentsBefore(LSN lsn);
+
+  std::error_code status() const {
+    return status_ec_;
+  }
+
+  // Makes the following syncs fail with ec. Must be called from the shard thread.
+  void TEST_FailSync(std::error_code ec) {
+    test_sync_ec_ = ec;
+  }
+
+  // Returns the existing segments of the shard ordered by their LSN.
+  static std::vector<JournalSegment> ListSegments(std::string_view dir, unsigned shard_id);
+
+  static void EncodeRecord(LSN lsn, std::string_view data, std::string* dest);
+
+  static constexpr std::string_view kMagic = "DFJRNL01";
+
+ private:
+  std::error_code OpenSegment(LSN start_lsn);
+  std::error_code WriteBatch();
+  std::error_code Sync();
+  void FlushFb();
+
+  unsigned shard_id_;
+  Options opts_;
+
+  std::deque<JournalSegment> segments_;  // oldest first, the last one is active.
+  std::unique_ptr<util::fb2::LinuxFile> file_;
+  size_t offset_ = 0;
+
+  std::string pending_, batch_;
+  LSN pending_start_lsn_ = 0, batch_start_lsn_ = 0;
+  LSN written_lsn_ = 0;  // last entry written to the file.
+
+  // Accessed by coordinators in WaitSynced().
+  std::atomic<LSN> appended_lsn_{0}, synced_lsn_{0};
+  std::atomic_bool failed_{false};
+  util::fb2::EventCount synced_ec_;
+
+  bool dirty_ = false;  // has writes that were not synced yet.
+  bool stopping_ = false;
+  std::chrono::steady_clock::time_point last_sync_;
+  util::fb2::EventCount waker_;
+  util::fb2::Fiber flush_fb_;
+
+  std::error_code status_ec_;
+  std::error_code test_sync_ec_;
+};
+
+// Reads the records of a journal segment written by JournalFile.
+class JournalFileReader {
+ public:
+  explicit JournalFileReader(io::Source* source);
+
+  // Reads the next record. Returns false at the end of the segment. An incomplete or corrupted
+  // record, which is expected at the tail after a crash, ends the segment and sets corrupted().
+  bool Next(LSN* lsn, std::string* data);
+
+  bool corrupted() const {
+    return corrupted_;
+  }
+
+ private:
+  // Returns false if the source ended before num bytes were available.
+  bool EnsureRead(size_t num);
+
+  io::Source* source_;
+  base::IoBuf buf_;
+  bool header_checked_ = false;
+  bool corrupted_ = false;
+};
+
+}  // namespace journal
+}  // namespace dfly
@@ -25,25 +25,6 @@ using namespace std;
 using namespace util;
 namespace fs = std::filesystem;
 
-namespace {
-
-/*
-string ShardName(std::string_view base, unsigned index) {
-  return absl::StrCat(base, "-", absl::Dec(index, absl::kZeroPad4), ".log");
-}
-
-uint32_t NextPowerOf2(uint32_t x) {
-  if (x < 2) {
-    return 1;
-  }
-  int log = 32 - __builtin_clz(x - 1);
-  return 1 << log;
-}
-
-*/
-
-}  // namespace
-
 #define CHECK_EC(x)                                                                 \
   do {                                                                              \
     auto __ec$ = (x);                                                               \
@@ -65,66 +46,36 @@ void JournalSlice::Init(unsigned index) {
   ring_buffer_.emplace(2);
 }
 
-#if 0
-std::error_code JournalSlice::Open(std::string_view dir) {
-  CHECK(!shard_file_);
+error_code JournalSlice::OpenFile(const JournalFile::Options& opts) {
+  CHECK(!file_);
   DCHECK_NE(slice_index_, UINT32_MAX);
 
-  fs::path dir_path;
-
-  if (dir.empty()) {
-  } else {
-    dir_path = dir;
-    error_code ec;
-
-    fs::file_status dir_status = fs::status(dir_path, ec);
-    if (ec) {
-      if (ec == errc::no_such_file_or_directory) {
-        fs::create_directory(dir_path, ec);
-        dir_status = fs::status(dir_path, ec);
-      }
-      if (ec)
-        return ec;
-    }
-    // LOG(INFO) << int(dir_status.type());
-  }
-
-  dir_path.append(ShardName("journal", slice_index_));
-  shard_path_ = dir_path;
-
-  // For file integrity guidelines see:
-  // https://lwn.net/Articles/457667/
-  // https://www.evanjones.ca/durability-filesystem.html
-  // NOTE: O_DSYNC is omitted.
-  constexpr auto kJournalFlags = O_CLOEXEC | O_CREAT | O_TRUNC | O_RDWR;
-  io::Result<unique_ptr<LinuxFile>> res = OpenLinux(shard_path_, kJournalFlags, 0666);
-  if (!res) {
-    return res.error();
+  file_ = make_unique<JournalFile>(slice_index_, opts);
+  if (auto ec = file_->Open(lsn_); ec) {
+    file_.reset();
+    return ec;
   }
-  DVLOG(1) << "Opened journal " << shard_path_;
-
-  shard_file_ = std::move(res).value();
-  file_offset_ = 0;
-  status_ec_.clear();
-
-  return error_code{};
+  return {};
 }
 
-error_code JournalSlice::Close() {
-  VLOG(1) << "JournalSlice::Close";
+error_code JournalSlice::CloseFile() {
+  if (!file_)
+    return {};
 
-  CHECK(shard_file_);
-  lameduck_ = true;
-
-  auto ec = shard_file_->Close();
+  auto ec = file_->Close();
+  file_.reset();
+  return ec;
+}
 
-  DVLOG(1) << "Closing " << shard_path_;
-  LOG_IF(ERROR, ec) << "Error closing journal file " << ec;
-  shard_file_.reset();
+LSN JournalSlice::MarkSnapshotPosition() {
+  snapshot_lsn_ = lsn_;
+  return lsn_;
+}
 
-  return ec;
+void JournalSlice::RemoveSnapshottedSegments() {
+  if (file_)
+    file_->RemoveSegmentsBefore(snapshot_lsn_);
 }
-#endif
 
 bool JournalSlice::IsLSNInBuffer(LSN lsn) const {
   DCHECK(ring_buffer_);
@@ -175,14 +126,10 @@ void JournalSlice::AddLogRecord(const Entry& entry) {
     VLOG(2) << "Writing item [" << item.lsn << "]: " << entry.ToString();
   }
 
-#if 0
-    if (shard_file_) {
-      string line = absl::StrCat(item.lsn, " ", entry.txid, " ", entry.opcode, "\n");
-      error_code ec = shard_file_->Write(io::Buffer(line), file_offset_, 0);
-      CHECK_EC(ec);
-      file_offset_ += line.size();
-    }
-#endif
+  // Control entries are meaningful only for an active replication stream.
+  if (file_ && (entry.opcode == Op::COMMAND || entry.opcode == Op::EXPIRED))
+    file_->Append(item.lsn, item.data);
+
   CallOnChange(item);
 }
 
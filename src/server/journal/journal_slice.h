@@ -10,6 +10,7 @@
 
 #include "base/ring_buffer.h"
 #include "server/common.h"
+#include "server/journal/journal_file.h"
 #include "server/journal/types.h"
 
 namespace dfly {
@@ -28,6 +29,11 @@ class JournalSlice {
     return lsn_;
   }
 
+  // Continues the sequence of LSNs, for example after replaying the on-disk journal.
+  void set_cur_lsn(LSN lsn) {
+    lsn_ = lsn;
+  }
+
   std::error_code status() const {
     return status_ec_;
   }
@@ -62,10 +68,29 @@ class JournalSlice {
   // with allow_flush=false and the subsequent call with allow_flush=true.
   void SetFlushMode(bool allow_flush);
 
+  // Starts persisting the commands to disk, starting with the next LSN.
+  std::error_code OpenFile(const JournalFile::Options& opts);
+  std::error_code CloseFile();
+
+  bool HasFile() const {
+    return bool(file_);
+  }
+
+  JournalFile* file() const {
+    return file_.get();
+  }
+
+  // Remembers the current LSN as the position of a snapshot that is being saved.
+  LSN MarkSnapshotPosition();
+
+  // Removes the on-disk segments with entries that precede the last marked snapshot position.
+  void RemoveSnapshottedSegments();
+
  private:
   void CallOnChange(const JournalItem& item);
-  // std::string shard_path_;
-  // std::unique_ptr<LinuxFile> shard_file_;
+
+  std::unique_ptr<JournalFile> file_;
+  LSN snapshot_lsn_ = 0;
   std::optional<base::RingBuffer<JournalItem>> ring_buffer_;
   base::IoBuf ring_serialize_buf_;
 
@@ -3,11 +3,16 @@
 
 #include "base/gtest.h"
 #include "base/logging.h"
+#include "server/journal/journal_file.h"
 #include "server/journal/pending_buf.h"
 #include "server/journal/serializer.h"
 #include "server/journal/types.h"
 #include "server/serializer_commons.h"
 
+extern "C" {
+#include "redis/crc64.h"
+}
+
 using namespace testing;
 using namespace std;
 using namespace util;
@@ -217,5 +222,56 @@ TEST(Journal, PendingBuf) {
   ASSERT_EQ(pbuf.Size(), 0);
 }
 
+TEST(Journal, FileRecords) {
+  crc64_init();
+
+  vector<pair<LSN, string>> records = {{1, "first"}, {2, ""}, {3, string(100000, 'x')}};
+  string segment{JournalFile::kMagic};
+  for (const auto& [lsn, data] : records)
+    JournalFile::EncodeRecord(lsn, data, &segment);
+
+  auto read_all = [](string_view segment, bool* corrupted) {
+    io::BytesSource source{io::Buffer(segment)};
+    JournalFileReader reader{&source};
+    vector<pair<LSN, string>> res;
+    LSN lsn;
+    string data;
+    while (reader.Next(&lsn, &data))
+      res.emplace_back(lsn, data);
+    *corrupted = reader.corrupted();
+    return res;
+  };
+
+  bool corrupted = false;
+  EXPECT_EQ(records, read_all(segment, &corrupted));
+  EXPECT_FALSE(corrupted);
+
+  // A torn write at the tail ends the segment after the last complete record.
+  EXPECT_EQ(vector(records.begin(), records.begin() + 2),
+            read_all(string_view{segment}.substr(0, segment.size() - 10), &corrupted));
+  EXPECT_TRUE(corrupted);
+
+  // A flipped bit fails the checksum.
+  string damaged = segment;
+  damaged[JournalFile::kMagic.size() + 20 + 2] ^= 1;
+  EXPECT_TRUE(read_all(damaged, &corrupted).empty());
+  EXPECT_TRUE(corrupted);
+
+  EXPECT_TRUE(read_all("NOTJRNL0", &corrupted).empty());
+  EXPECT_TRUE(corrupted);
+
+  EXPECT_TRUE(read_all(JournalFile::kMagic, &corrupted).empty());
+  EXPECT_FALSE(corrupted);
+}
+
+TEST(Journal, ParseFsyncPolicy) {
+  FsyncPolicy policy;
+  EXPECT_TRUE(ParseFsyncPolicy("ALWAYS", &policy));
+  EXPECT_EQ(FsyncPolicy::ALWAYS, policy);
+  EXPECT_TRUE(ParseFsyncPolicy("no", &policy));
+  EXPECT_EQ(FsyncPolicy::NO, policy);
+  EXPECT_FALSE(ParseFsyncPolicy("sometimes", &policy));
+}
+
 }  // namespace journal
 }  // namespace dfly
@@ -4,11 +4,14 @@
 
 #include "server/json_family.h"
 
+#include <absl/container/flat_hash_map.h>
 #include <absl/strings/match.h>
 #include <absl/strings/str_cat.h>
 #include <absl/strings/str_join.h>
 #include <absl/strings/str_split.h>
 
+#include <list>
+
 #include "absl/cleanup/cleanup.h"
 #include "base/flags.h"
 #include "base/logging.h"
@@ -26,6 +29,7 @@
 #include "server/error.h"
 #include "server/journal/journal.h"
 #include "server/search/doc_index.h"
+#include "server/server_state.h"
 #include "server/string_family.h"
 #include "server/tiered_storage.h"
 #include "server/transaction.h"
@@ -39,6 +43,8 @@
 ABSL_FLAG(bool, jsonpathv2, true,
           "If true uses Dragonfly jsonpath implementation, "
           "otherwise uses legacy jsoncons implementation.");
+ABSL_FLAG(uint32_t, json_path_cache_size, 256,
+          "Number of parsed json paths cached per thread, 0 disables the cache.");
 
 namespace dfly {
 
@@ -130,8 +136,80 @@ bool IsJsonPathV2(std::string_view path) {
   return !path.empty() && path.front() == '$';
 }
 
+// LRU cache of the paths parsed by the thread. Services usually access their documents with
+// a small set of paths, and parsing them is a large part of the simple JSON commands.
+class JsonPathCache {
+ public:
+  std::optional<WrappedJsonPath> Get(std::string_view path);
+  void Put(std::string_view path, const WrappedJsonPath& json_path);
+
+ private:
+  struct Entry {
+    std::string key;
+    json::Path parsed;
+    JsonPathType path_type;
+    std::string v2_path;  // legacy paths are converted to v2 before parsing
+  };
+
+  std::list<Entry> lru_;  // most recently used first
+  absl::flat_hash_map<std::string_view, std::list<Entry>::iterator> index_;  // by Entry::key
+};
+
+std::optional<WrappedJsonPath> JsonPathCache::Get(std::string_view path) {
+  if (absl::GetFlag(FLAGS_json_path_cache_size) == 0 || !absl::GetFlag(FLAGS_jsonpathv2))
+    return std::nullopt;
+
+  auto& stats = ServerState::tlocal()->stats;
+  auto it = index_.find(path);
+  if (it == index_.end()) {
+    stats.json_path_cache_misses++;
+    return std::nullopt;
+  }
+  stats.json_path_cache_hits++;
+
+  lru_.splice(lru_.begin(), lru_, it->second);
+  const Entry& entry = *it->second;
+
+  // The entry can be evicted while the command runs, so the path does not refer to it.
+  StringOrView path_str = entry.path_type == JsonPathType::kV2
+                              ? StringOrView::FromView(path)
+                              : StringOrView::FromString(entry.v2_path);
+  return WrappedJsonPath{entry.parsed, std::move(path_str), entry.path_type};
+}
+
+void JsonPathCache::Put(std::string_view path, const WrappedJsonPath& json_path) {
+  size_t capacity = absl::GetFlag(FLAGS_json_path_cache_size);
+  if (capacity == 0 || !json_path.HoldsJsonPath())
+    return;
+
+  // Aggregate functions keep their results in the path segments, so their paths can't be shared.
+  const json::Path& parsed = json_path.AsJsonPath();
+  if (any_of(parsed.begin(), parsed.end(), [](const json::PathSegment& segment) {
+        return segment.type() == json::SegmentType::FUNCTION;
+      }))
+    return;
+
+  while (lru_.size() >= capacity) {
+    index_.erase(lru_.back().key);
+    lru_.pop_back();
+  }
+
+  JsonPathType path_type =
+      json_path.IsLegacyModePath() ? JsonPathType::kLegacy : JsonPathType::kV2;
+  lru_.push_front(Entry{string(path), parsed, path_type, string(json_path.Path())});
+  index_.emplace(lru_.front().key, lru_.begin());
+}
+
+thread_local JsonPathCache tl_json_path_cache;
+
 ParseResult<WrappedJsonPath> ParseJsonPath(std::string_view path) {
-  return IsJsonPathV2(path) ? ParseJsonPathV2(path) : ParseJsonPathV1(path);
+  if (auto cached = tl_json_path_cache.Get(path); cached)
+    return std::move(*cached);
+
+  auto res = IsJsonPathV2(path) ? ParseJsonPathV2(path) : ParseJsonPathV1(path);
+  if (res)
+    tl_json_path_cache.Put(path, *res);
+  return res;
 }
 
 namespace reply_generic {
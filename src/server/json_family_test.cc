@@ -3063,4 +3063,28 @@ TEST_F(JsonFamilyTest, SetNestedFields) {
   EXPECT_EQ(resp, R"({"-field2":2,"field1":1})");
 }
 
+TEST_F(JsonFamilyTest, PathCache) {
+  auto cache_stats = [this] {
+    Metrics metrics = GetMetrics();
+    return pair{metrics.coordinator_stats.json_path_cache_hits,
+                metrics.coordinator_stats.json_path_cache_misses};
+  };
+
+  EXPECT_EQ(Run({"JSON.SET", "json", "$", R"({"cached":{"arr":[1,2,3],"num":1}})"}), "OK");
+  auto [hits, misses] = cache_stats();
+
+  EXPECT_EQ(Run({"JSON.GET", "json", "$.cached.arr"}), "[[1,2,3]]");
+  EXPECT_EQ(Run({"JSON.GET", "json", "$.cached.arr"}), "[[1,2,3]]");
+  EXPECT_EQ(Run({"JSON.GET", "json", ".cached.arr"}), "[1,2,3]");
+  EXPECT_EQ(Run({"JSON.GET", "json", ".cached.arr"}), "[1,2,3]");
+  EXPECT_EQ(cache_stats(), pair(hits + 2, misses + 2));
+
+  // Cached paths are not changed by the commands that use them.
+  EXPECT_EQ(Run({"JSON.NUMINCRBY", "json", "$.cached.num", "1"}), "[2]");
+  EXPECT_EQ(Run({"JSON.NUMINCRBY", "json", "$.cached.num", "1"}), "[3]");
+  EXPECT_EQ(Run({"JSON.ARRPOP", "json", "$.cached.arr"}), "3");
+  EXPECT_EQ(Run({"JSON.ARRPOP", "json", "$.cached.arr"}), "2");
+  EXPECT_EQ(Run({"JSON.GET", "json", "$.cached"}), R"([{"arr":[1],"num":3}])");
+}
+
 }  // namespace dfly
@@ -0,0 +1,67 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#include "server/latency_monitor.h"
+
+#include <cmath>
+#include <ctime>
+
+namespace dfly {
+
+using namespace std;
+
+unsigned LatencyHistogram::BucketIndex(uint64_t usec) {
+  usec = min(usec, (uint64_t(1) << kMaxValueBits) - 1);
+  if (usec < kSubBuckets)
+    return usec;
+
+  unsigned shift = (63 - __builtin_clzll(usec)) - kSubBucketBits;
+  return (shift + 1) * kSubBuckets + ((usec >> shift) & (kSubBuckets - 1));
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  for (unsigned i = 0; i < kNumBuckets; ++i)
+    buckets_[i] += other.buckets_[i];
+  count_ += other.count_;
+  sum_ += other.sum_;
+  max_ = std::max(max_, other.max_);
+}
+
+void LatencyHistogram::Clear() {
+  buckets_.fill(0);
+  count_ = sum_ = max_ = 0;
+}
+
+uint64_t LatencyHistogram::Percentile(double percentile) const {
+  if (count_ == 0)
+    return 0;
+
+  uint64_t target = max<uint64_t>(1, ceil(percentile / 100 * count_));
+  uint64_t cumulative = 0;
+  for (unsigned i = 0; i < kNumBuckets; ++i) {
+    cumulative += buckets_[i];
+    if (cumulative >= target)
+      return min(BucketStart(i + 1) - 1, max_);
+  }
+  return max_;
+}
+
+void LatencyMonitor::Add(string_view event, uint64_t latency_usec) {
+  uint64_t now = time(nullptr);
+  uint32_t latency_ms = min<uint64_t>(latency_usec / 1000, UINT32_MAX);
+
+  auto it = events_.find(event);
+  if (it == events_.end())
+    it = events_.emplace(event, Event{}).first;
+
+  Event& ev = it->second;
+  ev.max_ms = std::max(ev.max_ms, latency_ms);
+  if (!ev.samples.empty() && ev.samples.back().unix_ts_sec == now) {
+    ev.samples.back().latency_ms = std::max(ev.samples.back().latency_ms, latency_ms);
+    return;
+  }
+  ev.samples.push_back({now, latency_ms});
+}
+
+}  // namespace dfly
@@ -0,0 +1,123 @@
+// Copyright 2025, DragonflyDB authors.  All rights reserved.
+// See LICENSE for licensing terms.
+//
+
+#pragma once
+
+#include <absl/container/flat_hash_map.h>
+
+#include <algorithm>
+#include <array>
+#include <boost/circular_buffer.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace dfly {
+
+// HDR-style histogram of latencies in usec. Values are grouped by their highest set bit and
+// every group is split into kSubBuckets linear buckets, so the relative error is bounded by
+// 1 / kSubBuckets at any magnitude while the histogram keeps a small fixed size.
+class LatencyHistogram {
+ public:
+  static constexpr unsigned kSubBucketBits = 3;
+  static constexpr unsigned kSubBuckets = 1u << kSubBucketBits;
+  static constexpr unsigned kMaxValueBits = 40;  // larger values are clamped, ~12 days in usec.
+  static constexpr unsigned kNumBuckets = (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets;
+
+  void Add(uint64_t usec) {
+    ++buckets_[BucketIndex(usec)];
+    ++count_;
+    sum_ += usec;
+    max_ = std::max(max_, usec);
+  }
+
+  void Merge(const LatencyHistogram& other);
+  void Clear();
+
+  uint64_t count() const {
+    return count_;
+  }
+
+  uint64_t sum() const {
+    return sum_;
+  }
+
+  uint64_t max() const {
+    return max_;
+  }
+
+  // Returns the highest value equivalent to the value at the given percentile (0 - 100].
+  uint64_t Percentile(double percentile) const;
+
+  // Calls cb(upper_bound, count) for the powers of two, where count is the number of values
+  // below upper_bound. Skips the bounds that do not add values and stops after the last value.
+  template <typename F> void ForEachPow2Bucket(F&& cb) const;
+
+  static unsigned BucketIndex(uint64_t usec);
+
+  // Returns the lowest value that falls into the bucket.
+  static uint64_t BucketStart(unsigned index) {
+    if (index < kSubBuckets)
+      return index;
+    return uint64_t(kSubBuckets + index % kSubBuckets) << (index / kSubBuckets - 1);
+  }
+
+ private:
+  std::array<uint64_t, kNumBuckets> buckets_{};
+  uint64_t count_ = 0;
+  uint64_t sum_ = 0;
+  uint64_t max_ = 0;
+};
+
+template <typename F> void LatencyHistogram::ForEachPow2Bucket(F&& cb) const {
+  uint64_t cumulative = 0, reported = 0;
+  for (unsigned i = 0; i < kNumBuckets && reported < count_; ++i) {
+    cumulative += buckets_[i];
+
+    // The next bucket starts at a power of two.
+    unsigned next = i + 1;
+    bool pow2 = next < kSubBuckets ? (next & (next - 1)) == 0 : next % kSubBuckets == 0;
+    if (pow2 && cumulative > reported) {
+      cb(BucketStart(next), cumulative);
+      reported = cumulative;
+    }
+  }
+}
+
+// Keeps the recent latency spikes of named events, like LATENCY of Redis. Samples are stored
+// with a resolution of a second and the samples of the same second are merged.
+class LatencyMonitor {
+ public:
+  static constexpr size_t kMaxSamples = 160;
+
+  struct Sample {
+    uint64_t unix_ts_sec;
+    uint32_t latency_ms;
+  };
+
+  struct Event {
+    boost::circular_buffer<Sample> samples{kMaxSamples};
+    uint32_t max_ms = 0;
+  };
+
+  void Add(std::string_view event, uint64_t latency_usec);
+
+  // Returns true if the event had samples.
+  bool Reset(std::string_view event) {
+    return events_.erase(event) > 0;
+  }
+
+  void ResetAll() {
+    events_.clear();
+  }
+
+  const absl::flat_hash_map<std::string, Event>& events() const {
+    return events_;
+  }
+
+ private:
+  absl::flat_hash_map<std::string, Event> events_;
+};
+
+}  // namespace dfly
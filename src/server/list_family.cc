@@ -61,6 +61,12 @@ ABSL_FLAG(int32_t, list_max_listpack_size, -2, "Maximum listpack size, default i
  */
 
 ABSL_FLAG(int32_t, list_compress_depth, 0, "Compress depth of the list. Default is no compression");
+ABSL_FLAG(string, list_compress_method, "lzf",
+          "Compression method of the list nodes, one of lzf, lz4 or zstd. Requires "
+          "list_compress_depth > 0 and list_experimental_v2");
+ABSL_FLAG(bool, list_background_compression, false,
+          "If true, list nodes are compressed by the shard heartbeat instead of the commands "
+          "that push them out of the compress depth");
 ABSL_FLAG(bool, list_experimental_v2, true,
           "Enables dragonfly specific implementation of quicklist");
 
@@ -6,6 +6,7 @@
 
 #include <absl/strings/match.h>
 
+#include "base/flags.h"
 #include "base/gtest.h"
 #include "base/logging.h"
 #include "facade/facade_test.h"
@@ -1365,5 +1366,76 @@ TEST_F(ListFamilyTest, AwakeDb1) {
   f1.Join();
 }
 
+TEST_F(ListFamilyTest, IndexMemoryNotAccounted) {
+  absl::FlagSaver saver;
+  SetTestFlag("list_max_listpack_size", "4");
+
+  const auto baseline = GetMetrics().db_stats[0];
+  for (unsigned i = 0; i < 400; ++i)
+    Run({"rpush", kKey1, StrCat(i)});
+  EXPECT_THAT(Run({"debug", "object", kKey1}).GetString(), HasSubstr("nc:100"));
+
+  // Reads build the positional index of long lists.
+  EXPECT_EQ(Run({"lindex", kKey1, "200"}), "200");
+  EXPECT_THAT(Run({"lrange", kKey1, "300", "301"}), RespArray(ElementsAre("300", "301")));
+  EXPECT_THAT(Run({"debug", "object", kKey1}).GetString(), HasSubstr(" ib:"));
+
+  Run({"del", kKey1});
+  const auto stats = GetMetrics().db_stats[0];
+  EXPECT_EQ(stats.obj_memory_usage, baseline.obj_memory_usage);
+  EXPECT_EQ(stats.memory_usage_by_type[OBJ_LIST], baseline.memory_usage_by_type[OBJ_LIST]);
+}
+
+class ListBackgroundCompressionTest : public ListFamilyTest {
+ protected:
+  void SetUp() override {
+    // The shards read the compression flags when they start.
+    SetTestFlag("list_compress_method", "zstd");
+    SetTestFlag("list_background_compression", "true");
+    SetTestFlag("list_compress_depth", "1");
+    ListFamilyTest::SetUp();
+  }
+
+  string ObjectInfo() {
+    return Run({"debug", "object", kKey1}).GetString();
+  }
+
+  absl::FlagSaver saver_;
+};
+
+TEST_F(ListBackgroundCompressionTest, HeartbeatAndReload) {
+  const auto baseline = GetMetrics().db_stats[0];
+  auto value = [](unsigned i) { return StrCat("event:", i, ":", string(40, 'x')); };
+
+  constexpr unsigned kNumValues = 3000;
+  for (unsigned i = 0; i < kNumValues; ++i)
+    Run({"rpush", kKey1, value(i)});
+  const size_t list_usage = GetMetrics().db_stats[0].memory_usage_by_type[OBJ_LIST];
+
+  // The heartbeat compresses the nodes, and the list accounts the change on its next update.
+  ASSERT_TRUE(WaitUntilCondition([&] { return absl::StrContains(ObjectInfo(), " cn:"); }, 1s));
+  EXPECT_EQ(Run({"lindex", kKey1, "1500"}), value(1500));
+  EXPECT_EQ(GetMetrics().db_stats[0].memory_usage_by_type[OBJ_LIST], list_usage);
+
+  EXPECT_THAT(Run({"rpush", kKey1, value(kNumValues)}), IntArg(kNumValues + 1));
+  EXPECT_LT(GetMetrics().db_stats[0].memory_usage_by_type[OBJ_LIST], list_usage);
+
+  // Compressed nodes are saved uncompressed and marked for compression again when loaded.
+  EXPECT_EQ(Run({"debug", "reload"}), "OK");
+  ASSERT_THAT(Run({"llen", kKey1}), IntArg(kNumValues + 1));
+  ASSERT_TRUE(WaitUntilCondition([&] { return absl::StrContains(ObjectInfo(), " cn:"); }, 1s));
+
+  auto resp = Run({"lrange", kKey1, "0", "-1"});
+  ASSERT_THAT(resp, ArrLen(kNumValues + 1));
+  const auto& values = resp.GetVec();
+  for (unsigned i = 0; i <= kNumValues; ++i)
+    ASSERT_EQ(values[i], value(i)) << i;
+
+  Run({"del", kKey1});
+  const auto stats = GetMetrics().db_stats[0];
+  EXPECT_EQ(stats.obj_memory_usage, baseline.obj_memory_usage);
+  EXPECT_EQ(stats.memory_usage_by_type[OBJ_LIST], baseline.memory_usage_by_type[OBJ_LIST]);
+}
+
 #pragma GCC diagnostic pop
 }  // namespace dfly
@@ -18,6 +18,7 @@ extern "C" {
 #include <absl/cleanup/cleanup.h>
 #include <absl/functional/bind_front.h>
 #include <absl/strings/ascii.h>
+#include <absl/strings/escaping.h>
 #include <absl/strings/match.h>
 #include <absl/strings/str_format.h>
 #include <xxhash.h>
@@ -40,12 +41,14 @@ extern "C" {
 #include "server/channel_store.h"
 #include "server/cluster/cluster_family.h"
 #include "server/conn_context.h"
+#include "server/dispatch_coalescer.h"
 #include "server/error.h"
 #include "server/generic_family.h"
 #include "server/geo_family.h"
 #include "server/hll_family.h"
 #include "server/hset_family.h"
 #include "server/http_api.h"
+#include "server/journal/journal.h"
 #include "server/json_family.h"
 #include "server/list_family.h"
 #include "server/multi_command_squasher.h"
@@ -116,6 +119,10 @@ ABSL_FLAG(size_t, serialization_max_chunk_size, 64_KB,
           "sync. Values bigger than this threshold will be serialized using streaming "
           "serialization. 0 - to disable streaming mode");
 
+ABSL_FLAG(string, huffman_table, "",
+          "Base64 encoded huffman table that is used to encode keys and string values, "
+          "as returned by DEBUG COMPRESSION. Empty - huffman encoding is disabled.");
+
 namespace dfly {
 
 #if defined(__linux__)
@@ -776,6 +783,7 @@ void Service::Init(util::AcceptServer* acceptor, std::vector<facade::Listener*>
                                          [](size_t val) { SetSerializationMaxChunkSize(val); });
 
   config_registry.RegisterMutable("pipeline_squash");
+  config_registry.RegisterMutable("cross_conn_squash");
 
   config_registry.RegisterSetter<uint32_t>("pipeline_queue_limit", [](uint32_t val) {
     shard_set->pool()->AwaitBrief(
@@ -787,6 +795,18 @@ void Service::Init(util::AcceptServer* acceptor, std::vector<facade::Listener*>
         [val](unsigned tid, auto*) { facade::Connection::SetPipelineBufferLimit(tid, val); });
   });
 
+  config_registry.RegisterSetter<uint64_t>("subscriber_buffer_limit", [](uint64_t val) {
+    shard_set->pool()->AwaitBrief(
+        [val](unsigned tid, auto*) { facade::Connection::SetSubscriberBufferLimit(tid, val); });
+  });
+
+  config_registry.RegisterSetter<facade::PubOverflowPolicy>(
+      "subscriber_overflow_policy", [](facade::PubOverflowPolicy policy) {
+        shard_set->pool()->AwaitBrief([policy](unsigned tid, auto*) {
+          facade::Connection::SetSubscriberOverflowPolicy(tid, policy);
+        });
+      });
+
   config_registry.RegisterMutable("replica_partial_sync");
   config_registry.RegisterMutable("replication_timeout");
   config_registry.RegisterMutable("migration_finalization_timeout_ms");
@@ -847,6 +867,17 @@ void Service::Init(util::AcceptServer* acceptor, std::vector<facade::Listener*>
     acl_family_.Init(main_listener, &user_registry_);
   }
 
+  // Must be loaded before any string is created in the shards.
+  if (string huff_table = GetFlag(FLAGS_huffman_table); !huff_table.empty()) {
+    string binary, err = "bad base64 encoding";
+    bool loaded = absl::Base64Unescape(huff_table, &binary) &&
+                  CompactObj::InitHuffmanTable(binary, &err);
+    if (!loaded) {
+      LOG(ERROR) << "Failed to load huffman table: " << err;
+      exit(1);
+    }
+  }
+
   // Initialize shard_set with a callback running once in a while in the shard threads.
   shard_set->Init(shard_num, [this] {
     server_family_.GetDflyCmd()->BreakStalledFlowsInShard();
@@ -1089,6 +1120,9 @@ std::optional<ErrorReply> Service::VerifyCommandState(const CommandId* cid, CmdA
   if (!etl.is_master && is_write_cmd && !dfly_cntx.is_replicating)
     return ErrorReply{"-READONLY You can't write against a read only replica."};
 
+  if (is_write_cmd && etl.journal() && etl.journal()->HasFileError())
+    return ErrorReply{journal::kFileErr};
+
   if (multi_active) {
     if (absl::EndsWith(cmd_name, "SUBSCRIBE"))
       return ErrorReply{absl::StrCat("Can not call ", cmd_name, " within a transaction")};
@@ -1198,6 +1232,21 @@ void Service::DispatchCommand(ArgSlice args, SinkReplyBuilder* builder,
     return builder->SendSimpleString("QUEUED");
   }
 
+  // If cmd is an alias, pass it to Invoke so the stats are updated against the alias. By defaults
+  // stats will be updated for cid.name
+  std::optional<std::string_view> orig_cmd_name = std::nullopt;
+  if (registry_.IsAlias(cmd)) {
+    orig_cmd_name = cmd;
+  }
+
+  // Squash single-shard commands with the ones of other connections dispatching concurrently
+  if (!dispatching_in_multi && builder->GetProtocol() == Protocol::REDIS &&
+      DispatchCoalescer::tlocal()->TryDispatch(cid, args_no_cmd,
+                                               static_cast<RedisReplyBuilder*>(builder), dfly_cntx,
+                                               this, orig_cmd_name)) {
+    return;
+  }
+
   // Create command transaction
   intrusive_ptr<Transaction> dist_trans;
 
@@ -1234,12 +1283,6 @@ void Service::DispatchCommand(ArgSlice args, SinkReplyBuilder* builder,
 
   dfly_cntx->cid = cid;
 
-  // If cmd is an alias, pass it to Invoke so the stats are updated against the alias. By defaults
-  // stats will be updated for cid.name
-  std::optional<std::string_view> orig_cmd_name = std::nullopt;
-  if (registry_.IsAlias(cmd)) {
-    orig_cmd_name = cmd;
-  }
   if (!InvokeCmd(cid, args_no_cmd, builder, dfly_cntx, orig_cmd_name)) {
     builder->SendError("Internal Error");
     builder->CloseConnection();
@@ -1346,17 +1389,38 @@ bool Service::InvokeCmd(const CommandId* cid, CmdArgList tail_args, SinkReplyBui
   // Verifies that we reply to the client when needed.
   ReplyGuard reply_guard(cid->name(), builder, cntx);
 #endif
+  // Squashed commands run inside a hop, their squasher uploads the containers beforehand.
+  if (tx && cid->IsTransactional() && !cntx->conn_state.squashing_info)
+    tx->FetchOffloadedContainers();
+
+  // With journal_fsync=always, the reply of a write is held back until it is known whether its
+  // journal entries were persisted. The commands of EXEC and EVAL are covered by their own calls.
+  optional<CapturingReplyBuilder> journal_crb;
+  if (tx && cid->IsWriteOnly() && builder->GetProtocol() == Protocol::REDIS) {
+    if (auto* journal = ServerState::tlocal()->journal(); journal && journal->SyncsEveryWrite())
+      journal_crb.emplace(ReplyMode::FULL,
+                          static_cast<RedisReplyBuilder*>(builder)->GetRespVersion());
+  }
+
   uint64_t invoke_time_usec = 0;
   auto last_error = builder->ConsumeLastError();
   DCHECK(last_error.empty());
   try {
-    invoke_time_usec = cid->Invoke(tail_args, CommandContext{tx, builder, cntx},
+    SinkReplyBuilder* cmd_builder = journal_crb ? &*journal_crb : builder;
+    invoke_time_usec = cid->Invoke(tail_args, CommandContext{tx, cmd_builder, cntx},
                                    orig_cmd_name.value_or(cid->name()));
   } catch (std::exception& e) {
     LOG(ERROR) << "Internal error, system probably unstable " << e.what();
     return false;
   }
 
+  if (journal_crb) {
+    if (tx->TakeJournalError())
+      builder->SendError(journal::kFileErr);
+    else
+      CapturingReplyBuilder::Apply(journal_crb->Take(), static_cast<RedisReplyBuilder*>(builder));
+  }
+
   if (std::string reason = builder->ConsumeLastError(); !reason.empty()) {
     VLOG(2) << FailedCommandToString(cid->name(), tail_args, reason);
     LOG_EVERY_T(WARNING, 1) << FailedCommandToString(cid->name(), tail_args, reason);
@@ -1396,6 +1460,10 @@ bool Service::InvokeCmd(const CommandId* cid, CmdArgList tail_args, SinkReplyBui
                                                 absl::GetCurrentTimeNanos() / 1000);
   }
 
+  if (!(cid->opt_mask() & CO::BLOCKING)) {
+    ServerState::SafeTLocal()->RecordLatencyEvent("command", invoke_time_usec);
+  }
+
   if (tx && !cntx->conn_state.exec_info.IsRunning() && cntx->conn_state.script_info == nullptr) {
     cntx->last_command_debug.clock = tx->txid();
   }
@@ -1485,14 +1553,17 @@ size_t Service::DispatchManyCommands(absl::Span<CmdArgList> args_list, SinkReply
   return dispatched;
 }
 
-void Service::DispatchMC(const MemcacheParser::Command& cmd, std::string_view value,
-                         MCReplyBuilder* mc_builder, facade::ConnectionContext* cntx) {
-  absl::InlinedVector<MutableSlice, 8> args;
+namespace {
+
+// Storage for the arguments of a translated memcache command that are not part of the command.
+struct MCArgStorage {
   char cmd_name[16];
   char ttl[absl::numbers_internal::kFastToBufferSize];
   char store_opt[32] = {0};
-  char ttl_op[] = "EXAT";
+  char ttl_op[5] = "EXAT";
+};
 
+void SetMCReplyFlags(const MemcacheParser::Command& cmd, MCReplyBuilder* mc_builder) {
   mc_builder->SetNoreply(cmd.no_reply);
   mc_builder->SetMeta(cmd.meta);
   if (cmd.meta) {
@@ -1501,6 +1572,14 @@ void Service::DispatchMC(const MemcacheParser::Command& cmd, std::string_view va
     mc_builder->SetReturnValue(cmd.return_value);
     mc_builder->SetReturnVersion(cmd.return_version);
   }
+}
+
+// Translates a memcache command to the arguments of the equivalent redis command.
+// Returns false if there is no such command.
+bool TranslateMCCommand(const MemcacheParser::Command& cmd, string_view value,
+                        MCArgStorage* storage, absl::InlinedVector<MutableSlice, 8>* args) {
+  char* cmd_name = storage->cmd_name;
+  char* store_opt = storage->store_opt;
 
   switch (cmd.type) {
     case MemcacheParser::REPLACE:
@@ -1540,32 +1619,23 @@ void Service::DispatchMC(const MemcacheParser::Command& cmd, std::string_view va
     case MemcacheParser::QUIT:
       strcpy(cmd_name, "QUIT");
       break;
-    case MemcacheParser::STATS:
-      server_family_.StatsMC(cmd.key, mc_builder);
-      return;
-    case MemcacheParser::VERSION:
-      mc_builder->SendSimpleString("VERSION 1.6.0 DF");
-      return;
     default:
-      mc_builder->SendClientError("bad command line format");
-      return;
+      return false;
   }
 
-  args.emplace_back(cmd_name, strlen(cmd_name));
+  args->emplace_back(cmd_name, strlen(cmd_name));
 
   if (!cmd.key.empty()) {
     char* key = const_cast<char*>(cmd.key.data());
-    args.emplace_back(key, cmd.key.size());
+    args->emplace_back(key, cmd.key.size());
   }
 
-  ConnectionContext* dfly_cntx = static_cast<ConnectionContext*>(cntx);
-
   if (MemcacheParser::IsStoreCmd(cmd.type)) {
     char* v = const_cast<char*>(value.data());
-    args.emplace_back(v, value.size());
+    args->emplace_back(v, value.size());
 
     if (store_opt[0]) {
-      args.emplace_back(store_opt, strlen(store_opt));
+      args->emplace_back(store_opt, strlen(store_opt));
     }
 
     // if expire_ts is greater than month it's a unix timestamp
@@ -1575,28 +1645,137 @@ void Service::DispatchMC(const MemcacheParser::Command& cmd, std::string_view va
                                    ? cmd.expire_ts + time(nullptr)
                                    : cmd.expire_ts;
     if (expire_ts && memcmp(cmd_name, "SET", 3) == 0) {
-      char* next = absl::numbers_internal::FastIntToBuffer(expire_ts, ttl);
-      args.emplace_back(ttl_op, 4);
-      args.emplace_back(ttl, next - ttl);
+      char* next = absl::numbers_internal::FastIntToBuffer(expire_ts, storage->ttl);
+      args->emplace_back(storage->ttl_op, 4);
+      args->emplace_back(storage->ttl, next - storage->ttl);
     }
-    dfly_cntx->conn_state.memcache_flag = cmd.flags;
   } else if (cmd.type < MemcacheParser::QUIT) {  // read commands
     for (auto s : cmd.keys_ext) {
       char* key = const_cast<char*>(s.data());
-      args.emplace_back(key, s.size());
+      args->emplace_back(key, s.size());
     }
   } else {  // write commands.
     if (store_opt[0]) {
-      args.emplace_back(store_opt, strlen(store_opt));
+      args->emplace_back(store_opt, strlen(store_opt));
     }
   }
 
+  return true;
+}
+
+}  // namespace
+
+void Service::DispatchMC(const MemcacheParser::Command& cmd, std::string_view value,
+                         MCReplyBuilder* mc_builder, facade::ConnectionContext* cntx) {
+  SetMCReplyFlags(cmd, mc_builder);
+
+  switch (cmd.type) {
+    case MemcacheParser::STATS:
+      server_family_.StatsMC(cmd.key, mc_builder);
+      return;
+    case MemcacheParser::VERSION:
+      mc_builder->SendSimpleString("VERSION 1.6.0 DF");
+      return;
+    default:
+      break;
+  }
+
+  MCArgStorage storage;
+  absl::InlinedVector<MutableSlice, 8> args;
+  if (!TranslateMCCommand(cmd, value, &storage, &args)) {
+    mc_builder->SendClientError("bad command line format");
+    return;
+  }
+
+  ConnectionContext* dfly_cntx = static_cast<ConnectionContext*>(cntx);
+  if (MemcacheParser::IsStoreCmd(cmd.type))
+    dfly_cntx->conn_state.memcache_flag = cmd.flags;
+
   DispatchCommand(CmdArgList{args}, mc_builder, cntx);
 
   // Reset back.
   dfly_cntx->conn_state.memcache_flag = 0;
 }
 
+size_t Service::DispatchManyMCCommands(absl::Span<const MCCommandRef> cmds,
+                                       MCReplyBuilder* mc_builder,
+                                       facade::ConnectionContext* cntx) {
+  ConnectionContext* dfly_cntx = static_cast<ConnectionContext*>(cntx);
+  DCHECK(!dfly_cntx->conn_state.exec_info.IsRunning());
+
+  vector<StoredCmd> stored_cmds;
+  vector<MultiCommandSquasher::MemcacheState> mc_states;
+  intrusive_ptr<Transaction> dist_trans;
+
+  size_t dispatched = 0;
+  auto* ss = dfly::ServerState::tlocal();
+
+  auto perform_squash = [&] {
+    if (stored_cmds.empty())
+      return;
+
+    if (!dist_trans) {
+      dist_trans.reset(new Transaction{exec_cid_});
+      dist_trans->StartMultiNonAtomic();
+    } else {
+      // Reset to original command id as it's changed during squashing
+      dist_trans->MultiSwitchCmd(exec_cid_);
+    }
+
+    dfly_cntx->transaction = dist_trans.get();
+    size_t squashed_num = MultiCommandSquasher::ExecuteMC(absl::MakeSpan(stored_cmds), mc_states,
+                                                          mc_builder, dfly_cntx, this);
+    dfly_cntx->transaction = nullptr;
+    dfly_cntx->conn_state.memcache_flag = 0;
+
+    dispatched += stored_cmds.size();
+    ss->stats.squashed_commands += squashed_num;
+    stored_cmds.clear();
+    mc_states.clear();
+  };
+
+  // Don't even start when paused. We can only continue if DispatchTracker is aware of us running.
+  if (ss->IsPaused())
+    return 0;
+
+  for (const MCCommandRef& ref : cmds) {
+    const MemcacheParser::Command& cmd = *ref.cmd;
+
+    MCArgStorage storage;
+    absl::InlinedVector<MutableSlice, 8> args;
+    const CommandId* cid = nullptr;
+    if (cmd.type != MemcacheParser::QUIT && TranslateMCCommand(cmd, ref.value, &storage, &args))
+      cid = registry_.Find(args[0]);
+
+    if (cid != nullptr) {
+      SetMCReplyFlags(cmd, mc_builder);
+      uint32_t flag = MemcacheParser::IsStoreCmd(cmd.type) ? cmd.flags : 0;
+      stored_cmds.reserve(cmds.size());
+      stored_cmds.emplace_back(cid, absl::MakeSpan(args).subspan(1));
+      mc_states.push_back({flag, mc_builder->GetFlags()});
+      continue;
+    }
+
+    // Squash accumulated commands
+    perform_squash();
+
+    // Stop accumulating when a pause is requested, fall back to regular dispatch
+    if (ss->IsPaused())
+      break;
+
+    // Dispatch non squashed command only after all squshed commands were executed and replied
+    DispatchMC(cmd, ref.value, mc_builder, cntx);
+    dispatched++;
+  }
+
+  perform_squash();
+
+  if (dist_trans)
+    dist_trans->UnlockMulti();
+
+  return dispatched;
+}
+
 ErrorReply Service::ReportUnknownCmd(string_view cmd_name) {
   lock_guard lk(mu_);
   if (unknown_cmds_.size() < 1024)
@@ -1973,12 +2152,14 @@ void Service::EvalInternal(CmdArgList args, const EvalArgs& eval_args, Interpret
 
     ++ServerState::tlocal()->stats.eval_shardlocal_coordination_cnt;
     tx->PrepareMultiForScheduleSingleHop(cntx->ns, *sid, cntx->db_index(), args);
+    bool journaled = false;
     tx->ScheduleSingleHop([&](Transaction*, EngineShard*) {
       boost::intrusive_ptr<Transaction> stub_tx =
           new Transaction{tx, *sid, slot_checker.GetUniqueSlotId()};
       cntx->transaction = stub_tx.get();
 
       result = interpreter->RunFunction(eval_args.sha, &error);
+      journaled = stub_tx->TakeJournaled();
 
       cntx->transaction = tx;
       return OpStatus::OK;
@@ -1989,6 +2170,12 @@ void Service::EvalInternal(CmdArgList args, const EvalArgs& eval_args, Interpret
               << ProactorBase::me()->GetPoolIndex() << " to " << *sid;
       cntx->conn()->RequestAsyncMigration(shard_set->pool()->at(*sid));
     }
+
+    // The script wrote inside the hop, it can reply only once its journal entries are synced.
+    if (auto* journal = ServerState::tlocal()->journal();
+        journaled && journal && journal->SyncsEveryWrite() && journal->WaitDurable(*sid)) {
+      return builder->SendError(journal::kFileErr);
+    }
   } else {
     Transaction::MultiMode script_mode = DetermineMultiMode(*params);
     Transaction::MultiMode tx_mode = tx->GetMultiMode();
@@ -2612,6 +2799,8 @@ void Service::OnConnectionClose(facade::ConnectionContext* cntx) {
 
   server_family_.OnClose(server_cntx);
 
+  if (conn_state.tracking_info_.IsBcast())
+    server_cntx->ChangeBcastTracking(false);
   conn_state.tracking_info_.SetClientTracking(false);
 }
 
@@ -63,6 +63,11 @@ class Service : public facade::ServiceInterface {
   void DispatchMC(const MemcacheParser::Command& cmd, std::string_view value,
                   facade::MCReplyBuilder* builder, facade::ConnectionContext* cntx) final;
 
+  // Execute multiple consecutive memcache commands, possibly in parallel by squashing
+  size_t DispatchManyMCCommands(absl::Span<const facade::MCCommandRef> cmds,
+                                facade::MCReplyBuilder* builder,
+                                facade::ConnectionContext* cntx) final;
+
   facade::ConnectionContext* CreateContext(facade::Connection* owner) final;
 
   const CommandId* FindCmd(std::string_view) const;
@@ -4,6 +4,7 @@
 
 #include "server/multi_command_squasher.h"
 
+#include <absl/cleanup/cleanup.h>
 #include <absl/container/inlined_vector.h>
 
 #include "base/logging.h"
@@ -12,6 +13,9 @@
 #include "server/command_registry.h"
 #include "server/conn_context.h"
 #include "server/engine_shard_set.h"
+#include "server/journal/journal.h"
+#include "server/namespaces.h"
+#include "server/tiered_storage.h"
 #include "server/transaction.h"
 #include "server/tx_base.h"
 
@@ -135,6 +139,16 @@ MultiCommandSquasher::SquashResult MultiCommandSquasher::TrySquash(StoredCmd* cm
   sinfo.cmds.push_back(cmd);
   order_.push_back(last_sid);
 
+  // Keys point into the stored command, so they stay valid until the squashed hop is done.
+  // Offloaded values are prefetched only by non-atomic hops, see SquashedHopCb.
+  bool read_only = cmd->Cid()->IsReadOnly() && !IsAtomic();
+  for (string_view key : keys->Range(args)) {
+    sinfo.keys.push_back(key);
+    if (read_only)
+      sinfo.read_keys.push_back(key);
+  }
+  sinfo.key_ends.push_back(sinfo.keys.size());
+
   num_squashed_++;
 
   // Because the squashed hop is currently blocking, we cannot add more than the max channel size,
@@ -143,12 +157,15 @@ MultiCommandSquasher::SquashResult MultiCommandSquasher::TrySquash(StoredCmd* cm
   return need_flush ? SquashResult::SQUASHED_FULL : SquashResult::SQUASHED;
 }
 
-bool MultiCommandSquasher::ExecuteStandalone(facade::RedisReplyBuilder* rb, StoredCmd* cmd) {
+bool MultiCommandSquasher::ExecuteStandalone(facade::SinkReplyBuilder* rb, StoredCmd* cmd) {
   DCHECK(order_.empty());  // check no squashed chain is interrupted
 
   cmd->Fill(&tmp_keylist_);
   auto args = absl::MakeSpan(tmp_keylist_);
 
+  if (IsMemcache())
+    ApplyMemcacheState(cmd, static_cast<MCReplyBuilder*>(rb), cntx_);
+
   if (verify_commands_) {
     if (auto err = service_->VerifyCommandState(cmd->Cid(), args, *cntx_); err) {
       rb->SendError(std::move(*err));
@@ -165,6 +182,7 @@ bool MultiCommandSquasher::ExecuteStandalone(facade::RedisReplyBuilder* rb, Stor
     tx->InitByArgs(cntx_->ns, cntx_->conn_state.db_index, args);
   service_->InvokeCmd(cmd->Cid(), args, rb, cntx_);
 
+  cntx_->conn_state.memcache_flag = 0;
   return true;
 }
 
@@ -175,24 +193,63 @@ OpStatus MultiCommandSquasher::SquashedHopCb(Transaction* parent_tx, EngineShard
 
   auto* local_tx = sinfo.local_tx.get();
   facade::CapturingReplyBuilder crb(ReplyMode::FULL, resp_v);
+
+  // Memcache replies are serialized right away, as they depend on the per command flags.
+  io::StringSink mc_sink;
+  facade::MCReplyBuilder mcb(&mc_sink);
+  SinkReplyBuilder* builder = IsMemcache() ? static_cast<SinkReplyBuilder*>(&mcb) : &crb;
+
   ConnectionContext local_cntx{cntx_, local_tx};
   if (cntx_->conn()) {
     local_cntx.skip_acl_validation = cntx_->conn()->IsPrivileged();
   }
   absl::InlinedVector<MutableSlice, 4> arg_vec;
 
-  for (auto* cmd : sinfo.cmds) {
+  // Read offloaded values of all read commands with a single batch of disk reads, instead of
+  // blocking on them one by one. Only non-atomic hops run as L2 tasks, which can wait for the disk
+  // without stalling the transaction queue of the shard.
+  TieredStorage* tiered_storage = es->tiered_storage();
+  bool prefetched = tiered_storage && sinfo.read_keys.size() > 1;
+  if (prefetched)
+    tiered_storage->Prefetch(cntx_->conn_state.db_index, sinfo.read_keys);
+  absl::Cleanup release_prefetched([&] {
+    if (prefetched)
+      tiered_storage->ReleasePrefetched();
+  });
+
+  // Prefetch the buckets of the keys of the following commands while running the current ones,
+  // so that the lookups of the whole batch do not stall on memory one after another.
+  DbSlice& db_slice = cntx_->ns->GetDbSlice(es->shard_id());
+  DbIndex db_index = cntx_->conn_state.db_index;
+  size_t prefetched_keys = 0;
+
+  for (size_t i = 0; i < sinfo.cmds.size(); ++i) {
+    auto* cmd = sinfo.cmds[i];
     arg_vec.resize(cmd->NumArgs());
     auto args = absl::MakeSpan(arg_vec);
     cmd->Fill(args);
 
-    if (verify_commands_) {
-      // The shared context is used for state verification, the local one is only for replies
-      if (auto err = service_->VerifyCommandState(cmd->Cid(), args, *cntx_); err) {
-        crb.SendError(std::move(*err));
+    if (IsMemcache())
+      ApplyMemcacheState(cmd, &mcb, &local_cntx);
+
+    size_t prefetch_end = std::min(sinfo.key_ends[i] + DbSlice::kPrefetchBatch, sinfo.keys.size());
+    for (; prefetched_keys < prefetch_end; ++prefetched_keys)
+      db_slice.PrefetchKey(db_index, sinfo.keys[prefetched_keys]);
+
+    auto record_reply = [&] {
+      if (IsMemcache()) {
+        sinfo.mc_reply_ends.push_back(mc_sink.str().size());
+      } else {
         sinfo.replies.emplace_back(crb.Take());
         current_reply_size_.fetch_add(Size(sinfo.replies.back()), std::memory_order_relaxed);
+      }
+    };
 
+    if (verify_commands_) {
+      // The shared context is used for state verification, the local one is only for replies
+      if (auto err = service_->VerifyCommandState(cmd->Cid(), args, *cntx_); err) {
+        builder->SendError(std::move(*err));
+        record_reply();
         continue;
       }
     }
@@ -202,10 +259,8 @@ OpStatus MultiCommandSquasher::SquashedHopCb(Transaction* parent_tx, EngineShard
     crb.SetReplyMode(cmd->ReplyMode());
 
     local_tx->InitByArgs(cntx_->ns, local_cntx.conn_state.db_index, args);
-    service_->InvokeCmd(cmd->Cid(), args, &crb, &local_cntx);
-
-    sinfo.replies.emplace_back(crb.Take());
-    current_reply_size_.fetch_add(Size(sinfo.replies.back()), std::memory_order_relaxed);
+    service_->InvokeCmd(cmd->Cid(), args, builder, &local_cntx);
+    record_reply();
 
     // Assert commands made no persistent state changes to stub context state
     const auto& local_state = local_cntx.conn_state;
@@ -213,11 +268,16 @@ OpStatus MultiCommandSquasher::SquashedHopCb(Transaction* parent_tx, EngineShard
     CheckConnStateClean(local_state);
   }
 
+  if (IsMemcache()) {
+    sinfo.mc_replies = std::move(mc_sink).str();
+    current_reply_size_.fetch_add(sinfo.mc_replies.size(), std::memory_order_relaxed);
+  }
+
   reverse(sinfo.replies.begin(), sinfo.replies.end());
   return OpStatus::OK;
 }
 
-bool MultiCommandSquasher::ExecuteSquashed(facade::RedisReplyBuilder* rb) {
+bool MultiCommandSquasher::ExecuteSquashed(facade::SinkReplyBuilder* rb) {
   DCHECK(!cntx_->conn_state.exec_info.IsCollecting());
 
   if (order_.empty())
@@ -230,11 +290,32 @@ bool MultiCommandSquasher::ExecuteSquashed(facade::RedisReplyBuilder* rb) {
       ++num_shards;
   }
 
+  RespVersion resp_v = IsMemcache() ? RespVersion::kResp2
+                                    : static_cast<RedisReplyBuilder*>(rb)->GetRespVersion();
+
   Transaction* tx = cntx_->transaction;
   ServerState::tlocal()->stats.multi_squash_executions++;
   ProactorBase* proactor = ProactorBase::me();
   uint64_t start = proactor->GetMonotonicTimeNs();
 
+  // Upload offloaded containers before the hop, so that the squashed commands find them in
+  // memory instead of blocking the shards on disk reads.
+  if (TieredStorage::MayOffloadContainers()) {
+    fb2::BlockingCounter bc(num_shards);
+    DbIndex db_index = cntx_->conn_state.db_index;
+    for (unsigned i = 0; i < sharded_.size(); ++i) {
+      if (sharded_[i].cmds.empty())
+        continue;
+      shard_set->AddL2(i, [this, bc, i, db_index]() mutable {
+        TieredStorage* ts = EngineShard::tlocal()->tiered_storage();
+        if (ts && ts->HasOffloadedContainers())
+          ts->FetchContainers(db_index, sharded_[i].keys);
+        bc->Dec();
+      });
+    }
+    bc->Wait();
+  }
+
   // Atomic transactions (that have all keys locked) perform hops and run squashed commands via
   // stubs, non-atomic ones just run the commands in parallel.
   if (IsAtomic()) {
@@ -242,14 +323,14 @@ bool MultiCommandSquasher::ExecuteSquashed(facade::RedisReplyBuilder* rb) {
     auto cb = [this](ShardId sid) { return !sharded_[sid].cmds.empty(); };
     tx->PrepareSquashedMultiHop(base_cid_, cb);
     tx->ScheduleSingleHop(
-        [this, rb](auto* tx, auto* es) { return SquashedHopCb(tx, es, rb->GetRespVersion()); });
+        [this, resp_v](auto* tx, auto* es) { return SquashedHopCb(tx, es, resp_v); });
   } else {
 #if 1
     fb2::BlockingCounter bc(num_shards);
     DVLOG(1) << "Squashing " << num_shards << " " << tx->DebugId();
 
-    auto cb = [this, tx, bc, rb]() mutable {
-      this->SquashedHopCb(tx, EngineShard::tlocal(), rb->GetRespVersion());
+    auto cb = [this, tx, bc, resp_v]() mutable {
+      this->SquashedHopCb(tx, EngineShard::tlocal(), resp_v);
       bc->Dec();
     };
 
@@ -260,22 +341,56 @@ bool MultiCommandSquasher::ExecuteSquashed(facade::RedisReplyBuilder* rb) {
     bc->Wait();
 #else
     shard_set->RunBlockingInParallel(
-        [this, tx, rb](auto* es) { SquashedHopCb(tx, es, rb->GetRespVersion()); },
+        [this, tx, resp_v](auto* es) { SquashedHopCb(tx, es, resp_v); },
         [this](auto sid) { return !sharded_[sid].cmds.empty(); });
 #endif
   }
 
+  // With journal_fsync=always, squashed writes reply only after their journal entries are synced.
+  // Stubs of atomic transactions leave it to us, non-atomic ones wait inside their commands.
+  if (auto* journal = ServerState::tlocal()->journal(); journal && journal->SyncsEveryWrite()) {
+    for (unsigned i = 0; i < sharded_.size(); ++i) {
+      auto& sinfo = sharded_[i];
+      if (!sinfo.local_tx || !sinfo.local_tx->TakeJournaled())
+        continue;
+
+      // Memcache replies are already serialized and are sent as they are.
+      if (!journal->WaitDurable(i) || IsMemcache())
+        continue;
+
+      // Replies are stored in reverse order.
+      for (size_t j = 0; j < sinfo.cmds.size(); ++j) {
+        if (!sinfo.cmds[j]->Cid()->IsWriteOnly())
+          continue;
+        auto& reply = sinfo.replies[sinfo.replies.size() - 1 - j];
+        current_reply_size_.fetch_sub(Size(reply), std::memory_order_relaxed);
+        reply = CapturingReplyBuilder::Error{string{journal::kFileErr}, ""};
+        current_reply_size_.fetch_add(Size(reply), std::memory_order_relaxed);
+      }
+    }
+  }
+
   uint64_t after_hop = proactor->GetMonotonicTimeNs();
   bool aborted = false;
 
   for (auto idx : order_) {
+    if (IsMemcache()) {
+      auto& sinfo = sharded_[idx];
+      size_t i = sinfo.mc_replies_sent++;
+      size_t start = i == 0 ? 0 : sinfo.mc_reply_ends[i - 1];
+      if (size_t end = sinfo.mc_reply_ends[i]; end > start)  // empty for noreply commands
+        static_cast<MCReplyBuilder*>(rb)->SendRaw(
+            string_view{sinfo.mc_replies}.substr(start, end - start));
+      continue;
+    }
+
     auto& replies = sharded_[idx].replies;
     CHECK(!replies.empty());
 
     aborted |= error_abort_ && CapturingReplyBuilder::TryExtractError(replies.back());
 
     current_reply_size_.fetch_sub(Size(replies.back()), std::memory_order_relaxed);
-    CapturingReplyBuilder::Apply(std::move(replies.back()), rb);
+    CapturingReplyBuilder::Apply(std::move(replies.back()), static_cast<RedisReplyBuilder*>(rb));
     replies.pop_back();
 
     if (aborted)
@@ -285,14 +400,23 @@ bool MultiCommandSquasher::ExecuteSquashed(facade::RedisReplyBuilder* rb) {
   ServerState::SafeTLocal()->stats.multi_squash_exec_hop_usec += (after_hop - start) / 1000;
   ServerState::SafeTLocal()->stats.multi_squash_exec_reply_usec += (after_reply - after_hop) / 1000;
 
-  for (auto& sinfo : sharded_)
+  for (auto& sinfo : sharded_) {
     sinfo.cmds.clear();
+    sinfo.keys.clear();
+    sinfo.key_ends.clear();
+    sinfo.read_keys.clear();
+
+    current_reply_size_.fetch_sub(sinfo.mc_replies.size(), std::memory_order_relaxed);
+    sinfo.mc_replies.clear();
+    sinfo.mc_reply_ends.clear();
+    sinfo.mc_replies_sent = 0;
+  }
 
   order_.clear();
   return !aborted;
 }
 
-size_t MultiCommandSquasher::Run(RedisReplyBuilder* rb) {
+size_t MultiCommandSquasher::Run(SinkReplyBuilder* rb) {
   DVLOG(1) << "Trying to squash " << cmds_.size() << " commands for transaction "
            << cntx_->transaction->DebugId();
 
@@ -336,4 +460,11 @@ bool MultiCommandSquasher::IsAtomic() const {
   return atomic_;
 }
 
+void MultiCommandSquasher::ApplyMemcacheState(const StoredCmd* cmd, MCReplyBuilder* rb,
+                                              ConnectionContext* cntx) const {
+  const MemcacheState& state = mc_states_[cmd - cmds_.data()];
+  rb->SetFlags(state.reply_flags);
+  cntx->conn_state.memcache_flag = state.flag;
+}
+
 }  // namespace dfly
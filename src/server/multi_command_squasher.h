@@ -20,14 +20,32 @@ namespace dfly {
 // transactional api for commands. Non atomic multi transactions use regular shard_set dispatches
 // instead of hops for executing batches. This allows avoiding locking many keys at once. Each shard
 // contains a non-atomic multi transaction to execute squashed commands.
+//
+// Memcache commands are squashed as well, their replies are serialized on the shards and sent
+// in order with MCReplyBuilder::SendRaw.
 class MultiCommandSquasher {
  public:
+  // Memcache state of a command, applied to the reply builder and the context before it runs.
+  struct MemcacheState {
+    uint32_t flag = 0;        // ConnectionState::memcache_flag
+    uint8_t reply_flags = 0;  // MCReplyBuilder flags
+  };
+
   static size_t Execute(absl::Span<StoredCmd> cmds, facade::RedisReplyBuilder* rb,
                         ConnectionContext* cntx, Service* service, bool verify_commands = false,
                         bool error_abort = false) {
     return MultiCommandSquasher{cmds, cntx, service, verify_commands, error_abort}.Run(rb);
   }
 
+  // Execute memcache commands, mc_states holds the state of each command of cmds.
+  static size_t ExecuteMC(absl::Span<StoredCmd> cmds, absl::Span<const MemcacheState> mc_states,
+                          facade::MCReplyBuilder* rb, ConnectionContext* cntx, Service* service) {
+    DCHECK_EQ(cmds.size(), mc_states.size());
+    MultiCommandSquasher squasher{cmds, cntx, service, true, false};
+    squasher.mc_states_ = mc_states;
+    return squasher.Run(rb);
+  }
+
   static size_t GetRepliesMemSize() {
     return current_reply_size_.load(std::memory_order_relaxed);
   }
@@ -38,8 +56,14 @@ class MultiCommandSquasher {
     ShardExecInfo() : cmds{}, replies{}, local_tx{nullptr} {
     }
 
-    std::vector<StoredCmd*> cmds;  // accumulated commands
+    std::vector<StoredCmd*> cmds;             // accumulated commands
+    std::vector<std::string_view> keys;       // keys of all commands, to prefetch their buckets
+    std::vector<size_t> key_ends;             // end offsets of the keys of each command in keys
+    std::vector<std::string_view> read_keys;  // keys of read-only commands, to prefetch
     std::vector<facade::CapturingReplyBuilder::Payload> replies;
+    std::string mc_replies;             // serialized memcache replies
+    std::vector<size_t> mc_reply_ends;  // end offsets of the replies in mc_replies
+    size_t mc_replies_sent = 0;         // number of replies already sent from mc_replies
     boost::intrusive_ptr<Transaction> local_tx;  // stub-mode tx for use inside shard
   };
 
@@ -58,20 +82,28 @@ class MultiCommandSquasher {
   SquashResult TrySquash(StoredCmd* cmd);
 
   // Execute separate non-squashed cmd. Return false if aborting on error.
-  bool ExecuteStandalone(facade::RedisReplyBuilder* rb, StoredCmd* cmd);
+  bool ExecuteStandalone(facade::SinkReplyBuilder* rb, StoredCmd* cmd);
 
   // Callback that runs on shards during squashed hop.
   facade::OpStatus SquashedHopCb(Transaction* parent_tx, EngineShard* es,
                                  facade::RespVersion resp_v);
 
   // Execute all currently squashed commands. Return false if aborting on error.
-  bool ExecuteSquashed(facade::RedisReplyBuilder* rb);
+  bool ExecuteSquashed(facade::SinkReplyBuilder* rb);
 
   // Run all commands until completion. Returns number of squashed commands.
-  size_t Run(facade::RedisReplyBuilder* rb);
+  size_t Run(facade::SinkReplyBuilder* rb);
 
   bool IsAtomic() const;
 
+  bool IsMemcache() const {
+    return !mc_states_.empty();
+  }
+
+  // Apply the memcache state of cmd to the reply builder and the context.
+  void ApplyMemcacheState(const StoredCmd* cmd, facade::MCReplyBuilder* rb,
+                          ConnectionContext* cntx) const;
+
  private:
   absl::Span<StoredCmd> cmds_;  // Input range of stored commands
   ConnectionContext* cntx_;     // Underlying context
@@ -83,6 +115,8 @@ class MultiCommandSquasher {
   bool verify_commands_ = false;  // Whether commands need to be verified before execution
   bool error_abort_ = false;      // Abort upon receiving error
 
+  absl::Span<const MemcacheState> mc_states_;  // Set only for memcache commands
+
   std::vector<ShardExecInfo> sharded_;
   std::vector<ShardId> order_;  // reply order for squashed cmds
 
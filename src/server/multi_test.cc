@@ -17,6 +17,7 @@
 #include "server/transaction.h"
 
 ABSL_DECLARE_FLAG(bool, multi_exec_squash);
+ABSL_DECLARE_FLAG(uint32_t, cross_conn_squash);
 ABSL_DECLARE_FLAG(bool, lua_auto_async);
 ABSL_DECLARE_FLAG(bool, lua_allow_undeclared_auto_correct);
 ABSL_DECLARE_FLAG(std::string, default_lua_flags);
@@ -885,6 +886,79 @@ TEST_F(MultiTest, TestSquashing) {
   Run({"exec"});
 }
 
+// Commands of connections dispatching on the same thread are squashed into shared hops.
+TEST_F(MultiTest, CrossConnectionSquashing) {
+  absl::FlagSaver fs;
+  absl::SetFlag(&FLAGS_cross_conn_squash, 1);
+
+  const unsigned kConns = 8;
+  vector<Fiber> fbs(kConns);
+  for (unsigned i = 0; i < kConns; i++) {
+    fbs[i] = pp_->at(0)->LaunchFiber([this, i] {
+      string id = StrCat("conn", i);
+      for (unsigned j = 0; j < 100; j++) {
+        EXPECT_THAT(Run(id, {"incr", StrCat("key", j % 10)}), ArgType(RespExpr::INT64));
+      }
+    });
+  }
+
+  for (auto& fb : fbs)
+    fb.Join();
+
+  for (unsigned j = 0; j < 10; j++)
+    EXPECT_EQ(Run({"get", StrCat("key", j)}), "80");
+
+  // Multi-shard commands are dispatched regularly.
+  EXPECT_EQ(Run({"mset", kKeySid0, "a", kKeySid1, "b"}), "OK");
+
+  auto metrics = GetMetrics();
+  EXPECT_GT(metrics.coordinator_stats.cross_conn_squashed_commands,
+            metrics.coordinator_stats.cross_conn_squash_batches);
+}
+
+// A command on a locked key would wait in the batch for the transaction holding the lock, so it
+// is left out of the batch and dispatched regularly.
+TEST_F(MultiTest, CrossConnectionSquashingLockedKey) {
+  absl::FlagSaver fs;
+  absl::SetFlag(&FLAGS_cross_conn_squash, 1);
+
+  ShardId sid = Shard(kKeySid0, shard_set->size());
+  LockFp fp = LockTag(kKeySid0).Fingerprint();
+  KeyLockArgs lock_args{0, {&fp, 1}};
+
+  auto run_incrs = [&] {
+    const unsigned kConns = 8;
+    vector<Fiber> fbs(kConns);
+    for (unsigned i = 0; i < kConns; i++) {
+      fbs[i] = pp_->at(0)->LaunchFiber([this, i] {
+        string id = StrCat("conn", i);
+        for (unsigned j = 0; j < 50; j++)
+          EXPECT_THAT(Run(id, {"incr", kKeySid0}), ArgType(RespExpr::INT64));
+      });
+    }
+    for (auto& fb : fbs)
+      fb.Join();
+  };
+
+  // Hold the lock of the key as a scheduled transaction would.
+  shard_set->Await(sid, [&] {
+    namespaces->GetDefaultNamespace().GetDbSlice(sid).Acquire(IntentLock::EXCLUSIVE, lock_args);
+  });
+  run_incrs();
+  EXPECT_EQ(Run({"get", kKeySid0}), "400");
+
+  auto metrics = GetMetrics();
+  EXPECT_GT(metrics.coordinator_stats.cross_conn_squash_batches, 0u);
+  EXPECT_EQ(metrics.coordinator_stats.cross_conn_squashed_commands, 0u);
+
+  shard_set->Await(sid, [&] {
+    namespaces->GetDefaultNamespace().GetDbSlice(sid).Release(IntentLock::EXCLUSIVE, lock_args);
+  });
+  run_incrs();
+  EXPECT_EQ(Run({"get", kKeySid0}), "800");
+  EXPECT_GT(GetMetrics().coordinator_stats.cross_conn_squashed_commands, 0u);
+}
+
 TEST_F(MultiTest, MultiLeavesTxQueue) {
   // Tests the scenario, where the OOO multi-tx is scheduled into tx queue and there is another
   // tx (mget) after it that runs and tests for atomicity.
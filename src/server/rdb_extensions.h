@@ -39,6 +39,17 @@ constexpr uint8_t RDB_OPCODE_JOURNAL_BLOB = 210;
 // so it is always sent at the end of the RDB stream.
 constexpr uint8_t RDB_OPCODE_JOURNAL_OFFSET = 211;
 
+// Serialized search index of a single shard. Written only to per-shard DF snapshot files,
+// so that the loader can restore the index instead of rebuilding it from the documents.
+// Format: shard id, shard count, index name, data chunks terminated by an empty string and
+// a flag that tells whether the data is complete.
+constexpr uint8_t RDB_OPCODE_SEARCH_INDEX = 212;
+
+// The journal LSN of a shard at the point in time of the snapshot. Written only to per-shard
+// DF snapshot files when the journal is persisted on disk, the loader replays the on-disk
+// journal from this position.
+constexpr uint8_t RDB_OPCODE_JOURNAL_POSITION = 213;
+
 constexpr uint8_t RDB_OPCODE_DF_MASK = 220; /* Mask for key properties */
 
 // RDB_OPCODE_DF_MASK define 4byte field with next flags
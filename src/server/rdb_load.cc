@@ -59,6 +59,9 @@ ABSL_DECLARE_FLAG(uint32_t, dbnum);
 ABSL_DECLARE_FLAG(bool, list_experimental_v2);
 ABSL_FLAG(bool, rdb_load_dry_run, false, "Dry run RDB load without applying changes");
 ABSL_FLAG(bool, rdb_ignore_expiry, false, "Ignore Key Expiry when loding from RDB snapshot");
+ABSL_FLAG(bool, rdb_load_parallel_decode, true,
+          "If true, compressed blobs are decompressed and parsed on the shard threads instead of "
+          "the loading fiber");
 
 namespace dfly {
 
@@ -194,6 +197,11 @@ bool RdbTypeAllowedEmpty(int type) {
          type == RDB_TYPE_HASH_WITH_EXPIRY;
 }
 
+bool IsCompressedBlobStart(int type) {
+  return type == RDB_OPCODE_COMPRESSED_ZSTD_BLOB_START ||
+         type == RDB_OPCODE_COMPRESSED_LZ4_BLOB_START;
+}
+
 }  // namespace
 
 class RdbLoaderBase::OpaqueObjLoader {
@@ -1934,14 +1942,152 @@ struct RdbLoader::ObjSettings {
     mc_flags = flags;
   }
 
+  bool IsDefault() const {
+    return expiretime == 0 && !is_sticky && !has_mc_flags;
+  }
+
   ObjSettings() = default;
 };
 
+// A compressed blob that is decompressed and parsed into items on a shard thread.
+struct RdbLoader::DecodedBlob {
+  ~DecodedBlob() {
+    for (Item* item : items)
+      delete item;
+  }
+
+  int op_type = 0;
+  string compressed;
+  long long now = 0;
+
+  // Items in the order of the blob. Databases are selected before the item at the given index.
+  vector<Item*> items;
+  vector<pair<size_t, DbIndex>> selects;
+  size_t keys = 0;
+
+  // The blob has opcodes other than entries or could not be decoded, so it must be loaded
+  // by the loading fiber.
+  bool fallback = false;
+  fb2::Done done;
+};
+
+class RdbLoader::BlobDecoder : public RdbLoaderBase {
+ public:
+  BlobDecoder(const RdbLoader* owner, DecodedBlob* blob) : owner_{owner}, blob_{blob} {
+    rdb_version_ = owner->rdb_version_;
+  }
+
+  void Decode();
+
+ private:
+  error_code DecodeEntries();
+  error_code DecodeKeyValPair(int type, ObjSettings* settings);
+
+  const RdbLoader* owner_;
+  DecodedBlob* blob_;
+};
+
+void RdbLoader::BlobDecoder::Decode() {
+  if (error_code ec = DecodeEntries(); ec) {
+    // Errors are reported when the loading fiber loads the blob on its own.
+    VLOG(1) << "Falling back to sequential load of a compressed blob: " << ec.message();
+    for (Item* item : blob_->items)
+      delete item;
+    blob_->items.clear();
+    blob_->selects.clear();
+    blob_->keys = 0;
+    blob_->fallback = true;
+  }
+}
+
+error_code RdbLoader::BlobDecoder::DecodeEntries() {
+  RETURN_ON_ERR(AllocateDecompressOnce(blob_->op_type));
+  SET_OR_RETURN(decompress_impl_->Decompress(blob_->compressed), mem_buf_);
+
+  ObjSettings settings;
+  settings.now = blob_->now;
+  while (true) {
+    int type;
+    SET_OR_RETURN(FetchType(), type);
+
+    if (type == RDB_OPCODE_EXPIRETIME_MS) {
+      int64_t val;
+      SET_OR_RETURN(FetchInt<int64_t>(), val);
+      if (!owner_->rdb_ignore_expiry_) {
+        settings.SetExpire(val);
+      }
+    } else if (type == RDB_OPCODE_DF_MASK) {
+      uint32_t mask;
+      SET_OR_RETURN(FetchInt<uint32_t>(), mask);
+      settings.is_sticky = mask & DF_MASK_FLAG_STICKY;
+      settings.has_mc_flags = mask & DF_MASK_FLAG_MC_FLAGS;
+      if (settings.has_mc_flags) {
+        SET_OR_RETURN(FetchInt<uint32_t>(), settings.mc_flags);
+      }
+    } else if (type == RDB_OPCODE_SELECTDB) {
+      unsigned dbid = 0;
+      SET_OR_RETURN(LoadLen(nullptr), dbid);
+      if (dbid > GetFlag(FLAGS_dbnum))
+        return RdbError(errc::bad_db_index);
+      blob_->selects.emplace_back(blob_->items.size(), dbid);
+    } else if (type == RDB_OPCODE_COMPRESSED_BLOB_END) {
+      // Attributes must not pass to the entries that follow the blob.
+      if (mem_buf_->InputLen() != 0 || !settings.IsDefault())
+        return RdbError(errc::rdb_file_corrupted);
+      return kOk;
+    } else if (rdbIsObjectTypeDF(type)) {
+      ++blob_->keys;
+      RETURN_ON_ERR(DecodeKeyValPair(type, &settings));
+      settings.Reset();
+    } else {
+      return RdbError(errc::unsupported_operation);
+    }
+  }
+}
+
+// Same as RdbLoader::LoadKeyValPair, but collects the items instead of dispatching them.
+error_code RdbLoader::BlobDecoder::DecodeKeyValPair(int type, ObjSettings* settings) {
+  string key;
+  SET_OR_RETURN(ReadKey(), key);
+
+  bool streamed = false;
+  do {
+    auto item = make_unique<Item>();
+    item->load_config.append = pending_read_.remaining > 0;
+    RETURN_ON_ERR(ReadObj(type, &item->val));
+
+    if (owner_->ShouldDiscardKey(key, settings)) {
+      pending_read_.reserve = 0;
+      continue;
+    }
+
+    if (pending_read_.remaining > 0) {
+      item->key = key;
+      streamed = true;
+    } else {
+      item->key = std::move(key);
+    }
+
+    item->load_config.streamed = streamed;
+    item->load_config.reserve = pending_read_.reserve;
+    pending_read_.reserve = 0;
+
+    item->is_sticky = settings->is_sticky;
+    item->has_mc_flags = settings->has_mc_flags;
+    item->mc_flags = settings->mc_flags;
+    item->expire_ms = settings->expiretime;
+    blob_->items.push_back(item.release());
+  } while (pending_read_.remaining > 0);
+
+  return kOk;
+}
+
 RdbLoader::RdbLoader(Service* service)
     : service_{service},
       rdb_ignore_expiry_{GetFlag(FLAGS_rdb_ignore_expiry)},
       script_mgr_{service == nullptr ? nullptr : service->script_mgr()},
-      shard_buf_{shard_set->size()} {
+      shard_buf_{shard_set->size()},
+      parallel_decode_{GetFlag(FLAGS_rdb_load_parallel_decode)} {
 }
 
 RdbLoader::~RdbLoader() {
@@ -2025,175 +2171,259 @@ error_code RdbLoader::Load(io::Source* src) {
 
     DVLOG(3) << "Opcode type: " << type;
 
-    /* Handle special types. */
-    if (type == RDB_OPCODE_EXPIRETIME) {
-      LOG(ERROR) << "opcode RDB_OPCODE_EXPIRETIME not supported";
-
-      return RdbError(errc::invalid_encoding);
+    if (IsCompressedBlobStart(type) && CanDecodeInParallel(settings)) {
+      RETURN_ON_ERR(DispatchCompressedBlob(type, &settings, &keys_loaded));
+      continue;
     }
 
-    if (type == RDB_OPCODE_EXPIRETIME_MS) {
-      int64_t val;
-      /* EXPIRETIME_MS: milliseconds precision expire times introduced
-       * with RDB v3. Like EXPIRETIME but no with more precision. */
-      SET_OR_RETURN(FetchInt<int64_t>(), val);
-      if (!rdb_ignore_expiry_) {
-        settings.SetExpire(val);
-      }
-      continue; /* Read next opcode. */
-    }
+    // Everything else must be applied after the preceding blobs.
+    RETURN_ON_ERR(ApplyDecodedBlobs(0, &settings, &keys_loaded));
 
-    if (type == RDB_OPCODE_DF_MASK) {
-      uint32_t mask;
-      SET_OR_RETURN(FetchInt<uint32_t>(), mask);
-      settings.is_sticky = mask & DF_MASK_FLAG_STICKY;
-      settings.has_mc_flags = mask & DF_MASK_FLAG_MC_FLAGS;
-      if (settings.has_mc_flags) {
-        SET_OR_RETURN(FetchInt<uint32_t>(), settings.mc_flags);
-      }
-      continue; /* Read next opcode. */
-    }
+    bool eof = false;
+    RETURN_ON_ERR(HandleOpcode(type, &settings, &keys_loaded, &eof));
+    if (eof)
+      break;
+  }  // main load loop
 
-    if (type == RDB_OPCODE_FREQ) {
-      /* FREQ: LFU frequency. */
-      FetchInt<uint8_t>();  // IGNORE
-      continue;             /* Read next opcode. */
-    }
+  DVLOG(1) << "RdbLoad loop finished";
+
+  if (stop_early_) {
+    return *ec_;
+  }
+
+  /* Verify the checksum if RDB version is >= 5 */
+  RETURN_ON_ERR(VerifyChecksum());
+
+  return kOk;
+}
+
+error_code RdbLoader::HandleOpcode(int type, ObjSettings* settings, size_t* keys_loaded,
+                                   bool* eof) {
+  if (type == RDB_OPCODE_EXPIRETIME) {
+    LOG(ERROR) << "opcode RDB_OPCODE_EXPIRETIME not supported";
 
-    if (type == RDB_OPCODE_IDLE) {
-      /* IDLE: LRU idle time. */
-      uint64_t idle;
-      SET_OR_RETURN(LoadLen(nullptr), idle);  // ignore
-      (void)idle;
-      continue; /* Read next opcode. */
+    return RdbError(errc::invalid_encoding);
+  }
+
+  if (type == RDB_OPCODE_EXPIRETIME_MS) {
+    int64_t val;
+    /* EXPIRETIME_MS: milliseconds precision expire times introduced
+     * with RDB v3. Like EXPIRETIME but no with more precision. */
+    SET_OR_RETURN(FetchInt<int64_t>(), val);
+    if (!rdb_ignore_expiry_) {
+      settings->SetExpire(val);
     }
+    return kOk; /* Read next opcode. */
+  }
 
-    if (type == RDB_OPCODE_EOF) {
-      /* EOF: End of file, exit the main loop. */
-      break;
+  if (type == RDB_OPCODE_DF_MASK) {
+    uint32_t mask;
+    SET_OR_RETURN(FetchInt<uint32_t>(), mask);
+    settings->is_sticky = mask & DF_MASK_FLAG_STICKY;
+    settings->has_mc_flags = mask & DF_MASK_FLAG_MC_FLAGS;
+    if (settings->has_mc_flags) {
+      SET_OR_RETURN(FetchInt<uint32_t>(), settings->mc_flags);
     }
+    return kOk; /* Read next opcode. */
+  }
 
-    if (type == RDB_OPCODE_FULLSYNC_END) {
-      VLOG(1) << "Read RDB_OPCODE_FULLSYNC_END";
-      RETURN_ON_ERR(EnsureRead(8));
-      mem_buf_->ConsumeInput(8);  // ignore 8 bytes
+  if (type == RDB_OPCODE_FREQ) {
+    /* FREQ: LFU frequency. */
+    FetchInt<uint8_t>();  // IGNORE
+    return kOk;           /* Read next opcode. */
+  }
 
-      if (full_sync_cut_cb) {
-        FlushAllShards();  // Flush as the handler awakes post load handlers
-        full_sync_cut_cb();
-      }
-      continue;
+  if (type == RDB_OPCODE_IDLE) {
+    /* IDLE: LRU idle time. */
+    uint64_t idle;
+    SET_OR_RETURN(LoadLen(nullptr), idle);  // ignore
+    (void)idle;
+    return kOk; /* Read next opcode. */
+  }
+
+  if (type == RDB_OPCODE_EOF) {
+    /* EOF: End of file, exit the main loop. */
+    *eof = true;
+    return kOk;
+  }
+
+  if (type == RDB_OPCODE_FULLSYNC_END) {
+    VLOG(1) << "Read RDB_OPCODE_FULLSYNC_END";
+    RETURN_ON_ERR(EnsureRead(8));
+    mem_buf_->ConsumeInput(8);  // ignore 8 bytes
+
+    if (full_sync_cut_cb) {
+      FlushAllShards();  // Flush as the handler awakes post load handlers
+      full_sync_cut_cb();
     }
+    return kOk;
+  }
 
-    if (type == RDB_OPCODE_JOURNAL_OFFSET) {
-      VLOG(1) << "Read RDB_OPCODE_JOURNAL_OFFSET";
-      uint64_t journal_offset;
-      SET_OR_RETURN(FetchInt<uint64_t>(), journal_offset);
-      VLOG(1) << "Got offset " << journal_offset;
-      journal_offset_ = journal_offset;
-      continue;
+  if (type == RDB_OPCODE_JOURNAL_OFFSET) {
+    VLOG(1) << "Read RDB_OPCODE_JOURNAL_OFFSET";
+    uint64_t journal_offset;
+    SET_OR_RETURN(FetchInt<uint64_t>(), journal_offset);
+    VLOG(1) << "Got offset " << journal_offset;
+    journal_offset_ = journal_offset;
+    return kOk;
+  }
+
+  if (type == RDB_OPCODE_SELECTDB) {
+    unsigned dbid = 0;
+
+    /* SELECTDB: Select the specified database. */
+    SET_OR_RETURN(LoadLen(nullptr), dbid);
+
+    if (dbid > GetFlag(FLAGS_dbnum)) {
+      LOG(WARNING) << "database id " << dbid << " exceeds dbnum limit. Try increasing the flag.";
+
+      return RdbError(errc::bad_db_index);
     }
 
-    if (type == RDB_OPCODE_SELECTDB) {
-      unsigned dbid = 0;
+    SelectDb(dbid);
+    return kOk; /* Read next opcode. */
+  }
 
-      /* SELECTDB: Select the specified database. */
-      SET_OR_RETURN(LoadLen(nullptr), dbid);
+  if (type == RDB_OPCODE_RESIZEDB) {
+    /* RESIZEDB: Hint about the size of the keys in the currently
+     * selected data base, in order to avoid useless rehashing. */
+    uint64_t db_size, expires_size;
+    SET_OR_RETURN(LoadLen(nullptr), db_size);
+    SET_OR_RETURN(LoadLen(nullptr), expires_size);
 
-      if (dbid > GetFlag(FLAGS_dbnum)) {
-        LOG(WARNING) << "database id " << dbid << " exceeds dbnum limit. Try increasing the flag.";
+    ResizeDb(db_size, expires_size);
+    return kOk; /* Read next opcode. */
+  }
 
-        return RdbError(errc::bad_db_index);
-      }
+  if (type == RDB_OPCODE_AUX) {
+    RETURN_ON_ERR(HandleAux());
+    return kOk; /* Read type again. */
+  }
 
-      DVLOG(2) << "Select DB: " << dbid;
-      for (unsigned i = 0; i < shard_set->size(); ++i) {
-        // we should flush pending items before switching dbid.
-        FlushShardAsync(i);
+  if (type == RDB_OPCODE_MODULE_AUX) {
+    uint64_t module_id;
+    SET_OR_RETURN(LoadLen(nullptr), module_id);
+    string module_name = ModuleTypeName(module_id);
 
-        // Active database if not existed before.
-        shard_set->Add(
-            i, [dbid] { namespaces->GetDefaultNamespace().GetCurrentDbSlice().ActivateDb(dbid); });
-      }
+    LOG(WARNING) << "WARNING: Skipping data for module " << module_name;
+    RETURN_ON_ERR(SkipModuleData());
+    return kOk;
+  }
 
-      cur_db_index_ = dbid;
-      if (EngineShard::tlocal()) {  // because we sometimes create entries inline.
-        namespaces->GetDefaultNamespace().GetCurrentDbSlice().ActivateDb(dbid);
-      }
-      continue; /* Read next opcode. */
-    }
+  if (type == RDB_OPCODE_COMPRESSED_ZSTD_BLOB_START ||
+      type == RDB_OPCODE_COMPRESSED_LZ4_BLOB_START) {
+    RETURN_ON_ERR(HandleCompressedBlob(type));
+    return kOk;
+  }
 
-    if (type == RDB_OPCODE_RESIZEDB) {
-      /* RESIZEDB: Hint about the size of the keys in the currently
-       * selected data base, in order to avoid useless rehashing. */
-      uint64_t db_size, expires_size;
-      SET_OR_RETURN(LoadLen(nullptr), db_size);
-      SET_OR_RETURN(LoadLen(nullptr), expires_size);
+  if (type == RDB_OPCODE_COMPRESSED_BLOB_END) {
+    RETURN_ON_ERR(HandleCompressedBlobFinish());
+    return kOk;
+  }
 
-      ResizeDb(db_size, expires_size);
-      continue; /* Read next opcode. */
-    }
+  if (type == RDB_OPCODE_SEARCH_INDEX) {
+    RETURN_ON_ERR(HandleSearchIndex());
+    return kOk;
+  }
 
-    if (type == RDB_OPCODE_AUX) {
-      RETURN_ON_ERR(HandleAux());
-      continue; /* Read type again. */
-    }
+  if (type == RDB_OPCODE_JOURNAL_POSITION) {
+    RETURN_ON_ERR(HandleJournalPosition());
+    return kOk;
+  }
+
+  if (type == RDB_OPCODE_JOURNAL_BLOB) {
+    FlushAllShards();  // Always flush before applying incremental on top
+    RETURN_ON_ERR(HandleJournalBlob(service_));
+    return kOk;
+  }
 
-    if (type == RDB_OPCODE_MODULE_AUX) {
-      uint64_t module_id;
-      SET_OR_RETURN(LoadLen(nullptr), module_id);
-      string module_name = ModuleTypeName(module_id);
+  if (type == RDB_OPCODE_SLOT_INFO) {
+    [[maybe_unused]] uint64_t slot_id;
+    SET_OR_RETURN(LoadLen(nullptr), slot_id);
+    [[maybe_unused]] uint64_t slot_size;
+    SET_OR_RETURN(LoadLen(nullptr), slot_size);
+    [[maybe_unused]] uint64_t expires_slot_size;
+    SET_OR_RETURN(LoadLen(nullptr), expires_slot_size);
+    return kOk;
+  }
 
-      LOG(WARNING) << "WARNING: Skipping data for module " << module_name;
-      RETURN_ON_ERR(SkipModuleData());
-      continue;
-    }
+  if (!rdbIsObjectTypeDF(type)) {
+    return RdbError(errc::invalid_rdb_type);
+  }
 
-    if (type == RDB_OPCODE_COMPRESSED_ZSTD_BLOB_START ||
-        type == RDB_OPCODE_COMPRESSED_LZ4_BLOB_START) {
-      RETURN_ON_ERR(HandleCompressedBlob(type));
-      continue;
-    }
+  ++*keys_loaded;
+  RETURN_ON_ERR(LoadKeyValPair(type, settings));
+  settings->Reset();
+  return kOk;
+}
 
-    if (type == RDB_OPCODE_COMPRESSED_BLOB_END) {
-      RETURN_ON_ERR(HandleCompressedBlobFinish());
-      continue;
-    }
+bool RdbLoader::CanDecodeInParallel(const ObjSettings& settings) const {
+  // Blobs are decoded from scratch, so there must be no attributes for the next entry.
+  return parallel_decode_ && mem_buf_ == &origin_mem_buf_ && settings.IsDefault();
+}
 
-    if (type == RDB_OPCODE_JOURNAL_BLOB) {
-      FlushAllShards();  // Always flush before applying incremental on top
-      RETURN_ON_ERR(HandleJournalBlob(service_));
-      continue;
-    }
+error_code RdbLoader::DispatchCompressedBlob(int op_type, ObjSettings* settings,
+                                             size_t* keys_loaded) {
+  // Limit the memory of decoded blobs that wait for their turn.
+  RETURN_ON_ERR(ApplyDecodedBlobs(2 * shard_set->size() - 1, settings, keys_loaded));
 
-    if (type == RDB_OPCODE_SLOT_INFO) {
-      [[maybe_unused]] uint64_t slot_id;
-      SET_OR_RETURN(LoadLen(nullptr), slot_id);
-      [[maybe_unused]] uint64_t slot_size;
-      SET_OR_RETURN(LoadLen(nullptr), slot_size);
-      [[maybe_unused]] uint64_t expires_slot_size;
-      SET_OR_RETURN(LoadLen(nullptr), expires_slot_size);
+  auto blob = make_shared<DecodedBlob>();
+  blob->op_type = op_type;
+  blob->now = settings->now;
+  SET_OR_RETURN(FetchGenericString(), blob->compressed);
+
+  // The shard threads create the objects later anyway, so spread the decoding among them.
+  ShardId sid = next_decode_shard_++ % shard_set->size();
+  shard_set->Add(sid, [this, blob] {
+    BlobDecoder{this, blob.get()}.Decode();
+    blob->done.Notify();
+  });
+
+  decoded_blobs_.push_back(std::move(blob));
+  return kOk;
+}
+
+error_code RdbLoader::ApplyDecodedBlobs(size_t max_pending, ObjSettings* settings,
+                                        size_t* keys_loaded) {
+  while (decoded_blobs_.size() > max_pending) {
+    shared_ptr<DecodedBlob> blob = std::move(decoded_blobs_.front());
+    decoded_blobs_.pop_front();
+    blob->done.Wait();
+
+    if (blob->fallback) {
+      RETURN_ON_ERR(LoadCompressedBlob(*blob, settings, keys_loaded));
       continue;
     }
 
-    if (!rdbIsObjectTypeDF(type)) {
-      return RdbError(errc::invalid_rdb_type);
+    auto select_it = blob->selects.begin();
+    for (size_t i = 0; i <= blob->items.size(); ++i) {
+      for (; select_it != blob->selects.end() && select_it->first == i; ++select_it)
+        SelectDb(select_it->second);
+
+      if (i < blob->items.size())
+        DispatchItem(blob->items[i]);
     }
+    blob->items.clear();
+    *keys_loaded += blob->keys;
+  }
+  return kOk;
+}
 
-    ++keys_loaded;
-    RETURN_ON_ERR(LoadKeyValPair(type, &settings));
-    settings.Reset();
-  }  // main load loop
+error_code RdbLoader::LoadCompressedBlob(const DecodedBlob& blob, ObjSettings* settings,
+                                         size_t* keys_loaded) {
+  RETURN_ON_ERR(AllocateDecompressOnce(blob.op_type));
+  SET_OR_RETURN(decompress_impl_->Decompress(blob.compressed), mem_buf_);
 
-  DVLOG(1) << "RdbLoad loop finished";
+  // RDB_OPCODE_COMPRESSED_BLOB_END switches back to the original buffer.
+  while (mem_buf_ != &origin_mem_buf_) {
+    int type;
+    SET_OR_RETURN(FetchType(), type);
 
-  if (stop_early_) {
-    return *ec_;
+    bool eof = false;
+    RETURN_ON_ERR(HandleOpcode(type, settings, keys_loaded, &eof));
+    if (eof)
+      return RdbError(errc::rdb_file_corrupted);
   }
-
-  /* Verify the checksum if RDB version is >= 5 */
-  RETURN_ON_ERR(VerifyChecksum());
-
   return kOk;
 }
 
@@ -2207,6 +2437,9 @@ void RdbLoader::FinishLoad(absl::Time start_time, size_t* keys_loaded) {
     shard_set->Add(i, [bc]() mutable { bc->Dec(); });
   }
   bc->Wait();  // wait for sentinels to report.
+
+  // Decoding runs in the shard queues, so it's done by now. Drop the blobs left after an error.
+  decoded_blobs_.clear();
   // Decrement local one if it exists
   if (EngineShard* es = EngineShard::tlocal(); es) {
     namespaces->GetDefaultNamespace().GetCurrentDbSlice().DecrLoadInProgress();
@@ -2410,6 +2643,63 @@ error_code RdbLoaderBase::HandleJournalBlob(Service* service) {
   return std::error_code{};
 }
 
+error_code RdbLoader::HandleSearchIndex() {
+  uint64_t shard_id, shard_count;
+  SET_OR_RETURN(LoadLen(nullptr), shard_id);
+  SET_OR_RETURN(LoadLen(nullptr), shard_count);
+
+  string name, data;
+  SET_OR_RETURN(FetchGenericString(), name);
+
+  // The index is streamed in chunks terminated by an empty one.
+  while (true) {
+    string chunk;
+    SET_OR_RETURN(FetchGenericString(), chunk);
+    if (chunk.empty())
+      break;
+    data.append(chunk);
+  }
+
+  // The index changed while it was serialized, so it will be rebuilt.
+  uint64_t complete;
+  SET_OR_RETURN(LoadLen(nullptr), complete);
+  if (!complete) {
+    VLOG(1) << "Skipping incomplete search index " << name << " of shard " << shard_id;
+    return kOk;
+  }
+
+  // Documents are distributed differently with another number of shards, so the index
+  // must be rebuilt from scratch.
+  if (shard_count != shard_set->size() || shard_id >= shard_count) {
+    VLOG(1) << "Skipping serialized search index " << name << " of shard " << shard_id << "/"
+            << shard_count;
+    return kOk;
+  }
+
+  // The index definitions might not be loaded yet, so the data is only stashed here and
+  // restored in PerformPostLoad.
+  shard_set->Add(shard_id, [name = std::move(name), data = std::move(data)]() mutable {
+    EngineShard::tlocal()->search_indices()->AddSerializedIndex(std::move(name), std::move(data));
+  });
+  return kOk;
+}
+
+error_code RdbLoader::HandleJournalPosition() {
+  uint64_t shard_id, shard_count, lsn;
+  SET_OR_RETURN(LoadLen(nullptr), shard_id);
+  SET_OR_RETURN(LoadLen(nullptr), shard_count);
+  SET_OR_RETURN(LoadLen(nullptr), lsn);
+
+  // The on-disk journal is split by shards, so it can be replayed only with the same layout.
+  if (shard_count != shard_set->size() || shard_id >= shard_count) {
+    LOG(WARNING) << "Ignoring journal position of shard " << shard_id << "/" << shard_count;
+    return kOk;
+  }
+
+  service_->server_family().journal()->SetLoadedSnapshotPosition(shard_id, lsn);
+  return kOk;
+}
+
 error_code RdbLoader::HandleAux() {
   /* AUX: generic string-string fields. Use to add state to RDB
    * which is backward compatible. Implementations of RDB loading
@@ -2532,6 +2822,32 @@ std::error_code RdbLoaderBase::FromOpaque(const OpaqueObj& opaque, LoadConfig co
   return visitor.ec();
 }
 
+std::error_code RdbLoaderBase::LoadObject(string_view blob, CompactObj* pv) {
+  RdbLoaderBase loader;
+  io::BytesSource bs{io::Buffer(blob)};
+  loader.src_ = &bs;
+
+  io::Result<uint8_t> type = loader.FetchType();
+  if (!type)
+    return type.error();
+  if (!rdbIsObjectTypeDF(*type))
+    return RdbError(errc::invalid_rdb_type);
+
+  // Big values are read in parts, similarly to RESTORE.
+  LoadConfig config;
+  do {
+    OpaqueObj obj;
+    RETURN_ON_ERR(loader.ReadObj(*type, &obj));
+
+    config.streamed = loader.pending_read_.remaining > 0;
+    config.reserve = loader.pending_read_.reserve;
+    RETURN_ON_ERR(FromOpaque(obj, config, pv));
+    config.append = true;
+  } while (loader.pending_read_.remaining > 0);
+
+  return {};
+}
+
 void RdbLoaderBase::CopyStreamId(const StreamID& src, struct streamID* dest) {
   dest->ms = src.ms;
   dest->seq = src.seq;
@@ -2710,24 +3026,7 @@ error_code RdbLoader::LoadKeyValPair(int type, ObjSettings* settings) {
     item->expire_ms = settings->expiretime;
 
     std::move(cleanup).Cancel();
-    ShardId sid = Shard(item->key, shard_set->size());
-    EngineShard* es = EngineShard::tlocal();
-
-    if (es && es->shard_id() == sid) {
-      DbContext db_cntx{&namespaces->GetDefaultNamespace(), cur_db_index_, GetCurrentTimeMs()};
-      CreateObjectOnShard(db_cntx, item, &db_cntx.GetDbSlice(sid));
-      item_queue_.Push(item);
-    } else {
-      auto& out_buf = shard_buf_[sid];
-
-      out_buf.emplace_back(std::move(item));
-
-      constexpr size_t kBufSize = 64;
-      if (out_buf.size() >= kBufSize) {
-        // Despite being async, this function can block if the shard queue is full.
-        FlushShardAsync(sid);
-      }
-    }
+    DispatchItem(item);
   } while (pending_read_.remaining > 0);
 
   int delta_ms = (absl::GetCurrentTimeNanos() - start) / 1000'000;
@@ -2736,6 +3035,44 @@ error_code RdbLoader::LoadKeyValPair(int type, ObjSettings* settings) {
   return kOk;
 }
 
+void RdbLoader::DispatchItem(Item* item) {
+  ShardId sid = Shard(item->key, shard_set->size());
+  EngineShard* es = EngineShard::tlocal();
+
+  if (es && es->shard_id() == sid) {
+    DbContext db_cntx{&namespaces->GetDefaultNamespace(), cur_db_index_, GetCurrentTimeMs()};
+    CreateObjectOnShard(db_cntx, item, &db_cntx.GetDbSlice(sid));
+    item_queue_.Push(item);
+  } else {
+    auto& out_buf = shard_buf_[sid];
+
+    out_buf.emplace_back(item);
+
+    constexpr size_t kBufSize = 64;
+    if (out_buf.size() >= kBufSize) {
+      // Despite being async, this function can block if the shard queue is full.
+      FlushShardAsync(sid);
+    }
+  }
+}
+
+void RdbLoader::SelectDb(DbIndex dbid) {
+  DVLOG(2) << "Select DB: " << dbid;
+  for (unsigned i = 0; i < shard_set->size(); ++i) {
+    // we should flush pending items before switching dbid.
+    FlushShardAsync(i);
+
+    // Active database if not existed before.
+    shard_set->Add(
+        i, [dbid] { namespaces->GetDefaultNamespace().GetCurrentDbSlice().ActivateDb(dbid); });
+  }
+
+  cur_db_index_ = dbid;
+  if (EngineShard::tlocal()) {  // because we sometimes create entries inline.
+    namespaces->GetDefaultNamespace().GetCurrentDbSlice().ActivateDb(dbid);
+  }
+}
+
 bool RdbLoader::ShouldDiscardKey(std::string_view key, ObjSettings* settings) const {
   if (!load_unowned_slots_ && IsClusterEnabled()) {
     const auto cluster_config = cluster::ClusterConfig::Current();
@@ -2812,7 +3149,8 @@ void RdbLoader::PerformPostLoad(Service* service) {
   if (cmd == nullptr)  // On MacOS we don't include search so FT.CREATE won't exist.
     return;
 
-  // Rebuild all search indices as only their definitions are extracted from the snapshot
+  // Restore all search indices from their serialized data if it was loaded from the snapshot,
+  // otherwise rebuild them from their definitions.
   shard_set->AwaitRunningOnShardQueue([](EngineShard* es) {
     es->search_indices()->RebuildAllIndices(
         OpArgs{es, nullptr, DbContext{&namespaces->GetDefaultNamespace(), 0, GetCurrentTimeMs()}});
@@ -3,6 +3,8 @@
 //
 #pragma once
 
+#include <deque>
+#include <memory>
 #include <system_error>
 
 extern "C" {
@@ -29,6 +31,11 @@ class Service;
 using RdbVersion = std::uint16_t;
 
 class RdbLoaderBase {
+ public:
+  // Loads a value serialized with SerializerBase::SerializeObject into pv.
+  // Ignores any trailing bytes after the value.
+  static std::error_code LoadObject(std::string_view blob, CompactObj* pv);
+
  protected:
   RdbLoaderBase();
   ~RdbLoaderBase();
@@ -294,12 +301,34 @@ class RdbLoader : protected RdbLoaderBase {
   using ItemsBuf = std::vector<Item*>;
 
   struct ObjSettings;
+  struct DecodedBlob;
+  class BlobDecoder;
+
+  // Handles an opcode read from the stream. Sets eof once the end of the stream is reached.
+  std::error_code HandleOpcode(int type, ObjSettings* settings, size_t* keys_loaded, bool* eof);
+
+  // Compressed blobs are read ahead and decoded into items on the shard threads. The items
+  // are dispatched by the loading fiber in the order of the blobs.
+  bool CanDecodeInParallel(const ObjSettings& settings) const;
+  std::error_code DispatchCompressedBlob(int op_type, ObjSettings* settings, size_t* keys_loaded);
+
+  // Dispatches the items of decoded blobs in order until at most max_pending blobs are left.
+  std::error_code ApplyDecodedBlobs(size_t max_pending, ObjSettings* settings,
+                                    size_t* keys_loaded);
+
+  // Loads a blob that could not be decoded in parallel on the loading fiber.
+  std::error_code LoadCompressedBlob(const DecodedBlob& blob, ObjSettings* settings,
+                                     size_t* keys_loaded);
 
   std::error_code LoadKeyValPair(int type, ObjSettings* settings);
+  void DispatchItem(Item* item);
+  void SelectDb(DbIndex dbid);
   // Returns whether to discard the read key pair.
   bool ShouldDiscardKey(std::string_view key, ObjSettings* settings) const;
   void ResizeDb(size_t key_num, size_t expire_num);
   std::error_code HandleAux();
+  std::error_code HandleSearchIndex();
+  std::error_code HandleJournalPosition();
 
   std::error_code VerifyChecksum();
 
@@ -331,6 +360,9 @@ class RdbLoader : protected RdbLoaderBase {
 
   DbIndex cur_db_index_ = 0;
   bool pause_ = false;
+  bool parallel_decode_ = false;
+  ShardId next_decode_shard_ = 0;
+  std::deque<std::shared_ptr<DecodedBlob>> decoded_blobs_;
   bool is_tiered_enabled_ = false;
   AggregateError ec_;
 
@@ -390,7 +390,16 @@ error_code RdbSerializer::SaveListObject(const PrimeValue& pv) {
 
       RETURN_ON_ERR(SaveLzfBlob(Bytes{reinterpret_cast<uint8_t*>(data), compress_len}, node->sz));
     } else {
-      RETURN_ON_ERR(SaveString(node->entry, node->sz));
+      string_view entry{reinterpret_cast<const char*>(node->entry), node->sz};
+
+      // LZ4 and ZSTD compressed QList nodes have no rdb encoding, so they are saved uncompressed.
+      string decoded;
+      if (node->encoding != QUICKLIST_NODE_ENCODING_RAW) {
+        decoded = QList::UncompressedEntry(reinterpret_cast<const QList::Node*>(node));
+        entry = decoded;
+      }
+
+      RETURN_ON_ERR(SaveString(entry));
       FlushState flush_state = FlushState::kFlushMidEntry;
       if (node->next == nullptr)
         flush_state = FlushState::kFlushEndEntry;
@@ -787,6 +796,38 @@ error_code RdbSerializer::SendJournalOffset(uint64_t journal_offset) {
   return WriteRaw(buf);
 }
 
+error_code RdbSerializer::SaveSearchIndexStart(uint32_t shard_id, uint32_t shard_count,
+                                               string_view name) {
+  VLOG(1) << "SaveSearchIndex " << name << " of shard " << shard_id;
+  RETURN_ON_ERR(WriteOpcode(RDB_OPCODE_SEARCH_INDEX));
+  RETURN_ON_ERR(SaveLen(shard_id));
+  RETURN_ON_ERR(SaveLen(shard_count));
+  return SaveString(name);
+}
+
+error_code RdbSerializer::SaveSearchIndexChunk(string_view chunk) {
+  DCHECK(!chunk.empty());
+  RETURN_ON_ERR(SaveString(chunk));
+  FlushIfNeeded(FlushState::kFlushMidEntry);
+  return error_code{};
+}
+
+error_code RdbSerializer::SaveSearchIndexEnd(bool complete) {
+  RETURN_ON_ERR(SaveString(string_view{}));
+  RETURN_ON_ERR(SaveLen(complete));
+  FlushIfNeeded(FlushState::kFlushEndEntry);
+  return error_code{};
+}
+
+error_code RdbSerializer::SaveJournalPosition(uint32_t shard_id, uint32_t shard_count,
+                                              uint64_t lsn) {
+  VLOG(1) << "SaveJournalPosition " << lsn << " of shard " << shard_id;
+  RETURN_ON_ERR(WriteOpcode(RDB_OPCODE_JOURNAL_POSITION));
+  RETURN_ON_ERR(SaveLen(shard_id));
+  RETURN_ON_ERR(SaveLen(shard_count));
+  return SaveLen(lsn);
+}
+
 error_code SerializerBase::SendFullSyncCut() {
   VLOG(1) << "SendFullSyncCut";
   RETURN_ON_ERR(WriteOpcode(RDB_OPCODE_FULLSYNC_END));
@@ -903,6 +944,17 @@ void SerializerBase::DumpObject(const CompactObj& obj, io::StringSink* out) {
   CHECK_GT(out->str().size(), 10u);
 }
 
+void SerializerBase::SerializeObject(const CompactObj& obj, io::StringSink* out) {
+  RdbSerializer serializer(CompressionMode::NONE);
+
+  std::error_code ec = serializer.WriteOpcode(RdbObjectType(obj));
+  CHECK(!ec);
+  ec = serializer.SaveValue(obj);
+  CHECK(!ec);
+  ec = serializer.FlushToSink(out, SerializerBase::FlushState::kFlushEndEntry);
+  CHECK(!ec);
+}
+
 size_t SerializerBase::SerializedLen() const {
   return mem_buf_.InputLen();
 }
@@ -1242,7 +1294,11 @@ void RdbSaver::Impl::StartSnapshotting(bool stream_journal, ExecutionState* cntx
   const auto allow_flush = (save_mode_ != SaveMode::RDB) ? SliceSnapshot::SnapshotFlush::kAllow
                                                          : SliceSnapshot::SnapshotFlush::kDisallow;
 
-  s->Start(stream_journal, allow_flush);
+  // Search indices and journal positions are restored only from per-shard snapshot files.
+  // During replication the journal changes applied during the full sync would desync them.
+  const bool save_shard_state = save_mode_ == SaveMode::SINGLE_SHARD && !stream_journal;
+
+  s->Start(stream_journal, allow_flush, save_shard_state);
 }
 
 void RdbSaver::Impl::StartIncrementalSnapshotting(LSN start_lsn, ExecutionState* cntx,
@@ -159,6 +159,10 @@ class SerializerBase {
   // Dumps `obj` in DUMP command format into `out`. Uses default compression mode.
   static void DumpObject(const CompactObj& obj, io::StringSink* out);
 
+  // Appends the type and the uncompressed value of `obj` to `out`, without the DUMP footer.
+  // The result can be loaded back with RdbLoaderBase::LoadObject.
+  static void SerializeObject(const CompactObj& obj, io::StringSink* out);
+
   // Internal buffer size. Might shrink after flush due to compression.
   size_t SerializedLen() const;
 
@@ -239,6 +243,18 @@ class RdbSerializer : public SerializerBase {
 
   std::error_code SendJournalOffset(uint64_t journal_offset);
 
+  // Write a search index serialized by ShardDocIndex::Serialize, see RDB_OPCODE_SEARCH_INDEX.
+  // The data is passed in chunks between SaveSearchIndexStart and SaveSearchIndexEnd, which
+  // marks whether the index was serialized completely.
+  // Chunks and the end might preempt if flush_fun_ is used.
+  std::error_code SaveSearchIndexStart(uint32_t shard_id, uint32_t shard_count,
+                                       std::string_view name);
+  std::error_code SaveSearchIndexChunk(std::string_view chunk);
+  std::error_code SaveSearchIndexEnd(bool complete);
+
+  // Writes the journal position of the shard, see RDB_OPCODE_JOURNAL_POSITION.
+  std::error_code SaveJournalPosition(uint32_t shard_id, uint32_t shard_count, uint64_t lsn);
+
   size_t GetTempBufferSize() const override;
   std::error_code SendEofAndChecksum();
 
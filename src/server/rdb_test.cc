@@ -34,6 +34,7 @@ ABSL_DECLARE_FLAG(int32, list_compress_depth);
 ABSL_DECLARE_FLAG(int32, list_max_listpack_size);
 ABSL_DECLARE_FLAG(dfly::CompressionMode, compression_mode);
 ABSL_DECLARE_FLAG(bool, rdb_ignore_expiry);
+ABSL_DECLARE_FLAG(bool, rdb_load_parallel_decode);
 
 namespace dfly {
 
@@ -199,6 +200,34 @@ TEST_F(RdbTest, RdbLoaderOnReadCompressedDataShouldNotEnterEnsureReadFlow) {
   ASSERT_EQ(resp, "OK");
 }
 
+TEST_F(RdbTest, ParallelDecodeCompressedBlobs) {
+  SetFlag(&FLAGS_compression_mode, CompressionMode::MULTI_ENTRY_LZ4);
+  Run({"debug", "populate", "20000"});
+  Run({"select", "1"});
+  Run({"debug", "populate", "10000", "db1key"});
+  Run({"pexpire", "db1key:1", "1000000"});
+  Run({"set", "mc", "val"});
+  Run({"stick", "mc"});
+
+  for (bool parallel : {true, false}) {
+    SetFlag(&FLAGS_rdb_load_parallel_decode, parallel);
+    RespExpr resp = Run({"save", "df"});
+    ASSERT_EQ(resp, "OK");
+
+    auto save_info = service_->server_family().GetLastSaveInfo();
+    resp = Run({"dfly", "load", save_info.file_name});
+    ASSERT_EQ(resp, "OK");
+
+    Run({"select", "0"});
+    EXPECT_EQ(20000, CheckedInt({"dbsize"}));
+    Run({"select", "1"});
+    EXPECT_EQ(10001, CheckedInt({"dbsize"}));
+    EXPECT_GT(CheckedInt({"pttl", "db1key:1"}), 0);
+    EXPECT_THAT(Run({"stick", "mc"}), IntArg(0));
+  }
+  SetFlag(&FLAGS_rdb_load_parallel_decode, true);
+}
+
 TEST_F(RdbTest, SaveLoadSticky) {
   Run({"set", "a", "1"});
   Run({"set", "b", "2"});
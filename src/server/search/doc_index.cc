@@ -12,6 +12,7 @@
 #include "base/logging.h"
 #include "core/overloaded.h"
 #include "core/search/indices.h"
+#include "core/search/serialization.h"
 #include "server/engine_shard_set.h"
 #include "server/search/doc_accessors.h"
 #include "server/server_state.h"
@@ -50,6 +51,33 @@ void TraverseAllMatching(const DocIndex& index, const OpArgs& op_args, F&& f) {
   } while (cursor);
 }
 
+// Indices access documents directly, so documents offloaded to tiered storage are loaded back
+// to memory. Lookups fetch offloaded values and cancel their pending stashes.
+void MaterializeOffloadedDocs(const OpArgs& op_args) {
+  if (!op_args.shard->tiered_storage())
+    return;
+
+  auto& db_slice = op_args.GetDbSlice();
+  auto [prime_table, _] = db_slice.GetTables(op_args.db_cntx.db_index);
+
+  vector<string> keys;
+  auto cb = [&](PrimeTable::iterator it) {
+    const PrimeValue& pv = it->second;
+    bool offloaded = pv.IsExternal() || pv.HasStashPending();
+    if (offloaded && (pv.ObjType() == OBJ_HASH || pv.ObjType() == OBJ_JSON))
+      keys.push_back(it->first.ToString());
+  };
+
+  PrimeTable::Cursor cursor;
+  do {
+    cursor = prime_table->Traverse(cursor, cb);
+  } while (cursor);
+
+  // Might block on reads of offloaded values.
+  for (const string& key : keys)
+    db_slice.FindReadOnly(op_args.db_cntx, key);
+}
+
 }  // namespace
 
 bool SerializedSearchDoc::operator<(const SerializedSearchDoc& other) const {
@@ -112,9 +140,19 @@ string DocIndexInfo::BuildRestoreCommand() const {
     Overloaded info{
         [](monostate) {},
         [out = &out](const search::SchemaField::VectorParams& params) {
-          auto sim = params.sim == search::VectorSimilarity::L2 ? "L2" : "COSINE";
-          absl::StrAppend(out, " ", params.use_hnsw ? "HNSW" : "FLAT", " 6 ", "DIM ", params.dim,
-                          " DISTANCE_METRIC ", sim, " INITIAL_CAP ", params.capacity);
+          string_view sim = "L2";
+          if (params.sim == search::VectorSimilarity::IP)
+            sim = "IP";
+          else if (params.sim == search::VectorSimilarity::COSINE)
+            sim = "COSINE";
+          bool quantized = params.quantization == search::VectorQuantization::INT8;
+          size_t num_args = 6 + (quantized ? 2 : 0) + (params.rerank_factor ? 2 : 0);
+          absl::StrAppend(out, " ", params.use_hnsw ? "HNSW" : "FLAT", " ", num_args, " DIM ",
+                          params.dim, " DISTANCE_METRIC ", sim, " INITIAL_CAP ", params.capacity);
+          if (quantized)
+            absl::StrAppend(out, " QUANTIZATION INT8");
+          if (params.rerank_factor)
+            absl::StrAppend(out, " RERANK ", params.rerank_factor);
         },
         [out = &out](const search::SchemaField::TagParams& params) {
           absl::StrAppend(out, " ", "SEPARATOR", " ", string{params.separator});
@@ -170,6 +208,51 @@ size_t ShardDocIndex::DocKeyIndex::Size() const {
   return ids_.size();
 }
 
+bool ShardDocIndex::DocKeyIndex::Contains(string_view key) const {
+  return ids_.contains(key);
+}
+
+bool ShardDocIndex::DocKeyIndex::Serialize(search::BinaryWriter* out) const {
+  out->Write<uint64_t>(keys_.size());
+  for (const auto& key : keys_) {
+    if (!out->Checkpoint())
+      return false;
+    out->WriteString(key);
+  }
+
+  out->Write<uint64_t>(free_ids_.size());
+  return out->WriteBytesChunked(free_ids_.data(), free_ids_.size() * sizeof(DocId));
+}
+
+bool ShardDocIndex::DocKeyIndex::Deserialize(search::BinaryReader* in) {
+  uint64_t size = 0;
+  if (!in->ReadSize(&size, sizeof(uint64_t)))
+    return false;
+
+  keys_.resize(size);
+  for (DocId id = 0; id < size; id++) {
+    string_view key;
+    if (!in->ReadString(&key))
+      return false;
+
+    // Removed keys are empty, their ids are in free_ids_
+    keys_[id] = key;
+    if (!key.empty() && !ids_.emplace(key, id).second)
+      return false;
+  }
+  last_id_ = size;
+
+  if (!in->ReadSize(&size, sizeof(DocId)))
+    return false;
+
+  free_ids_.resize(size);
+  for (DocId& id : free_ids_) {
+    if (!in->Read(&id) || id >= keys_.size() || !keys_[id].empty())
+      return false;
+  }
+  return ids_.size() + free_ids_.size() == keys_.size();
+}
+
 uint8_t DocIndex::GetObjCode() const {
   return type == JSON ? OBJ_JSON : OBJ_HASH;
 }
@@ -183,6 +266,7 @@ ShardDocIndex::ShardDocIndex(shared_ptr<const DocIndex> index)
 }
 
 void ShardDocIndex::Rebuild(const OpArgs& op_args, PMR_NS::memory_resource* mr) {
+  version_++;
   key_index_ = DocKeyIndex{};
   indices_.emplace(base_->schema, base_->options, mr, &synonyms_);
 
@@ -198,8 +282,54 @@ void ShardDocIndex::Rebuild(const OpArgs& op_args, PMR_NS::memory_resource* mr)
   VLOG(1) << "Indexed " << key_index_.Size() << " docs on " << base_->prefix;
 }
 
+// Synonyms are not part of the snapshot, so indices with synonym groups are always rebuilt.
+bool ShardDocIndex::Serialize(search::BinaryWriter* out) const {
+  if (!indices_ || !synonyms_.GetGroups().empty())
+    return false;
+
+  return key_index_.Serialize(out) && indices_->Serialize(out);
+}
+
+bool ShardDocIndex::Restore(const OpArgs& op_args, string_view data,
+                            PMR_NS::memory_resource* mr) {
+  version_++;
+  search::BinaryReader reader{data};
+  key_index_ = DocKeyIndex{};
+  indices_.emplace(base_->schema, base_->options, mr, &synonyms_);
+
+  bool restored = key_index_.Deserialize(&reader) && indices_->Deserialize(&reader) &&
+                  reader.Empty() && key_index_.Size() == indices_->GetAllDocs().size();
+
+  // Documents could expire before or while loading, so make sure all of them still exist.
+  if (restored) {
+    vector<string> keys;
+    keys.reserve(key_index_.Size());
+    key_index_.ForEachKey([&keys](string_view key) { keys.emplace_back(key); });
+
+    auto& db_slice = op_args.GetDbSlice();
+    for (const string& key : keys) {
+      // Expired documents are removed from the index by the deletion callback during lookup.
+      auto it = db_slice.FindReadOnly(op_args.db_cntx, key, base_->GetObjCode());
+      if ((!it || !IsValid(*it)) && key_index_.Contains(key)) {
+        restored = false;
+        break;
+      }
+    }
+  }
+
+  if (!restored) {
+    key_index_ = DocKeyIndex{};
+    indices_.reset();
+    return false;
+  }
+
+  VLOG(1) << "Restored " << key_index_.Size() << " docs on " << base_->prefix;
+  return true;
+}
+
 void ShardDocIndex::RebuildForGroup(const OpArgs& op_args, const std::string_view& group_id,
                                     const std::vector<std::string_view>& terms) {
+  version_++;
   if (!indices_)
     return;
 
@@ -246,6 +376,7 @@ void ShardDocIndex::RebuildForGroup(const OpArgs& op_args, const std::string_vie
 }
 
 void ShardDocIndex::AddDoc(string_view key, const DbContext& db_cntx, const PrimeValue& pv) {
+  version_++;
   if (!indices_)
     return;
 
@@ -257,12 +388,13 @@ void ShardDocIndex::AddDoc(string_view key, const DbContext& db_cntx, const Prim
 }
 
 void ShardDocIndex::RemoveDoc(string_view key, const DbContext& db_cntx, const PrimeValue& pv) {
+  version_++;
   if (!indices_)
     return;
 
-  auto accessor = GetAccessor(db_cntx, pv);
   auto id = key_index_.Remove(key);
   if (id) {
+    auto accessor = GetAccessor(db_cntx, pv);
     indices_->Remove(id.value(), *accessor);
   }
 }
@@ -285,7 +417,18 @@ SearchFieldsList ToSV(const search::Schema& schema, const std::optional<SearchFi
 SearchResult ShardDocIndex::Search(const OpArgs& op_args, const SearchParams& params,
                                    search::SearchAlgorithm* search_algo) const {
   auto& db_slice = op_args.GetDbSlice();
-  auto search_results = search_algo->Search(&*indices_, params.limit_offset + params.limit_total);
+
+  // Quantized vector indices re-rank their KNN candidates by the original document vectors.
+  search::VectorLoader vector_loader = [&](DocId id,
+                                           string_view field) -> optional<search::OwnedFtVector> {
+    auto it = db_slice.FindReadOnly(op_args.db_cntx, key_index_.Get(id), base_->GetObjCode());
+    if (!it || !IsValid(*it))
+      return nullopt;
+    return GetAccessor(op_args.db_cntx, (*it)->second)->GetVector(field);
+  };
+
+  auto search_results =
+      search_algo->Search(&*indices_, params.limit_offset + params.limit_total, &vector_loader);
 
   if (!search_results.error.empty())
     return SearchResult{facade::ErrorReply{std::move(search_results.error)}};
@@ -451,11 +594,14 @@ void ShardDocIndices::InitIndex(const OpArgs& op_args, std::string_view name,
                                 shared_ptr<const DocIndex> index_ptr) {
   auto shard_index = make_unique<ShardDocIndex>(std::move(index_ptr));
   auto [it, _] = indices_.emplace(name, std::move(shard_index));
+  version_++;
 
   // Don't build while loading, shutting down, etc.
   // After loading, indices are rebuilt separately
-  if (ServerState::tlocal()->gstate() == GlobalState::ACTIVE)
+  if (ServerState::tlocal()->gstate() == GlobalState::ACTIVE) {
+    MaterializeOffloadedDocs(op_args);
     it->second->Rebuild(op_args, &local_mr_);
+  }
 
   op_args.GetDbSlice().SetDocDeletionCallback(
       [this](string_view key, const DbContext& cntx, const PrimeValue& pv) {
@@ -470,6 +616,7 @@ bool ShardDocIndices::DropIndex(string_view name) {
 
   DropIndexCache(*it->second);
   indices_.erase(it);
+  version_++;
 
   return true;
 }
@@ -479,6 +626,7 @@ void ShardDocIndices::DropAllIndices() {
     DropIndexCache(*it->second);
   }
   indices_.clear();
+  version_++;
 }
 
 void ShardDocIndices::DropIndexCache(const dfly::ShardDocIndex& shard_doc_index) {
@@ -488,8 +636,22 @@ void ShardDocIndices::DropIndexCache(const dfly::ShardDocIndex& shard_doc_index)
 }
 
 void ShardDocIndices::RebuildAllIndices(const OpArgs& op_args) {
-  for (auto& [_, ptr] : indices_)
+  if (!indices_.empty())
+    MaterializeOffloadedDocs(op_args);
+
+  for (auto& [name, ptr] : indices_) {
+    if (auto it = serialized_indices_.find(name); it != serialized_indices_.end()) {
+      if (ptr->Restore(op_args, it->second, &local_mr_))
+        continue;
+      LOG(WARNING) << "Could not restore search index " << name << ", rebuilding it";
+    }
     ptr->Rebuild(op_args, &local_mr_);
+  }
+  serialized_indices_.clear();
+}
+
+void ShardDocIndices::AddSerializedIndex(string name, string data) {
+  serialized_indices_[std::move(name)] = std::move(data);
 }
 
 vector<string> ShardDocIndices::GetIndexNames() const {
@@ -500,6 +662,14 @@ vector<string> ShardDocIndices::GetIndexNames() const {
   return names;
 }
 
+bool ShardDocIndices::MatchesAnyIndex(string_view key, unsigned obj_code) const {
+  for (const auto& [_, index] : indices_) {
+    if (index->Matches(key, obj_code))
+      return true;
+  }
+  return false;
+}
+
 void ShardDocIndices::AddDoc(string_view key, const DbContext& db_cntx, const PrimeValue& pv) {
   for (auto& [_, index] : indices_) {
     if (index->Matches(key, pv.ObjType()))
@@ -213,6 +213,16 @@ class ShardDocIndex {
 
     std::string_view Get(DocId id) const;
     size_t Size() const;
+    bool Contains(std::string_view key) const;
+
+    bool Serialize(search::BinaryWriter* out) const;
+    bool Deserialize(search::BinaryReader* in);
+
+    // Calls f(key) for every indexed key.
+    template <typename F> void ForEachKey(F&& f) const {
+      for (const auto& [key, _] : ids_)
+        f(key);
+    }
 
    private:
     absl::flat_hash_map<std::string, DocId> ids_;
@@ -257,15 +267,30 @@ class ShardDocIndex {
   void RebuildForGroup(const OpArgs& op_args, const std::string_view& group_id,
                        const std::vector<std::string_view>& terms);
 
+  // Serializes the document ids and all field indices, so that the index can be restored
+  // from a snapshot without re-indexing. Returns false if the index can't be serialized or
+  // a checkpoint of the writer failed, the index must not be accessed after that.
+  bool Serialize(search::BinaryWriter* out) const;
+
+  // Incremented on every change of the index.
+  uint64_t version() const {
+    return version_;
+  }
+
  private:
   // Clears internal data. Traverses all matching documents and assigns ids.
   void Rebuild(const OpArgs& op_args, PMR_NS::memory_resource* mr);
 
+  // Restores the state written by Serialize(). Returns false if the data is malformed or does
+  // not match the loaded documents, the index must be rebuilt in this case.
+  bool Restore(const OpArgs& op_args, std::string_view data, PMR_NS::memory_resource* mr);
+
  private:
   std::shared_ptr<const DocIndex> base_;
   std::optional<search::FieldIndices> indices_;
   DocKeyIndex key_index_;
   Synonyms synonyms_;
+  uint64_t version_ = 0;
 };
 
 // Stores shard doc indices by name on a specific shard.
@@ -287,11 +312,27 @@ class ShardDocIndices {
   // Drop all indices
   void DropAllIndices();
 
-  // Rebuild all indices
+  // Rebuild all indices. Indices with serialized data are restored from it instead.
   void RebuildAllIndices(const OpArgs& op_args);
 
+  // Stores the serialized state of an index loaded from a snapshot until RebuildAllIndices.
+  void AddSerializedIndex(std::string name, std::string data);
+
   std::vector<std::string> GetIndexNames() const;
 
+  bool HasIndices() const {
+    return !indices_.empty();
+  }
+
+  // Returns true if the key is a document of some index.
+  bool MatchesAnyIndex(std::string_view key, unsigned obj_code) const;
+
+  // Incremented when indices are created or dropped. Together with ShardDocIndex::version() it
+  // detects whether an index changed while it was serialized with preemptions.
+  uint64_t version() const {
+    return version_;
+  }
+
   void AddDoc(std::string_view key, const DbContext& db_cnt, const PrimeValue& pv);
   void RemoveDoc(std::string_view key, const DbContext& db_cnt, const PrimeValue& pv);
 
@@ -304,6 +345,8 @@ class ShardDocIndices {
  private:
   MiMemoryResource local_mr_;
   absl::flat_hash_map<std::string, std::unique_ptr<ShardDocIndex>> indices_;
+  absl::flat_hash_map<std::string, std::string> serialized_indices_;
+  uint64_t version_ = 0;
 };
 
 }  // namespace dfly
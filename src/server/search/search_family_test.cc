@@ -1966,6 +1966,88 @@ TEST_F(SearchFamilyTest, KnnSearchOptions) {
   EXPECT_THAT(resp, AreDocIds("doc:1"));
 }
 
+TEST_F(SearchFamilyTest, KnnQuantized) {
+  Run({"JSON.SET", "doc:1", ".", R"({"vector": [0.1, 0.2, 0.3, 0.4]})"});
+  Run({"JSON.SET", "doc:2", ".", R"({"vector": [0.5, 0.6, 0.7, 0.8]})"});
+  Run({"JSON.SET", "doc:3", ".", R"({"vector": [0.9, 0.1, 0.4, 0.3]})"});
+
+  for (string_view algo : {"FLAT", "HNSW"}) {
+    string index = absl::StrCat("idx_", algo);
+    auto resp = Run({"FT.CREATE", index, "ON", "JSON", "PREFIX", "1", "doc:", "SCHEMA", "$.vector",
+                     "AS", "vector", "VECTOR", algo, "10", "TYPE", "FLOAT32", "DIM", "4",
+                     "DISTANCE_METRIC", "L2", "QUANTIZATION", "INT8", "RERANK", "2"});
+    EXPECT_EQ(resp, "OK");
+
+    // Distances to doc:1 and doc:3 differ by less than the quantization step of the query
+    std::string query_vector("\x00\x00\x00\x3f\x00\x00\x00\x40\x00\x00\x00\x41\x00\x00\x80\x42",
+                             16);
+    resp = Run({"FT.SEARCH", index, "*=>[KNN 3 @vector $query_vector]", "PARAMS", "2",
+                "query_vector", query_vector, "NOCONTENT"});
+    EXPECT_THAT(resp, IsArray(IntArg(3), "doc:2", "doc:1", "doc:3")) << algo;
+
+    resp = Run({"FT.CREATE", absl::StrCat(index, "_bad"), "SCHEMA", "v", "VECTOR", algo, "4",
+                "DIM", "4", "QUANTIZATION", "INT4"});
+    EXPECT_THAT(resp, ErrArg("Parse error of vector parameters")) << algo;
+  }
+}
+
+TEST_F(SearchFamilyTest, RestoreIndicesOnReload) {
+  for (unsigned i = 0; i < 20; i++) {
+    string vec(16, '\0');
+    float values[4] = {float(i), float(i % 3), 1.0f, float(20 - i)};
+    memcpy(vec.data(), values, sizeof(values));
+    Run({"HSET", absl::StrCat("doc:", i), "title", absl::StrCat("title ", i % 2 ? "odd" : "even"),
+         "tag", absl::StrCat("t", i % 4), "num", absl::StrCat(i), "vec", vec});
+  }
+
+  auto resp = Run({"FT.CREATE", "idx", "ON", "HASH", "PREFIX", "1", "doc:", "SCHEMA", "title",
+                   "TEXT", "tag", "TAG", "num", "NUMERIC", "SORTABLE", "vec", "VECTOR", "HNSW", "6",
+                   "TYPE", "FLOAT32", "DIM", "4", "DISTANCE_METRIC", "L2"});
+  EXPECT_EQ(resp, "OK");
+
+  auto check_queries = [this] {
+    auto resp = Run({"FT.SEARCH", "idx", "odd @tag:{t1}", "NOCONTENT"});
+    EXPECT_THAT(resp, IsUnordArray(IntArg(5), "doc:1", "doc:5", "doc:9", "doc:13", "doc:17"));
+
+    resp = Run({"FT.SEARCH", "idx", "@num:[5 8]", "NOCONTENT"});
+    EXPECT_THAT(resp, IsUnordArray(IntArg(4), "doc:5", "doc:6", "doc:7", "doc:8"));
+
+    resp = Run({"FT.SEARCH", "idx", "*=>[KNN 3 @vec $q]", "PARAMS", "2", "q", string(16, '\0'),
+                "NOCONTENT"});
+    EXPECT_THAT(resp, IsArray(IntArg(3), "doc:10", "doc:9", "doc:11"));
+  };
+
+  check_queries();
+  EXPECT_EQ(Run({"DEBUG", "RELOAD"}), "OK");
+  check_queries();
+
+  // The restored index must keep tracking changes
+  Run({"HSET", "doc:100", "title", "odd", "tag", "t1", "num", "7"});
+  Run({"DEL", "doc:1"});
+  resp = Run({"FT.SEARCH", "idx", "odd @tag:{t1}", "NOCONTENT"});
+  EXPECT_THAT(resp, IsUnordArray(IntArg(5), "doc:5", "doc:9", "doc:13", "doc:17", "doc:100"));
+}
+
+TEST_F(SearchFamilyTest, RestoreLargeIndexOnReload) {
+  Run({"FT.CREATE", "idx", "ON", "HASH", "PREFIX", "1", "doc:", "SCHEMA", "tag", "TAG", "num",
+       "NUMERIC"});
+
+  // Large enough to be streamed in multiple chunks
+  const size_t kNumDocs = 10000;
+  for (size_t i = 0; i < kNumDocs; i++) {
+    Run({"HSET", absl::StrCat("doc:", i), "tag", absl::StrCat("t", i % 10), "num",
+         absl::StrCat(i)});
+  }
+
+  EXPECT_EQ(Run({"DEBUG", "RELOAD"}), "OK");
+
+  auto resp = Run({"FT.SEARCH", "idx", "@tag:{t3} @num:[0 40]", "NOCONTENT"});
+  EXPECT_THAT(resp, IsUnordArray(IntArg(4), "doc:3", "doc:13", "doc:23", "doc:33"));
+
+  auto info = Run({"FT.INFO", "idx"});
+  EXPECT_THAT(info, IsArray(_, _, _, _, _, _, "num_docs", IntArg(kNumDocs)));
+}
+
 TEST_F(SearchFamilyTest, InvalidAggregateOptions) {
   Run({"JSON.SET", "j1", ".", R"({"field1":"first","field2":"second"})"});
   Run({"FT.CREATE", "idx", "ON", "JSON", "SCHEMA", "$.field1", "AS", "field1", "TEXT", "$.field2",
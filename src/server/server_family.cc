@@ -5,6 +5,7 @@
 #include "server/server_family.h"
 
 #include <absl/cleanup/cleanup.h>
+#include <absl/container/flat_hash_set.h>
 #include <absl/random/random.h>  // for master_replid_ generation.
 #include <absl/strings/match.h>
 #include <absl/strings/str_join.h>
@@ -33,6 +34,7 @@ extern "C" {
 #include "core/compact_object.h"
 #include "facade/cmd_arg_parser.h"
 #include "facade/dragonfly_connection.h"
+#include "facade/framed_transport.h"
 #include "facade/reply_builder.h"
 #include "io/file_util.h"
 #include "io/proc_reader.h"
@@ -43,11 +45,15 @@ extern "C" {
 #include "server/debugcmd.h"
 #include "server/detail/save_stages_controller.h"
 #include "server/detail/snapshot_storage.h"
+#include "server/detail/transport_codec.h"
 #include "server/dflycmd.h"
 #include "server/engine_shard_set.h"
 #include "server/error.h"
 #include "server/generic_family.h"
+#include "server/journal/executor.h"
 #include "server/journal/journal.h"
+#include "server/journal/serializer.h"
+#include "server/journal/tx_executor.h"
 #include "server/main_service.h"
 #include "server/memory_cmd.h"
 #include "server/multi_command_squasher.h"
@@ -98,6 +104,15 @@ ABSL_FLAG(uint32_t, maxclients, 64000, "Maximum number of concurrent clients all
 ABSL_FLAG(string, save_schedule, "", "the flag is deprecated, please use snapshot_cron instead");
 ABSL_FLAG(CronExprFlag, snapshot_cron, {},
           "cron expression for the time to save a snapshot, crontab style");
+ABSL_FLAG(string, journal_dir, "",
+          "If set, the journal of every shard is persisted to this directory and replayed on "
+          "startup on top of the loaded snapshot. Requires io_uring.");
+ABSL_FLAG(string, journal_fsync, "everysec",
+          "When to sync the journal files to disk: always, everysec or no. With always, writes "
+          "reply only after their journal entries are synced.");
+ABSL_FLAG(uint64_t, journal_max_segment_size, 1ULL << 28,
+          "Size after which a new journal segment is started, 0 to disable rotation. Segments "
+          "that are covered by a snapshot are removed after the snapshot is saved.");
 ABSL_FLAG(bool, df_snapshot_format, true,
           "if true, save in dragonfly-specific snapshotting format");
 ABSL_FLAG(int, epoll_file_threads, 0,
@@ -111,6 +126,12 @@ ABSL_FLAG(int32_t, slowlog_log_slower_than, 10000,
           "Add commands slower than this threshold to slow log. The value is expressed in "
           "microseconds and if it's negative - disables the slowlog.");
 ABSL_FLAG(uint32_t, slowlog_max_len, 20, "Slow log maximum length.");
+ABSL_FLAG(uint32_t, latency_monitor_threshold, 0,
+          "Commands and internal events that take at least this many milliseconds are recorded "
+          "as latency spikes for the LATENCY command. 0 disables the latency monitor.");
+ABSL_FLAG(bool, latency_tracking, true,
+          "If true, tracks per-command latency histograms for LATENCY HISTOGRAM, "
+          "INFO LATENCYSTATS and the metrics endpoint.");
 
 ABSL_FLAG(string, s3_endpoint, "", "endpoint for s3 snapshots, default uses aws regional endpoint");
 ABSL_FLAG(bool, s3_use_https, true, "whether to use https for s3 endpoints");
@@ -276,6 +297,84 @@ std::shared_ptr<detail::SnapshotStorage> CreateCloudSnapshotStorage(std::string_
   }
 }
 
+journal::JournalFile::Options GetJournalFileOptions() {
+  journal::JournalFile::Options opts;
+  opts.dir = GetFlag(FLAGS_journal_dir);
+  CHECK(journal::ParseFsyncPolicy(GetFlag(FLAGS_journal_fsync), &opts.fsync));
+  opts.max_segment_size = GetFlag(FLAGS_journal_max_segment_size);
+  return opts;
+}
+
+// Reads the commands from the on-disk journal segments of a shard.
+class JournalSegmentsReader {
+ public:
+  JournalSegmentsReader(vector<journal::JournalSegment> segments, LSN start_lsn)
+      : segments_{std::move(segments)}, start_lsn_{start_lsn} {
+  }
+
+  // Returns the next command with LSN not below start_lsn or nullopt after the last segment.
+  optional<TransactionData> Next();
+
+  // LSN of the last read entry, 0 if none were read.
+  LSN last_lsn() const {
+    return last_lsn_;
+  }
+
+ private:
+  vector<journal::JournalSegment> segments_;
+  size_t next_segment_ = 0;
+  unique_ptr<io::FileSource> source_;
+  unique_ptr<journal::JournalFileReader> reader_;
+
+  LSN start_lsn_, last_lsn_ = 0;
+  string record_;
+};
+
+optional<TransactionData> JournalSegmentsReader::Next() {
+  while (true) {
+    if (!reader_) {
+      if (next_segment_ == segments_.size())
+        return nullopt;
+
+      const string& path = segments_[next_segment_++].path;
+      io::ReadonlyFileOrError file = fb2::OpenRead(path);
+      if (!file) {
+        LOG(ERROR) << "Could not open journal segment " << path << ": " << file.error().message();
+        continue;
+      }
+      source_ = make_unique<io::FileSource>(*file);
+      reader_ = make_unique<journal::JournalFileReader>(source_.get());
+    }
+
+    LSN lsn;
+    if (!reader_->Next(&lsn, &record_)) {
+      // Expected for the last segment if the server was not shut down gracefully.
+      LOG_IF(WARNING, reader_->corrupted())
+          << "Journal segment " << segments_[next_segment_ - 1].path
+          << " ends with an incomplete or corrupted record after LSN " << last_lsn_;
+      reader_.reset();
+      source_.reset();
+      continue;
+    }
+
+    if (lsn < start_lsn_ || lsn <= last_lsn_)
+      continue;
+
+    // Every record is self-contained, it starts with the selection of its database.
+    io::BytesSource bs{io::Buffer(record_)};
+    JournalReader journal_reader{&bs, 0};
+    auto entry = journal_reader.ReadEntry();
+    if (!entry) {
+      LOG(ERROR) << "Could not parse journal entry " << lsn << ": " << entry.error().message();
+      continue;
+    }
+
+    last_lsn_ = lsn;
+    if (entry->opcode == journal::Op::COMMAND || entry->opcode == journal::Op::EXPIRED)
+      return TransactionData::FromEntry(std::move(*entry));
+  }
+}
+
 // Check that if TLS is used at least one form of client authentication is
 // enabled. That means either using a password or giving a root
 // certificate for authenticating client certificates which will
@@ -385,7 +484,7 @@ void ClientTracking(CmdArgList args, SinkReplyBuilder* builder, ConnectionContex
         "Client tracking is currently not supported for RESP2. Please use RESP3.");
 
   CmdArgParser parser{args};
-  if (!parser.HasAtLeast(1) || args.size() > 3)
+  if (!parser.HasAtLeast(1))
     return builder->SendError(kSyntaxErr);
 
   bool is_on = false;
@@ -398,34 +497,58 @@ void ClientTracking(CmdArgList args, SinkReplyBuilder* builder, ConnectionContex
   }
 
   bool noloop = false;
+  bool bcast = false;
+  vector<string> prefixes;
 
-  if (parser.HasNext()) {
-    if (parser.Check("OPTIN")) {
+  while (parser.HasNext()) {
+    string_view prefix;
+    if (option == Tracking::NONE && parser.Check("OPTIN")) {
       option = Tracking::OPTIN;
-    } else if (parser.Check("OPTOUT")) {
+    } else if (option == Tracking::NONE && parser.Check("OPTOUT")) {
       option = Tracking::OPTOUT;
-    } else if (parser.Check("NOLOOP")) {
+    } else if (!noloop && parser.Check("NOLOOP")) {
       noloop = true;
+    } else if (!bcast && parser.Check("BCAST")) {
+      bcast = true;
+    } else if (parser.Check("PREFIX", &prefix)) {
+      prefixes.emplace_back(prefix);
     } else {
       return builder->SendError(kSyntaxErr);
     }
   }
 
-  if (parser.HasNext()) {
-    if (!noloop && parser.Check("NOLOOP")) {
-      noloop = true;
-    } else {
-      return builder->SendError(kSyntaxErr);
-    }
+  if (bcast && option != Tracking::NONE)
+    return builder->SendError("ERR OPTIN and OPTOUT are not compatible with BCAST");
+
+  if (!bcast && !prefixes.empty())
+    return builder->SendError("ERR PREFIX option requires BCAST mode to be enabled");
+
+  auto& tracking_info = cntx->conn_state.tracking_info_;
+  if (is_on && tracking_info.IsTrackingOn() && tracking_info.IsBcast() != bcast) {
+    return builder->SendError(
+        "ERR You can't switch BCAST mode on/off before disabling tracking for this client, and "
+        "then re-enabling it with a different mode.");
   }
 
+  // Drop the previous prefixes, tracking turned off or new prefixes replace them.
+  if (tracking_info.IsTrackingOn() && tracking_info.IsBcast())
+    cntx->ChangeBcastTracking(false);
+
   if (is_on) {
     ++cntx->subscriptions;
   }
 
-  cntx->conn_state.tracking_info_.SetClientTracking(is_on);
-  cntx->conn_state.tracking_info_.SetOption(option);
-  cntx->conn_state.tracking_info_.SetNoLoop(noloop);
+  sort(prefixes.begin(), prefixes.end());
+  prefixes.erase(unique(prefixes.begin(), prefixes.end()), prefixes.end());
+
+  tracking_info.SetClientTracking(is_on);
+  tracking_info.SetOption(option);
+  tracking_info.SetNoLoop(noloop);
+  tracking_info.SetBcast(is_on && bcast, std::move(prefixes));
+
+  if (tracking_info.IsBcast())
+    cntx->ChangeBcastTracking(true);
+
   return builder->SendOk();
 }
 
@@ -495,6 +618,35 @@ void ClientId(CmdArgList args, SinkReplyBuilder* builder, ConnectionContext* cnt
   return builder->SendLong(cntx->conn()->GetClientId());
 }
 
+void ClientCompression(CmdArgList args, SinkReplyBuilder* builder, ConnectionContext* cntx) {
+  constexpr uint32_t kDefaultMinSize = 1024;
+
+  CmdArgParser parser{args};
+  bool zstd = parser.MapNext("LZ4", false, "ZSTD", true);
+  uint32_t min_size = kDefaultMinSize;
+  if (parser.Check("MINSIZE"))
+    min_size = parser.Next<uint32_t>();
+
+  if (parser.HasNext())
+    return builder->SendError(kSyntaxErr);
+  if (auto err = parser.Error(); err)
+    return builder->SendError(err->MakeReply());
+
+  auto* conn = cntx->conn();
+  if (conn == nullptr || conn->IsFramedTransport())
+    return builder->SendError("ERR compression is already enabled");
+
+  // The client must wait for the reply before sending framed requests.
+  if (cntx->async_dispatch || cntx->conn_state.exec_info.IsRunning())
+    return builder->SendError("ERR CLIENT COMPRESSION can not be pipelined or used in MULTI");
+
+  unique_ptr<facade::FrameCodec> codec =
+      zstd ? detail::TransportCodec::CreateZstd() : detail::TransportCodec::CreateLZ4();
+
+  builder->SendOk();
+  conn->EnableFramedTransport(std::move(codec), min_size);
+}
+
 void ClientKill(CmdArgList args, absl::Span<facade::Listener*> listeners, SinkReplyBuilder* builder,
                 ConnectionContext* cntx) {
   std::function<bool(facade::Connection * conn)> evaluator;
@@ -635,6 +787,100 @@ uint64_t GetDelayMs(uint64_t ts) {
   return delay_ns;
 }
 
+struct MergedLatencyEvent {
+  vector<LatencyMonitor::Sample> samples;  // ordered by time
+  uint32_t max_ms = 0;
+};
+
+// Merges the latency spikes recorded on all threads, sorted by the event name.
+map<string, MergedLatencyEvent, less<>> MergeLatencyEvents(util::ProactorPool* pp) {
+  vector<absl::flat_hash_map<string, LatencyMonitor::Event>> events(pp->size());
+  pp->AwaitFiberOnAll([&](auto index, auto* context) {
+    events[index] = ServerState::tlocal()->GetLatencyMonitor().events();
+  });
+
+  map<string, MergedLatencyEvent, less<>> merged;
+  for (const auto& thread_events : events) {
+    for (const auto& [name, event] : thread_events) {
+      auto& dest = merged[name];
+      dest.max_ms = max(dest.max_ms, event.max_ms);
+      dest.samples.insert(dest.samples.end(), event.samples.begin(), event.samples.end());
+    }
+  }
+
+  for (auto& [_, event] : merged) {
+    auto& samples = event.samples;
+    sort(samples.begin(), samples.end(),
+         [](const auto& l, const auto& r) { return l.unix_ts_sec < r.unix_ts_sec; });
+
+    // Samples of the same second from different threads are merged like on a single thread.
+    size_t last = 0;
+    for (size_t i = 1; i < samples.size(); ++i) {
+      if (samples[i].unix_ts_sec == samples[last].unix_ts_sec)
+        samples[last].latency_ms = max(samples[last].latency_ms, samples[i].latency_ms);
+      else
+        samples[++last] = samples[i];
+    }
+    samples.resize(min(samples.size(), last + 1));
+
+    if (samples.size() > LatencyMonitor::kMaxSamples)
+      samples.erase(samples.begin(), samples.end() - LatencyMonitor::kMaxSamples);
+  }
+  return merged;
+}
+
+string_view LatencyEventAdvice(string_view event) {
+  if (event == "command")
+    return "Check SLOWLOG GET for the slow commands and LATENCY HISTOGRAM for their latency "
+           "distribution. Commands with O(N) complexity on big values block their thread.";
+  if (event == "expire-cycle")
+    return "Many keys expire at the same time. Consider spreading their expiration times.";
+  if (event == "eviction-cycle")
+    return "The eviction of keys takes long. Consider increasing maxmemory or lowering "
+           "max_eviction_per_heartbeat.";
+  if (event == "defrag-cycle")
+    return "Memory defragmentation takes long. Consider lowering "
+           "mem_defrag_page_utilization_threshold.";
+  if (event == "snapshot-change")
+    return "Writes during a snapshot serialize the buckets that were not saved yet. Big values "
+           "in these buckets delay the writes.";
+  if (event == "tiering-read")
+    return "Reads of offloaded values wait for the disk. Check the disk latency and consider "
+           "raising tiered_offload_threshold to keep more values in memory.";
+  if (event == "tiering-cycle")
+    return "Offloading values to disk takes long. Consider lowering tiered_storage_write_depth.";
+  return "";
+}
+
+string LatencyDoctorReport(const map<string, MergedLatencyEvent, less<>>& events) {
+  if (ServerState::tlocal()->latency_monitor_threshold_usec == UINT64_MAX)
+    return "The latency monitor is disabled. Set latency_monitor_threshold to the minimal "
+           "latency in milliseconds that should be reported to enable it.\n";
+
+  if (events.empty())
+    return "No latency spikes were observed since the latency monitor was enabled.\n";
+
+  string report = "Dragonfly observed the following latency spikes:\n\n";
+  unsigned index = 0;
+  for (const auto& [name, event] : events) {
+    uint64_t sum = 0;
+    for (const auto& sample : event.samples)
+      sum += sample.latency_ms;
+    size_t count = event.samples.size();
+
+    absl::StrAppend(&report, ++index, ". ", name, ": ", count, " latency spikes (average ",
+                    count ? sum / count : 0, "ms). Worst all time event ", event.max_ms, "ms.\n");
+    if (count > 1) {
+      uint64_t period = (event.samples.back().unix_ts_sec - event.samples.front().unix_ts_sec) /
+                        (count - 1);
+      absl::StrAppend(&report, "   Mean period between spikes: ", period, " sec.\n");
+    }
+    if (string_view advice = LatencyEventAdvice(name); !advice.empty())
+      absl::StrAppend(&report, "   ", advice, "\n");
+  }
+  return report;
+}
+
 }  // namespace
 
 void SlowLogGet(dfly::CmdArgList args, std::string_view sub_cmd, util::ProactorPool* pp,
@@ -820,6 +1066,18 @@ void SetSlowLogThreshold(util::ProactorPool& pool, int32_t val) {
   });
 }
 
+void SetLatencyMonitorThreshold(util::ProactorPool& pool, uint32_t val_ms) {
+  pool.AwaitFiberOnAll([val_ms](auto index, auto* context) {
+    ServerState::tlocal()->latency_monitor_threshold_usec =
+        val_ms == 0 ? UINT64_MAX : uint64_t(val_ms) * 1000;
+  });
+}
+
+void SetLatencyTracking(util::ProactorPool& pool, bool val) {
+  pool.AwaitFiberOnAll(
+      [val](auto index, auto* context) { ServerState::tlocal()->latency_tracking = val; });
+}
+
 void ServerFamily::Init(util::AcceptServer* acceptor, std::vector<facade::Listener*> listeners) {
   CHECK(acceptor_ == nullptr);
   acceptor_ = acceptor;
@@ -844,6 +1102,15 @@ void ServerFamily::Init(util::AcceptServer* acceptor, std::vector<facade::Listen
   config_registry.RegisterSetter<uint32_t>(
       "slowlog_max_len", [this](uint32_t val) { SetSlowLogMaxLen(service_.proactor_pool(), val); });
 
+  SetLatencyMonitorThreshold(service_.proactor_pool(),
+                             absl::GetFlag(FLAGS_latency_monitor_threshold));
+  config_registry.RegisterSetter<uint32_t>("latency_monitor_threshold", [this](uint32_t val) {
+    SetLatencyMonitorThreshold(service_.proactor_pool(), val);
+  });
+  SetLatencyTracking(service_.proactor_pool(), absl::GetFlag(FLAGS_latency_tracking));
+  config_registry.RegisterSetter<bool>(
+      "latency_tracking", [this](bool val) { SetLatencyTracking(service_.proactor_pool(), val); });
+
   // We only reconfigure TLS when the 'tls' config key changes. Therefore to
   // update TLS certs, first update tls_cert_file, then set 'tls true'.
   config_registry.RegisterMutable("tls", [this](const absl::CommandLineFlag& flag) {
@@ -880,6 +1147,25 @@ void ServerFamily::Init(util::AcceptServer* acceptor, std::vector<facade::Listen
     snapshot_storage_ = std::make_shared<detail::FileSnapshotStorage>(nullptr);
   }
 
+  if (!GetFlag(FLAGS_journal_dir).empty()) {
+    journal::FsyncPolicy policy;
+    if (!journal::ParseFsyncPolicy(GetFlag(FLAGS_journal_fsync), &policy)) {
+      LOG(ERROR) << "Invalid journal_fsync value " << GetFlag(FLAGS_journal_fsync);
+      exit(1);
+    }
+    if (pb_task_->GetKind() != ProactorBase::IOURING) {
+      LOG(ERROR) << "journal_dir requires io_uring";
+      exit(1);
+    }
+    // Created here, so that the shard threads do not block on it when opening the journal.
+    error_code ec;
+    fs::create_directories(GetFlag(FLAGS_journal_dir), ec);
+    if (ec) {
+      LOG(ERROR) << "Could not create journal_dir: " << ec.message();
+      exit(1);
+    }
+  }
+
   // check for '--replicaof' before loading anything
   if (ReplicaOfFlag flag = GetFlag(FLAGS_replicaof); flag.has_value()) {
     service_.proactor_pool().GetNextProactor()->Await(
@@ -909,11 +1195,12 @@ void ServerFamily::LoadFromSnapshot() {
 
   const auto load_path_result =
       snapshot_storage_->LoadPath(GetFlag(FLAGS_dir), GetFlag(FLAGS_dbfilename));
+  const bool restore_journal = !GetFlag(FLAGS_journal_dir).empty();
 
   if (load_path_result) {
     const std::string load_path = *load_path_result;
     if (!load_path.empty()) {
-      auto future = Load(load_path, LoadExistingKeys::kFail);
+      auto future = Load(load_path, LoadExistingKeys::kFail, restore_journal);
       load_fiber_ = service_.proactor_pool().GetNextProactor()->LaunchFiber([future]() mutable {
         // Wait for load to finish in a dedicated fiber.
         // Failure to load on start causes Dragonfly to exit with an error code.
@@ -922,6 +1209,7 @@ void ServerFamily::LoadFromSnapshot() {
           exit(1);
         }
       });
+      return;
     }
   } else {
     if (std::error_code(load_path_result.error()) == std::errc::no_such_file_or_directory) {
@@ -930,8 +1218,104 @@ void ServerFamily::LoadFromSnapshot() {
       util::fb2::LockGuard lk{loading_stats_mu_};
       loading_stats_.failed_restore_count++;
       LOG(ERROR) << "Failed to load snapshot: " << load_path_result.error().Format();
+
+      // The journal can't be replayed without its snapshot, keep the files untouched.
+      LOG_IF(ERROR, restore_journal) << "Journal persistence is disabled";
+      return;
+    }
+  }
+
+  if (restore_journal) {
+    service_.SwitchState(GlobalState::ACTIVE, GlobalState::LOADING);
+    load_fiber_ = service_.proactor_pool().GetNextProactor()->LaunchFiber([this] {
+      auto ec = RestoreJournal(false);
+      service_.SwitchState(GlobalState::LOADING, GlobalState::ACTIVE);
+      if (ec)
+        exit(1);
+    });
+  }
+}
+
+error_code ServerFamily::RestoreJournal(bool snapshot_loaded) {
+  const journal::JournalFile::Options opts = GetJournalFileOptions();
+
+  vector<JournalSegmentsReader> readers;
+  for (ShardId sid = 0; sid < shard_count(); ++sid) {
+    auto segments = journal::JournalFile::ListSegments(opts.dir, sid);
+    optional<LSN> snapshot_lsn = journal_->GetLoadedSnapshotPosition(sid);
+
+    // A snapshot without the journal position was saved without persisting the journal,
+    // so the existing segments do not continue it.
+    if (snapshot_loaded && !snapshot_lsn) {
+      LOG_IF(WARNING, !segments.empty())
+          << "Snapshot has no journal position for shard " << sid << ", discarding its journal";
+      segments.clear();
+    }
+
+    LSN start_lsn = snapshot_lsn.value_or(1);
+    LOG_IF(ERROR, !segments.empty() && segments.front().start_lsn > start_lsn)
+        << "Journal of shard " << sid << " misses the entries from " << start_lsn << " to "
+        << segments.front().start_lsn;
+    readers.emplace_back(std::move(segments), start_lsn);
+  }
+
+  // The commands of a shard touch only its keys, so the shards are replayed independently
+  // up to the global commands, which are executed once all shards reached them.
+  vector<optional<TransactionData>> heads(readers.size());
+  for (size_t i = 0; i < readers.size(); ++i)
+    heads[i] = readers[i].Next();
+
+  JournalExecutor executor{&service_};
+  size_t num_replayed = 0;
+  while (true) {
+    for (size_t i = 0; i < readers.size(); ++i) {
+      while (heads[i] && !heads[i]->IsGlobalCmd()) {
+        executor.Execute(heads[i]->dbid, heads[i]->command);
+        ++num_replayed;
+        heads[i] = readers[i].Next();
+      }
+    }
+
+    optional<TxId> global_txid;
+    for (const auto& head : heads) {
+      if (head && (!global_txid || head->txid < *global_txid))
+        global_txid = head->txid;
+    }
+    if (!global_txid)
+      break;
+
+    bool executed = false;
+    for (size_t i = 0; i < readers.size(); ++i) {
+      if (!heads[i] || heads[i]->txid != *global_txid)
+        continue;
+      if (!executed) {
+        executor.Execute(heads[i]->dbid, heads[i]->command);
+        ++num_replayed;
+        executed = true;
+      }
+      heads[i] = readers[i].Next();
     }
   }
+  LOG(INFO) << "Replayed " << num_replayed << " journal entries";
+
+  // Continue the LSN sequences of the shards and start persisting the journal.
+  service_.proactor_pool().AwaitFiberOnAll([this](ProactorBase*) { journal_->StartInThread(); });
+
+  AggregateError result;
+  shard_set->RunBlockingInParallel([&](EngineShard* shard) {
+    const auto& reader = readers[shard->shard_id()];
+    LSN start_lsn = journal_->GetLoadedSnapshotPosition(shard->shard_id()).value_or(1);
+    journal_->SetLsn(std::max(start_lsn, reader.last_lsn() + 1));
+
+    if (auto ec = journal_->OpenFile(opts); ec) {
+      LOG(ERROR) << "Could not open journal file of shard " << shard->shard_id() << ": "
+                 << ec.message();
+      result = ec;
+    }
+  });
+  journal_->ClearLoadedSnapshotPositions();
+
+  return *result;
 }
 
 void ServerFamily::JoinSnapshotSchedule() {
@@ -1051,7 +1435,8 @@ void ServerFamily::FlushAll(Namespace* ns) {
 // It starts one more fiber that waits for all load fibers to finish and returns the first
 // error (if any occured) with a future.
 std::optional<fb2::Future<GenericError>> ServerFamily::Load(string_view load_path,
-                                                            LoadExistingKeys existing_keys) {
+                                                            LoadExistingKeys existing_keys,
+                                                            bool restore_journal) {
   std::string path(load_path);
 
   if (load_path.empty()) {
@@ -1121,8 +1506,8 @@ std::optional<fb2::Future<GenericError>> ServerFamily::Load(string_view load_pat
   fb2::Future<GenericError> future;
 
   // Run fiber that empties the channel and sets ec_promise.
-  auto load_join_func = [this, aggregated_result, load_fibers = std::move(load_fibers),
-                         future]() mutable {
+  auto load_join_func = [this, aggregated_result, load_fibers = std::move(load_fibers), future,
+                         restore_journal]() mutable {
     for (auto& fiber : load_fibers) {
       fiber.Join();
     }
@@ -1132,6 +1517,10 @@ std::optional<fb2::Future<GenericError>> ServerFamily::Load(string_view load_pat
     } else {
       RdbLoader::PerformPostLoad(&service_);
       LOG(INFO) << "Load finished, num keys read: " << aggregated_result->keys_read;
+
+      // Replayed after the indices were restored, so that they are updated with the changes.
+      if (restore_journal)
+        aggregated_result->first_error = RestoreJournal(true);
     }
 
     service_.SwitchState(GlobalState::LOADING, GlobalState::ACTIVE);
@@ -1457,6 +1846,21 @@ void PrintPrometheusMetrics(uint64_t uptime, const Metrics& m, DflyCmd* dfly_cmd
                         &command_metrics);
     }
 
+    AppendMetricHeader("commands_latency_usec", "Latency histogram of commands in usec",
+                       MetricType::HISTOGRAM, &command_metrics);
+    for (const auto& [name, histo] : m.cmd_latency_map) {
+      histo.ForEachPow2Bucket([&](uint64_t bound, uint64_t count) {
+        AppendMetricValue("commands_latency_usec_bucket", count, {"cmd", "le"},
+                          {name, absl::StrCat(bound)}, &command_metrics);
+      });
+      AppendMetricValue("commands_latency_usec_bucket", histo.count(), {"cmd", "le"},
+                        {name, "+Inf"}, &command_metrics);
+      AppendMetricValue("commands_latency_usec_sum", histo.sum(), {"cmd"}, {name},
+                        &command_metrics);
+      AppendMetricValue("commands_latency_usec_count", histo.count(), {"cmd"}, {name},
+                        &command_metrics);
+    }
+
     absl::StrAppend(&resp->body(), command_metrics);
   }
 
@@ -1935,6 +2339,8 @@ void ClientHelp(SinkReplyBuilder* builder) {
       "CLIENT <subcommand> [<arg> [value] [opt] ...]. Subcommands are:",
       "CACHING (YES|NO)",
       "    Enable/disable tracking of the keys for next command in OPTIN/OPTOUT modes.",
+      "COMPRESSION (LZ4|ZSTD) [MINSIZE <bytes>]",
+      "    Switch the connection to compressed frames, replies below MINSIZE are not compressed.",
       "GETNAME",
       "    Return the name of the current connection.",
       "ID",
@@ -1995,6 +2401,8 @@ void ServerFamily::Client(CmdArgList args, const CommandContext& cmd_cntx) {
     return ClientSetInfo(sub_args, builder, cntx);
   } else if (sub_cmd == "ID") {
     return ClientId(sub_args, builder, cntx);
+  } else if (sub_cmd == "COMPRESSION") {
+    return ClientCompression(sub_args, builder, cntx);
   } else if (sub_cmd == "HELP") {
     return ClientHelp(builder);
   }
@@ -2192,6 +2600,7 @@ static void MergeDbSliceStats(const DbSlice::Stats& src, Metrics* dest) {
 
   dest->events += src.events;
   dest->small_string_bytes += src.small_string_bytes;
+  dest->client_tracking_bytes += src.client_tracking_bytes;
 }
 
 void ServerFamily::ResetStat(Namespace* ns) {
@@ -2250,6 +2659,10 @@ Metrics ServerFamily::GetMetrics(Namespace* ns) const {
         result.search_stats += shard->search_indices()->GetStats();
       }
 
+      if (shard->huge_page_resource()) {
+        result.huge_page_stats += shard->huge_page_resource()->stats();
+      }
+
       result.traverse_ttl_per_sec += shard->GetMovingSum6(EngineShard::TTL_TRAVERSE);
       result.delete_ttl_per_sec += shard->GetMovingSum6(EngineShard::TTL_DELETE);
       if (result.tx_queue_len < shard->txq()->size())
@@ -2278,6 +2691,10 @@ Metrics ServerFamily::GetMetrics(Namespace* ns) const {
           min<uint64_t>(result.oldest_pending_send_ts, oldest_member.timestamp_ns);
     }
     service_.mutable_registry()->MergeCallStats(index, cmd_stat_cb);
+    service_.mutable_registry()->MergeLatencyHistograms(
+        index, [&dest = result.cmd_latency_map](string_view name, const LatencyHistogram& histo) {
+          dest[absl::AsciiStrToLower(name)].Merge(histo);
+        });
   };  // cb
 
   service_.proactor_pool().AwaitFiberOnAll(std::move(cb));
@@ -2421,10 +2838,16 @@ string ServerFamily::FormatInfoMetrics(const Metrics& m, std::string_view sectio
       }
     }
     append("table_used_memory", total.table_mem_usage);
+    if (const auto& hp = m.huge_page_stats; hp.mapped_bytes + hp.fallback_bytes > 0) {
+      append("table_huge_pages_mapped_bytes", hp.mapped_bytes);
+      append("table_huge_pages_used_bytes", hp.used_bytes);
+      append("table_huge_pages_fallback_bytes", hp.fallback_bytes);
+    }
     append("num_buckets", total.bucket_count);
     append("num_entries", total.key_count);
     append("inline_keys", total.inline_keys);
     append("small_string_bytes", m.small_string_bytes);
+    append("client_tracking_bytes", m.client_tracking_bytes);
     append("pipeline_cache_bytes", m.facade_stats.conn_stats.pipeline_cmd_cache_bytes);
     append("dispatch_queue_bytes", m.facade_stats.conn_stats.dispatch_queue_bytes);
     append("dispatch_queue_subscriber_bytes",
@@ -2471,14 +2894,20 @@ string ServerFamily::FormatInfoMetrics(const Metrics& m, std::string_view sectio
     append("total_pipelined_squashed_commands", m.coordinator_stats.squashed_commands);
     append("pipeline_throttle_total", conn_stats.pipeline_throttle_count);
     append("pipelined_latency_usec", conn_stats.pipelined_cmd_latency);
+    append("total_request_allocs", conn_stats.request_allocs);
     append("total_net_input_bytes", conn_stats.io_read_bytes);
     append("connection_migrations", conn_stats.num_migrations);
     append("connection_recv_provided_calls", conn_stats.num_recv_provided_calls);
+    append("connection_recv_provided_exhausted", conn_stats.num_recv_provided_exhausted);
+    append("pubsub_dropped_messages", conn_stats.pubsub_dropped_messages);
+    append("pubsub_overflow_disconnects", conn_stats.pubsub_overflow_disconnects);
     append("total_net_output_bytes", reply_stats.io_write_bytes);
     append("rdb_save_usec", m.coordinator_stats.rdb_save_usec);
     append("rdb_save_count", m.coordinator_stats.rdb_save_count);
     append("big_value_preemptions", m.coordinator_stats.big_value_preemptions);
     append("compressed_blobs", m.coordinator_stats.compressed_blobs);
+    append("json_path_cache_hits", m.coordinator_stats.json_path_cache_hits);
+    append("json_path_cache_misses", m.coordinator_stats.json_path_cache_misses);
     append("instantaneous_input_kbps", -1);
     append("instantaneous_output_kbps", -1);
     append("rejected_connections", -1);
@@ -2536,6 +2965,9 @@ string ServerFamily::FormatInfoMetrics(const Metrics& m, std::string_view sectio
     append("tiered_cold_storage_bytes", m.tiered_stats.cold_storage_bytes);
     append("tiered_offloading_steps", m.tiered_stats.total_offloading_steps);
     append("tiered_offloading_stashes", m.tiered_stats.total_offloading_stashes);
+    append("tiered_total_compactions", m.tiered_stats.total_compactions);
+    append("tiered_total_relocations", m.tiered_stats.total_relocations);
+    append("tiered_released_bytes", m.tiered_stats.released_bytes);
     append("tiered_ram_hits", m.events.ram_hits);
     append("tiered_ram_cool_hits", m.events.ram_cool_hits);
     append("tiered_ram_misses", m.events.ram_misses);
@@ -2588,6 +3020,13 @@ string ServerFamily::FormatInfoMetrics(const Metrics& m, std::string_view sectio
     append("last_failed_save", save_info.last_error_time);
     append("last_error", save_info.last_error.Format());
     append("last_failed_save_duration_sec", save_info.failed_duration_sec);
+
+    if (!GetFlag(FLAGS_journal_dir).empty() && journal_) {
+      error_code journal_ec = journal_->GetFileError();
+      append("journal_file_status", journal_ec ? "err" : "ok");
+      if (journal_ec)
+        append("journal_file_last_error", journal_ec.message());
+    }
   };
 
   auto add_tx_info = [&] {
@@ -2610,6 +3049,8 @@ string ServerFamily::FormatInfoMetrics(const Metrics& m, std::string_view sectio
     append("multi_squash_execution_total", m.coordinator_stats.multi_squash_executions);
     append("multi_squash_execution_hop_usec", m.coordinator_stats.multi_squash_exec_hop_usec);
     append("multi_squash_execution_reply_usec", m.coordinator_stats.multi_squash_exec_reply_usec);
+    append("cross_conn_squash_batches_total", m.coordinator_stats.cross_conn_squash_batches);
+    append("cross_conn_squashed_commands_total", m.coordinator_stats.cross_conn_squashed_commands);
   };
 
   auto add_repl_info = [&] {
@@ -2725,6 +3166,14 @@ string ServerFamily::FormatInfoMetrics(const Metrics& m, std::string_view sectio
     add_cmdstats();
   }
 
+  if (should_enter("LATENCYSTATS", true)) {
+    for (const auto& [name, histo] : m.cmd_latency_map) {
+      append(StrCat("latency_percentiles_usec_", name),
+             absl::StrCat("p50=", histo.Percentile(50), ",p99=", histo.Percentile(99),
+                          ",p99.9=", histo.Percentile(99.9)));
+    }
+  }
+
   if (should_enter("MODULES")) {
     append("module",
            "name=ReJSON,ver=20000,api=1,filters=0,usedby=[search],using=[],options=[handle-io-"
@@ -3246,9 +3695,114 @@ void ServerFamily::LastSave(CmdArgList args, const CommandContext& cmd_cntx) {
 void ServerFamily::Latency(CmdArgList args, const CommandContext& cmd_cntx) {
   auto* rb = static_cast<RedisReplyBuilder*>(cmd_cntx.rb);
   string sub_cmd = absl::AsciiStrToUpper(ArgS(args, 0));
+  auto& pp = service_.proactor_pool();
+
+  if (sub_cmd == "HELP") {
+    string_view help[] = {
+        "LATENCY <subcommand> [<arg> [value] [opt] ...]. Subcommands are:",
+        "LATEST",
+        "    Return the latest latency spikes of all events.",
+        "    Entries are made of: event, timestamp, latest latency in ms, max latency in ms.",
+        "HISTORY <event>",
+        "    Return the timestamps and latencies in ms of the spikes of the event.",
+        "RESET [<event> ...]",
+        "    Reset the spikes of the given events or of all events.",
+        "HISTOGRAM [<command> ...]",
+        "    Return the latency histograms in usec of the given commands or of all commands.",
+        "DOCTOR",
+        "    Return a report of the latency spikes.",
+        "HELP",
+        "    Prints this help.",
+    };
+    return rb->SendSimpleStrArr(help);
+  }
+
+  if (sub_cmd == "LATEST" && args.size() == 1) {
+    auto events = MergeLatencyEvents(&pp);
+    rb->StartArray(events.size());
+    for (const auto& [name, event] : events) {
+      rb->StartArray(4);
+      rb->SendBulkString(name);
+      rb->SendLong(event.samples.back().unix_ts_sec);
+      rb->SendLong(event.samples.back().latency_ms);
+      rb->SendLong(event.max_ms);
+    }
+    return;
+  }
+
+  if (sub_cmd == "HISTORY" && args.size() == 2) {
+    auto events = MergeLatencyEvents(&pp);
+    auto it = events.find(ArgS(args, 1));
+    if (it == events.end())
+      return rb->SendEmptyArray();
+
+    rb->StartArray(it->second.samples.size());
+    for (const auto& sample : it->second.samples) {
+      rb->StartArray(2);
+      rb->SendLong(sample.unix_ts_sec);
+      rb->SendLong(sample.latency_ms);
+    }
+    return;
+  }
+
+  if (sub_cmd == "RESET") {
+    auto events = MergeLatencyEvents(&pp);
+    vector<string> names;
+    for (size_t i = 1; i < args.size(); ++i) {
+      if (events.count(ArgS(args, i)))
+        names.emplace_back(ArgS(args, i));
+    }
+    size_t reset = args.size() == 1 ? events.size() : names.size();
+
+    pp.AwaitFiberOnAll([&](auto index, auto* context) {
+      auto& monitor = ServerState::tlocal()->GetLatencyMonitor();
+      if (args.size() == 1)
+        monitor.ResetAll();
+      for (const auto& name : names)
+        monitor.Reset(name);
+    });
+    return rb->SendLong(reset);
+  }
+
+  if (sub_cmd == "HISTOGRAM") {
+    absl::flat_hash_set<string> filter;
+    for (size_t i = 1; i < args.size(); ++i)
+      filter.insert(absl::AsciiStrToLower(ArgS(args, i)));
+
+    map<string, LatencyHistogram> histos;
+    util::fb2::Mutex mu;
+    pp.AwaitFiberOnAll([&](unsigned index, auto* context) {
+      lock_guard lk(mu);
+      service_.mutable_registry()->MergeLatencyHistograms(
+          index, [&](string_view name, const LatencyHistogram& histo) {
+            string cmd = absl::AsciiStrToLower(name);
+            if (filter.empty() || filter.contains(cmd))
+              histos[cmd].Merge(histo);
+          });
+    });
+
+    rb->StartCollection(histos.size(), RedisReplyBuilder::MAP);
+    for (const auto& [name, histo] : histos) {
+      vector<pair<uint64_t, uint64_t>> buckets;
+      histo.ForEachPow2Bucket(
+          [&buckets](uint64_t bound, uint64_t count) { buckets.emplace_back(bound, count); });
+
+      rb->SendBulkString(name);
+      rb->StartCollection(2, RedisReplyBuilder::MAP);
+      rb->SendBulkString("calls");
+      rb->SendLong(histo.count());
+      rb->SendBulkString("histogram_usec");
+      rb->StartCollection(buckets.size(), RedisReplyBuilder::MAP);
+      for (const auto& [bound, count] : buckets) {
+        rb->SendLong(bound);
+        rb->SendLong(count);
+      }
+    }
+    return;
+  }
 
-  if (sub_cmd == "LATEST") {
-    return rb->SendEmptyArray();
+  if (sub_cmd == "DOCTOR" && args.size() == 1) {
+    return rb->SendVerbatimString(LatencyDoctorReport(MergeLatencyEvents(&pp)));
   }
 
   return rb->SendError(UnknownSubCmd(sub_cmd, "LATENCY"), kSyntaxErrType);
@@ -82,6 +82,7 @@ struct Metrics {
   TieredStats tiered_stats;
 
   SearchStats search_stats;
+  HugePageResource::Stats huge_page_stats;  // hash table memory served from huge pages
   ServerState::Stats coordinator_stats;  // stats on transaction running
   PeakStats peak_stats;
 
@@ -89,6 +90,7 @@ struct Metrics {
 
   size_t heap_used_bytes = 0;
   size_t small_string_bytes = 0;
+  size_t client_tracking_bytes = 0;  // memory used by the client tracking tables
   uint32_t traverse_ttl_per_sec = 0;
   uint32_t delete_ttl_per_sec = 0;
   uint64_t fiber_switch_cnt = 0;
@@ -116,6 +118,9 @@ struct Metrics {
   // command call frequencies (count, aggregated latency in usec).
   std::map<std::string, std::pair<uint64_t, uint64_t>> cmd_stats_map;
 
+  // Latency histograms of the commands that were called since the last reset.
+  std::map<std::string, LatencyHistogram> cmd_latency_map;
+
   absl::flat_hash_map<std::string, uint64_t> connections_lib_name_ver_map;
 
   struct ReplicaInfo {
@@ -218,10 +223,12 @@ class ServerFamily {
   void FlushAll(Namespace* ns);
 
   // Load snapshot from file (.rdb file or summary.dfs file) and return
-  // future with error_code.
+  // future with error_code. If restore_journal is set, the on-disk journal is replayed on top of
+  // the snapshot before the server becomes active.
   enum class LoadExistingKeys { kFail, kOverride };
   std::optional<util::fb2::Future<GenericError>> Load(std::string_view file_name,
-                                                      LoadExistingKeys existing_keys);
+                                                      LoadExistingKeys existing_keys,
+                                                      bool restore_journal = false);
 
   bool TEST_IsSaving() const;
 
@@ -271,6 +278,10 @@ class ServerFamily {
   void JoinSnapshotSchedule();
   void LoadFromSnapshot() ABSL_LOCKS_EXCLUDED(loading_stats_mu_);
 
+  // Replays the on-disk journal (--journal_dir) from the positions of the loaded snapshot and
+  // starts persisting the journal. Must be called in LOADING state.
+  std::error_code RestoreJournal(bool snapshot_loaded);
+
   uint32_t shard_count() const {
     return shard_set->size();
   }
@@ -6,11 +6,16 @@
 
 #include <absl/strings/match.h>
 
+#include <filesystem>
+
 #include "absl/strings/str_cat.h"
 #include "base/flags.h"
 #include "base/gtest.h"
 #include "base/logging.h"
 #include "facade/facade_test.h"
+#include "server/detail/transport_codec.h"
+#include "server/engine_shard_set.h"
+#include "server/journal/journal.h"
 #include "server/test_utils.h"
 
 using namespace testing;
@@ -19,6 +24,7 @@ using namespace util;
 using namespace boost;
 
 ABSL_DECLARE_FLAG(string, cluster_mode);
+ABSL_DECLARE_FLAG(bool, force_epoll);
 
 namespace dfly {
 
@@ -187,6 +193,86 @@ TEST_F(ServerFamilyTest, SlowLogMinusOneDisabled) {
   EXPECT_THAT(resp.GetInt(), 0);
 }
 
+TEST(LatencyHistogramTest, Buckets) {
+  for (uint64_t val : {0ul, 1ul, 7ul, 8ul, 9ul, 100ul, 1000ul, 123456ul, 1ul << 39}) {
+    unsigned index = LatencyHistogram::BucketIndex(val);
+    EXPECT_LE(LatencyHistogram::BucketStart(index), val);
+    EXPECT_GT(LatencyHistogram::BucketStart(index + 1), val);
+  }
+  EXPECT_EQ(LatencyHistogram::BucketIndex(UINT64_MAX), LatencyHistogram::kNumBuckets - 1);
+
+  LatencyHistogram histo;
+  for (uint64_t i = 1; i <= 1000; ++i)
+    histo.Add(i);
+  EXPECT_EQ(1000u, histo.count());
+  EXPECT_EQ(1000u, histo.max());
+
+  // The relative error is bounded by the sub-buckets.
+  EXPECT_NEAR(500, histo.Percentile(50), 500 / LatencyHistogram::kSubBuckets);
+  EXPECT_NEAR(990, histo.Percentile(99), 990 / LatencyHistogram::kSubBuckets);
+
+  vector<pair<uint64_t, uint64_t>> buckets;
+  histo.ForEachPow2Bucket(
+      [&](uint64_t bound, uint64_t count) { buckets.emplace_back(bound, count); });
+  ASSERT_EQ(10u, buckets.size());
+  EXPECT_EQ(make_pair(2ul, 1ul), buckets.front());
+  EXPECT_EQ(make_pair(1024ul, 1000ul), buckets.back());
+}
+
+TEST_F(ServerFamilyTest, LatencyHistogram) {
+  Run({"set", "foo", "bar"});
+  Run({"get", "foo"});
+  Run({"get", "foo"});
+
+  auto resp = Run({"latency", "histogram", "GET", "set"});
+  ASSERT_THAT(resp, ArrLen(4));
+  auto vec = resp.GetVec();
+  EXPECT_EQ(vec[0], "get");
+  ASSERT_THAT(vec[1], ArrLen(4));
+  EXPECT_EQ(vec[1].GetVec()[0], "calls");
+  EXPECT_THAT(vec[1].GetVec()[1], IntArg(2));
+  EXPECT_EQ(vec[1].GetVec()[2], "histogram_usec");
+  EXPECT_EQ(vec[2], "set");
+
+  Run({"config", "set", "latency_tracking", "false"});
+  Run({"get", "foo"});
+  Run({"config", "set", "latency_tracking", "true"});
+  resp = Run({"latency", "histogram", "get"});
+  EXPECT_THAT(resp.GetVec()[1].GetVec()[1], IntArg(2));
+
+  Run({"config", "resetstat"});
+  EXPECT_THAT(Run({"latency", "histogram", "get"}), ArrLen(0));
+}
+
+TEST_F(ServerFamilyTest, LatencyMonitor) {
+  EXPECT_THAT(Run({"latency", "latest"}), ArrLen(0));
+  EXPECT_THAT(Run({"latency", "doctor"}).GetString(), HasSubstr("disabled"));
+
+  // Spikes are recorded on every thread and merged.
+  Run({"config", "set", "latency_monitor_threshold", "5"});
+  for (unsigned i = 0; i < 2; ++i) {
+    pp_->at(i)->Await([i] {
+      ServerState::tlocal()->RecordLatencyEvent("expire-cycle", 7000 - i * 1000);
+      ServerState::tlocal()->RecordLatencyEvent("expire-cycle", 4000);
+    });
+  }
+
+  auto resp = Run({"latency", "latest"});
+  ASSERT_THAT(resp, ArrLen(4));
+  EXPECT_EQ(resp.GetVec()[0], "expire-cycle");
+  EXPECT_THAT(resp.GetVec()[3], IntArg(7));
+
+  // Either one merged sample or two samples if the second changed in between.
+  EXPECT_THAT(Run({"latency", "history", "expire-cycle"}), ArrLen(2));
+  EXPECT_THAT(Run({"latency", "doctor"}).GetString(), HasSubstr("1. expire-cycle"));
+
+  EXPECT_THAT(Run({"latency", "reset", "command"}), IntArg(0));
+  EXPECT_THAT(Run({"latency", "reset"}), IntArg(1));
+  EXPECT_THAT(Run({"latency", "latest"}), ArrLen(0));
+  EXPECT_THAT(Run({"latency", "unknown"}), ErrArg("Unknown subcommand"));
+  Run({"config", "set", "latency_monitor_threshold", "0"});
+}
+
 TEST_F(ServerFamilyTest, ClientPause) {
   auto start = absl::Now();
   Run({"CLIENT", "PAUSE", "50"});
@@ -204,6 +290,48 @@ TEST_F(ServerFamilyTest, ClientPause) {
   EXPECT_GT((absl::Now() - start), absl::Milliseconds(50));
 }
 
+TEST_F(ServerFamilyTest, ClientCompressionErrors) {
+  EXPECT_THAT(Run({"CLIENT", "COMPRESSION", "GZIP"}), ErrArg("syntax error"));
+  EXPECT_THAT(Run({"CLIENT", "COMPRESSION", "LZ4", "MINSIZE", "x"}), ErrArg("not an integer"));
+  EXPECT_THAT(Run({"CLIENT", "COMPRESSION", "ZSTD", "FOO"}), ErrArg("syntax error"));
+
+  Run({"MULTI"});
+  Run({"CLIENT", "COMPRESSION", "LZ4"});
+  EXPECT_THAT(Run({"EXEC"}), ErrArg("can not be pipelined or used in MULTI"));
+}
+
+TEST_F(ServerFamilyTest, ClientCompressionCodecs) {
+  string data;
+  for (unsigned i = 0; i < 1000; i++)
+    absl::StrAppend(&data, "key:", i % 17, " value:", i, "\r\n");
+
+  for (bool zstd : {false, true}) {
+    SCOPED_TRACE(zstd ? "zstd" : "lz4");
+    auto codec = zstd ? detail::TransportCodec::CreateZstd() : detail::TransportCodec::CreateLZ4();
+    auto compressed = codec->Compress(io::Buffer(data));
+    ASSERT_TRUE(compressed);
+    string frame{io::View(*compressed)};
+    ASSERT_LT(frame.size(), data.size());
+
+    // The blob end opcode that terminates decompressed blobs is not part of the payload.
+    io::IoBuf dest;
+    for (unsigned i = 0; i < 2; i++) {
+      ASSERT_FALSE(codec->Decompress(io::Buffer(frame), data.size(), &dest));
+      EXPECT_EQ(io::View(dest.InputBuffer()), data);
+      dest.Clear();
+    }
+
+    // Truncated and oversized frames fail and leave the codec usable.
+    string_view truncated = string_view{frame}.substr(0, frame.size() / 2);
+    EXPECT_TRUE(codec->Decompress(io::Buffer(truncated), data.size(), &dest));
+    EXPECT_TRUE(codec->Decompress(io::Buffer(frame), data.size() - 1, &dest));
+    dest.Clear();
+
+    ASSERT_FALSE(codec->Decompress(io::Buffer(frame), data.size(), &dest));
+    EXPECT_EQ(io::View(dest.InputBuffer()), data);
+  }
+}
+
 TEST_F(ServerFamilyTest, ClientTrackingOnAndOff) {
   // case 1. can't use the feature for resp2
   auto resp = Run({"CLIENT", "TRACKING", "ON"});
@@ -422,7 +550,7 @@ TEST_F(ServerFamilyTest, ClientTrackingUpdateKey) {
   Run({"GET", "FOO"});
   Run({"SET", "FOO", "10"});
   const auto& msg = GetInvalidationMessage("IO0", 0);
-  EXPECT_EQ(msg.key, "FOO");
+  EXPECT_THAT(msg.keys, ElementsAre("FOO"));
 
   // make sure invalidation message only gets sent once.
   Run({"GET", "FOO"});
@@ -434,16 +562,21 @@ TEST_F(ServerFamilyTest, ClientTrackingUpdateKey) {
   pp_->at(1)->Await([&] { return Run({"SET", "FOO", "30"}); });
   pp_->AwaitFiberOnAll([](ProactorBase* pb) {});
   const auto& msg2 = GetInvalidationMessage("IO0", 1);
-  EXPECT_EQ(msg2.key, "FOO");
+  EXPECT_THAT(msg2.keys, ElementsAre("FOO"));
 
   // case 4. test multi command
   Run({"MGET", "X1", "X2", "X3", "X4", "Y1", "Y2", "Y3", "Y4", "Z1", "Z2", "Z3", "Z4"});
   pp_->at(1)->Await([&] { return Run({"MSET", "X1", "1", "Y3", "2", "Z2", "3", "Z4", "5"}); });
   pp_->AwaitFiberOnAll([](ProactorBase* pb) {});
-  EXPECT_EQ(InvalidationMessagesLen("IO0"), 6);
+  // Keys invalidated on the same shard are batched into one message.
+  size_t num_msgs = InvalidationMessagesLen("IO0");
+  EXPECT_GT(num_msgs, 2);
+  EXPECT_LE(num_msgs, 6);
   std::vector<std::string_view> keys_invalidated;
-  for (unsigned int i = 2; i < 6; ++i)
-    keys_invalidated.push_back(GetInvalidationMessage("IO0", i).key);
+  for (unsigned int i = 2; i < num_msgs; ++i) {
+    for (const auto& key : GetInvalidationMessage("IO0", i).keys)
+      keys_invalidated.push_back(key);
+  }
   ASSERT_THAT(keys_invalidated, UnorderedElementsAre("X1", "Y3", "Z2", "Z4"));
 
   Run({"FLUSHDB"});
@@ -456,7 +589,7 @@ TEST_F(ServerFamilyTest, ClientTrackingDeleteKey) {
   Run({"GET", "FOO"});
   pp_->at(1)->Await([&] { return Run({"DEL", "FOO"}); });
   pp_->AwaitFiberOnAll([](ProactorBase* pb) {});
-  EXPECT_EQ(GetInvalidationMessage("IO0", 0).key, "FOO");
+  EXPECT_THAT(GetInvalidationMessage("IO0", 0).keys, ElementsAre("FOO"));
 }
 
 TEST_F(ServerFamilyTest, ClientTrackingRenameKey) {
@@ -466,7 +599,7 @@ TEST_F(ServerFamilyTest, ClientTrackingRenameKey) {
   Run({"GET", "FOO"});
   pp_->at(1)->Await([&] { return Run({"RENAME", "FOO", "BAR"}); });
   pp_->AwaitFiberOnAll([](ProactorBase* pb) {});
-  EXPECT_EQ(GetInvalidationMessage("IO0", 0).key, "FOO");
+  EXPECT_THAT(GetInvalidationMessage("IO0", 0).keys, ElementsAre("FOO"));
 }
 
 TEST_F(ServerFamilyTest, ClientTrackingExpireKey) {
@@ -479,7 +612,7 @@ TEST_F(ServerFamilyTest, ClientTrackingExpireKey) {
   auto resp = Run({"GET", "C"});
   EXPECT_THAT(resp, ArgType(RespExpr::NIL));
   EXPECT_EQ(InvalidationMessagesLen("IO0"), 1);
-  EXPECT_EQ(GetInvalidationMessage("IO0", 0).key, "C");
+  EXPECT_THAT(GetInvalidationMessage("IO0", 0).keys, ElementsAre("C"));
 }
 
 TEST_F(ServerFamilyTest, ClientTrackingSelectDB) {
@@ -491,7 +624,50 @@ TEST_F(ServerFamilyTest, ClientTrackingSelectDB) {
   pp_->at(1)->Await([&] { return Run({"SET", "C", "1000"}); });
   pp_->AwaitFiberOnAll([](ProactorBase* pb) {});
   EXPECT_EQ(InvalidationMessagesLen("IO0"), 1);
-  EXPECT_EQ(GetInvalidationMessage("IO0", 0).key, "C");
+  EXPECT_THAT(GetInvalidationMessage("IO0", 0).keys, ElementsAre("C"));
+}
+
+TEST_F(ServerFamilyTest, ClientTrackingBcast) {
+  Run({"HELLO", "3"});
+  EXPECT_THAT(Run({"CLIENT", "TRACKING", "ON", "PREFIX", "user:"}),
+              ErrArg("PREFIX option requires BCAST mode"));
+  EXPECT_THAT(Run({"CLIENT", "TRACKING", "ON", "BCAST", "OPTIN"}),
+              ErrArg("OPTIN and OPTOUT are not compatible with BCAST"));
+
+  EXPECT_EQ(Run({"CLIENT", "TRACKING", "ON", "BCAST", "PREFIX", "user:", "PREFIX", "item:"}), "OK");
+  EXPECT_THAT(Run({"CLIENT", "TRACKING", "ON"}), ErrArg("can't switch BCAST mode"));
+
+  // Keys are not tracked on reads, writes are matched against the prefixes.
+  Run({"GET", "other"});
+  pp_->at(1)->Await([&] { return Run({"SET", "other", "1"}); });
+  pp_->at(1)->Await([&] { return Run({"SET", "user:1", "1"}); });
+  pp_->AwaitFiberOnAll([](ProactorBase* pb) {});
+  ASSERT_EQ(InvalidationMessagesLen("IO0"), 1);
+  EXPECT_THAT(GetInvalidationMessage("IO0", 0).keys, ElementsAre("user:1"));
+
+  // Registrations stay after the invalidation.
+  pp_->at(1)->Await([&] { return Run({"SET", "user:1", "2"}); });
+  pp_->AwaitFiberOnAll([](ProactorBase* pb) {});
+  EXPECT_EQ(InvalidationMessagesLen("IO0"), 2);
+
+  // Keys invalidated by the same hop are batched per shard.
+  pp_->at(1)->Await([&] { return Run({"MSET", "item:1", "1", "item:2", "2", "item:3", "3"}); });
+  pp_->AwaitFiberOnAll([](ProactorBase* pb) {});
+  std::vector<std::string> keys;
+  for (size_t i = 2; i < InvalidationMessagesLen("IO0"); ++i) {
+    for (const auto& key : GetInvalidationMessage("IO0", i).keys)
+      keys.push_back(key);
+  }
+  EXPECT_THAT(keys, UnorderedElementsAre("item:1", "item:2", "item:3"));
+
+  auto metrics = GetMetrics();
+  EXPECT_GT(metrics.client_tracking_bytes, 0u);
+
+  Run({"CLIENT", "TRACKING", "OFF"});
+  size_t num_msgs = InvalidationMessagesLen("IO0");
+  pp_->at(1)->Await([&] { return Run({"SET", "user:2", "1"}); });
+  pp_->AwaitFiberOnAll([](ProactorBase* pb) {});
+  EXPECT_EQ(InvalidationMessagesLen("IO0"), num_msgs);
 }
 
 TEST_F(ServerFamilyTest, ClientTrackingNonTransactionalBug) {
@@ -563,4 +739,69 @@ TEST_F(ServerFamilyTest, PubSubCommandErr) {
                      "PUBSUB HELP."));
 }
 
+class JournalFsyncTest : public ServerFamilyTest {
+ protected:
+  void SetUp() override {
+    // The journal files require io_uring.
+    if (!absl::GetFlag(FLAGS_force_epoll)) {
+      journal_dir_ = filesystem::temp_directory_path() / absl::StrCat("journal_", getpid());
+      SetTestFlag("journal_dir", journal_dir_.string());
+      SetTestFlag("journal_fsync", "always");
+    }
+    ServerFamilyTest::SetUp();
+  }
+
+  void TearDown() override {
+    ServerFamilyTest::TearDown();
+    if (!journal_dir_.empty())
+      filesystem::remove_all(journal_dir_);
+  }
+
+  // Waits until the journal is restored and accepts writes, then fails the following syncs.
+  void FailSyncs() {
+    ASSERT_TRUE(WaitUntilCondition([&] { return Run({"set", "init", "1"}) == "OK"; }, 1s));
+    shard_set->RunBriefInParallel([](EngineShard* shard) {
+      shard->journal()->TEST_FailFileSync(make_error_code(errc::io_error));
+    });
+  }
+
+  absl::FlagSaver saver_;
+  filesystem::path journal_dir_;
+};
+
+TEST_F(JournalFsyncTest, FailedSync) {
+  if (journal_dir_.empty())
+    GTEST_SKIP() << "journal_dir requires io_uring";
+
+  FailSyncs();
+  EXPECT_THAT(Run({"set", "a", "1"}), ErrArg("MISCONF"));
+
+  // Writes are rejected once the journal failed.
+  EXPECT_THAT(Run({"set", "a", "2"}), ErrArg("MISCONF"));
+  EXPECT_THAT(Run({"get", "init"}), "1");
+}
+
+TEST_F(JournalFsyncTest, FailedSyncInExec) {
+  if (journal_dir_.empty())
+    GTEST_SKIP() << "journal_dir requires io_uring";
+
+  FailSyncs();
+  Run({"multi"});
+  Run({"set", "a", "1"});
+  Run({"set", "b", "1"});
+  auto resp = Run({"exec"});
+  ASSERT_THAT(resp, ArrLen(2));
+  EXPECT_THAT(resp.GetVec()[0], ErrArg("MISCONF"));
+  EXPECT_THAT(resp.GetVec()[1], ErrArg("MISCONF"));
+}
+
+TEST_F(JournalFsyncTest, FailedSyncInEval) {
+  if (journal_dir_.empty())
+    GTEST_SKIP() << "journal_dir requires io_uring";
+
+  FailSyncs();
+  auto resp = Run({"eval", "return redis.pcall('set', KEYS[1], '1')", "1", "a"});
+  EXPECT_THAT(resp, ErrArg("MISCONF"));
+}
+
 }  // namespace dfly
@@ -35,7 +35,7 @@ ServerState::Stats::Stats(unsigned num_shards) : tx_width_freq_arr(num_shards) {
 }
 
 ServerState::Stats& ServerState::Stats::Add(const ServerState::Stats& other) {
-  static_assert(sizeof(Stats) == 20 * 8, "Stats size mismatch");
+  static_assert(sizeof(Stats) == 24 * 8, "Stats size mismatch");
 
 #define ADD(x) this->x += (other.x)
 
@@ -53,6 +53,8 @@ ServerState::Stats& ServerState::Stats::Add(const ServerState::Stats& other) {
   ADD(multi_squash_exec_hop_usec);
   ADD(multi_squash_exec_reply_usec);
   ADD(squashed_commands);
+  ADD(cross_conn_squash_batches);
+  ADD(cross_conn_squashed_commands);
 
   ADD(blocked_on_interpreter);
   ADD(rdb_save_usec);
@@ -60,6 +62,8 @@ ServerState::Stats& ServerState::Stats::Add(const ServerState::Stats& other) {
 
   ADD(big_value_preemptions);
   ADD(compressed_blobs);
+  ADD(json_path_cache_hits);
+  ADD(json_path_cache_misses);
 
   ADD(oom_error_cmd_cnt);
   ADD(conn_timeout_events);
@@ -14,6 +14,7 @@
 #include "server/acl/user_registry.h"
 #include "server/channel_store.h"
 #include "server/common.h"
+#include "server/latency_monitor.h"
 #include "server/script_mgr.h"
 #include "server/slowlog.h"
 #include "util/sliding_counter.h"
@@ -122,6 +123,8 @@ class ServerState {  // public struct - to allow initialization.
     uint64_t multi_squash_exec_hop_usec = 0;
     uint64_t multi_squash_exec_reply_usec = 0;
     uint64_t squashed_commands = 0;
+    uint64_t cross_conn_squash_batches = 0;
+    uint64_t cross_conn_squashed_commands = 0;
     uint64_t blocked_on_interpreter = 0;
 
     uint64_t rdb_save_usec = 0;
@@ -129,6 +132,8 @@ class ServerState {  // public struct - to allow initialization.
 
     uint64_t big_value_preemptions = 0;
     uint64_t compressed_blobs = 0;
+    uint64_t json_path_cache_hits = 0;
+    uint64_t json_path_cache_misses = 0;
 
     // Number of times we rejected command dispatch due to OOM condition.
     uint64_t oom_error_cmd_cnt = 0;
@@ -270,10 +275,18 @@ class ServerState {  // public struct - to allow initialization.
 
   bool ShouldLogSlowCmd(unsigned latency_usec) const;
 
+  // Records a latency spike of an event if it reached the latency monitor threshold.
+  void RecordLatencyEvent(std::string_view event, uint64_t latency_usec) {
+    if (latency_usec >= latency_monitor_threshold_usec)
+      latency_monitor_.Add(event, latency_usec);
+  }
+
   Stats stats;
 
   bool is_master = true;
   uint32_t log_slower_than_usec = UINT32_MAX;
+  uint64_t latency_monitor_threshold_usec = UINT64_MAX;
+  bool latency_tracking = true;  // Whether to track per-command latency histograms.
 
   acl::UserRegistry* user_registry;
 
@@ -296,6 +309,10 @@ class ServerState {  // public struct - to allow initialization.
     return slow_log_shard_;
   };
 
+  LatencyMonitor& GetLatencyMonitor() {
+    return latency_monitor_;
+  }
+
   // Tries to returns as much RSS memory as possible to the OS.
   // Decommits 3 possible heaps according to the flags.
   // For decommit_glibcmalloc the heap is global for the process, for others it's specific only
@@ -319,6 +336,7 @@ class ServerState {  // public struct - to allow initialization.
 
   int64_t live_transactions_ = 0;
   SlowLogShard slow_log_shard_;
+  LatencyMonitor latency_monitor_;
   mi_heap_t* data_heap_;
   journal::Journal* journal_ = nullptr;
 
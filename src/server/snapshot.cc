@@ -6,17 +6,21 @@
 
 #include <absl/strings/match.h>
 #include <absl/strings/str_cat.h>
+#include <absl/time/clock.h>
 
 #include <mutex>
 
 #include "base/flags.h"
 #include "base/logging.h"
 #include "core/heap_size.h"
+#include "core/search/serialization.h"
 #include "server/db_slice.h"
 #include "server/engine_shard_set.h"
 #include "server/journal/journal.h"
 #include "server/rdb_extensions.h"
+#include "server/rdb_load.h"
 #include "server/rdb_save.h"
+#include "server/search/doc_index.h"
 #include "server/server_state.h"
 #include "server/tiered_storage.h"
 #include "util/fibers/synchronization.h"
@@ -63,7 +67,8 @@ bool SliceSnapshot::IsSnaphotInProgress() {
   return tl_slice_snapshots.size() > 0;
 }
 
-void SliceSnapshot::Start(bool stream_journal, SnapshotFlush allow_flush) {
+void SliceSnapshot::Start(bool stream_journal, SnapshotFlush allow_flush,
+                          bool save_shard_state) {
   DCHECK(!snapshot_fb_.IsJoinable());
 
   auto db_cb = [this](DbIndex db_index, const DbSlice::ChangeReq& req) {
@@ -96,15 +101,108 @@ void SliceSnapshot::Start(bool stream_journal, SnapshotFlush allow_flush) {
   }
   serializer_ = std::make_unique<RdbSerializer>(compression_mode_, flush_fun);
 
+  // Serialized synchronously, so the position matches the point in time of the snapshot.
+  // The search indices are streamed from the snapshot fiber, see SerializeSearchIndices.
+  if (save_shard_state) {
+    SerializeJournalPosition();
+    search_indices_pending_ = true;
+  }
+
   VLOG(1) << "DbSaver::Start - saving entries with version less than " << snapshot_version_;
 
   snapshot_fb_ = fb2::Fiber("snapshot", [this, stream_journal] {
+    {
+      std::lock_guard guard(big_value_mu_);
+      SerializeSearchIndices();
+    }
+    PushSerialized(false);
     this->IterateBucketsFb(stream_journal);
     db_slice_->UnregisterOnChange(snapshot_version_);
     consumer_->Finalize();
   });
 }
 
+void SliceSnapshot::SerializeJournalPosition() {
+  EngineShard* shard = db_slice_->shard_owner();
+  if (auto* journal = shard->journal(); journal && journal->HasFile()) {
+    LSN lsn = journal->MarkSnapshotPosition();
+    if (auto ec = serializer_->SaveJournalPosition(shard->shard_id(), shard_set->size(), lsn); ec)
+      cntx_->ReportError(ec);
+  }
+}
+
+// Must be called with big_value_mu_ locked, so that changes wait until the indices are streamed.
+// Changes of documents run the callback before modifying the indices, so whoever comes first,
+// the snapshot fiber or OnDbChange, serializes the indices at the snapshot point in time.
+// Indices can also change without a callback, when documents expire or by FT.* commands, so
+// if an index changed while streaming preempted, it is marked incomplete and rebuilt on load.
+void SliceSnapshot::SerializeSearchIndices() {
+  if (!search_indices_pending_)
+    return;
+  search_indices_pending_ = false;
+
+  // Prevents Heartbeat() from expiring documents while streaming preempts.
+  std::lock_guard blocking_counter_guard(*db_slice_->GetLatch());
+
+  EngineShard* shard = db_slice_->shard_owner();
+  ShardDocIndices* indices = shard->search_indices();
+  for (const string& name : indices->GetIndexNames()) {
+    if (!cntx_->IsRunning())
+      return;
+
+    ShardDocIndex* index = indices->GetIndex(name);
+    if (index == nullptr)  // dropped while the previous index was streamed
+      continue;
+
+    error_code ec = serializer_->SaveSearchIndexStart(shard->shard_id(), shard_set->size(), name);
+    if (ec) {
+      cntx_->ReportError(ec);
+      return;
+    }
+
+    const uint64_t indices_version = indices->version(), index_version = index->version();
+    auto flush_cb = [&](string_view chunk) {
+      if (ec = serializer_->SaveSearchIndexChunk(chunk); ec) {
+        cntx_->ReportError(ec);
+        return false;
+      }
+      // The index might be dropped, so its version is checked only if no indices were dropped.
+      return indices->version() == indices_version && index->version() == index_version;
+    };
+
+    string buf;
+    search::BinaryWriter writer{&buf, kMinBlobSize, std::move(flush_cb)};
+    bool complete = index->Serialize(&writer) && writer.Flush();
+    if (!complete)
+      VLOG(1) << "Search index " << name << " is saved incomplete";
+
+    if (ec = serializer_->SaveSearchIndexEnd(complete); ec) {
+      cntx_->ReportError(ec);
+      return;
+    }
+  }
+}
+
+bool SliceSnapshot::ChangesSearchDocument(const DbSlice::ChangeReq& req) const {
+  const ShardDocIndices* indices = db_slice_->shard_owner()->search_indices();
+  string scratch;
+
+  const PrimeTable::bucket_iterator* bit = req.update();
+  if (!bit) {
+    // The type of a new key is not known yet.
+    string_view key = get<string_view>(req.change);
+    return indices->MatchesAnyIndex(key, OBJ_HASH) || indices->MatchesAnyIndex(key, OBJ_JSON);
+  }
+
+  // The changed key is not known, so any document in the bucket counts.
+  PrimeTable::bucket_iterator it = *bit;
+  for (it.AdvanceIfNotOccupied(); !it.is_done(); ++it) {
+    if (indices->MatchesAnyIndex(it->first.GetSlice(&scratch), it->second.ObjType()))
+      return true;
+  }
+  return false;
+}
+
 void SliceSnapshot::StartIncremental(LSN start_lsn) {
   serializer_ = std::make_unique<RdbSerializer>(compression_mode_);
 
@@ -372,10 +470,22 @@ bool SliceSnapshot::PushSerialized(bool force) {
       // 1. We may block here too frequently, slowing down the process.
       // 2. For small bin values, we issue multiple reads for the same page, creating
       //    read factor amplification that can reach factor of ~60.
-      PrimeValue pv{entry.value.Get()};  // Might block until the future resolves.
+      string value = entry.value.Get();  // Might block until the future resolves.
 
       // TODO: to introduce RdbSerializer::SaveString that can accept a string value directly.
-      serializer_->SaveEntry(entry.key, pv, entry.expire, entry.mc_flags, entry.dbid);
+      PrimeValue pv;
+      if (entry.obj_type == OBJ_STRING) {
+        pv = PrimeValue{value};
+      } else if (auto ec = RdbLoaderBase::LoadObject(value, &pv); ec) {
+        LOG(DFATAL) << "Could not load offloaded value: " << ec.message();
+        delayed_entries_.pop_back();
+        continue;
+      }
+
+      io::Result<uint8_t> res =
+          serializer_->SaveEntry(entry.key, pv, entry.expire, entry.mc_flags, entry.dbid);
+      CHECK(res);
+      ++type_freq_map_[*res];
       delayed_entries_.pop_back();
     } while (!delayed_entries_.empty());
 
@@ -392,12 +502,16 @@ void SliceSnapshot::SerializeExternal(DbIndex db_index, PrimeKey key, const Prim
   util::fb2::Future<string> future =
       EngineShard::tlocal()->tiered_storage()->Read(db_index, key.ToString(), pv);
 
-  delayed_entries_.push_back({db_index, std::move(key), std::move(future), expire_time, mc_flags});
-  ++type_freq_map_[RDB_TYPE_STRING];
+  delayed_entries_.push_back(
+      {db_index, std::move(key), std::move(future), expire_time, mc_flags, pv.ObjType()});
 }
 
 void SliceSnapshot::OnDbChange(DbIndex db_index, const DbSlice::ChangeReq& req) {
   std::lock_guard guard(big_value_mu_);
+  uint64_t start = absl::GetCurrentTimeNanos();
+
+  if (search_indices_pending_ && ChangesSearchDocument(req))
+    SerializeSearchIndices();
 
   PrimeTable* table = db_slice_->GetTables(db_index).first;
   const PrimeTable::bucket_iterator* bit = req.update();
@@ -413,6 +527,10 @@ void SliceSnapshot::OnDbChange(DbIndex db_index, const DbSlice::ChangeReq& req)
       stats_.side_saved += SerializeBucket(db_index, it);
     });
   }
+
+  // The command that triggered the change waits for the bucket serialization.
+  ServerState::tlocal()->RecordLatencyEvent("snapshot-change",
+                                            (absl::GetCurrentTimeNanos() - start) / 1000);
 }
 
 // For any key any journal entry must arrive at the replica strictly after its first original rdb
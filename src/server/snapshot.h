@@ -68,9 +68,12 @@ class SliceSnapshot {
 
   // Initialize snapshot, start bucket iteration fiber, register listeners.
   // In journal streaming mode it needs to be stopped by either Stop or Cancel.
+  // If save_shard_state is set, the search indices and the journal position of the shard are
+  // serialized at the snapshot point in time as well.
   enum class SnapshotFlush { kAllow, kDisallow };
 
-  void Start(bool stream_journal, SnapshotFlush allow_flush = SnapshotFlush::kDisallow);
+  void Start(bool stream_journal, SnapshotFlush allow_flush = SnapshotFlush::kDisallow,
+             bool save_shard_state = false);
 
   // Initialize a snapshot that sends only the missing journal updates
   // since start_lsn and then registers a callback switches into the
@@ -111,6 +114,15 @@ class SliceSnapshot {
   // A fiber function that switches to the incremental mode
   void SwitchIncrementalFb(LSN lsn);
 
+  // Writes the position of the on-disk journal.
+  void SerializeJournalPosition();
+
+  // Streams the search indices of the shard if they were not serialized yet.
+  void SerializeSearchIndices();
+
+  // Returns true if the change might modify a document of a search index.
+  bool ChangesSearchDocument(const DbSlice::ChangeReq& req) const;
+
   // Called on traversing cursor by IterateBucketsFb.
   bool BucketSaveCb(DbIndex db_index, PrimeTable::bucket_iterator it);
 
@@ -146,6 +158,7 @@ class SliceSnapshot {
     util::fb2::Future<string> value;
     time_t expire;
     uint32_t mc_flags;
+    CompactObjType obj_type;  // containers are read in their serialized form.
   };
 
   DbSlice* db_slice_;
@@ -156,6 +169,9 @@ class SliceSnapshot {
 
   // Used for sanity checks.
   bool serialize_bucket_running_ = false;
+
+  // Set until the search indices are streamed, see SerializeSearchIndices.
+  bool search_indices_pending_ = false;
   util::fb2::Fiber snapshot_fb_;  // IterateEntriesFb
   util::fb2::CondVarAny seq_cond_;
   const CompressionMode compression_mode_;
@@ -35,6 +35,10 @@
 #include "server/transaction.h"
 #include "util/fibers/future.h"
 
+ABSL_FLAG(uint32_t, zero_copy_reply_min_size, 1 << 16,
+          "GET replies with binary string values of at least this size are sent straight from "
+          "the table without copying them, 0 - disabled");
+
 namespace dfly {
 
 namespace {
@@ -382,16 +386,21 @@ OpStatus OpMSet(const OpArgs& op_args, const ShardArgs& args) {
 
   OpStatus result = OpStatus::OK;
   size_t stored = 0;
-  for (auto it = args.begin(); it != args.end();) {
+  auto& db_slice = op_args.GetDbSlice();
+  auto set_cb = [&](auto it) {
+    if (result != OpStatus::OK)  // stop at the first failure
+      return;
+
     string_view key = *(it++);
-    string_view value = *(it++);
+    string_view value = *it;
     if (auto status = sg.Set(params, key, value); status != OpStatus::OK) {
       result = status;
-      break;
+      return;
     }
 
     stored++;
-  }
+  };
+  db_slice.ForEachPrefetched(op_args.db_cntx.db_index, args.begin(), args.end(), set_cb, 2);
 
   // Above loop could have parial success (e.g. OOM), so replicate only what was
   // changed
@@ -559,20 +568,22 @@ MGetResponse OpMGet(fb2::BlockingCounter wait_bc, uint8_t fetch_mask, const Tran
   unsigned index = 0;
   key_index.reserve(keys.Size());
 
-  for (string_view key : keys) {
+  DbContext db_cntx = t->GetDbContext();
+  db_slice.ForEachPrefetched(db_cntx.db_index, keys.begin(), keys.end(), [&](auto key_it) {
+    string_view key = *key_it;
     auto [it, inserted] = key_index.try_emplace(key, index);
     if (!inserted) {  // duplicate -> point to the first occurrence.
       items[index++].source_index = it->second;
-      continue;
+      return;
     }
 
-    auto it_res = db_slice.FindReadOnly(t->GetDbContext(), key, OBJ_STRING);
+    auto it_res = db_slice.FindReadOnly(db_cntx, key, OBJ_STRING);
     auto& dest = items[index++];
     if (it_res) {
       dest.it = *it_res;
       total_size += (*it_res)->second.Size();
     }
-  }
+  });
 
   VLOG_IF(1, total_size > 10000000) << "OpMGet: allocating " << total_size << " bytes";
 
@@ -581,6 +592,12 @@ MGetResponse OpMGet(fb2::BlockingCounter wait_bc, uint8_t fetch_mask, const Tran
   char* next = response.storage.get();
   bool fetch_mcflag = fetch_mask & FETCH_MCFLAG;
   bool fetch_mcver = fetch_mask & FETCH_MCVER;
+
+  // Tiered reads of all the keys are submitted together, coalescing adjacent pages.
+  TieredStorage* tiered_storage = shard->tiered_storage();
+  if (tiered_storage)
+    tiered_storage->StartReadBatch();
+
   for (size_t i = 0; i < items.size(); ++i) {
     auto it = items[i].it;
     if (it.is_done()) {
@@ -599,7 +616,7 @@ MGetResponse OpMGet(fb2::BlockingCounter wait_bc, uint8_t fetch_mask, const Tran
         memcpy(next, v.data(), v.size());
         wait_bc->Dec();
       };
-      shard->tiered_storage()->Read(t->GetDbIndex(), it.key(), it->second, std::move(cb));
+      tiered_storage->Read(t->GetDbIndex(), it.key(), it->second, std::move(cb));
     } else {
       CopyValueToBuffer(it->second, next);
     }
@@ -620,6 +637,9 @@ MGetResponse OpMGet(fb2::BlockingCounter wait_bc, uint8_t fetch_mask, const Tran
   }
   key_index.clear();
 
+  if (tiered_storage)
+    tiered_storage->SubmitReadBatch();
+
   return response;
 }
 
@@ -791,6 +811,59 @@ void IncrByGeneric(string_view key, int64_t val, Transaction* tx, SinkReplyBuild
   }
 }
 
+// Replies with large raw string values straight from the prime table. Instead of concluding,
+// the hop keeps the key read-locked while the reply is written to the socket and the lock is
+// released by a follow-up hop, which does not add to the latency observed by the client.
+// Values with expiry are copied as usual, because they can be deleted by other readers.
+void GetZeroCopy(string_view key, size_t min_size, const CommandContext& cmnd_cntx) {
+  OpResult<StringValue> res;
+  string_view pinned;
+
+  auto cb = [&](Transaction* tx, EngineShard* es) -> Transaction::RunnableResult {
+    auto& db_slice = tx->GetDbSlice(es->shard_id());
+    auto it_res = db_slice.FindReadOnly(tx->GetDbContext(), key, OBJ_STRING);
+    if (!it_res.ok()) {
+      res = it_res.status();
+      return OpStatus::OK;
+    }
+
+    const PrimeValue& pv = (*it_res)->second;
+    if (pv.IsExternal() || pv.HasStashPending() || pv.HasExpire() || pv.Size() < min_size) {
+      res = StringValue::Read(tx->GetDbIndex(), key, pv, es);
+      return OpStatus::OK;
+    }
+
+    // Encoded values are decoded into the scratch buffer and can not be referenced.
+    string scratch;
+    string_view value = pv.GetSlice(&scratch);
+    if (value.data() == scratch.data()) {
+      res = StringValue{std::move(scratch)};
+      return OpStatus::OK;
+    }
+
+    db_slice.PinValue();
+    pinned = value;
+    return {OpStatus::OK, Transaction::RunnableResult::AVOID_CONCLUDING};
+  };
+
+  Transaction* tx = cmnd_cntx.tx;
+  tx->ScheduleSingleHop(cb);
+
+  GetReplies replies{cmnd_cntx.rb};
+  if (pinned.empty())
+    return replies.Send(std::move(res));
+
+  // Large strings are written to the socket before SendBulkString returns.
+  replies.rb->SendBulkString(pinned);
+
+  tx->Execute(
+      [](Transaction* t, EngineShard* es) {
+        t->GetDbSlice(es->shard_id()).UnpinValue();
+        return OpStatus::OK;
+      },
+      true);
+}
+
 }  // namespace
 
 StringValue StringValue::Read(DbIndex dbid, string_view key, const PrimeValue& pv,
@@ -1108,7 +1181,12 @@ void StringFamily::SetNx(CmdArgList args, const CommandContext& cmnd_cntx) {
 }
 
 void StringFamily::Get(CmdArgList args, const CommandContext& cmnd_cntx) {
-  auto cb = [key = ArgS(args, 0)](Transaction* tx, EngineShard* es) -> OpResult<StringValue> {
+  string_view key = ArgS(args, 0);
+  size_t min_size = absl::GetFlag(FLAGS_zero_copy_reply_min_size);
+  if (min_size > 0 && !cmnd_cntx.tx->IsMulti())
+    return GetZeroCopy(key, max(min_size, SinkReplyBuilder::kMinDirectRefSize), cmnd_cntx);
+
+  auto cb = [key](Transaction* tx, EngineShard* es) -> OpResult<StringValue> {
     auto it_res = tx->GetDbSlice(es->shard_id()).FindReadOnly(tx->GetDbContext(), key, OBJ_STRING);
     if (!it_res.ok())
       return it_res.status();
@@ -1339,10 +1417,9 @@ void StringFamily::MGet(CmdArgList args, const CommandContext& cmnd_cntx) {
   // The code below is safe in the context of squashing (uses CapturingReplyBuilder).
   // Specifically:
   // 1. For Memcache:
-  //    builder != CapturingReplyBuilder here because this is only used in squashing
-  //    and there are only two cases:
-  //    * Squashing the pipeline something that is turned off when using MEMCACHE.
-  //    * Squashing a multi/exec block. There exist no such command in MEMCACHE.
+  //    builder != CapturingReplyBuilder here because squashed memcache pipelines are
+  //    executed with a MCReplyBuilder that serializes the replies on the shard, and there
+  //    exist no multi/exec blocks in MEMCACHE.
   //    Therefore this path is safe, and the DCHECK in the if statement below shall
   //    never trigger.
   // 2. For Redis:
@@ -213,6 +213,32 @@ TEST_F(StringFamilyTest, SetHugeKey) {
   Run({"del", key});
 }
 
+TEST_F(StringFamilyTest, GetLargeValueZeroCopy) {
+  // Binary values are stored as is and are sent straight from the table, ascii values are packed.
+  string binary(300000, '\xff');
+  for (size_t i = 0; i < binary.size(); i += 7)
+    binary[i] = char(i % 256);
+  const string ascii(300000, 'a');
+
+  Run({"set", "binary", binary});
+  Run({"set", "ascii", ascii});
+  Run({"set", "ttl", binary, "ex", "100"});
+
+  EXPECT_EQ(Run({"get", "binary"}), binary);
+  EXPECT_FALSE(IsLocked(0, "binary"));
+  EXPECT_EQ(Run({"get", "ascii"}), ascii);
+  EXPECT_EQ(Run({"get", "ttl"}), binary);
+  EXPECT_THAT(Run({"get", "missing"}), ArgType(RespExpr::NIL));
+
+  // The key is released once the reply was sent.
+  EXPECT_THAT(Run({"append", "binary", "x"}), IntArg(300001));
+  EXPECT_EQ(Run({"get", "binary"}), binary + "x");
+
+  absl::FlagSaver fs;
+  SetTestFlag("zero_copy_reply_min_size", "0");
+  EXPECT_EQ(Run({"get", "binary"}), binary + "x");
+}
+
 TEST_F(StringFamilyTest, MSetLong) {
   vector<string> command({"mset"});
   for (unsigned i = 0; i < 12000; ++i) {
@@ -223,6 +249,41 @@ TEST_F(StringFamilyTest, MSetLong) {
   EXPECT_EQ(resp, "OK");
 }
 
+TEST_F(StringFamilyTest, MultiKeyBatches) {
+  // Spans several prefetch batches per shard.
+  vector<string> mset({"mset"}), mget({"mget"}), keys;
+  for (unsigned i = 0; i < 100; ++i) {
+    keys.push_back(StrCat("key", i));
+    mset.push_back(keys.back());
+    mset.push_back(StrCat(i));
+  }
+  EXPECT_EQ(Run(absl::MakeSpan(mset)), "OK");
+
+  for (unsigned i = 0; i < 120; ++i)
+    mget.push_back(i % 3 == 2 ? keys[i % 100] : StrCat("key", i));
+
+  auto resp = Run(absl::MakeSpan(mget));
+  ASSERT_THAT(resp, ArrLen(120));
+  const auto& arr = resp.GetVec();
+  for (unsigned i = 0; i < 120; ++i) {
+    unsigned key_i = i % 3 == 2 ? i % 100 : i;
+    if (key_i < 100)
+      EXPECT_EQ(arr[i], StrCat(key_i)) << i;
+    else
+      EXPECT_EQ(arr[i].type, RespExpr::NIL) << i;
+  }
+
+  vector<string> exists({"exists"}), del({"del"});
+  for (unsigned i = 50; i < 150; ++i) {
+    exists.push_back(StrCat("key", i));
+    del.push_back(StrCat("key", i));
+  }
+  EXPECT_THAT(Run(absl::MakeSpan(exists)), IntArg(50));
+  EXPECT_THAT(Run(absl::MakeSpan(del)), IntArg(50));
+  EXPECT_THAT(Run(absl::MakeSpan(exists)), IntArg(0));
+  EXPECT_EQ(50, CheckedInt({"dbsize"}));
+}
+
 TEST_F(StringFamilyTest, MGetSet) {
   Run({"mset", "z", "0"});         // single key
   auto resp = Run({"mget", "z"});  // single key
@@ -526,6 +526,21 @@ auto BaseFamilyTest::GetMC(MP::CmdType cmd_type, std::initializer_list<std::stri
   return conn->SplitLines();
 }
 
+auto BaseFamilyTest::RunMCPipeline(absl::Span<const facade::MCCommandRef> cmds) -> MCResponse {
+  if (!ProactorBase::IsProactorThread()) {
+    return pp_->at(0)->Await([&] { return this->RunMCPipeline(cmds); });
+  }
+
+  TestConnWrapper* conn = AddFindConn(Protocol::MEMCACHE, GetId());
+
+  auto* context = conn->cmd_cntx();
+  size_t dispatched = service_->DispatchManyMCCommands(
+      cmds, static_cast<MCReplyBuilder*>(conn->builder()), context);
+  CHECK_EQ(dispatched, cmds.size());
+
+  return conn->SplitLines();
+}
+
 int64_t BaseFamilyTest::CheckedInt(ArgSlice list) {
   RespExpr resp = Run(list);
   if (resp.type == RespExpr::INT64) {
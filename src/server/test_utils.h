@@ -91,6 +91,8 @@ class BaseFamilyTest : public ::testing::Test {
                    uint32_t flags = 0, std::chrono::seconds ttl = std::chrono::seconds{});
   MCResponse RunMC(MemcacheParser::CmdType cmd_type, std::string_view key = std::string_view{});
   MCResponse GetMC(MemcacheParser::CmdType cmd_type, std::initializer_list<std::string_view> list);
+  // Runs the memcache commands as one squashed pipeline.
+  MCResponse RunMCPipeline(absl::Span<const facade::MCCommandRef> cmds);
 
   int64_t CheckedInt(std::initializer_list<std::string_view> list) {
     return CheckedInt(ArgSlice{list.begin(), list.size()});
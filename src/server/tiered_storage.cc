@@ -4,8 +4,10 @@
 
 #include "server/tiered_storage.h"
 
+#include <absl/time/clock.h>
 #include <mimalloc.h>
 
+#include <atomic>
 #include <cstddef>
 #include <memory>
 #include <optional>
@@ -18,6 +20,10 @@
 #include "server/common.h"
 #include "server/db_slice.h"
 #include "server/engine_shard_set.h"
+#include "server/rdb_load.h"
+#include "server/rdb_save.h"
+#include "server/search/doc_index.h"
+#include "server/server_state.h"
 #include "server/snapshot.h"
 #include "server/table.h"
 #include "server/tiering/common.h"
@@ -31,8 +37,14 @@ ABSL_FLAG(bool, tiered_experimental_cooling, true,
           "If true, uses intermidate cooling layer "
           "when offloading values to storage");
 
+ABSL_FLAG(bool, tiered_experimental_containers, false,
+          "If true, offloads hashes, sets, lists and json values in addition to strings");
+
 ABSL_FLAG(unsigned, tiered_storage_write_depth, 50,
           "Maximum number of concurrent stash requests issued by background offload");
+ABSL_FLAG(float, tiered_compaction_threshold, 0.25,
+          "Entries of backing file pages with a lower ratio of used space are relocated to "
+          "free the pages. 0 disables relocation");
 ABSL_FLAG(float, tiered_low_memory_factor, 0.1,
           "Determines the low limit per shard that "
           "tiered storage should not cross");
@@ -70,6 +82,11 @@ string DecodeString(bool is_raw, string_view str, PrimeValue decoder) {
   return string{str};
 }
 
+// Containers are offloaded in their serialized form, see SerializerBase::SerializeObject.
+bool IsOffloadableContainer(CompactObjType type) {
+  return type == OBJ_HASH || type == OBJ_SET || type == OBJ_LIST || type == OBJ_JSON;
+}
+
 tiering::DiskSegment FromCoolItem(const PrimeValue::CoolItem& item) {
   return {item.record->page_index * tiering::kPageSize + item.page_offset, item.serialized_size};
 }
@@ -102,6 +119,12 @@ class TieredStorage::ShardOpManager : public tiering::OpManager {
     return db_slice_.MutableStats(dbid);
   }
 
+  // Transactions access containers only in memory, so containers are not offloaded while their
+  // keys are locked. Coordinators upload them before locking the keys, see FetchContainers.
+  bool IsKeyLocked(DbIndex dbid, string_view key) const {
+    return !db_slice_.CheckLock(IntentLock::EXCLUSIVE, dbid, key);
+  }
+
   void DeleteOffloaded(DbIndex dbid, const tiering::DiskSegment& segment);
 
  private:
@@ -137,7 +160,17 @@ class TieredStorage::ShardOpManager : public tiering::OpManager {
   void Upload(DbIndex dbid, string_view value, bool is_raw, size_t serialized_len, PrimeValue* pv) {
     DCHECK(!value.empty());
 
-    pv->Materialize(value, is_raw);
+    if (pv->ObjType() == OBJ_STRING) {
+      pv->Materialize(value, is_raw);
+    } else {
+      // Containers are never modified in their serialized form, so is_raw is irrelevant.
+      PrimeValue obj;
+      if (auto ec = RdbLoaderBase::LoadObject(value, &obj); ec) {
+        LOG(DFATAL) << "Could not load offloaded value: " << ec.message();
+        return;
+      }
+      pv->Materialize(std::move(obj));
+    }
     RecordDeleted(*pv, serialized_len, GetDbTableStats(dbid));
   }
 
@@ -148,11 +181,20 @@ class TieredStorage::ShardOpManager : public tiering::OpManager {
       auto* stats = GetDbTableStats(key.first);
 
       pv->SetStashPending(false);
+
+      // Cool values stay in memory, so only the fully offloaded containers are checked.
+      bool cooling = absl::GetFlag(FLAGS_tiered_experimental_cooling);
+      if (!cooling && pv->ObjType() != OBJ_STRING && IsKeyLocked(key.first, key.second)) {
+        OpManager::DeleteOffloaded(segment);
+        stats_.total_cancels++;
+        return;
+      }
+
       stats->tiered_entries++;
       stats->tiered_used_bytes += segment.length;
       stats_.total_stashes++;
 
-      if (absl::GetFlag(FLAGS_tiered_experimental_cooling)) {
+      if (cooling) {
         RetireColdEntries(pv->MallocUsed());
         ts_->CoolDown(key.first, key.second, segment, pv);
       } else {
@@ -259,6 +301,9 @@ bool TieredStorage::ShardOpManager::NotifyFetched(EntryId id, string_view value,
 bool TieredStorage::ShardOpManager::NotifyDelete(tiering::DiskSegment segment) {
   DVLOG(2) << "NotifyDelete [" << segment.offset << "," << segment.length << "]";
 
+  if (!ts_->prefetched_.empty())
+    ts_->prefetched_.erase(pair{segment.offset, segment.length});
+
   if (OccupiesWholePages(segment.length))
     return true;
 
@@ -347,17 +392,141 @@ void TieredStorage::Read(DbIndex dbid, std::string_view key, const PrimeValue& v
   DCHECK(value.IsExternal());
   DCHECK(!value.IsCool());
 
+  // Values prefetched by the running hop are served directly, unless modifications are pending.
+  if (!prefetched_.empty()) {
+    auto it = prefetched_.find(value.GetExternalSlice());
+    if (it != prefetched_.end() && !op_manager_->HasPendingOps(value.GetExternalSlice())) {
+      readf(it->second);
+      return;
+    }
+  }
+
   PrimeValue decoder;
   decoder.ImportExternal(value);
 
-  auto cb = [readf = std::move(readf), decoder = std::move(decoder)](
-                bool is_raw, const string* raw_val) mutable {
-    readf(DecodeString(is_raw, *raw_val, std::move(decoder)));
+  // Containers are passed in their serialized form.
+  auto cb = [readf = std::move(readf), decoder = std::move(decoder),
+             start = absl::GetCurrentTimeNanos()](bool is_raw, const string* raw_val) mutable {
+    // The reader waits for the disk, so slow reads are reported as latency spikes.
+    ServerState::tlocal()->RecordLatencyEvent("tiering-read",
+                                              (absl::GetCurrentTimeNanos() - start) / 1000);
+    if (decoder.ObjType() == OBJ_STRING)
+      readf(DecodeString(is_raw, *raw_val, std::move(decoder)));
+    else
+      readf(*raw_val);
     return false;
   };
   op_manager_->Enqueue(KeyRef(dbid, key), value.GetExternalSlice(), std::move(cb));
 }
 
+void TieredStorage::FetchContainerAsync(DbIndex dbid, std::string_view key,
+                                        const PrimeValue& value) {
+  DCHECK(value.IsExternal());
+  DCHECK(!value.IsCool());
+  DCHECK_NE(value.ObjType(), OBJ_STRING);
+
+  // Reporting the value as modified makes the op manager upload it back to memory.
+  auto cb = [](bool is_raw, std::string* raw_val) { return true; };
+  op_manager_->Enqueue(KeyRef(dbid, key), value.GetExternalSlice(), std::move(cb));
+}
+
+void TieredStorage::FetchContainers(DbIndex dbid, absl::Span<const std::string_view> keys) {
+  PrimeTable& table = op_manager_->db_slice_.GetDBTable(dbid)->prime;
+  util::fb2::BlockingCounter bc{0};
+
+  op_manager_->StartReadBatch();
+  for (string_view key : keys) {
+    auto it = table.Find(key);
+    if (!IsValid(it) || it->second.ObjType() == OBJ_STRING)
+      continue;
+
+    // Otherwise the containers could be offloaded before the transaction locks their keys.
+    PrimeValue& pv = it->second;
+    if (pv.HasStashPending()) {
+      CancelStash(dbid, key, &pv);
+      continue;
+    }
+    if (pv.IsCool()) {
+      pv = Warmup(dbid, pv.GetCool());
+      continue;
+    }
+    if (!pv.IsExternal())
+      continue;
+
+    // Reporting the value as modified makes the op manager upload it back to memory.
+    auto cb = [bc](bool is_raw, std::string* raw_val) mutable {
+      bc->Dec();
+      return true;
+    };
+    bc->Add(1);
+    op_manager_->Enqueue(KeyRef(dbid, key), it->second.GetExternalSlice(), std::move(cb));
+  }
+  op_manager_->SubmitReadBatch();
+
+  bc->Wait();
+}
+
+bool TieredStorage::MayOffloadContainers() {
+  return absl::GetFlag(FLAGS_tiered_experimental_containers);
+}
+
+void TieredStorage::StartReadBatch() {
+  op_manager_->StartReadBatch();
+}
+
+void TieredStorage::SubmitReadBatch() {
+  op_manager_->SubmitReadBatch();
+}
+
+void TieredStorage::Prefetch(DbIndex dbid, absl::Span<const std::string_view> keys) {
+  PrimeTable& table = op_manager_->db_slice_.GetDBTable(dbid)->prime;
+  util::fb2::BlockingCounter bc{0};
+  size_t total_size = 0;
+  ++prefetch_refs_;
+
+  op_manager_->StartReadBatch();
+  for (string_view key : keys) {
+    auto it = table.Find(key);
+    if (!IsValid(it) || !it->second.IsExternal() || it->second.IsCool())
+      continue;
+
+    const PrimeValue& pv = it->second;
+    auto segment = pv.GetExternalSlice();
+    if (prefetched_.contains(segment))
+      continue;
+
+    // Leave the rest to regular reads if keeping the values would drain the memory.
+    total_size += pv.Size();
+    if (!op_manager_->HasEnoughMemoryMargin(total_size))
+      break;
+
+    PrimeValue decoder;
+    decoder.ImportExternal(pv);
+
+    // The values are not reported as modified, so they stay offloaded.
+    auto cb = [this, bc, segment, decoder = std::move(decoder)](bool is_raw,
+                                                               std::string* raw_val) mutable {
+      if (decoder.ObjType() == OBJ_STRING)
+        prefetched_[segment] = DecodeString(is_raw, *raw_val, std::move(decoder));
+      else
+        prefetched_[segment] = *raw_val;
+      bc->Dec();
+      return false;
+    };
+    bc->Add(1);
+    op_manager_->Enqueue(KeyRef(dbid, key), segment, std::move(cb));
+  }
+  op_manager_->SubmitReadBatch();
+
+  bc->Wait();
+}
+
+void TieredStorage::ReleasePrefetched() {
+  DCHECK_GT(prefetch_refs_, 0u);
+  if (--prefetch_refs_ == 0)
+    prefetched_.clear();
+}
+
 template <typename T>
 util::fb2::Future<T> TieredStorage::Modify(DbIndex dbid, std::string_view key,
                                            const PrimeValue& value,
@@ -400,17 +569,32 @@ bool TieredStorage::TryStash(DbIndex dbid, string_view key, PrimeValue* value) {
     return false;
   }
 
-  StringOrView raw_string = value->GetRawString();
-  value->SetStashPending(true);
-
   tiering::OpManager::EntryId id;
   error_code ec;
-  if (OccupiesWholePages(value->Size())) {  // large enough for own page
+
+  if (value->ObjType() != OBJ_STRING) {
+    // Containers always occupy whole pages, so that their segments are never mistaken for bins.
+    io::StringSink sink;
+    SerializerBase::SerializeObject(*value, &sink);
+    string blob = std::move(sink).str();
+    if (blob.size() < kMinOccupancySize)
+      blob.resize(kMinOccupancySize);  // LoadObject ignores the padding.
+
+    value->SetStashPending(true);
+    containers_offloaded_ = true;
     id = KeyRef(dbid, key);
-    ec = op_manager_->Stash(id, raw_string.view());
-  } else if (auto bin = bins_->Stash(dbid, key, raw_string.view()); bin) {
-    id = bin->first;
-    ec = op_manager_->Stash(id, bin->second);
+    ec = op_manager_->Stash(id, blob);
+  } else {
+    StringOrView raw_string = value->GetRawString();
+    value->SetStashPending(true);
+
+    if (OccupiesWholePages(value->Size())) {  // large enough for own page
+      id = KeyRef(dbid, key);
+      ec = op_manager_->Stash(id, raw_string.view());
+    } else if (auto bin = bins_->Stash(dbid, key, raw_string.view()); bin) {
+      id = bin->first;
+      ec = op_manager_->Stash(id, bin->second);
+    }
   }
 
   if (ec) {
@@ -430,8 +614,7 @@ void TieredStorage::Delete(DbIndex dbid, PrimeValue* value) {
 
   tiering::DiskSegment segment = value->GetExternalSlice();
   if (value->IsCool()) {
-    auto hot = DeleteCool(value->GetCool().record);
-    DCHECK_EQ(hot.ObjType(), OBJ_STRING);
+    DeleteCool(value->GetCool().record);
   }
 
   // In any case we delete the offloaded segment and reset the value.
@@ -441,7 +624,7 @@ void TieredStorage::Delete(DbIndex dbid, PrimeValue* value) {
 
 void TieredStorage::CancelStash(DbIndex dbid, std::string_view key, PrimeValue* value) {
   DCHECK(value->HasStashPending());
-  if (OccupiesWholePages(value->Size())) {
+  if (value->ObjType() != OBJ_STRING || OccupiesWholePages(value->Size())) {
     op_manager_->Delete(KeyRef(dbid, key));
   } else if (auto bin = bins_->Delete(dbid, key); bin) {
     op_manager_->Delete(*bin);
@@ -473,6 +656,7 @@ TieredStats TieredStorage::GetStats() const {
     stats.capacity_bytes = op_stats.disk_stats.capacity_bytes;
     stats.total_heap_buf_allocs = op_stats.disk_stats.heap_buf_alloc_count;
     stats.total_registered_buf_allocs = op_stats.disk_stats.registered_buf_alloc_count;
+    stats.released_bytes = op_stats.disk_stats.released_bytes;
   }
 
   {  // SmallBins stats
@@ -487,6 +671,8 @@ TieredStats TieredStorage::GetStats() const {
     stats.cold_storage_bytes = stats_.cool_memory_used;
     stats.total_offloading_steps = stats_.offloading_steps;
     stats.total_offloading_stashes = stats_.offloading_stashes;
+    stats.total_compactions = stats_.compactions;
+    stats.total_relocations = stats_.relocations;
   }
   return stats;
 }
@@ -509,7 +695,7 @@ void TieredStorage::RunOffloading(DbIndex dbid) {
     if (ShouldStash(it->second)) {
       if (it->first.WasTouched()) {
         it->first.SetTouched(false);
-      } else {
+      } else if (op_manager_->db_slice_.CanMoveValue(dbid, it->first)) {
         stats_.offloading_stashes++;
         TryStash(dbid, it->first.GetSlice(&tmp), &it->second);
       }
@@ -529,6 +715,101 @@ void TieredStorage::RunOffloading(DbIndex dbid) {
   } while (offloading_cursor_ != start_cursor && iterations++ < kMaxIterations);
 }
 
+void TieredStorage::RunCompaction() {
+  const size_t kMaxIterations = 500;
+  const size_t kMaxReleasedBytes = 64UL << 20;
+  const unsigned kMaxEvacuatedPages = 16;
+  const auto kPassInterval = chrono::seconds(1);
+
+  tiering::DiskStorage& storage = op_manager_->storage_;
+  storage.ReleaseFreePages(kMaxReleasedBytes);
+
+  float threshold = absl::GetFlag(FLAGS_tiered_compaction_threshold);
+  if (threshold <= 0 || SliceSnapshot::IsSnaphotInProgress())
+    return;
+
+  if (!compacting_) {
+    // Looking for sparse pages scans all of them, so don't do it too often.
+    auto now = chrono::steady_clock::now();
+    if (now < next_compaction_)
+      return;
+
+    next_compaction_ = now + kPassInterval;
+    if (storage.StartEvacuation(threshold, kMaxEvacuatedPages) == 0)
+      return;
+
+    compacting_ = true;
+    compaction_db_ = 0;
+    compaction_cursor_ = {};
+    stats_.compactions++;
+  }
+
+  DbIndex dbid = 0;
+  size_t total_size = 0;
+  string tmp;
+  auto cb = [&](PrimeIterator it) {
+    PrimeValue& pv = it->second;
+    if (!pv.IsExternal())
+      return;
+
+    // Cool values are still in memory, just drop their storage.
+    if (pv.IsCool()) {
+      if (storage.IsEvacuating(FromCoolItem(pv.GetCool()))) {
+        pv = Warmup(dbid, pv.GetCool());
+        stats_.relocations++;
+      }
+      return;
+    }
+
+    if (!storage.IsEvacuating(pv.GetExternalSlice()))
+      return;
+
+    total_size += pv.Size();
+    if (!op_manager_->HasEnoughMemoryMargin(total_size))
+      return;
+
+    PrimeValue decoder;
+    decoder.ImportExternal(pv);
+
+    // Reporting the value as modified makes the op manager upload it back to memory.
+    auto read_cb = [decoder = std::move(decoder)](bool is_raw, std::string* raw_val) mutable {
+      if (is_raw && decoder.ObjType() == OBJ_STRING) {
+        decoder.Materialize(*raw_val, true);
+        decoder.GetString(raw_val);
+      }
+      return true;
+    };
+    op_manager_->Enqueue(KeyRef(dbid, it->first.GetSlice(&tmp)), pv.GetExternalSlice(),
+                         std::move(read_cb));
+    stats_.relocations++;
+  };
+
+  DbSlice& db_slice = op_manager_->db_slice_;
+  size_t iterations = 0;
+
+  op_manager_->StartReadBatch();
+  while (iterations++ < kMaxIterations) {
+    if (compaction_db_ >= db_slice.db_array_size()) {
+      // The pass is over, pages that still have entries are used for allocations again.
+      storage.StopEvacuation();
+      compacting_ = false;
+      break;
+    }
+
+    if (!db_slice.IsDbValid(compaction_db_)) {
+      ++compaction_db_;
+      continue;
+    }
+
+    dbid = compaction_db_;
+    PrimeTable& table = db_slice.GetDBTable(dbid)->prime;
+    compaction_cursor_ = table.TraverseBySegmentOrder(compaction_cursor_, cb);
+    if (!compaction_cursor_)
+      ++compaction_db_;
+  }
+  op_manager_->SubmitReadBatch();
+}
+
 size_t TieredStorage::ReclaimMemory(size_t goal) {
   size_t gained = 0;
   do {
@@ -537,19 +818,30 @@ size_t TieredStorage::ReclaimMemory(size_t goal) {
     if (record == nullptr)  // nothing to pull anymore
       break;
 
-    gained += memory_before - stats_.cool_memory_used;
-
     // Find the entry that points to the cool item and externalize it.
     auto predicate = [record](const PrimeKey& key, const PrimeValue& probe) {
       return probe.IsExternal() && probe.IsCool() && probe.GetCool().record == record;
     };
 
-    PrimeIterator it = op_manager_->db_slice_.GetDBTable(record->db_index)
-                           ->prime.FindFirst(record->key_hash, predicate);
+    DbIndex dbid = record->db_index;
+    PrimeIterator it =
+        op_manager_->db_slice_.GetDBTable(dbid)->prime.FindFirst(record->key_hash, predicate);
     CHECK(IsValid(it));
     PrimeValue& pv = it->second;
     tiering::DiskSegment segment = FromCoolItem(pv.GetCool());
 
+    // Containers of locked keys are warmed up instead, see ShardOpManager::IsKeyLocked.
+    string tmp;
+    if (record->value.ObjType() != OBJ_STRING &&
+        op_manager_->IsKeyLocked(dbid, it->first.GetSlice(&tmp))) {
+      pv = std::move(record->value);
+      CompactObj::DeleteMR<detail::TieredColdRecord>(record);
+      op_manager_->DeleteOffloaded(dbid, segment);
+      continue;
+    }
+
+    gained += memory_before - stats_.cool_memory_used;
+
     // Now the item is only in storage.
     pv.SetExternal(segment.offset, segment.length);
 
@@ -562,10 +854,29 @@ size_t TieredStorage::ReclaimMemory(size_t goal) {
 }
 
 bool TieredStorage::ShouldStash(const PrimeValue& pv) const {
+  if (pv.IsExternal() || pv.HasStashPending())
+    return false;
+
+  size_t size = 0;
+  if (pv.ObjType() == OBJ_STRING) {
+    // Huffman encoded values may be inlined despite their size, those can not be stashed.
+    if (pv.IsInline() || pv.Size() < kMinValueSize)
+      return false;
+    size = pv.Size();
+  } else {
+    // Search indices access documents directly, so containers stay in memory while they exist.
+    if (!absl::GetFlag(FLAGS_tiered_experimental_containers) ||
+        !IsOffloadableContainer(pv.ObjType()) ||
+        EngineShard::tlocal()->search_indices()->HasIndices())
+      return false;
+
+    size = pv.MallocUsed();
+    if (size < kMinOccupancySize)
+      return false;
+  }
+
   const auto& disk_stats = op_manager_->GetStats().disk_stats;
-  return !pv.IsExternal() && !pv.HasStashPending() && pv.ObjType() == OBJ_STRING &&
-         pv.Size() >= kMinValueSize &&
-         disk_stats.allocated_bytes + tiering::kPageSize + pv.Size() < disk_stats.max_file_size;
+  return disk_stats.allocated_bytes + tiering::kPageSize + size < disk_stats.max_file_size;
 }
 
 void TieredStorage::CoolDown(DbIndex db_ind, std::string_view str,
@@ -580,7 +891,7 @@ void TieredStorage::CoolDown(DbIndex db_ind, std::string_view str,
   record->value = std::move(*pv);
 
   pv->SetCool(segment.offset, segment.length, record);
-  DCHECK_EQ(pv->Size(), record->value.Size());
+  DCHECK(pv->ObjType() != OBJ_STRING || pv->Size() == record->value.Size());
 }
 
 PrimeValue TieredStorage::Warmup(DbIndex dbid, PrimeValue::CoolItem item) {
@@ -591,8 +902,6 @@ PrimeValue TieredStorage::Warmup(DbIndex dbid, PrimeValue::CoolItem item) {
   op_manager_->DeleteOffloaded(dbid, segment);
 
   // Bring it back to the PrimeTable.
-  DCHECK(hot.ObjType() == OBJ_STRING);
-
   return hot;
 }
 
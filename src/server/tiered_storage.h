@@ -3,7 +3,10 @@
 //
 #pragma once
 
+#include <absl/types/span.h>
+
 #include <boost/intrusive/list.hpp>
+#include <chrono>
 #include <memory>
 #include <utility>
 
@@ -46,13 +49,44 @@ class TieredStorage {
 
   void SetMemoryLowWatermark(size_t mem_limit);
 
-  // Read offloaded value. It must be of external type
+  // Read offloaded value. It must be of external type. Containers are read in their serialized
+  // form, which can be loaded with RdbLoaderBase::LoadObject.
   util::fb2::Future<std::string> Read(DbIndex dbid, std::string_view key, const PrimeValue& value);
 
   // Read offloaded value. It must be of external type
   void Read(DbIndex dbid, std::string_view key, const PrimeValue& value,
             std::function<void(const std::string&)> readf);
 
+  // Starts loading an offloaded container back to memory without waiting for it.
+  // The value must be external and not cool.
+  void FetchContainerAsync(DbIndex dbid, std::string_view key, const PrimeValue& value);
+
+  // Loads the offloaded containers among the keys back to memory with one batch of disk reads.
+  // Blocks until they are uploaded, so it must not run inside the transaction queue. Pending
+  // stashes of the containers are cancelled and cool ones are warmed up. Containers are not
+  // offloaded while their keys are locked, so they stay in memory for the transaction.
+  void FetchContainers(DbIndex dbid, absl::Span<const std::string_view> keys);
+
+  // Whether containers can be offloaded at all. Can be called from any thread.
+  static bool MayOffloadContainers();
+
+  // Whether this shard has started offloading containers since startup.
+  bool HasOffloadedContainers() const {
+    return containers_offloaded_;
+  }
+
+  // Reads issued between the calls are coalesced and submitted together.
+  // The calling fiber must not preempt in between.
+  void StartReadBatch();
+  void SubmitReadBatch();
+
+  // Reads offloaded values of the keys with a single batch of disk reads and keeps them decoded
+  // until the matching ReleasePrefetched(), so that Read() serves them without waiting for the
+  // disk. The values stay offloaded. Blocks until all reads complete, so it must not run inside
+  // the transaction queue. Missing and in-memory keys are ignored.
+  void Prefetch(DbIndex dbid, absl::Span<const std::string_view> keys);
+  void ReleasePrefetched();
+
   // Apply modification to offloaded value, return generic result from callback.
   // Unlike immutable Reads - the modified value must be uploaded back to memory.
   // This is handled by OpManager when modf completes.
@@ -78,6 +112,12 @@ class TieredStorage {
   // Run offloading loop until i/o device is loaded or all entries were traversed
   void RunOffloading(DbIndex dbid);
 
+  // Run a step of backing file compaction. Returns the space of freed pages to the filesystem
+  // and relocates entries from sparsely used pages, so that their pages become free as well.
+  // Entries are relocated by uploading them back to memory, to be stashed densely again later.
+  // Can block.
+  void RunCompaction();
+
   // Prune cool entries to reach the set memory goal with freed memory
   size_t ReclaimMemory(size_t goal);
 
@@ -101,18 +141,35 @@ class TieredStorage {
 
   PrimeTable::Cursor offloading_cursor_{};  // where RunOffloading left off
 
+  // State of the ongoing compaction pass over all databases.
+  bool compacting_ = false;
+  std::chrono::steady_clock::time_point next_compaction_{};  // earliest start of the next pass
+  DbIndex compaction_db_ = 0;
+  PrimeTable::Cursor compaction_cursor_{};
+
   std::unique_ptr<ShardOpManager> op_manager_;
   std::unique_ptr<tiering::SmallBins> bins_;
+
+  // Values read by Prefetch keyed by their segment, in the form Read() passes them. An entry is
+  // dropped once its segment is deleted, so it can not be confused with a later value stashed
+  // at the same place.
+  absl::flat_hash_map<std::pair<size_t, size_t>, std::string> prefetched_;
+  unsigned prefetch_refs_ = 0;
   typedef ::boost::intrusive::list<detail::TieredColdRecord> CoolQueue;
 
   CoolQueue cool_queue_;
 
+  // Set once the first container is stashed, to skip uploading them before hops until then.
+  bool containers_offloaded_ = false;
+
   unsigned write_depth_limit_ = 10;
   struct {
     uint64_t stash_overflow_cnt = 0;
     uint64_t total_deletes = 0;
     uint64_t offloading_steps = 0;
     uint64_t offloading_stashes = 0;
+    uint64_t compactions = 0;
+    uint64_t relocations = 0;
     size_t cool_memory_used = 0;
   } stats_;
 };
@@ -157,6 +214,32 @@ class TieredStorage {
             std::function<void(const std::string&)> readf) {
   }
 
+  void FetchContainerAsync(DbIndex dbid, std::string_view key, const PrimeValue& value) {
+  }
+
+  void FetchContainers(DbIndex dbid, absl::Span<const std::string_view> keys) {
+  }
+
+  static bool MayOffloadContainers() {
+    return false;
+  }
+
+  bool HasOffloadedContainers() const {
+    return false;
+  }
+
+  void StartReadBatch() {
+  }
+
+  void SubmitReadBatch() {
+  }
+
+  void Prefetch(DbIndex dbid, absl::Span<const std::string_view> keys) {
+  }
+
+  void ReleasePrefetched() {
+  }
+
   template <typename T>
   util::fb2::Future<T> Modify(DbIndex dbid, std::string_view key, const PrimeValue& value,
                               std::function<T(std::string*)> modf) {
@@ -195,6 +278,9 @@ class TieredStorage {
   void RunOffloading(DbIndex dbid) {
   }
 
+  void RunCompaction() {
+  }
+
   PrimeValue Warmup(DbIndex dbid, PrimeValue::CoolItem item) {
     return PrimeValue{};
   }
@@ -27,6 +27,8 @@ ABSL_DECLARE_FLAG(string, tiered_prefix);
 ABSL_DECLARE_FLAG(float, tiered_offload_threshold);
 ABSL_DECLARE_FLAG(unsigned, tiered_storage_write_depth);
 ABSL_DECLARE_FLAG(bool, tiered_experimental_cooling);
+ABSL_DECLARE_FLAG(bool, tiered_experimental_containers);
+ABSL_DECLARE_FLAG(float, tiered_compaction_threshold);
 
 namespace dfly {
 
@@ -199,6 +201,41 @@ TEST_F(TieredStorageTest, Defrag) {
   EXPECT_EQ(metrics.tiered_stats.allocated_bytes, 0u);
 }
 
+TEST_F(TieredStorageTest, Compaction) {
+  absl::FlagSaver saver;
+  SetFlag(&FLAGS_tiered_offload_threshold, 1.1f);  // disable offloading
+  SetFlag(&FLAGS_tiered_experimental_cooling, false);
+  SetFlag(&FLAGS_tiered_compaction_threshold, 0.25f);
+
+  // Every value occupies a 4KB block, a page holds 256 of them.
+  const int kNum = 1024;
+  string value = BuildString(3000);
+  for (size_t i = 0; i < kNum; i++) {
+    Run({"SET", absl::StrCat("k", i), value});
+  }
+  ExpectConditionWithinTimeout([&] { return GetMetrics().db_stats[0].tiered_entries == kNum; });
+
+  // Keep every 16th entry, so that all pages stay allocated but are sparsely used.
+  for (size_t i = 0; i < kNum; i++) {
+    if (i % 16 != 0)
+      Run({"DEL", absl::StrCat("k", i)});
+  }
+
+  // Entries are relocated from the sparse pages and the freed pages are released.
+  ExpectConditionWithinTimeout([&] {
+    auto stats = GetMetrics().tiered_stats;
+    return stats.total_relocations > 0 && stats.released_bytes > 0;
+  });
+
+  auto metrics = GetMetrics();
+  EXPECT_GT(metrics.tiered_stats.total_compactions, 0u);
+  EXPECT_LT(metrics.db_stats[0].tiered_entries, kNum / 16);
+
+  for (size_t i = 0; i < kNum; i += 16) {
+    EXPECT_EQ(Run({"GET", absl::StrCat("k", i)}), value);
+  }
+}
+
 TEST_F(TieredStorageTest, BackgroundOffloading) {
   absl::FlagSaver saver;
   SetFlag(&FLAGS_tiered_offload_threshold, 0.0f);  // offload all values
@@ -375,4 +412,96 @@ TEST_F(TieredStorageTest, Dump) {
   EXPECT_EQ(resp, "OK");
 }
 
+TEST_F(TieredStorageTest, PrefetchSquashed) {
+  absl::FlagSaver saver;
+  SetFlag(&FLAGS_tiered_offload_threshold, 0.0f);  // offload all values
+  SetFlag(&FLAGS_tiered_experimental_cooling, false);
+
+  const int kNum = 10;
+  for (size_t i = 0; i < kNum; i++) {
+    Run({"SET", absl::StrCat("k", i), BuildString(3000, 'a' + i)});
+  }
+  ExpectConditionWithinTimeout([&] { return GetMetrics().db_stats[0].tiered_entries == kNum; });
+  SetFlag(&FLAGS_tiered_offload_threshold, 1.1f);  // stop offloading
+
+  // Squashed pipelines read all the values with a single batch, but keep them offloaded.
+  using MP = MemcacheParser;
+  vector<string> keys(kNum);
+  vector<MP::Command> cmds(kNum);
+  vector<facade::MCCommandRef> refs;
+  for (size_t i = 0; i < kNum; i++) {
+    keys[i] = absl::StrCat("k", i);
+    cmds[i].type = MP::GET;
+    cmds[i].key = keys[i];
+    refs.push_back({&cmds[i], ""});
+  }
+  auto resp = RunMCPipeline(refs);
+  ASSERT_EQ(resp.size(), kNum * 3);
+  for (size_t i = 0; i < kNum; i++) {
+    EXPECT_EQ(resp[i * 3 + 1], BuildString(3000, 'a' + i));
+  }
+
+  // Every value was read from disk once, by the prefetch.
+  auto metrics = GetMetrics();
+  EXPECT_EQ(metrics.db_stats[0].tiered_entries, kNum);
+  EXPECT_EQ(metrics.tiered_stats.total_fetches, kNum);
+  EXPECT_EQ(metrics.tiered_stats.total_uploads, 0u);
+}
+
+TEST_F(TieredStorageTest, Containers) {
+  absl::FlagSaver saver;
+  SetFlag(&FLAGS_tiered_offload_threshold, 0.0f);  // offload all values
+  SetFlag(&FLAGS_tiered_experimental_containers, true);
+
+  // we want to test without cooling to trigger disk I/O on reads.
+  SetFlag(&FLAGS_tiered_experimental_cooling, false);
+
+  const int kNum = 10;
+  string value = BuildString(64);
+  for (size_t i = 0; i < kNum; i++) {
+    string suffix = absl::StrCat(i);
+    for (size_t j = 0; j < 100; j++) {
+      Run({"HSET", "h" + suffix, absl::StrCat("f", j), value});
+      Run({"SADD", "s" + suffix, absl::StrCat(value, j)});
+      Run({"RPUSH", "l" + suffix, value});
+    }
+    Run({"EXPIRE", "h" + suffix, "100"});
+  }
+
+  ExpectConditionWithinTimeout([&] { return GetMetrics().db_stats[0].tiered_entries == 3 * kNum; });
+
+  // Offloaded containers keep their type and are loaded back on access.
+  EXPECT_EQ(Run({"TYPE", "h0"}), "hash");
+  for (size_t i = 0; i < kNum; i++) {
+    string suffix = absl::StrCat(i);
+    EXPECT_THAT(Run({"HLEN", "h" + suffix}), IntArg(100));
+    EXPECT_EQ(Run({"HGET", "h" + suffix, "f99"}), value);
+    EXPECT_THAT(Run({"TTL", "h" + suffix}), IntArg(100));
+    EXPECT_THAT(Run({"SISMEMBER", "s" + suffix, absl::StrCat(value, 42)}), IntArg(1));
+    EXPECT_THAT(Run({"LPUSH", "l" + suffix, "head"}), IntArg(101));
+    EXPECT_EQ(Run({"LINDEX", "l" + suffix, "0"}), "head");
+    EXPECT_THAT(Run({"GET", "l" + suffix}), ErrArg("WRONGTYPE"));
+  }
+  EXPECT_GE(GetMetrics().tiered_stats.total_uploads, 3u * kNum);
+
+  // Squashed commands find the containers uploaded before their hop.
+  ExpectConditionWithinTimeout([&] { return GetMetrics().db_stats[0].tiered_entries == 3 * kNum; });
+  Run({"MULTI"});
+  for (size_t i = 0; i < kNum; i++) {
+    Run({"HLEN", absl::StrCat("h", i)});
+  }
+  auto resp = Run({"EXEC"});
+  ASSERT_THAT(resp, ArrLen(kNum));
+  for (const auto& elem : resp.GetVec()) {
+    EXPECT_THAT(elem, IntArg(100));
+  }
+
+  // Offloaded containers are serialized into snapshots.
+  ExpectConditionWithinTimeout([&] { return GetMetrics().db_stats[0].tiered_entries == 3 * kNum; });
+  Run({"DEBUG", "RELOAD"});
+  EXPECT_THAT(Run({"HLEN", "h0"}), IntArg(100));
+  EXPECT_THAT(Run({"SCARD", "s0"}), IntArg(100));
+  EXPECT_THAT(Run({"LLEN", "l0"}), IntArg(101));
+}
+
 }  // namespace dfly
@@ -4,6 +4,9 @@
 
 #include "server/tiering/disk_storage.h"
 
+#include <fcntl.h>
+
+#include <algorithm>
 #include <system_error>
 
 #include "base/flags.h"
@@ -187,10 +190,52 @@ std::error_code DiskStorage::Stash(io::Bytes bytes, StashCb cb) {
   return {};
 }
 
+void DiskStorage::ReleaseFreePages(size_t max_bytes) {
+  vector<DiskSegment> pages = alloc_.ReserveReleasable(max_bytes);
+  if (pages.empty())
+    return;
+
+  // Merge adjacent pages to punch them with a single call.
+  sort(pages.begin(), pages.end(), [](auto l, auto r) { return l.offset < r.offset; });
+  vector<DiskSegment> ranges{pages.front()};
+  for (size_t i = 1; i < pages.size(); ++i) {
+    DiskSegment& last = ranges.back();
+    if (last.offset + last.length == pages[i].offset)
+      last.length += pages[i].length;
+    else
+      ranges.push_back(pages[i]);
+  }
+
+  constexpr int kMode = FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE;
+  for (const DiskSegment& range : ranges) {
+    // The pages stay reserved while the call is in flight, so they can't be written meanwhile.
+    if (punch_hole_supported_) {
+      pending_ops_++;
+      auto ec = DoFiberCall(&SubmitEntry::PrepFallocate, backing_file_->fd(), kMode,
+                            off_t(range.offset), off_t(range.length));
+      pending_ops_--;
+
+      if (!ec) {
+        released_bytes_ += range.length;
+      } else if (ec == errc::operation_not_supported) {
+        LOG(WARNING) << "Backing file does not support punching holes, freed space is kept";
+        punch_hole_supported_ = false;
+      } else {
+        LOG(ERROR) << "Could not release " << range << " of the backing file: " << ec.message();
+      }
+    }
+    alloc_.ReturnReleased(range);
+  }
+}
+
 DiskStorage::Stats DiskStorage::GetStats() const {
-  return {
-      alloc_.allocated_bytes(),       alloc_.capacity(), heap_buf_alloc_cnt_, reg_buf_alloc_cnt_,
-      static_cast<size_t>(max_size_), pending_ops_};
+  return {alloc_.allocated_bytes(),
+          alloc_.capacity(),
+          heap_buf_alloc_cnt_,
+          reg_buf_alloc_cnt_,
+          static_cast<size_t>(max_size_),
+          pending_ops_,
+          released_bytes_};
 }
 
 bool DiskStorage::CanGrow() const {
@@ -26,6 +26,7 @@ class DiskStorage {
     uint64_t registered_buf_alloc_count = 0;
     size_t max_file_size = 0;
     size_t pending_ops = 0;
+    uint64_t released_bytes = 0;
   };
 
   using ReadCb = std::function<void(io::Result<std::string_view>)>;
@@ -48,6 +49,23 @@ class DiskStorage {
   // Bytes are copied and can be dropped before cb is resolved
   std::error_code Stash(io::Bytes bytes, StashCb cb);
 
+  // Returns the disk space of up to max_bytes of freed pages to the filesystem by punching holes
+  // into the backing file. Blocks until done.
+  void ReleaseFreePages(size_t max_bytes);
+
+  // Exclude sparsely used pages from new allocations, see ExternalAllocator::StartEvacuation.
+  unsigned StartEvacuation(float max_usage, unsigned max_pages) {
+    return alloc_.StartEvacuation(max_usage, max_pages);
+  }
+
+  void StopEvacuation() {
+    alloc_.StopEvacuation();
+  }
+
+  bool IsEvacuating(DiskSegment segment) const {
+    return alloc_.IsEvacuating(segment.offset);
+  }
+
   Stats GetStats() const;
 
  private:
@@ -65,6 +83,8 @@ class DiskStorage {
   uint64_t heap_buf_alloc_cnt_ = 0, reg_buf_alloc_cnt_ = 0;
 
   bool grow_pending_ = false;
+  bool punch_hole_supported_ = true;
+  uint64_t released_bytes_ = 0;
   std::unique_ptr<util::fb2::LinuxFile> backing_file_;
 
   ExternalAllocator alloc_;
@@ -144,6 +144,9 @@ struct Page {
   // need some mapping function to map from block_size to real_block_size given Page class.
   BinIdx bin_idx;
   uint8_t segment_inuse : 1;  // true if segment allocated this page.
+  uint8_t dirty : 1;          // true if the page was used since its storage was released.
+  uint8_t release_queued : 1;  // true if the page is in released_pages_ list.
+  uint8_t evacuating : 1;      // true if the page is excluded from new allocations.
   uint8_t reserved[3];
 
   // can be computed via free_blocks.count().
@@ -170,6 +173,7 @@ void Page::Init(PageClass pc, BinIdx bin_id) {
   DCHECK(segment_inuse);
 
   bin_idx = bin_id;
+  dirty = 1;
   if (pc == PageClass::LARGE_P) {
     available = 1;
   } else {
@@ -226,6 +230,14 @@ class ExternalAllocator::SegmentDescr {
     return page_info_.pages + i;
   }
 
+  size_t PageOffset(const Page* page) const {
+    return offset_ + (size_t(page->id) << page_info_.page_shift);
+  }
+
+  Page* PageAt(size_t offset) {
+    return GetPage((offset - offset_) >> page_info_.page_shift);
+  }
+
   size_t BlockOffset(const Page* page, unsigned blockpos) {
     return offset_ + page->id * (1 << page_info_.page_shift) +
            ToBlockSize(page->bin_idx) * blockpos;
@@ -401,7 +413,7 @@ void ExternalAllocator::Free(size_t offset, size_t sz) {
   // then return it to free pages list
   if (page->available == blocks_num) {
     FreePage(page, seg, block_size);
-  } else if (page->available == 1) {
+  } else if (page->available == 1 && !page->evacuating) {
     DCHECK_NE(page, free_pages_[page->bin_idx]);
     page->next_free = free_pages_[page->bin_idx];
     free_pages_[page->bin_idx] = page;
@@ -416,6 +428,95 @@ void ExternalAllocator::AddStorage(size_t start, size_t size) {
   capacity_ += size;
 }
 
+vector<DiskSegment> ExternalAllocator::ReserveReleasable(size_t max_bytes) {
+  vector<DiskSegment> res;
+  size_t bytes = 0;
+  while (!released_pages_.empty() && bytes < max_bytes) {
+    size_t offset = released_pages_.back();
+    released_pages_.pop_back();
+
+    SegmentDescr* seg = segments_[offset / kSegmentAlignment];
+    Page* page = seg->PageAt(offset);
+    page->release_queued = 0;
+
+    // The page could have been allocated again in the meantime.
+    if (page->segment_inuse || !page->dirty)
+      continue;
+
+    // Pin the page to the segment so that it won't be allocated until it's returned.
+    page->segment_inuse = 1;
+    page->dirty = 0;
+    ++seg->page_info_.used;
+
+    size_t page_size = 1UL << seg->page_shift();
+    res.emplace_back(offset, page_size);
+    bytes += page_size;
+  }
+  return res;
+}
+
+void ExternalAllocator::ReturnReleased(DiskSegment segment) {
+  size_t end = segment.offset + segment.length;
+  for (size_t offset = segment.offset; offset < end;) {
+    SegmentDescr* seg = segments_[offset / kSegmentAlignment];
+    Page* page = seg->PageAt(offset);
+    DCHECK(page->segment_inuse);
+    DCHECK_EQ(page->available, 0u);
+
+    ReturnPage(page, seg);
+    offset += 1UL << seg->page_shift();
+  }
+}
+
+unsigned ExternalAllocator::StartEvacuation(float max_usage, unsigned max_pages) {
+  DCHECK(evacuating_.empty());
+
+  for (SegmentDescr* seg : segments_) {
+    if (seg == nullptr)
+      continue;
+
+    for (unsigned i = 0; i < seg->capacity() && evacuating_.size() < max_pages; ++i) {
+      Page* page = seg->GetPage(i);
+
+      // Skip free, full and reserved pages, as well as the pages we are currently filling.
+      if (!page->segment_inuse || page->available == 0 || free_pages_[page->bin_idx] == page)
+        continue;
+
+      unsigned blocks_num = (1u << seg->page_shift()) / ToBlockSize(page->bin_idx);
+      if (blocks_num - page->available > max_usage * blocks_num)
+        continue;
+
+      UnlinkFreePage(page);
+      page->next_free = nullptr;
+      page->evacuating = 1;
+      evacuating_.push_back(page);
+    }
+  }
+  return evacuating_.size();
+}
+
+void ExternalAllocator::StopEvacuation() {
+  for (Page* page : evacuating_) {
+    if (!page->evacuating)  // was fully freed
+      continue;
+
+    DCHECK_GT(page->available, 0u);
+    page->evacuating = 0;
+    page->next_free = free_pages_[page->bin_idx];
+    free_pages_[page->bin_idx] = page;
+  }
+  evacuating_.clear();
+}
+
+bool ExternalAllocator::IsEvacuating(size_t offset) const {
+  size_t idx = offset / kSegmentAlignment;
+
+  // Large blocks do not belong to segments.
+  if (idx >= segments_.size() || segments_[idx] == nullptr)
+    return false;
+  return segments_[idx]->PageAt(offset)->evacuating;
+}
+
 size_t ExternalAllocator::GoodSize(size_t sz) {
   uint8_t bin_idx = ToBinIdx(sz);
   if (bin_idx < kLargeSizeBin)
@@ -496,9 +597,23 @@ void ExternalAllocator::FreePage(Page* page, SegmentDescr* owner, size_t block_s
   // page is fully free. Return it to the segment even if it's
   // referenced via free_pages_. The allows more elasticity by potentially reassigning
   // it to other bin sizes.
-  BinIdx bidx = ToBinIdx(block_size);
+  DCHECK_EQ(ToBinIdx(block_size), page->bin_idx);
 
   // Remove fast allocation reference.
+  UnlinkFreePage(page);
+  page->evacuating = 0;
+
+  // Queue the page so that the storage behind it could be released.
+  if (!page->release_queued) {
+    page->release_queued = 1;
+    released_pages_.push_back(owner->PageOffset(page));
+  }
+
+  ReturnPage(page, owner);
+}
+
+void ExternalAllocator::UnlinkFreePage(Page* page) {
+  BinIdx bidx = page->bin_idx;
   if (free_pages_[bidx] == page) {
     free_pages_[bidx] = page->next_free ? page->next_free : &empty_page;
   } else {
@@ -509,17 +624,19 @@ void ExternalAllocator::FreePage(Page* page, SegmentDescr* owner, size_t block_s
       }
     }
   }
+}
 
+void ExternalAllocator::ReturnPage(Page* page, SegmentDescr* owner) {
   page->segment_inuse = 0;
   page->available = 0;
   page->next_free = nullptr;
 
-  if (!owner->HasFreePages()) {
+  // A full segment is detached lazily by FindPage, so it could still be in the queue.
+  auto& sq = sq_[owner->page_class()];
+  bool linked = owner->next != owner || sq == owner;
+  if (!linked) {
     // Segment was fully booked but now it has a free page.
     // Add it to the tail of segment queue.
-    DCHECK(owner->next == owner->prev);
-
-    auto& sq = sq_[owner->page_class()];
     if (sq == nullptr) {
       sq = owner;
     } else {
@@ -67,6 +67,25 @@ class ExternalAllocator {
   /// added storage ranges.
   void AddStorage(size_t start, size_t size);
 
+  // Reserves up to max_bytes of pages that became free since their storage was released last
+  // time. Reserved pages are not allocated until they are returned with ReturnReleased(),
+  // so the storage behind them can be released in the meantime.
+  std::vector<DiskSegment> ReserveReleasable(size_t max_bytes);
+
+  // Returns reserved pages covered by the segment to the allocator.
+  void ReturnReleased(DiskSegment segment);
+
+  // Selects up to max_pages partly used pages with a ratio of used blocks not above max_usage.
+  // Selected pages are not used for new allocations, so they become free once their blocks
+  // are relocated. Returns the number of selected pages.
+  unsigned StartEvacuation(float max_usage, unsigned max_pages);
+
+  // Makes the selected pages that still have used blocks available for allocations again.
+  void StopEvacuation();
+
+  // Returns true if the block at offset belongs to a page selected for evacuation.
+  bool IsEvacuating(size_t offset) const;
+
   // Similar to mi_good_size, returns the size of the underlying block as if
   // were returned by Malloc. Guaranteed that the result not less than sz.
   // No allocation is done.
@@ -92,6 +111,12 @@ class ExternalAllocator {
   SegmentDescr* GetNewSegment(detail::PageClass sc);
   void FreePage(Page* page, SegmentDescr* owner, size_t block_size);
 
+  // Removes page from the free_pages_ list if it's there.
+  void UnlinkFreePage(Page* page);
+
+  // Returns page to its segment, so that it can be used for any block size.
+  void ReturnPage(Page* page, SegmentDescr* owner);
+
   static SegmentDescr* ToSegDescr(Page*);
 
   SegmentDescr* sq_[2];                      // map: PageClass -> free Segment.
@@ -102,6 +127,9 @@ class ExternalAllocator {
 
   ExtentTree extent_tree_;
 
+  std::vector<size_t> released_pages_;  // offsets of free pages with storage to release
+  std::vector<Page*> evacuating_;
+
   size_t capacity_ = 0;  // in bytes.
   size_t allocated_bytes_ = 0;
 };
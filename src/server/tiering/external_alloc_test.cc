@@ -146,6 +146,47 @@ TEST_F(ExternalAllocatorTest, EmptyFull) {
     EXPECT_GT(ext_alloc_.Malloc(kAllocSize), 0u);
 }
 
+TEST_F(ExternalAllocatorTest, Compaction) {
+  ext_alloc_.AddStorage(0, kSegSize);
+
+  // Fill two pages of 256 blocks.
+  vector<int64_t> offsets;
+  for (unsigned i = 0; i < 512; i++)
+    offsets.push_back(ext_alloc_.Malloc(kMinBlockSize));
+  ASSERT_EQ(offsets.back(), int64_t(2_MB - kMinBlockSize));
+
+  // Leave the first page sparse and the second one densely used.
+  for (unsigned i = 0; i < 250; i++)
+    ext_alloc_.Free(offsets[i], kMinBlockSize);
+  for (unsigned i = 256; i < 312; i++)
+    ext_alloc_.Free(offsets[i], kMinBlockSize);
+
+  EXPECT_EQ(ext_alloc_.StartEvacuation(0.25, 16), 1u);
+  EXPECT_TRUE(ext_alloc_.IsEvacuating(offsets[255]));
+  EXPECT_FALSE(ext_alloc_.IsEvacuating(offsets[511]));
+
+  // The evacuated page is not used for new allocations.
+  int64_t offset = ext_alloc_.Malloc(kMinBlockSize);
+  EXPECT_GE(offset, int64_t(1_MB));
+  ext_alloc_.Free(offset, kMinBlockSize);
+
+  // Relocate the rest of the entries, the page becomes free and its storage can be released.
+  for (unsigned i = 250; i < 256; i++)
+    ext_alloc_.Free(offsets[i], kMinBlockSize);
+  EXPECT_FALSE(ext_alloc_.IsEvacuating(offsets[255]));
+  ext_alloc_.StopEvacuation();
+
+  auto released = ext_alloc_.ReserveReleasable(64_MB);
+  ASSERT_EQ(released.size(), 1u);
+  EXPECT_EQ(released[0], DiskSegment(0, 1_MB));
+  EXPECT_TRUE(ext_alloc_.ReserveReleasable(64_MB).empty());
+
+  // Reserved pages are not allocated until they are returned.
+  EXPECT_EQ(ext_alloc_.Malloc(16_KB), int64_t(2_MB));
+  ext_alloc_.ReturnReleased(released[0]);
+  EXPECT_EQ(ext_alloc_.Malloc(32_KB), 0);
+}
+
 TEST_F(ExternalAllocatorTest, AllocLarge) {
   ext_alloc_.AddStorage(0, kSegSize);
 
@@ -4,6 +4,7 @@
 
 #include "server/tiering/op_manager.h"
 
+#include <algorithm>
 #include <variant>
 
 #include "base/logging.h"
@@ -16,6 +17,9 @@ namespace dfly::tiering {
 
 namespace {
 
+// Upper bound for coalesced reads of adjacent pages.
+constexpr size_t kMaxCoalescedRead = 32 * kPageSize;
+
 OpManager::OwnedEntryId ToOwned(OpManager::EntryId id) {
   Overloaded convert{[](unsigned i) -> OpManager::OwnedEntryId { return i; },
                      [](std::pair<DbIndex, std::string_view> p) -> OpManager::OwnedEntryId {
@@ -65,6 +69,36 @@ void OpManager::Enqueue(EntryId id, DiskSegment segment, ReadCallback cb) {
       .callbacks.emplace_back(std::move(cb));
 }
 
+void OpManager::StartReadBatch() {
+  DCHECK(!batching_reads_);
+  batching_reads_ = true;
+}
+
+void OpManager::SubmitReadBatch() {
+  DCHECK(batching_reads_);
+  batching_reads_ = false;
+
+  std::vector<size_t> offsets = std::move(batched_reads_);
+  batched_reads_.clear();
+  std::sort(offsets.begin(), offsets.end());
+
+  // Merge runs of adjacent segments into single reads.
+  for (size_t i = 0; i < offsets.size();) {
+    DiskSegment merged = pending_reads_.at(offsets[i]).segment;
+    size_t j = i + 1;
+    for (; j < offsets.size(); j++) {
+      DiskSegment next = pending_reads_.at(offsets[j]).segment;
+      if (next.offset != merged.offset + merged.length ||
+          merged.length + next.length > kMaxCoalescedRead)
+        break;
+      merged.length += next.length;
+    }
+
+    IssueRead(merged, {offsets.begin() + i, offsets.begin() + j});
+    i = j;
+  }
+}
+
 void OpManager::Delete(EntryId id) {
   // If the item isn't offloaded, it has io pending, so cancel it
   DCHECK(pending_stash_ver_.count(ToOwned(id)));
@@ -86,6 +120,11 @@ void OpManager::DeleteOffloaded(DiskSegment segment) {
   }
 }
 
+bool OpManager::HasPendingOps(DiskSegment segment) {
+  auto it = pending_reads_.find(segment.ContainingPages().offset);
+  return it != pending_reads_.end() && it->second.Find(segment) != nullptr;
+}
+
 std::error_code OpManager::Stash(EntryId id_ref, std::string_view value) {
   auto id = ToOwned(id_ref);
   unsigned version = pending_stash_ver_[id] = ++pending_stash_counter_;
@@ -108,15 +147,26 @@ OpManager::ReadOp& OpManager::PrepareRead(DiskSegment aligned_segment) {
 
   auto [it, inserted] = pending_reads_.try_emplace(aligned_segment.offset, aligned_segment);
   if (inserted) {
-    auto io_cb = [this, aligned_segment](io::Result<std::string_view> result) {
-      CHECK(result) << result.error();  // TODO: to handle this gracefully.
-      ProcessRead(aligned_segment.offset, *result);
-    };
-    storage_.Read(aligned_segment, io_cb);
+    if (batching_reads_)
+      batched_reads_.push_back(aligned_segment.offset);
+    else
+      IssueRead(aligned_segment, {aligned_segment.offset});
   }
   return it->second;
 }
 
+void OpManager::IssueRead(DiskSegment aligned_segment, std::vector<size_t> offsets) {
+  auto io_cb = [this, aligned_segment,
+                offsets = std::move(offsets)](io::Result<std::string_view> result) {
+    CHECK(result) << result.error();  // TODO: to handle this gracefully.
+    for (size_t offset : offsets) {
+      size_t length = pending_reads_.at(offset).segment.length;
+      ProcessRead(offset, result->substr(offset - aligned_segment.offset, length));
+    }
+  };
+  storage_.Read(aligned_segment, std::move(io_cb));
+}
+
 void OpManager::ProcessStashed(EntryId id, unsigned version,
                                const io::Result<DiskSegment>& segment) {
   if (auto it = pending_stash_ver_.find(ToOwned(id));
@@ -60,12 +60,21 @@ class OpManager {
   // will have it's own independent callback loop that can safely modify the underlying value
   void Enqueue(EntryId id, DiskSegment segment, ReadCallback cb);
 
+  // Defer disk reads triggered by Enqueue until SubmitReadBatch. Reads of adjacent pages are then
+  // coalesced and submitted together, instead of a separate round trip for every segment.
+  // The calling fiber must not preempt in between.
+  void StartReadBatch();
+  void SubmitReadBatch();
+
   // Delete entry with pending io
   void Delete(EntryId id);
 
   // Delete offloaded entry located at the segment.
   void DeleteOffloaded(DiskSegment segment);
 
+  // Whether reads or modifications of the entry located at the segment are still pending.
+  bool HasPendingOps(DiskSegment segment);
+
   // Stash value to be offloaded. It is opaque to OpManager.
   std::error_code Stash(EntryId id, std::string_view value);
 
@@ -115,6 +124,9 @@ class OpManager {
   // Refernce is valid until any other read operations occur.
   ReadOp& PrepareRead(DiskSegment aligned_segment);
 
+  // Issue read of aligned segments starting at the given offsets and covering adjacent pages.
+  void IssueRead(DiskSegment aligned_segment, std::vector<size_t> offsets);
+
   // Called once read finished
   void ProcessRead(size_t offset, std::string_view value);
 
@@ -126,6 +138,9 @@ class OpManager {
 
   absl::flat_hash_map<size_t /* offset */, ReadOp> pending_reads_;
 
+  bool batching_reads_ = false;
+  std::vector<size_t> batched_reads_;  // offsets of pending reads that were not issued yet
+
   size_t pending_stash_counter_ = 0;
   // todo: allow heterogeneous lookups with non owned id
   absl::flat_hash_map<OwnedEntryId, unsigned /* version */> pending_stash_ver_;
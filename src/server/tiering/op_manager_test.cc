@@ -182,4 +182,33 @@ TEST_F(OpManagerTest, Modify) {
   });
 }
 
+TEST_F(OpManagerTest, ReadBatch) {
+  pp_->at(0)->Await([this] {
+    Open();
+
+    const unsigned kNum = 16;
+    for (unsigned i = 0; i < kNum; i++)
+      EXPECT_FALSE(Stash(i, std::string(kPageSize, 'a' + i)));
+    while (stashed_.size() < kNum)
+      util::ThisFiber::SleepFor(1ms);
+
+    StartReadBatch();
+    std::vector<util::fb2::Future<std::string>> futures;
+    for (unsigned i = 0; i < kNum; i++)
+      futures.emplace_back(Read(i, stashed_[i]));
+
+    // Nothing is issued until the batch is submitted, adjacent pages are then read together.
+    EXPECT_EQ(GetStats().disk_stats.pending_ops, 0u);
+    EXPECT_EQ(GetStats().pending_read_cnt, kNum);
+    SubmitReadBatch();
+    EXPECT_LT(GetStats().disk_stats.pending_ops, kNum);
+
+    for (unsigned i = 0; i < kNum; i++)
+      EXPECT_EQ(futures[i].Get(), std::string(kPageSize, 'a' + i));
+    EXPECT_EQ(GetStats().pending_read_cnt, 0u);
+
+    Close();
+  });
+}
+
 }  // namespace dfly::tiering
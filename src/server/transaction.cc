@@ -19,6 +19,7 @@
 #include "server/engine_shard_set.h"
 #include "server/journal/journal.h"
 #include "server/server_state.h"
+#include "server/tiered_storage.h"
 
 ABSL_FLAG(uint32_t, tx_queue_warning_len, 96,
           "Length threshold for warning about long transaction queue");
@@ -887,10 +888,58 @@ void Transaction::Execute(RunnableType cb, bool conclude) {
   run_barrier_.Wait();
   cb_ptr_ = nullptr;
 
+  // Covers the commands of EXEC and EVAL as well, their writes are journaled by this transaction.
+  if (journaled_.load(memory_order_relaxed)) {
+    if (auto ec = WaitJournalDurable(); ec)
+      journal_ec_ = ec;
+  }
+
   if (coordinator_state_ & COORD_CONCLUDING)
     coordinator_state_ &= ~COORD_SCHED;
 }
 
+void Transaction::FetchOffloadedContainers() {
+  if (!TieredStorage::MayOffloadContainers() || IsGlobal())
+    return;
+
+  // Squashed commands run inside the hop of their squasher, which uploads them for all of them.
+  if (multi_ && multi_->role != DEFAULT)
+    return;
+
+  fb2::BlockingCounter bc{0};
+  IterateActiveShards([this, bc](PerShardData&, ShardId sid) mutable {
+    bc->Add(1);
+    shard_set->AddL2(sid, [this, bc, sid]() mutable {
+      if (TieredStorage* ts = EngineShard::tlocal()->tiered_storage();
+          ts && ts->HasOffloadedContainers()) {
+        ShardArgs args = GetShardArgs(sid);
+        vector<string_view> keys(args.begin(), args.end());
+        ts->FetchContainers(db_index_, keys);
+      }
+      bc->Dec();
+    });
+  });
+  bc->Wait();
+}
+
+// Runs in coordinator thread. With journal_fsync=always, writes reply only after the journal
+// entries of their shards are synced. The wait happens outside of the shard queues.
+error_code Transaction::WaitJournalDurable() {
+  if (!TakeJournaled())
+    return {};
+
+  journal::Journal* journal = ServerState::tlocal()->journal();
+  if (journal == nullptr || !journal->SyncsEveryWrite())
+    return {};
+
+  error_code res;
+  IterateActiveShards([journal, &res](PerShardData&, ShardId sid) {
+    if (auto ec = journal->WaitDurable(sid); ec && !res)
+      res = ec;
+  });
+  return res;
+}
+
 // Runs in coordinator thread.
 void Transaction::DispatchHop() {
   DVLOG(1) << "DispatchHop " << DebugId();
@@ -1496,6 +1545,7 @@ void Transaction::LogJournalOnShard(EngineShard* shard, journal::Entry::Payload&
   CHECK(journal);
   journal->RecordEntry(txid_, journal::Op::COMMAND, db_index_, shard_cnt,
                        unique_slot_checker_.GetUniqueSlotId(), std::move(payload));
+  journaled_.store(true, memory_order_relaxed);
 }
 
 void Transaction::ReviveAutoJournal() {
@@ -12,6 +12,7 @@
 
 #include <atomic>
 #include <string_view>
+#include <system_error>
 #include <variant>
 #include <vector>
 
@@ -299,6 +300,18 @@ class Transaction {
     return coordinator_state_ & COORD_SCHED;
   }
 
+  // With journal_fsync=always, returns and clears the error of syncing the journal entries
+  // recorded by the hops so far. The command must not reply with success if it is set.
+  std::error_code TakeJournalError() {
+    return std::exchange(journal_ec_, {});
+  }
+
+  // Returns and clears whether the hops so far recorded journal entries. Squashed stubs do not
+  // wait for the journal themselves, their squasher does it for all of them.
+  bool TakeJournaled() {
+    return journaled_.exchange(false, std::memory_order_relaxed);
+  }
+
   MultiMode GetMultiMode() const {
     return multi_->mode;
   }
@@ -334,6 +347,11 @@ class Transaction {
   // Return debug information about a transaction, include shard local info if passed
   std::string DebugId(std::optional<ShardId> sid = std::nullopt) const;
 
+  // Uploads the offloaded containers among the keys of the current command with L2 tasks awaited
+  // by the coordinator, so that the hop callbacks find them in memory. Lookups never wait for the
+  // disk, see DbSlice::FindInternal. Runs in coordinator thread.
+  void FetchOffloadedContainers();
+
   // Prepares for running ScheduleSingleHop() for a single-shard multi tx.
   // It is safe to call ScheduleSingleHop() after calling this method, but the callback passed
   // to it must not block.
@@ -523,6 +541,9 @@ class Transaction {
   // Set ARMED flags, start run barrier and submit poll tasks. Doesn't wait for the run barrier
   void DispatchHop();
 
+  // Wait until the journal entries of the last hops are synced if required by journal_fsync.
+  std::error_code WaitJournalDurable();
+
   // Finish hop, decrement run barrier
   void FinishHop();
 
@@ -646,6 +667,10 @@ class Transaction {
   OpStatus local_result_ = OpStatus::OK;
   absl::base_internal::SpinLock local_result_mu_;
 
+  // Set by the shards that recorded journal entries during the hop, cleared by the coordinator.
+  mutable std::atomic_bool journaled_{false};
+  std::error_code journal_ec_;  // See TakeJournalError(), written by coordinator thread.
+
   // Stats purely for debugging purposes
   struct Stats {
     size_t schedule_attempts = 0;
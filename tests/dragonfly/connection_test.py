@@ -378,6 +378,83 @@ async def test_publish_stuck(df_server: DflyInstance, async_client: aioredis.Red
         await pub
 
 
+"""
+Test that a subscriber that does not read messages is limited by subscriber_buffer_limit
+without blocking the publisher.
+"""
+
+
+@dfly_args(
+    {
+        "proactor_threads": "1",
+        "subscriber_buffer_limit": "100000",
+        "subscriber_overflow_policy": "drop-oldest",
+    }
+)
+async def test_publish_slow_subscriber_drop(df_server: DflyInstance, async_client: aioredis.Redis):
+    reader, writer = await asyncio.open_connection("127.0.0.1", df_server.port, limit=10)
+    writer.write(b"SUBSCRIBE channel\r\n")
+    await writer.drain()
+
+    @assert_eventually
+    async def subscribed():
+        assert await async_client.pubsub_numsub("channel") == [("channel", 1)]
+
+    await subscribed()
+
+    payload = "msg" * 1000
+    p = async_client.pipeline()
+    for _ in range(2000):
+        p.publish("channel", payload)
+    await asyncio.wait_for(p.execute(), timeout=10)
+
+    info = await async_client.info()
+    assert int(info["dispatch_queue_subscriber_bytes"]) <= 100000
+    assert int(info["pubsub_dropped_messages"]) > 0
+
+    clients = await async_client.client_list()
+    assert any(int(c.get("pubsub-dropped", 0)) > 0 for c in clients)
+
+    writer.close()
+
+
+@dfly_args(
+    {
+        "proactor_threads": "1",
+        "subscriber_buffer_limit": "100000",
+        "subscriber_overflow_policy": "disconnect",
+    }
+)
+async def test_publish_slow_subscriber_disconnect(
+    df_server: DflyInstance, async_client: aioredis.Redis
+):
+    reader, writer = await asyncio.open_connection("127.0.0.1", df_server.port, limit=10)
+    writer.write(b"SUBSCRIBE channel\r\n")
+    await writer.drain()
+
+    @assert_eventually
+    async def subscribed():
+        assert await async_client.pubsub_numsub("channel") == [("channel", 1)]
+
+    await subscribed()
+
+    payload = "msg" * 1000
+    p = async_client.pipeline()
+    for _ in range(2000):
+        p.publish("channel", payload)
+    await asyncio.wait_for(p.execute(), timeout=10)
+
+    info = await async_client.info()
+    assert int(info["pubsub_overflow_disconnects"]) == 1
+
+    @assert_eventually
+    async def unsubscribed():
+        assert await async_client.pubsub_numsub("channel") == [("channel", 0)]
+
+    await unsubscribed()
+    writer.close()
+
+
 @pytest.mark.slow
 @dfly_args({"proactor_threads": "4"})
 async def test_pubsub_busy_connections(df_server: DflyInstance):
@@ -1235,3 +1312,52 @@ async def test_client_detached_crash(df_factory):
     async_client = server.client()
     await async_client.client_pause(2, all=False)
     server.stop()
+
+
+@pytest.mark.exclude_epoll
+@dfly_args({"proactor_threads": 1, "uring_recv_buffer_cnt": 2})
+async def test_recv_buffer_ring_exhausted(df_server: DflyInstance):
+    """
+    Pipelined clients exhaust the tiny recv buffer ring of the thread and fall back to reading
+    into their own buffers. New clients keep to their own buffers until the cooldown passes.
+    """
+
+    async def recv_provided_calls(client):
+        return (await client.info("STATS"))["connection_recv_provided_calls"]
+
+    client = df_server.client()
+    await client.ping()
+    if await recv_provided_calls(client) == 0:
+        pytest.skip("Socket recv buffer rings are not supported by the kernel")
+    await client.aclose()
+
+    value = "v" * 4096
+
+    async def pipe_sets(i):
+        c = df_server.client()
+        pipe = c.pipeline(transaction=False)
+        for j in range(100):
+            pipe.set(f"key:{i}:{j}", value)
+            pipe.get(f"key:{i}:{j}")
+        assert await pipe.execute() == [True, value] * 100
+        await c.aclose()
+
+    await asyncio.gather(*(pipe_sets(i) for i in range(20)))
+
+    # Connects within the cooldown, so it does not read from the ring.
+    client = df_server.client()
+    await client.ping()
+    assert (await client.info("STATS"))["connection_recv_provided_exhausted"] > 0
+
+    await asyncio.sleep(0.2)  # let the closed pipelined connections finish their reads
+    calls = await recv_provided_calls(client)
+    assert await recv_provided_calls(client) == calls
+    await client.aclose()
+
+    # After the cooldown, new connections read from the ring again.
+    await asyncio.sleep(2.5)
+    client = df_server.client()
+    await client.ping()
+    calls = await recv_provided_calls(client)
+    assert await recv_provided_calls(client) > calls
+    await client.aclose()